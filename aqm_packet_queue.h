@@ -0,0 +1,475 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+#include "latency_histogram.h"
+#include "mpmc_packet_queue.h"
+
+// How an AqmPacketQueue sheds load before the ring is full
+//   TailDrop - none: enqueue fails only when the ring is full
+//   Red      - Random Early Detection on enqueue, driven by the average
+//              occupancy
+//   CoDel    - Controlled Delay (RFC 8289) on dequeue, driven by how long
+//              each packet waited
+enum class AqmAlgorithm : uint8_t {
+    TailDrop,
+    Red,
+    CoDel
+};
+
+// RED thresholds for one PacketPriority, in packets of average occupancy.
+// Below min_threshold nothing is dropped. The drop probability then rises
+// linearly to max_probability at max_threshold, and above it every packet
+// of this priority is dropped. max_threshold = 0 picks a default from the
+// capacity, higher for higher priorities.
+struct RedProfile {
+    size_t min_threshold = 0;
+    size_t max_threshold = 0;
+    double max_probability = 0.1;
+};
+
+struct AqmConfig {
+    static constexpr size_t PRIORITY_COUNT = static_cast<size_t>(PacketPriority::Control) + 1;
+
+    size_t capacity = 1024;
+    AqmAlgorithm algorithm = AqmAlgorithm::CoDel;
+
+    // RED: each sample moves the average by 1/2^red_weight_shift of its
+    // distance, i.e. w_q = 2^-9 by default. Control packets use no profile.
+    unsigned red_weight_shift = 9;
+    std::array<RedProfile, PRIORITY_COUNT> red{};
+
+    // CoDel: acceptable standing delay, and how long it may be exceeded
+    // before dropping starts
+    std::chrono::nanoseconds codel_target = std::chrono::milliseconds(5);
+    std::chrono::nanoseconds codel_interval = std::chrono::milliseconds(100);
+
+    StatsMode stats_mode = StatsMode::Disabled;
+};
+
+// Packets shed by the AQM layer, by cause
+struct AqmDropStats {
+    uint64_t red_drops = 0;    // Early drops on enqueue
+    uint64_t codel_drops = 0;  // Drops on dequeue
+    uint64_t tail_drops = 0;   // Ring full
+};
+
+namespace detail {
+
+// Ring element: the packet and, under CoDel, its enqueue time
+struct AqmEntry {
+    Packet packet;
+    uint64_t enqueued = 0;
+};
+
+// Per-thread xorshift64* stream for RED's drop decisions
+inline uint32_t aqm_random() noexcept {
+    thread_local uint64_t state = 0;
+    if (state == 0) {
+        state = reinterpret_cast<uintptr_t>(&state) ^ 0x9e3779b97f4a7c15ull;
+    }
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    return static_cast<uint32_t>((state * 0x2545f4914f6cdd1dull) >> 32);
+}
+
+} // namespace detail
+
+// Active queue management over an MPMC ring.
+//
+// Red decides at enqueue time from an exponentially weighted average of
+// the ring's approx_size() hint. The average is one relaxed word; racing
+// producers may lose each other's updates, which only slows it down
+// slightly. Each priority has its own thresholds (weighted RED).
+//
+// CoDel stamps packets on enqueue and decides at dequeue time. Its state
+// machine is shared by all consumers through atomics. Once in the dropping
+// state, the consumer that wins the CAS on the next drop time drops one
+// packet, so the drop rate follows CoDel's control law however many
+// consumers there are.
+//
+// Control packets are never dropped early; they are lost only when the
+// ring is physically full. For FQ-CoDel-style per-flow isolation, use a
+// FlowShardedQueue<AqmPacketQueue>, which keeps one CoDel instance per
+// flow bucket.
+template <typename Clock = SteadyLatencyClock>
+class BasicAqmPacketQueue {
+private:
+    static constexpr uint64_t FIXED_ONE = uint64_t(1) << 16;  // RED average scale
+    static constexpr size_t BATCH_CHUNK = 64;
+
+    // One priority's RED profile in fixed-point average units
+    struct RedLimits {
+        uint64_t min_average = 0;
+        uint64_t max_average = 0;
+        double probability_per_unit = 0.0;  // 2^32-scaled drop chance per unit above min
+        bool enabled = false;
+    };
+
+    struct alignas(CACHE_LINE_SIZE) CoDelState {
+        std::atomic<uint64_t> first_above{0};  // When the delay may first count as standing; 0 = below target
+        std::atomic<uint64_t> drop_next{0};
+        std::atomic<uint32_t> count{0};        // Drops in the current dropping state
+        std::atomic<uint32_t> last_count{0};
+        std::atomic<bool> dropping{false};
+    };
+
+    struct alignas(CACHE_LINE_SIZE) DropCounters {
+        std::atomic<uint64_t> red{0};
+        std::atomic<uint64_t> codel{0};
+        std::atomic<uint64_t> tail{0};
+    };
+
+    BasicMPMCQueue<detail::AqmEntry> ring_;
+    const AqmAlgorithm algorithm_;
+    const unsigned red_weight_shift_;
+    std::array<RedLimits, AqmConfig::PRIORITY_COUNT> red_;
+    const uint64_t target_ns_;
+    const uint64_t interval_ns_;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> red_average_{0};
+    CoDelState codel_;
+    DropCounters drops_;
+
+    static uint64_t now_ns() noexcept {
+        return Clock::to_ns(Clock::now());
+    }
+
+    static bool exempt(const Packet& packet) noexcept {
+        return packet.priority == PacketPriority::Control;
+    }
+
+    static RedProfile default_profile(size_t capacity, PacketPriority priority) noexcept {
+        RedProfile profile;
+        switch (priority) {
+        case PacketPriority::Low:
+            profile.min_threshold = capacity / 8;
+            profile.max_threshold = capacity / 2;
+            break;
+        case PacketPriority::Medium:
+            profile.min_threshold = capacity / 4;
+            profile.max_threshold = capacity * 5 / 8;
+            break;
+        default:
+            profile.min_threshold = capacity * 3 / 8;
+            profile.max_threshold = capacity * 3 / 4;
+            profile.max_probability = 0.05;
+            break;
+        }
+        return profile;
+    }
+
+    void configure_red(const AqmConfig& config) {
+        if (config.red_weight_shift == 0 || config.red_weight_shift > 16) {
+            throw std::invalid_argument("red_weight_shift must be in [1, 16]");
+        }
+        for (size_t i = 0; i < AqmConfig::PRIORITY_COUNT; ++i) {
+            auto priority = static_cast<PacketPriority>(i);
+            if (priority == PacketPriority::Control) continue;
+
+            RedProfile profile = config.red[i];
+            if (profile.max_threshold == 0) profile = default_profile(ring_.capacity(), priority);
+            if (profile.min_threshold >= profile.max_threshold) {
+                throw std::invalid_argument("RED min_threshold must be below max_threshold");
+            }
+            if (!(profile.max_probability >= 0.0 && profile.max_probability <= 1.0)) {
+                throw std::invalid_argument("RED max_probability must be in [0, 1]");
+            }
+
+            RedLimits& limits = red_[i];
+            limits.min_average = profile.min_threshold * FIXED_ONE;
+            limits.max_average = profile.max_threshold * FIXED_ONE;
+            limits.probability_per_unit = profile.max_probability * 4294967296.0 /
+                static_cast<double>(limits.max_average - limits.min_average);
+            limits.enabled = true;
+        }
+    }
+
+    // Fold the current occupancy into the average and decide for packet
+    bool red_drop(const Packet& packet) noexcept {
+        const RedLimits& limits = red_[static_cast<size_t>(packet.priority) % AqmConfig::PRIORITY_COUNT];
+        if (!limits.enabled) return false;
+
+        auto sample = static_cast<int64_t>(ring_.approx_size() * FIXED_ONE);
+        auto average = static_cast<int64_t>(red_average_.load(std::memory_order_relaxed));
+        average += (sample - average) / (int64_t(1) << red_weight_shift_);
+        red_average_.store(static_cast<uint64_t>(average), std::memory_order_relaxed);
+
+        auto avg = static_cast<uint64_t>(average);
+        if (avg < limits.min_average) return false;
+        if (avg >= limits.max_average) return true;
+        double threshold = static_cast<double>(avg - limits.min_average) * limits.probability_per_unit;
+        return static_cast<double>(detail::aqm_random()) < threshold;
+    }
+
+    uint64_t control_law(uint64_t t, uint32_t count) const noexcept {
+        return t + static_cast<uint64_t>(static_cast<double>(interval_ns_) / std::sqrt(static_cast<double>(count)));
+    }
+
+    // CoDel verdict for an entry just taken off the ring at now
+    bool codel_drop(const detail::AqmEntry& entry, uint64_t now) noexcept {
+        if (exempt(entry.packet)) return false;
+
+        uint64_t sojourn = now > entry.enqueued ? now - entry.enqueued : 0;
+        if (sojourn < target_ns_ || ring_.empty()) {
+            // Below target, or nothing queued behind it: leave the dropping state
+            if (codel_.first_above.load(std::memory_order_relaxed) != 0) {
+                codel_.first_above.store(0, std::memory_order_relaxed);
+            }
+            if (codel_.dropping.load(std::memory_order_relaxed)) {
+                codel_.dropping.store(false, std::memory_order_relaxed);
+            }
+            return false;
+        }
+
+        uint64_t first_above = codel_.first_above.load(std::memory_order_relaxed);
+        if (first_above == 0) {
+            codel_.first_above.compare_exchange_strong(first_above, now + interval_ns_,
+                                                       std::memory_order_relaxed);
+            return false;
+        }
+        if (now < first_above) return false;
+
+        // Delay has stood above target for a whole interval
+        if (!codel_.dropping.load(std::memory_order_acquire)) {
+            if (codel_.dropping.exchange(true, std::memory_order_acq_rel)) return false;
+
+            // This consumer enters the dropping state. Resume near the
+            // previous drop rate if that state ended recently.
+            uint32_t count = codel_.count.load(std::memory_order_relaxed);
+            uint32_t delta = count - codel_.last_count.load(std::memory_order_relaxed);
+            uint32_t next = 1;
+            if (delta > 1 && now - codel_.drop_next.load(std::memory_order_relaxed) < 16 * interval_ns_) {
+                next = delta;
+            }
+            codel_.count.store(next, std::memory_order_relaxed);
+            codel_.last_count.store(next, std::memory_order_relaxed);
+            codel_.drop_next.store(control_law(now, next), std::memory_order_release);
+            return true;
+        }
+
+        uint64_t drop_next = codel_.drop_next.load(std::memory_order_acquire);
+        if (now < drop_next) return false;
+        uint32_t count = codel_.count.load(std::memory_order_relaxed) + 1;
+        if (!codel_.drop_next.compare_exchange_strong(drop_next, control_law(drop_next, count),
+                                                      std::memory_order_acq_rel)) {
+            return false;  // Another consumer took this drop
+        }
+        codel_.count.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    detail::AqmEntry make_entry(Packet&& packet) const noexcept {
+        detail::AqmEntry entry;
+        entry.packet = std::move(packet);
+        if (algorithm_ == AqmAlgorithm::CoDel) entry.enqueued = now_ns();
+        return entry;
+    }
+
+    // Packet is moved from only on success
+    bool admit(Packet& packet) noexcept {
+        if (algorithm_ == AqmAlgorithm::Red && !exempt(packet) && red_drop(packet)) {
+            drops_.red.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        detail::AqmEntry entry = make_entry(std::move(packet));
+        if (ring_.enqueue(std::move(entry))) return true;
+
+        packet = std::move(entry.packet);
+        drops_.tail.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+public:
+    explicit BasicAqmPacketQueue(const AqmConfig& config = AqmConfig())
+        : ring_(config.capacity, config.stats_mode),
+          algorithm_(config.algorithm),
+          red_weight_shift_(config.red_weight_shift),
+          target_ns_(static_cast<uint64_t>(config.codel_target.count())),
+          interval_ns_(static_cast<uint64_t>(config.codel_interval.count())) {
+
+        if (algorithm_ == AqmAlgorithm::Red) configure_red(config);
+        if (algorithm_ == AqmAlgorithm::CoDel &&
+            (config.codel_target.count() <= 0 || config.codel_interval <= config.codel_target)) {
+            throw std::invalid_argument("CoDel needs 0 < codel_target < codel_interval");
+        }
+    }
+
+    // CoDel with the RFC 8289 defaults, e.g. as a FlowShardedQueue shard
+    BasicAqmPacketQueue(size_t capacity, StatsMode stats_mode)
+        : BasicAqmPacketQueue([&] {
+              AqmConfig config;
+              config.capacity = capacity;
+              config.stats_mode = stats_mode;
+              return config;
+          }()) {}
+
+    // Deleted copy/move operations due to atomics and const members
+    BasicAqmPacketQueue(const BasicAqmPacketQueue&) = delete;
+    BasicAqmPacketQueue& operator=(const BasicAqmPacketQueue&) = delete;
+    BasicAqmPacketQueue(BasicAqmPacketQueue&&) = delete;
+    BasicAqmPacketQueue& operator=(BasicAqmPacketQueue&&) = delete;
+
+    // false if RED dropped the packet or the ring is full
+    bool enqueue(const Packet& packet) noexcept {
+        Packet copy = packet;
+        return admit(copy);
+    }
+
+    // packet is only moved from on success
+    bool enqueue(Packet&& packet) noexcept {
+        return admit(packet);
+    }
+
+    // Enqueue a burst, deciding for each packet. Under RED the accepted
+    // packets need not be a prefix; pass accepted to learn which were
+    // taken. Packets beyond accepted's size are not sent. Otherwise they
+    // are the accepted prefix, as with the ring: the burst stops at the
+    // first packet the ring rejects, and only the packets offered to the
+    // ring count as tail drops.
+    size_t enqueue_batch(my_std::span<const Packet> packets, my_std::span<bool> accepted = {}) noexcept {
+        if (!accepted.empty()) packets = packets.first(std::min(packets.size(), accepted.size()));
+        std::array<detail::AqmEntry, BATCH_CHUNK> entries;
+        std::array<uint8_t, BATCH_CHUNK> origin;
+        const bool red = algorithm_ == AqmAlgorithm::Red;
+        const uint64_t now = algorithm_ == AqmAlgorithm::CoDel ? now_ns() : 0;
+        size_t total = 0;
+
+        for (size_t base = 0; base < packets.size(); base += BATCH_CHUNK) {
+            const size_t n = std::min(BATCH_CHUNK, packets.size() - base);
+            size_t kept = 0;
+            for (size_t i = 0; i < n; ++i) {
+                const Packet& packet = packets[base + i];
+                if (!accepted.empty()) accepted[base + i] = false;
+                if (red && !exempt(packet) && red_drop(packet)) {
+                    drops_.red.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                entries[kept].packet = packet;
+                entries[kept].enqueued = now;
+                origin[kept++] = static_cast<uint8_t>(i);
+            }
+
+            size_t taken = ring_.enqueue_batch_move(my_std::span<detail::AqmEntry>(entries.data(), kept));
+            if (!accepted.empty()) {
+                for (size_t k = 0; k < taken; ++k) accepted[base + origin[k]] = true;
+            }
+            if (taken != kept) drops_.tail.fetch_add(kept - taken, std::memory_order_relaxed);
+            total += taken;
+
+            // Room a consumer frees later must not let packets in behind
+            // the ones just dropped
+            if (!red && taken != kept) {
+                for (size_t i = base + n; i < accepted.size(); ++i) accepted[i] = false;
+                break;
+            }
+        }
+        return total;
+    }
+
+    // Dequeue the next packet CoDel lets through. Dropped packets are
+    // handed to on_drop(Packet&&) so their buffers can be released.
+    template <typename OnDrop>
+    std::optional<Packet> dequeue(OnDrop&& on_drop) noexcept {
+        const bool codel = algorithm_ == AqmAlgorithm::CoDel;
+        const uint64_t now = codel ? now_ns() : 0;
+        while (auto entry = ring_.dequeue()) {
+            if (!codel || !codel_drop(*entry, now)) return std::move(entry->packet);
+            drops_.codel.fetch_add(1, std::memory_order_relaxed);
+            on_drop(std::move(entry->packet));
+        }
+        return std::nullopt;
+    }
+
+    std::optional<Packet> dequeue() noexcept {
+        return dequeue([](Packet&&) {});
+    }
+
+    // Fill packets with up to packets.size() survivors, consuming ring
+    // entries in place
+    template <typename OnDrop>
+    size_t dequeue_batch(my_std::span<Packet> packets, OnDrop&& on_drop) noexcept {
+        const bool codel = algorithm_ == AqmAlgorithm::CoDel;
+        const uint64_t now = codel ? now_ns() : 0;
+        size_t count = 0;
+        while (count < packets.size()) {
+            size_t consumed = ring_.consume_batch(packets.size() - count, [&](detail::AqmEntry& entry) {
+                if (codel && codel_drop(entry, now)) {
+                    drops_.codel.fetch_add(1, std::memory_order_relaxed);
+                    on_drop(std::move(entry.packet));
+                } else {
+                    packets[count++] = std::move(entry.packet);
+                }
+            });
+            if (consumed == 0) break;
+        }
+        return count;
+    }
+
+    size_t dequeue_batch(my_std::span<Packet> packets) noexcept {
+        return dequeue_batch(packets, [](Packet&&) {});
+    }
+
+    AqmAlgorithm algorithm() const noexcept {
+        return algorithm_;
+    }
+
+    // RED's average occupancy, in packets
+    double red_average() const noexcept {
+        return static_cast<double>(red_average_.load(std::memory_order_relaxed)) / FIXED_ONE;
+    }
+
+    // Whether CoDel is currently dropping
+    bool codel_dropping() const noexcept {
+        return codel_.dropping.load(std::memory_order_relaxed);
+    }
+
+    AqmDropStats drop_stats() const noexcept {
+        AqmDropStats stats;
+        stats.red_drops = drops_.red.load(std::memory_order_relaxed);
+        stats.codel_drops = drops_.codel.load(std::memory_order_relaxed);
+        stats.tail_drops = drops_.tail.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    void reset_drop_stats() noexcept {
+        drops_.red.store(0, std::memory_order_relaxed);
+        drops_.codel.store(0, std::memory_order_relaxed);
+        drops_.tail.store(0, std::memory_order_relaxed);
+    }
+
+    // Queue state queries
+    size_t size() const noexcept {
+        return ring_.size();
+    }
+
+    size_t capacity() const noexcept {
+        return ring_.capacity();
+    }
+
+    bool empty() const noexcept {
+        return ring_.empty();
+    }
+
+    // Ring counters; a RED drop never reaches the ring, a CoDel drop counts
+    // as a successful dequeue there
+    QueueStatsSnapshot stats_snapshot() const noexcept {
+        return ring_.stats_snapshot();
+    }
+
+    size_t memory_usage() const noexcept {
+        return sizeof(*this) - sizeof(ring_) + ring_.memory_usage();
+    }
+};
+
+using AqmPacketQueue = BasicAqmPacketQueue<>;
@@ -0,0 +1,211 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+#include <algorithm>
+#include "aqm_packet_queue.h"
+#include "flow_sharded_queue.h"
+
+namespace {
+
+// Time advanced by hand, in nanoseconds
+struct ManualClock {
+    static inline std::atomic<uint64_t> ticks{1};
+
+    static uint64_t now() noexcept { return ticks.load(); }
+    static uint64_t to_ns(uint64_t t) noexcept { return t; }
+    static void advance(std::chrono::nanoseconds by) { ticks.fetch_add(static_cast<uint64_t>(by.count())); }
+};
+
+using ManualAqmQueue = BasicAqmPacketQueue<ManualClock>;
+
+Packet with_priority(size_t id, PacketPriority priority) {
+    return Packet(nullptr, 0, priority, id);
+}
+
+AqmConfig codel_config(size_t capacity) {
+    AqmConfig config;
+    config.capacity = capacity;
+    config.algorithm = AqmAlgorithm::CoDel;
+    config.codel_target = std::chrono::milliseconds(5);
+    config.codel_interval = std::chrono::milliseconds(100);
+    return config;
+}
+
+} // namespace
+
+TEST(AqmPacketQueueTest, ConfigValidation) {
+    AqmConfig red;
+    red.algorithm = AqmAlgorithm::Red;
+    red.red[0] = {64, 32, 0.1};
+    EXPECT_THROW(AqmPacketQueue{red}, std::invalid_argument);
+    red.red[0] = {16, 32, 1.5};
+    EXPECT_THROW(AqmPacketQueue{red}, std::invalid_argument);
+    red.red[0] = {16, 32, 0.5};
+    red.red_weight_shift = 0;
+    EXPECT_THROW(AqmPacketQueue{red}, std::invalid_argument);
+
+    AqmConfig codel;
+    codel.codel_interval = codel.codel_target;
+    EXPECT_THROW(AqmPacketQueue{codel}, std::invalid_argument);
+    EXPECT_NO_THROW(AqmPacketQueue(64, StatsMode::Disabled));
+}
+
+TEST(AqmPacketQueueTest, TailDropOnlyWhenFull) {
+    AqmConfig config;
+    config.capacity = 8;
+    config.algorithm = AqmAlgorithm::TailDrop;
+    AqmPacketQueue queue(config);
+
+    for (size_t i = 0; i < 8; ++i) EXPECT_TRUE(queue.enqueue(Packet(i)));
+    Packet extra(99);
+    EXPECT_FALSE(queue.enqueue(std::move(extra)));
+    EXPECT_EQ(extra.id, 99);  // Not moved from on failure
+    EXPECT_EQ(queue.drop_stats().tail_drops, 1);
+
+    for (size_t i = 0; i < 8; ++i) EXPECT_EQ(queue.dequeue()->id, i);
+    EXPECT_FALSE(queue.dequeue().has_value());
+}
+
+TEST(AqmPacketQueueTest, BatchStopsAtFirstTailDrop) {
+    AqmConfig config;
+    config.capacity = 128;
+    config.algorithm = AqmAlgorithm::TailDrop;
+    AqmPacketQueue queue(config);
+    for (size_t i = 0; i < 100; ++i) ASSERT_TRUE(queue.enqueue(Packet(i)));
+
+    // Several chunks against 28 free slots: only a prefix goes in, and the
+    // chunks after the full one are not offered to the ring
+    std::vector<Packet> burst;
+    for (size_t i = 0; i < 200; ++i) burst.emplace_back(1000 + i);
+    std::vector<char> flags(burst.size(), 1);
+    my_std::span<bool> accepted(reinterpret_cast<bool*>(flags.data()), flags.size());
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst), accepted), 28);
+    for (size_t i = 0; i < burst.size(); ++i) EXPECT_EQ(accepted[i], i < 28);
+    EXPECT_EQ(queue.drop_stats().tail_drops, 64 - 28);
+    EXPECT_EQ(queue.size(), 128);
+
+    // A short accepted span limits the burst
+    while (queue.dequeue()) {}
+    bool three[3];
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst), my_std::span<bool>(three, 3)), 3);
+    EXPECT_EQ(queue.size(), 3);
+    EXPECT_TRUE(three[0] && three[1] && three[2]);
+}
+
+TEST(AqmPacketQueueTest, RedDropsEarlyByPriority) {
+    AqmConfig config;
+    config.capacity = 1024;
+    config.algorithm = AqmAlgorithm::Red;
+    config.red_weight_shift = 1;  // Track occupancy closely
+    config.red[static_cast<size_t>(PacketPriority::Low)] = {32, 96, 0.5};
+    AqmPacketQueue queue(config);
+
+    size_t accepted = 0;
+    for (size_t i = 0; i < 1000; ++i) {
+        if (queue.enqueue(with_priority(i, PacketPriority::Low))) ++accepted;
+    }
+    // Low traffic is shed long before the ring fills
+    EXPECT_GE(accepted, 32);
+    EXPECT_LT(accepted, 300);
+    AqmDropStats drops = queue.drop_stats();
+    EXPECT_EQ(drops.red_drops, 1000 - accepted);
+    EXPECT_EQ(drops.tail_drops, 0);
+    EXPECT_GT(queue.red_average(), 32.0);
+
+    // High has the default, higher thresholds; Control is never shed
+    for (size_t i = 0; i < 50; ++i) {
+        EXPECT_TRUE(queue.enqueue(with_priority(2000 + i, PacketPriority::High)));
+    }
+    for (size_t i = 0; i < 100; ++i) {
+        EXPECT_TRUE(queue.enqueue(with_priority(3000 + i, PacketPriority::Control)));
+    }
+    EXPECT_EQ(queue.size(), accepted + 150);
+
+    // Batches decide per packet and report which were taken
+    std::vector<Packet> burst;
+    for (size_t i = 0; i < 20; ++i) {
+        burst.push_back(with_priority(4000 + i, i % 2 ? PacketPriority::Control : PacketPriority::Low));
+    }
+    std::vector<char> flags(burst.size());
+    my_std::span<bool> accepted_flags(reinterpret_cast<bool*>(flags.data()), flags.size());
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst), accepted_flags), 10);
+    for (size_t i = 0; i < burst.size(); ++i) EXPECT_EQ(accepted_flags[i], i % 2 == 1);
+}
+
+TEST(AqmPacketQueueTest, CoDelDropsStandingQueue) {
+    ManualAqmQueue queue(codel_config(1024));
+    for (size_t i = 0; i < 200; ++i) {
+        EXPECT_TRUE(queue.enqueue(with_priority(i, i % 50 == 49 ? PacketPriority::Control : PacketPriority::Low)));
+    }
+
+    // Over target, but not yet for a whole interval
+    ManualClock::advance(std::chrono::milliseconds(10));
+    EXPECT_EQ(queue.dequeue()->id, 0);
+    ManualClock::advance(std::chrono::milliseconds(50));
+    EXPECT_EQ(queue.dequeue()->id, 1);
+    EXPECT_FALSE(queue.codel_dropping());
+
+    // A full interval above target: drop one and enter the dropping state
+    std::vector<size_t> dropped;
+    auto on_drop = [&](Packet&& p) { dropped.push_back(p.id); };
+    ManualClock::advance(std::chrono::milliseconds(60));
+    EXPECT_EQ(queue.dequeue(on_drop)->id, 3);
+    EXPECT_EQ(dropped, std::vector<size_t>{2});
+    EXPECT_TRUE(queue.codel_dropping());
+    EXPECT_EQ(queue.dequeue(on_drop)->id, 4);  // Next drop is an interval away
+
+    // The next drops come interval / sqrt(count) apart
+    ManualClock::advance(std::chrono::milliseconds(100));
+    EXPECT_EQ(queue.dequeue(on_drop)->id, 6);
+    ManualClock::advance(std::chrono::milliseconds(60));
+    EXPECT_EQ(queue.dequeue(on_drop)->id, 7);
+    ManualClock::advance(std::chrono::milliseconds(15));
+    EXPECT_EQ(queue.dequeue(on_drop)->id, 9);
+    EXPECT_EQ(dropped, (std::vector<size_t>{2, 5, 8}));
+    EXPECT_EQ(queue.drop_stats().codel_drops, 3);
+
+    // Control packets pass even while dropping
+    ManualClock::advance(std::chrono::milliseconds(500));
+    std::vector<Packet> burst(16);
+    size_t before = dropped.size();
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(burst), on_drop), 16);
+    EXPECT_GT(dropped.size(), before);
+    std::vector<size_t> delivered;
+    for (const Packet& p : burst) delivered.push_back(p.id);
+    while (auto p = queue.dequeue(on_drop)) {
+        delivered.push_back(p->id);
+        ManualClock::advance(std::chrono::milliseconds(30));
+    }
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(7 + delivered.size() + dropped.size(), 200);  // Nothing lost besides the drops
+    for (size_t id : {49, 99, 149, 199}) {
+        EXPECT_NE(std::find(delivered.begin(), delivered.end(), id), delivered.end());
+        EXPECT_EQ(std::find(dropped.begin(), dropped.end(), id), dropped.end());
+    }
+
+    // A short queue again: below target leaves the dropping state
+    EXPECT_TRUE(queue.enqueue(Packet(700)));
+    EXPECT_TRUE(queue.enqueue(Packet(701)));
+    ManualClock::advance(std::chrono::milliseconds(1));
+    EXPECT_EQ(queue.dequeue(on_drop)->id, 700);
+    EXPECT_FALSE(queue.codel_dropping());
+}
+
+TEST(AqmPacketQueueTest, PerFlowCoDelThroughFlowSharding) {
+    FlowShardedQueueConfig config;
+    config.shard_count = 4;
+    config.shard_capacity = 64;
+    FlowShardedQueue<AqmPacketQueue> queue(config);
+
+    std::vector<Packet> burst;
+    for (size_t i = 0; i < 32; ++i) burst.emplace_back(i);
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst)), 32);
+
+    size_t total = 0;
+    for (size_t s = 0; s < queue.shard_count(); ++s) {
+        while (queue.dequeue(s).has_value()) ++total;
+        EXPECT_EQ(queue.shard(s).drop_stats().codel_drops, 0);
+    }
+    EXPECT_EQ(total, 32);
+}
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+
+#include "mpmc_packet_queue.h"
+
+// MPMC ring in the style of DPDK's rte_ring, tuned for bursts.
+//
+// Producers and consumers each have a head/tail pair. A batch reserves its
+// range with one CAS on its side's head, copies packets without looking at
+// any per-slot state, then publishes by moving its side's tail forward once
+// every earlier batch has done so. A burst of N costs two shared atomics
+// instead of N slot-sequence loads, and the ring holds bare Packets instead
+// of cache-line slots.
+//
+// The trade-off is that publication is in reservation order: a preempted
+// thread delays the tail update of the batches reserved after it (though
+// not their copies). Use MPMC_PacketQueue when single-packet operations
+// dominate.
+class MPMC_BulkPacketQueue {
+private:
+    // Head and tail of one side share a line, as in rte_ring
+    struct alignas(CACHE_LINE_SIZE) HeadTail {
+        std::atomic<size_t> head{0};
+        std::atomic<size_t> tail{0};
+    };
+
+    // Spin briefly on the predecessor's tail update, then start yielding
+    static constexpr int SPINS_BEFORE_YIELD = 64;
+
+    const size_t capacity_;
+    const size_t mask_;
+
+    alignas(CACHE_LINE_SIZE) std::unique_ptr<Packet[]> ring_;
+    HeadTail prod_;
+    HeadTail cons_;
+
+    // Statistics (optional, can be disabled for performance)
+    QueueStatsCollector stats_;
+
+    // Reserve up to n entries on one side. The other side's tail plus
+    // limit_offset bounds how far self.head may move: cons_.tail + capacity
+    // for producers, prod_.tail for consumers. Returns the old head and sets
+    // n to the reserved count, which may be 0.
+    size_t reserve(HeadTail& self, const HeadTail& other, size_t limit_offset,
+                   size_t& n) noexcept {
+        size_t old_head = self.head.load(std::memory_order_relaxed);
+        while (true) {
+            // Acquire pairs with the other side's tail release, so our
+            // copies cannot start before its copies of this range are done.
+            size_t other_tail = other.tail.load(std::memory_order_acquire);
+            size_t available = other_tail + limit_offset - old_head;
+            size_t count = std::min(n, available);
+            if (count == 0) {
+                n = 0;
+                return old_head;
+            }
+            if (self.head.compare_exchange_weak(old_head, old_head + count,
+                                                std::memory_order_relaxed,
+                                                std::memory_order_relaxed)) {
+                n = count;
+                return old_head;
+            }
+            record_stat(&QueueStats::contention_events);
+        }
+    }
+
+    // Publish [old_head, old_head + n) once earlier reservations are published.
+    // The acquire load pairs with the earlier publisher's release store, so
+    // our release of the tail also carries its slot writes to the other side.
+    void publish(HeadTail& self, size_t old_head, size_t n) noexcept {
+        int spins = 0;
+        while (self.tail.load(std::memory_order_acquire) != old_head) {
+            if (spins < SPINS_BEFORE_YIELD) {
+                cpu_relax();
+                ++spins;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        self.tail.store(old_head + n, std::memory_order_release);
+    }
+
+    void record_stat(std::atomic<uint64_t> QueueStats::*counter) noexcept {
+        stats_.record(counter);
+    }
+
+    template <typename Source>
+    size_t enqueue_n(size_t n, Source&& source) noexcept {
+        size_t head = reserve(prod_, cons_, capacity_, n);
+        if (n == 0) return 0;
+
+        for (size_t i = 0; i < n; ++i) {
+            ring_[(head + i) & mask_] = source(i);
+        }
+        publish(prod_, head, n);
+        return n;
+    }
+
+public:
+    explicit MPMC_BulkPacketQueue(size_t capacity, bool enable_stats = false)
+        : MPMC_BulkPacketQueue(capacity, enable_stats ? StatsMode::Shared : StatsMode::Disabled) {}
+
+    MPMC_BulkPacketQueue(size_t capacity, StatsMode stats_mode)
+        : capacity_(round_up_to_power_of_two(capacity)),
+          mask_(capacity_ - 1),
+          ring_(std::make_unique<Packet[]>(capacity_)),
+          stats_(stats_mode) {
+
+        if (capacity == 0) {
+            throw std::invalid_argument("Capacity must be greater than 0");
+        }
+
+        if (capacity_ > (SIZE_MAX >> 1)) {
+            throw std::invalid_argument("Capacity too large");
+        }
+    }
+
+    // Deleted copy/move operations due to atomics and const members
+    MPMC_BulkPacketQueue(const MPMC_BulkPacketQueue&) = delete;
+    MPMC_BulkPacketQueue& operator=(const MPMC_BulkPacketQueue&) = delete;
+    MPMC_BulkPacketQueue(MPMC_BulkPacketQueue&&) = delete;
+    MPMC_BulkPacketQueue& operator=(MPMC_BulkPacketQueue&&) = delete;
+
+    ~MPMC_BulkPacketQueue() = default;
+
+    bool enqueue(const Packet& packet) noexcept {
+        record_stat(&QueueStats::enqueue_attempts);
+        if (enqueue_n(1, [&](size_t) -> const Packet& { return packet; }) == 0) {
+            return false;
+        }
+        record_stat(&QueueStats::enqueue_successes);
+        return true;
+    }
+
+    bool enqueue(Packet&& packet) noexcept {
+        record_stat(&QueueStats::enqueue_attempts);
+        if (enqueue_n(1, [&](size_t) -> Packet&& { return std::move(packet); }) == 0) {
+            return false;
+        }
+        record_stat(&QueueStats::enqueue_successes);
+        return true;
+    }
+
+    std::optional<Packet> dequeue() noexcept {
+        record_stat(&QueueStats::dequeue_attempts);
+
+        size_t n = 1;
+        size_t head = reserve(cons_, prod_, 0, n);
+        if (n == 0) return std::nullopt;
+
+        Packet packet = std::move(ring_[head & mask_]);
+        publish(cons_, head, 1);
+        record_stat(&QueueStats::dequeue_successes);
+        return packet;
+    }
+
+    // Enqueue as many packets as fit, with one reservation and one publish
+    size_t enqueue_batch(my_std::span<const Packet> packets) noexcept {
+        if (packets.empty()) return 0;
+        record_stat(&QueueStats::batch_enqueues);
+        return enqueue_n(packets.size(), [&](size_t i) -> const Packet& { return packets[i]; });
+    }
+
+    // As enqueue_batch, moving the accepted prefix out of packets
+    size_t enqueue_batch_move(my_std::span<Packet> packets) noexcept {
+        if (packets.empty()) return 0;
+        record_stat(&QueueStats::batch_enqueues);
+        return enqueue_n(packets.size(), [&](size_t i) -> Packet&& { return std::move(packets[i]); });
+    }
+
+    // Dequeue as many packets as are published, with one reservation and
+    // one publish
+    size_t dequeue_batch(my_std::span<Packet> packets) noexcept {
+        if (packets.empty()) return 0;
+        record_stat(&QueueStats::batch_dequeues);
+
+        size_t n = packets.size();
+        size_t head = reserve(cons_, prod_, 0, n);
+        if (n == 0) return 0;
+
+        for (size_t i = 0; i < n; ++i) {
+            packets[i] = std::move(ring_[(head + i) & mask_]);
+        }
+        publish(cons_, head, n);
+        return n;
+    }
+
+    // Non-blocking variants; every operation here already returns
+    // immediately on full/empty.
+    bool try_enqueue(const Packet& packet) noexcept {
+        return enqueue_n(1, [&](size_t) -> const Packet& { return packet; }) != 0;
+    }
+
+    bool try_enqueue(Packet&& packet) noexcept {
+        return enqueue_n(1, [&](size_t) -> Packet&& { return std::move(packet); }) != 0;
+    }
+
+    std::optional<Packet> try_dequeue() noexcept {
+        size_t n = 1;
+        size_t head = reserve(cons_, prod_, 0, n);
+        if (n == 0) return std::nullopt;
+
+        Packet packet = std::move(ring_[head & mask_]);
+        publish(cons_, head, 1);
+        return packet;
+    }
+
+    // Queue state queries
+    size_t size() const noexcept {
+        size_t cons_tail = cons_.tail.load(std::memory_order_acquire);
+        size_t prod_tail = prod_.tail.load(std::memory_order_acquire);
+        // The two loads are not atomic together; clamp a torn read
+        return std::min(prod_tail - cons_tail, capacity_);
+    }
+
+    size_t capacity() const noexcept {
+        return capacity_;
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    bool full() const noexcept {
+        return size() >= capacity_;
+    }
+
+    // Statistics access
+    StatsMode stats_mode() const noexcept {
+        return stats_.mode();
+    }
+
+    const QueueStats& get_stats() const noexcept {
+        return stats_.get();
+    }
+
+    QueueStatsSnapshot stats_snapshot() const noexcept {
+        return stats_.snapshot();
+    }
+
+    void reset_stats() noexcept {
+        stats_.reset();
+    }
+
+    // Memory usage estimation
+    size_t memory_usage() const noexcept {
+        return sizeof(*this) + (capacity_ * sizeof(Packet)) + stats_.memory_usage();
+    }
+};
@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <set>
+#include "bulk_packet_queue.h"
+
+TEST(MPMC_BulkPacketQueueTest, BasicEnqueueDequeue) {
+    MPMC_BulkPacketQueue queue(8);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.capacity(), 8);
+
+    EXPECT_TRUE(queue.enqueue(Packet(42)));
+    Packet moved(43);
+    EXPECT_TRUE(queue.enqueue(std::move(moved)));
+    EXPECT_EQ(queue.size(), 2);
+
+    auto packet = queue.dequeue();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->id, 42);
+    packet = queue.try_dequeue();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->id, 43);
+    EXPECT_FALSE(queue.dequeue().has_value());
+
+    EXPECT_THROW(MPMC_BulkPacketQueue invalid(0), std::invalid_argument);
+}
+
+TEST(MPMC_BulkPacketQueueTest, FullQueue) {
+    MPMC_BulkPacketQueue queue(4);
+    for (size_t i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.try_enqueue(Packet(i)));
+    }
+    EXPECT_TRUE(queue.full());
+    EXPECT_FALSE(queue.enqueue(Packet(99)));
+
+    EXPECT_TRUE(queue.dequeue().has_value());
+    EXPECT_TRUE(queue.enqueue(Packet(99)));
+}
+
+TEST(MPMC_BulkPacketQueueTest, PartialBatchesAndWrapAround) {
+    MPMC_BulkPacketQueue queue(8);
+    std::vector<Packet> burst;
+    for (size_t i = 0; i < 12; ++i) {
+        burst.emplace_back(i);
+    }
+
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst)), 8);
+
+    std::vector<Packet> out(5);
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(out)), 5);
+    for (size_t i = 0; i < 5; ++i) {
+        EXPECT_EQ(out[i].id, i);
+    }
+
+    // This batch wraps past the end of the ring
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst).subspan(8)), 4);
+    EXPECT_EQ(queue.size(), 7);
+
+    std::vector<Packet> rest(16);
+    ASSERT_EQ(queue.dequeue_batch(my_std::span<Packet>(rest)), 7);
+    for (size_t i = 0; i < 7; ++i) {
+        EXPECT_EQ(rest[i].id, i + 5);
+    }
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(MPMC_BulkPacketQueueTest, MovingEnqueue) {
+    MPMC_BulkPacketQueue queue(4);
+    uint8_t buffer[6][16];
+    std::vector<Packet> burst;
+    for (size_t i = 0; i < 6; ++i) {
+        burst.emplace_back(buffer[i], 16, PacketPriority::Low, i);
+    }
+
+    // The accepted prefix is moved from; the rest keeps its buffers
+    EXPECT_EQ(queue.enqueue_batch_move(my_std::span<Packet>(burst)), 4);
+    EXPECT_EQ(burst[3].data, nullptr);
+    EXPECT_EQ(burst[4].data, buffer[4]);
+    EXPECT_FALSE(queue.try_enqueue(std::move(burst[4])));
+    EXPECT_EQ(burst[4].data, buffer[4]);
+
+    auto packet = queue.dequeue();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->data, buffer[0]);
+    EXPECT_TRUE(queue.try_enqueue(std::move(burst[4])));
+    EXPECT_EQ(burst[4].data, nullptr);
+}
+
+TEST(MPMC_BulkPacketQueueTest, StatisticsModes) {
+    MPMC_BulkPacketQueue queue(8, StatsMode::PerThread);
+    EXPECT_TRUE(queue.enqueue(Packet(1)));
+    EXPECT_TRUE(queue.dequeue().has_value());
+    EXPECT_FALSE(queue.dequeue().has_value());
+
+    std::vector<Packet> burst(3);
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst)), 3);
+
+    QueueStatsSnapshot stats = queue.stats_snapshot();
+    EXPECT_EQ(stats.enqueue_successes, 1);
+    EXPECT_EQ(stats.dequeue_attempts, 2);
+    EXPECT_EQ(stats.dequeue_successes, 1);
+    EXPECT_EQ(stats.batch_enqueues, 1);
+}
+
+TEST(MPMC_BulkPacketQueueTest, MultiThreadedBursts) {
+    constexpr size_t num_producers = 4;
+    constexpr size_t num_consumers = 4;
+    constexpr size_t bursts_per_producer = 500;
+    constexpr size_t burst_size = 32;
+    constexpr size_t total_packets = num_producers * bursts_per_producer * burst_size;
+
+    MPMC_BulkPacketQueue queue(256);
+    std::atomic<size_t> consumed{0};
+    std::vector<std::vector<size_t>> seen(num_consumers);
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < num_producers; ++p) {
+        threads.emplace_back([&, p]() {
+            std::vector<Packet> burst(burst_size);
+            for (size_t b = 0; b < bursts_per_producer; ++b) {
+                for (size_t i = 0; i < burst_size; ++i) {
+                    burst[i] = Packet((p * bursts_per_producer + b) * burst_size + i);
+                }
+                size_t sent = 0;
+                while (sent < burst_size) {
+                    sent += queue.enqueue_batch(my_std::span<const Packet>(burst).subspan(sent));
+                    if (sent < burst_size) std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (size_t c = 0; c < num_consumers; ++c) {
+        threads.emplace_back([&, c]() {
+            std::vector<Packet> batch(burst_size);
+            while (consumed.load() < total_packets) {
+                size_t n = queue.dequeue_batch(my_std::span<Packet>(batch));
+                for (size_t i = 0; i < n; ++i) {
+                    seen[c].push_back(batch[i].id);
+                }
+                consumed.fetch_add(n);
+                if (n == 0) std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    std::set<size_t> all;
+    for (const auto& ids : seen) {
+        for (size_t id : ids) {
+            EXPECT_TRUE(all.insert(id).second) << "Packet " << id << " consumed multiple times";
+        }
+    }
+    EXPECT_EQ(all.size(), total_packets);
+    EXPECT_TRUE(queue.empty());
+}
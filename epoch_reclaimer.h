@@ -0,0 +1,334 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "mpmc_packet_queue.h"
+#include "packet_buffer_pool.h"
+#include "thread_index.h"
+
+// Bulk free callbacks for BasicEpochReclaimer. One call covers every payload
+// sealed under the same epoch.
+struct DeletePayloads {
+    void operator()(my_std::span<uint8_t* const> payloads) const noexcept {
+        for (uint8_t* data : payloads) delete[] data;
+    }
+};
+
+struct PoolPayloads {
+    PacketBufferPool* pool = nullptr;
+
+    void operator()(my_std::span<uint8_t* const> payloads) const noexcept {
+        for (uint8_t* data : payloads) pool->free(data);
+    }
+};
+
+// Quiescent-state reclamation for Packet::data buffers that are fanned out
+// to several queues (mirroring, TAP), so that no per-packet reference count
+// is needed.
+//
+// The producer enqueues the same payload to every queue and then retires
+// it once. Retired payloads collect in a per-thread bag; every bag_size
+// retires the bag is sealed under a fresh epoch, one atomic increment per
+// bag. Each consumer registers a Reader and dequeues through it. Once per
+// dequeue_batch the reader announces the newest epoch it has passed, with a
+// single store to its own cache line, and a sealed bag is handed to Free in
+// one call once every registered reader has passed its epoch.
+//
+// References held inside queues count as well as references a consumer is
+// working on. A reader therefore only passes an epoch after its queue has
+// been seen empty since it read that epoch, and it only announces it at the
+// next dequeue_batch, when the previous batch has been processed. Payloads
+// must not be used after the reader's next dequeue_batch or quiescent()
+// call. A consumer whose queue never empties holds back reclamation, so
+// retired payloads then build up in the limbo bags.
+//
+// Readers must be registered before payloads they may see are retired, and
+// a thread that drains several queues needs one reader per queue. Bags are
+// owned by the ThreadIndex of the retiring thread and are freed on its later
+// retire, collect() or flush() calls; threads beyond ThreadIndex::MAX_THREADS
+// share one bag under a mutex. Call flush() before a retiring thread exits.
+template <typename Free = DeletePayloads>
+class BasicEpochReclaimer {
+public:
+    static constexpr size_t DEFAULT_MAX_READERS = 64;
+    static constexpr size_t DEFAULT_BAG_SIZE = 64;
+
+private:
+    // Announced epoch of a reader that holds nothing back
+    static constexpr uint64_t IDLE = UINT64_MAX;
+
+    struct alignas(CACHE_LINE_SIZE) ReaderSlot {
+        std::atomic<uint64_t> epoch{IDLE};
+        std::atomic<bool> used{false};
+    };
+
+    struct Bag {
+        uint64_t epoch;
+        std::vector<uint8_t*> payloads;
+    };
+
+    // Owned by one thread index at a time, except the shared overflow bag
+    struct alignas(CACHE_LINE_SIZE) Limbo {
+        std::vector<uint8_t*> open;
+        std::deque<Bag> sealed;
+        std::vector<uint8_t*> spare;
+    };
+
+    const size_t max_readers_;
+    const size_t bag_size_;
+    Free free_;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> epoch_{1};
+    std::atomic<size_t> reader_limit_{0};  // One past the highest slot ever used
+    std::atomic<size_t> pending_{0};
+    std::unique_ptr<ReaderSlot[]> readers_;
+    std::unique_ptr<Limbo[]> limbos_;
+    std::mutex overflow_mutex_;
+
+    static size_t validate_readers(size_t max_readers) {
+        if (max_readers == 0) {
+            throw std::invalid_argument("Reader count must be greater than 0");
+        }
+        return max_readers;
+    }
+
+    static size_t validate_bag_size(size_t bag_size) {
+        if (bag_size == 0) {
+            throw std::invalid_argument("Bag size must be greater than 0");
+        }
+        return bag_size;
+    }
+
+    template <typename F>
+    void with_limbo(F&& fn) {
+        size_t index = ThreadIndex::get();
+        if (index < ThreadIndex::MAX_THREADS) {
+            fn(limbos_[index]);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(overflow_mutex_);
+        fn(limbos_[ThreadIndex::MAX_THREADS]);
+    }
+
+    // The increment orders every enqueue of the bag's payloads before any
+    // reader that sees the new epoch looks at its queue
+    void seal(Limbo& limbo) {
+        if (limbo.open.empty()) return;
+        uint64_t epoch = epoch_.fetch_add(1, std::memory_order_acq_rel) + 1;
+        pending_.fetch_add(limbo.open.size(), std::memory_order_relaxed);
+        limbo.sealed.push_back(Bag{epoch, std::move(limbo.open)});
+        limbo.open = std::move(limbo.spare);
+        limbo.open.clear();
+        limbo.open.reserve(bag_size_);
+        limbo.spare = std::vector<uint8_t*>();
+    }
+
+    size_t collect(Limbo& limbo) noexcept {
+        if (limbo.sealed.empty()) return 0;
+        const uint64_t safe = safe_epoch();
+        size_t freed = 0;
+        while (!limbo.sealed.empty() && limbo.sealed.front().epoch <= safe) {
+            std::vector<uint8_t*>& payloads = limbo.sealed.front().payloads;
+            free_(my_std::span<uint8_t* const>(payloads.data(), payloads.size()));
+            freed += payloads.size();
+            payloads.clear();
+            if (limbo.spare.capacity() < payloads.capacity()) limbo.spare.swap(payloads);
+            limbo.sealed.pop_front();
+        }
+        pending_.fetch_sub(freed, std::memory_order_relaxed);
+        return freed;
+    }
+
+public:
+    // Consumer-side handle. Move-only; unregisters when destroyed.
+    class Reader {
+    private:
+        BasicEpochReclaimer* owner_ = nullptr;
+        ReaderSlot* slot_ = nullptr;
+        uint64_t passed_ = 0;
+        uint64_t announced_ = 0;
+
+        friend class BasicEpochReclaimer;
+
+        Reader(BasicEpochReclaimer* owner, ReaderSlot* slot) noexcept
+            : owner_(owner), slot_(slot) {}
+
+    public:
+        Reader() = default;
+
+        Reader(Reader&& other) noexcept
+            : owner_(other.owner_), slot_(other.slot_),
+              passed_(other.passed_), announced_(other.announced_) {
+            other.owner_ = nullptr;
+            other.slot_ = nullptr;
+        }
+
+        Reader& operator=(Reader&& other) noexcept {
+            if (this != &other) {
+                release();
+                owner_ = other.owner_;
+                slot_ = other.slot_;
+                passed_ = other.passed_;
+                announced_ = other.announced_;
+                other.owner_ = nullptr;
+                other.slot_ = nullptr;
+            }
+            return *this;
+        }
+
+        Reader(const Reader&) = delete;
+        Reader& operator=(const Reader&) = delete;
+
+        ~Reader() { release(); }
+
+        explicit operator bool() const noexcept { return slot_ != nullptr; }
+
+        // Dequeue up to items.size() elements from queue, which is anything
+        // with dequeue_batch(my_std::span<T>) and empty(). First announces
+        // what the previous batch passed; payloads it returned must no
+        // longer be in use.
+        template <typename Queue, typename T>
+        size_t dequeue_batch(Queue& queue, my_std::span<T> items) noexcept {
+            quiescent();
+            const uint64_t epoch = owner_->epoch_.load(std::memory_order_acquire);
+            size_t count = queue.dequeue_batch(items);
+            // A full batch seldom drains the queue, so it skips the extra
+            // look at the producers' index
+            if (count < items.size() && queue.empty()) passed_ = epoch;
+            return count;
+        }
+
+        // Announce now rather than at the next dequeue_batch, e.g. before a
+        // consumer blocks. Nothing from earlier batches may still be in use.
+        void quiescent() noexcept {
+            if (passed_ != announced_) {
+                slot_->epoch.store(passed_, std::memory_order_release);
+                announced_ = passed_;
+            }
+        }
+
+        uint64_t announced_epoch() const noexcept { return announced_; }
+
+        // Unregister; the reader no longer holds anything back
+        void release() noexcept {
+            if (slot_ == nullptr) return;
+            slot_->epoch.store(IDLE, std::memory_order_release);
+            slot_->used.store(false, std::memory_order_release);
+            owner_ = nullptr;
+            slot_ = nullptr;
+        }
+    };
+
+    explicit BasicEpochReclaimer(size_t max_readers = DEFAULT_MAX_READERS,
+                                 size_t bag_size = DEFAULT_BAG_SIZE,
+                                 Free free = Free())
+        : max_readers_(validate_readers(max_readers)),
+          bag_size_(validate_bag_size(bag_size)),
+          free_(std::move(free)),
+          readers_(std::make_unique<ReaderSlot[]>(max_readers_)),
+          limbos_(std::make_unique<Limbo[]>(ThreadIndex::MAX_THREADS + 1)) {}
+
+    // Deleted copy/move operations; readers point back at the reclaimer
+    BasicEpochReclaimer(const BasicEpochReclaimer&) = delete;
+    BasicEpochReclaimer& operator=(const BasicEpochReclaimer&) = delete;
+    BasicEpochReclaimer(BasicEpochReclaimer&&) = delete;
+    BasicEpochReclaimer& operator=(BasicEpochReclaimer&&) = delete;
+
+    // All readers must be gone; every payload still retired is freed
+    ~BasicEpochReclaimer() {
+        for (size_t i = 0; i <= ThreadIndex::MAX_THREADS; ++i) {
+            Limbo& limbo = limbos_[i];
+            for (Bag& bag : limbo.sealed) {
+                free_(my_std::span<uint8_t* const>(bag.payloads.data(), bag.payloads.size()));
+            }
+            free_(my_std::span<uint8_t* const>(limbo.open.data(), limbo.open.size()));
+        }
+    }
+
+    // Throws std::length_error once max_readers readers are registered
+    Reader register_reader() {
+        for (size_t i = 0; i < max_readers_; ++i) {
+            bool used = false;
+            if (readers_[i].used.load(std::memory_order_relaxed) ||
+                !readers_[i].used.compare_exchange_strong(used, true, std::memory_order_acq_rel)) {
+                continue;
+            }
+            // Holds everything back until its queue is first seen empty
+            readers_[i].epoch.store(0, std::memory_order_seq_cst);
+            size_t limit = reader_limit_.load(std::memory_order_relaxed);
+            while (limit <= i &&
+                   !reader_limit_.compare_exchange_weak(limit, i + 1, std::memory_order_release,
+                                                        std::memory_order_relaxed)) {
+            }
+            return Reader(this, &readers_[i]);
+        }
+        throw std::length_error("Too many epoch readers");
+    }
+
+    // Hand over a payload that has been enqueued everywhere it is going.
+    // It is freed once every reader has drained its queue and moved on.
+    void retire(uint8_t* data) {
+        if (data == nullptr) return;
+        with_limbo([&](Limbo& limbo) {
+            limbo.open.push_back(data);
+            if (limbo.open.size() >= bag_size_) {
+                seal(limbo);
+                collect(limbo);
+            }
+        });
+    }
+
+    void retire(Packet& packet) {
+        retire(packet.data);
+        packet.data = nullptr;
+    }
+
+    // Free the calling thread's sealed bags that every reader has passed;
+    // returns how many payloads were freed
+    size_t collect() noexcept {
+        size_t freed = 0;
+        with_limbo([&](Limbo& limbo) { freed = collect(limbo); });
+        return freed;
+    }
+
+    // Seal the calling thread's open bag, then collect
+    size_t flush() {
+        size_t freed = 0;
+        with_limbo([&](Limbo& limbo) {
+            seal(limbo);
+            freed = collect(limbo);
+        });
+        return freed;
+    }
+
+    // Oldest epoch some reader may still depend on; bags sealed at or
+    // before it can be freed
+    uint64_t safe_epoch() const noexcept {
+        uint64_t safe = IDLE;
+        const size_t limit = reader_limit_.load(std::memory_order_acquire);
+        for (size_t i = 0; i < limit; ++i) {
+            safe = std::min(safe, readers_[i].epoch.load(std::memory_order_acquire));
+        }
+        return safe;
+    }
+
+    uint64_t epoch() const noexcept { return epoch_.load(std::memory_order_relaxed); }
+
+    // Payloads in sealed bags that are not freed yet; open bags excluded
+    size_t pending() const noexcept { return pending_.load(std::memory_order_relaxed); }
+
+    size_t max_readers() const noexcept { return max_readers_; }
+    size_t bag_size() const noexcept { return bag_size_; }
+};
+
+using EpochReclaimer = BasicEpochReclaimer<>;
+using PoolEpochReclaimer = BasicEpochReclaimer<PoolPayloads>;
@@ -0,0 +1,231 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include "epoch_reclaimer.h"
+
+namespace {
+
+constexpr uint8_t POISON = 0xdd;
+
+// Records bulk frees and poisons the payloads instead of deleting them, so
+// a payload freed too early shows up as a poisoned read
+struct Graveyard {
+    std::vector<uint8_t*> freed;
+    size_t calls = 0;
+
+    ~Graveyard() {
+        for (uint8_t* data : freed) delete[] data;
+    }
+};
+
+struct BuryPayloads {
+    Graveyard* graveyard = nullptr;
+
+    void operator()(my_std::span<uint8_t* const> payloads) const noexcept {
+        if (payloads.empty()) return;
+        ++graveyard->calls;
+        for (uint8_t* data : payloads) {
+            *data = POISON;
+            graveyard->freed.push_back(data);
+        }
+    }
+};
+
+using TestReclaimer = BasicEpochReclaimer<BuryPayloads>;
+
+uint8_t* make_payload(uint8_t value) {
+    uint8_t* data = new uint8_t[8];
+    std::memset(data, value, 8);
+    return data;
+}
+
+// Send one payload to every queue, then retire it
+void mirror(std::vector<MPMC_PacketQueue*> queues, TestReclaimer& reclaimer, size_t id) {
+    Packet packet(make_payload(static_cast<uint8_t>(id % 128)), 8, PacketPriority::Low, id);
+    for (MPMC_PacketQueue* queue : queues) ASSERT_TRUE(queue->enqueue(packet));
+    reclaimer.retire(packet);
+}
+
+} // namespace
+
+TEST(EpochReclaimerTest, ConfigAndRegistration) {
+    EXPECT_THROW(EpochReclaimer(0), std::invalid_argument);
+    EXPECT_THROW(EpochReclaimer(4, 0), std::invalid_argument);
+
+    EpochReclaimer reclaimer(2);
+    EpochReclaimer::Reader a = reclaimer.register_reader();
+    EpochReclaimer::Reader b = reclaimer.register_reader();
+    EXPECT_TRUE(a);
+    EXPECT_THROW(reclaimer.register_reader(), std::length_error);
+
+    // A released slot is handed out again; moved-from handles are empty
+    b.release();
+    EXPECT_FALSE(b);
+    EpochReclaimer::Reader c = reclaimer.register_reader();
+    EpochReclaimer::Reader d = std::move(c);
+    EXPECT_FALSE(c);
+    EXPECT_TRUE(d);
+
+    // Registered readers hold everything back until they first drain
+    EXPECT_EQ(reclaimer.safe_epoch(), 0);
+}
+
+TEST(EpochReclaimerTest, FreesInBulkOnceEveryMirrorDrains) {
+    Graveyard graveyard;
+    TestReclaimer reclaimer(4, 8, BuryPayloads{&graveyard});
+    MPMC_PacketQueue tap_a(64), tap_b(64);
+    TestReclaimer::Reader reader_a = reclaimer.register_reader();
+    TestReclaimer::Reader reader_b = reclaimer.register_reader();
+
+    for (size_t i = 0; i < 20; ++i) mirror({&tap_a, &tap_b}, reclaimer, i);
+    reclaimer.flush();
+    EXPECT_EQ(reclaimer.pending(), 20);  // Two full bags and a partial one
+    EXPECT_TRUE(graveyard.freed.empty());
+
+    // A drains its tap; the drain is announced with the next batch
+    std::vector<Packet> batch(32);
+    EXPECT_EQ(reader_a.dequeue_batch(tap_a, my_std::span<Packet>(batch)), 20);
+    EXPECT_EQ(reader_a.announced_epoch(), 0);
+    EXPECT_EQ(reader_a.dequeue_batch(tap_a, my_std::span<Packet>(batch)), 0);
+    EXPECT_GE(reader_a.announced_epoch(), reclaimer.epoch());
+    EXPECT_EQ(reclaimer.collect(), 0);  // B still has all of them queued
+
+    // B takes full batches: the packets left in its tap keep the bags alive
+    std::vector<Packet> small(8);
+    EXPECT_EQ(reader_b.dequeue_batch(tap_b, my_std::span<Packet>(small)), 8);
+    EXPECT_EQ(reader_b.dequeue_batch(tap_b, my_std::span<Packet>(small)), 8);
+    EXPECT_EQ(reclaimer.collect(), 0);
+    EXPECT_EQ(reader_b.dequeue_batch(tap_b, my_std::span<Packet>(small)), 4);
+    for (size_t i = 0; i < 4; ++i) EXPECT_EQ(*small[i].data, static_cast<uint8_t>(16 + i));
+    EXPECT_EQ(reclaimer.collect(), 0);  // The last batch is still being processed
+
+    reader_b.quiescent();
+    EXPECT_EQ(reclaimer.collect(), 20);
+    EXPECT_EQ(graveyard.calls, 3);  // One call per bag
+    EXPECT_EQ(reclaimer.pending(), 0);
+}
+
+TEST(EpochReclaimerTest, IdleAndDepartedReadersDoNotBlock) {
+    Graveyard graveyard;
+    TestReclaimer reclaimer(4, 4, BuryPayloads{&graveyard});
+    MPMC_PacketQueue tap(16), unused(16);
+    TestReclaimer::Reader active = reclaimer.register_reader();
+    TestReclaimer::Reader idle = reclaimer.register_reader();
+    TestReclaimer::Reader leaving = reclaimer.register_reader();
+
+    for (size_t i = 0; i < 4; ++i) mirror({&tap}, reclaimer, i);
+    EXPECT_EQ(reclaimer.pending(), 4);  // Sealed by the fourth retire
+
+    // Polling an empty queue passes every epoch
+    std::vector<Packet> batch(8);
+    for (int round = 0; round < 2; ++round) {
+        active.dequeue_batch(tap, my_std::span<Packet>(batch));
+        idle.dequeue_batch(unused, my_std::span<Packet>(batch));
+    }
+    EXPECT_EQ(reclaimer.collect(), 0);
+    leaving.release();
+    EXPECT_EQ(reclaimer.collect(), 4);
+
+    // A retire that seals a bag also frees what has become safe
+    for (size_t i = 4; i < 8; ++i) mirror({&tap}, reclaimer, i);
+    for (int round = 0; round < 2; ++round) {
+        active.dequeue_batch(tap, my_std::span<Packet>(batch));
+        idle.dequeue_batch(unused, my_std::span<Packet>(batch));
+    }
+    for (size_t i = 8; i < 12; ++i) mirror({&tap}, reclaimer, i);
+    EXPECT_EQ(graveyard.freed.size(), 8);
+    EXPECT_EQ(reclaimer.pending(), 4);
+}
+
+TEST(EpochReclaimerTest, ReturnsPoolBuffers) {
+    PacketBufferPool pool(32, 256, 0);
+    MPMC_PacketQueue tap_a(64), tap_b(64);
+    {
+        PoolEpochReclaimer reclaimer(2, 16, PoolPayloads{&pool});
+        PoolEpochReclaimer::Reader reader_a = reclaimer.register_reader();
+        PoolEpochReclaimer::Reader reader_b = reclaimer.register_reader();
+
+        for (size_t i = 0; i < 32; ++i) {
+            Packet packet(pool.allocate_raw(), 64, PacketPriority::Low, i);
+            ASSERT_NE(packet.data, nullptr);
+            tap_a.enqueue(packet);
+            tap_b.enqueue(packet);
+            reclaimer.retire(packet);
+        }
+        EXPECT_EQ(pool.available(), 0);
+
+        std::vector<Packet> batch(64);
+        for (int round = 0; round < 2; ++round) {
+            reader_a.dequeue_batch(tap_a, my_std::span<Packet>(batch));
+            reader_b.dequeue_batch(tap_b, my_std::span<Packet>(batch));
+        }
+        EXPECT_EQ(reclaimer.collect(), 32);
+        EXPECT_EQ(pool.available(), 32);
+
+        // Whatever is still retired goes back when the reclaimer is destroyed
+        reclaimer.retire(pool.allocate_raw());
+        reader_a.release();
+        reader_b.release();
+    }
+    EXPECT_EQ(pool.available(), 32);
+}
+
+TEST(EpochReclaimerTest, ConcurrentMirrorNeverSeesFreedPayload) {
+    constexpr size_t MIRRORS = 3;
+    constexpr size_t PACKETS = 20000;
+
+    Graveyard graveyard;
+    TestReclaimer reclaimer(MIRRORS, 32, BuryPayloads{&graveyard});
+    std::vector<std::unique_ptr<MPMC_PacketQueue>> taps;
+    std::vector<MPMC_PacketQueue*> targets;
+    std::vector<TestReclaimer::Reader> readers;
+    for (size_t m = 0; m < MIRRORS; ++m) {
+        taps.push_back(std::make_unique<MPMC_PacketQueue>(256));
+        targets.push_back(taps.back().get());
+        readers.push_back(reclaimer.register_reader());
+    }
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> poisoned{0};
+    std::vector<size_t> received(MIRRORS, 0);
+    std::vector<std::thread> consumers;
+    for (size_t m = 0; m < MIRRORS; ++m) {
+        consumers.emplace_back([&, m]() {
+            std::vector<Packet> batch(16);
+            while (true) {
+                bool finished = done.load();
+                size_t n = readers[m].dequeue_batch(*taps[m], my_std::span<Packet>(batch));
+                for (size_t i = 0; i < n; ++i) {
+                    if (batch[i].data[0] != static_cast<uint8_t>(batch[i].id % 128)) {
+                        poisoned.fetch_add(1);
+                    }
+                }
+                received[m] += n;
+                if (n == 0 && finished) break;
+                if (n == 0) std::this_thread::yield();
+            }
+            readers[m].quiescent();
+        });
+    }
+
+    // Only the producer thread frees, so the graveyard needs no locking
+    for (size_t i = 0; i < PACKETS; ++i) {
+        Packet packet(make_payload(static_cast<uint8_t>(i % 128)), 8, PacketPriority::Low, i);
+        for (MPMC_PacketQueue* tap : targets) {
+            while (!tap->enqueue(packet)) std::this_thread::yield();
+        }
+        reclaimer.retire(packet);
+    }
+    done.store(true);
+    for (auto& t : consumers) t.join();
+
+    EXPECT_EQ(poisoned.load(), 0);
+    for (size_t m = 0; m < MIRRORS; ++m) EXPECT_EQ(received[m], PACKETS);
+    reclaimer.flush();
+    for (auto& reader : readers) reader.release();
+    reclaimer.collect();
+    EXPECT_EQ(reclaimer.pending(), 0);
+    EXPECT_EQ(graveyard.freed.size(), PACKETS);
+}
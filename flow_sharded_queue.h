@@ -0,0 +1,309 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "mpmc_packet_queue.h"
+
+// How FlowShardedQueue maps a flow key to a shard.
+//   Multiplicative - Fibonacci hashing; one multiply, good spread for
+//                    sequential or structured keys
+//   Toeplitz       - the RSS hash NICs use, so software steering can agree
+//                    with hardware queue selection given the same key
+enum class FlowHash : uint8_t {
+    Multiplicative,
+    Toeplitz
+};
+
+struct FlowShardedQueueConfig {
+    size_t shard_count = 1;
+    size_t shard_capacity = 1024;
+    FlowHash hash = FlowHash::Multiplicative;
+
+    // Default flow key: (Packet::id >> flow_id_shift) & flow_id_mask
+    unsigned flow_id_shift = 0;
+    uint64_t flow_id_mask = ~uint64_t(0);
+
+    // Toeplitz secret; the default is the well-known Microsoft RSS key
+    std::array<uint8_t, 40> toeplitz_key{
+        0x6d, 0x5a, 0x56, 0xda, 0x25, 0x5b, 0x0e, 0xc2,
+        0x41, 0x67, 0x25, 0x3d, 0x43, 0xa3, 0x8f, 0xb0,
+        0xd0, 0xca, 0x2b, 0xcb, 0xae, 0x7b, 0x30, 0xb4,
+        0x77, 0xcb, 0x2d, 0xa3, 0x80, 0x30, 0xf2, 0x0c,
+        0x6a, 0x42, 0xb7, 0x3b, 0xbe, 0xac, 0x01, 0xfa};
+
+    StatsMode stats_mode = StatsMode::Disabled;
+};
+
+// Hash-steered set of queue shards that keeps every flow on one shard.
+//
+// All packets with the same flow key land on the same shard, and each shard
+// is meant to have a single consumer, so per-flow order is preserved end to
+// end and shards never contend with each other. The default shard type is
+// MPSC (any number of dispatchers, one consumer per shard); use
+// SPSC_PacketQueue when there is a single dispatcher.
+template <typename ShardQueue = MPSC_PacketQueue>
+class FlowShardedQueue {
+public:
+    static constexpr size_t MAX_SHARDS = 65535;
+
+private:
+    // Bursts are partitioned in chunks of this many packets on the stack
+    static constexpr size_t PARTITION_CHUNK = 64;
+
+    std::vector<std::unique_ptr<ShardQueue>> shards_;
+    const FlowHash hash_;
+    const unsigned flow_id_shift_;
+    const uint64_t flow_id_mask_;
+
+    // toeplitz_table_[byte][value]: contribution of one key byte, so the
+    // 64-bit key hashes with 8 lookups instead of 64 bit steps
+    std::unique_ptr<std::array<std::array<uint32_t, 256>, 8>> toeplitz_table_;
+
+    void build_toeplitz_table(const std::array<uint8_t, 40>& key) {
+        toeplitz_table_ = std::make_unique<std::array<std::array<uint32_t, 256>, 8>>();
+        for (size_t byte = 0; byte < 8; ++byte) {
+            for (size_t value = 0; value < 256; ++value) {
+                uint32_t result = 0;
+                for (size_t bit = 0; bit < 8; ++bit) {
+                    if ((value & (0x80u >> bit)) == 0) continue;
+                    // 32-bit window of the secret starting at this input bit
+                    size_t offset = byte * 8 + bit;
+                    uint64_t window = 0;
+                    for (size_t k = 0; k < 5; ++k) {
+                        window = (window << 8) | key[offset / 8 + k];
+                    }
+                    result ^= static_cast<uint32_t>(window >> (8 - offset % 8));
+                }
+                (*toeplitz_table_)[byte][value] = result;
+            }
+        }
+    }
+
+    uint32_t hash32(uint64_t key) const noexcept {
+        if (hash_ == FlowHash::Toeplitz) {
+            // Key bytes are taken most significant first, as on the wire
+            uint32_t result = 0;
+            for (size_t byte = 0; byte < 8; ++byte) {
+                result ^= (*toeplitz_table_)[byte][(key >> (56 - byte * 8)) & 0xff];
+            }
+            return result;
+        }
+        return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> 32);
+    }
+
+    template <typename KeyOf>
+    size_t enqueue_partitioned(my_std::span<const Packet> packets, KeyOf&& key_of,
+                               my_std::span<bool> accepted) noexcept {
+        if (!accepted.empty()) packets = packets.first(std::min(packets.size(), accepted.size()));
+        size_t total = 0;
+
+        // Shards that rejected a packet earlier in the burst, over all
+        // chunks: they get nothing more even if a consumer has made room
+        // since. Only cleared once some shard fills up.
+        std::array<uint64_t, (MAX_SHARDS + 63) / 64> closed;
+        bool any_closed = false;
+        auto is_closed = [&](size_t shard) {
+            return any_closed && (closed[shard / 64] >> (shard % 64) & 1) != 0;
+        };
+        auto close = [&](size_t shard) {
+            if (!any_closed) {
+                std::fill(closed.begin(), closed.begin() + (shards_.size() + 63) / 64, 0);
+                any_closed = true;
+            }
+            closed[shard / 64] |= uint64_t(1) << (shard % 64);
+        };
+
+        // Per chunk: the distinct shards seen (buckets), each packet's bucket,
+        // and the packets regrouped by bucket
+        std::array<uint16_t, PARTITION_CHUNK> bucket_shard;
+        std::array<uint8_t, PARTITION_CHUNK> bucket_of;
+        std::array<size_t, PARTITION_CHUNK + 1> bucket_start;
+        std::array<uint8_t, PARTITION_CHUNK> order;
+        std::array<Packet, PARTITION_CHUNK> sorted;
+
+        for (size_t base = 0; base < packets.size(); base += PARTITION_CHUNK) {
+            const size_t n = std::min(PARTITION_CHUNK, packets.size() - base);
+
+            // Hash each packet once and count packets per bucket. Bursts
+            // are usually runs of one flow, so the last bucket is tried first.
+            size_t buckets = 0, last = 0;
+            std::fill(bucket_start.begin(), bucket_start.end(), 0);
+            for (size_t i = 0; i < n; ++i) {
+                auto s = static_cast<uint16_t>(shard_for_key(key_of(base + i)));
+                size_t b = last;
+                if (buckets == 0 || bucket_shard[b] != s) {
+                    for (b = 0; b < buckets && bucket_shard[b] != s; ++b) {}
+                    if (b == buckets) bucket_shard[buckets++] = s;
+                }
+                bucket_of[i] = static_cast<uint8_t>(b);
+                ++bucket_start[b + 1];
+                last = b;
+            }
+
+            if (buckets == 1) {
+                // The whole chunk goes to one shard; no regrouping needed
+                size_t got = 0;
+                if (!is_closed(bucket_shard[0])) {
+                    got = shards_[bucket_shard[0]]->enqueue_batch(packets.subspan(base, n));
+                    if (got < n) close(bucket_shard[0]);
+                }
+                for (size_t i = 0; i < n && !accepted.empty(); ++i) accepted[base + i] = i < got;
+                total += got;
+                continue;
+            }
+
+            // Stable counting sort, so every flow keeps its order
+            for (size_t b = 0; b < buckets; ++b) bucket_start[b + 1] += bucket_start[b];
+            std::array<size_t, PARTITION_CHUNK> cursor;
+            std::copy(bucket_start.begin(), bucket_start.begin() + buckets, cursor.begin());
+            for (size_t i = 0; i < n; ++i) {
+                size_t pos = cursor[bucket_of[i]]++;
+                order[pos] = static_cast<uint8_t>(i);
+                sorted[pos] = packets[base + i];
+            }
+
+            for (size_t b = 0; b < buckets; ++b) {
+                size_t start = bucket_start[b], count = bucket_start[b + 1] - start;
+                size_t got = 0;
+                if (!is_closed(bucket_shard[b])) {
+                    got = shards_[bucket_shard[b]]->enqueue_batch(
+                        my_std::span<const Packet>(sorted.data() + start, count));
+                    if (got < count) close(bucket_shard[b]);
+                }
+                total += got;
+                if (!accepted.empty()) {
+                    for (size_t k = 0; k < count; ++k) accepted[base + order[start + k]] = k < got;
+                }
+            }
+        }
+        return total;
+    }
+
+public:
+    explicit FlowShardedQueue(const FlowShardedQueueConfig& config)
+        : hash_(config.hash),
+          flow_id_shift_(config.flow_id_shift),
+          flow_id_mask_(config.flow_id_mask) {
+        if (config.shard_count == 0 || config.shard_count > MAX_SHARDS) {
+            throw std::invalid_argument("Shard count must be between 1 and 65535");
+        }
+        if (config.flow_id_shift >= 64) {
+            throw std::invalid_argument("flow_id_shift must be less than 64");
+        }
+
+        shards_.reserve(config.shard_count);
+        for (size_t i = 0; i < config.shard_count; ++i) {
+            shards_.push_back(std::make_unique<ShardQueue>(config.shard_capacity, config.stats_mode));
+        }
+        if (hash_ == FlowHash::Toeplitz) {
+            build_toeplitz_table(config.toeplitz_key);
+        }
+    }
+
+    FlowShardedQueue(const FlowShardedQueue&) = delete;
+    FlowShardedQueue& operator=(const FlowShardedQueue&) = delete;
+    FlowShardedQueue(FlowShardedQueue&&) = delete;
+    FlowShardedQueue& operator=(FlowShardedQueue&&) = delete;
+
+    ~FlowShardedQueue() = default;
+
+    // Shard selection
+    size_t shard_for_key(uint64_t flow_key) const noexcept {
+        // Multiply-shift maps the 32-bit hash onto [0, shard_count)
+        return static_cast<size_t>((static_cast<uint64_t>(hash32(flow_key)) * shards_.size()) >> 32);
+    }
+
+    uint64_t flow_key(const Packet& packet) const noexcept {
+        return (static_cast<uint64_t>(packet.id) >> flow_id_shift_) & flow_id_mask_;
+    }
+
+    size_t shard_for(const Packet& packet) const noexcept {
+        return shard_for_key(flow_key(packet));
+    }
+
+    uint32_t hash(uint64_t flow_key) const noexcept {
+        return hash32(flow_key);
+    }
+
+    // Producer side; the flow key defaults to the configured Packet::id bits
+    bool enqueue(const Packet& packet) noexcept {
+        return shards_[shard_for(packet)]->enqueue(packet);
+    }
+
+    bool enqueue(Packet&& packet) noexcept {
+        ShardQueue& shard = *shards_[shard_for(packet)];
+        return shard.enqueue(std::move(packet));
+    }
+
+    bool enqueue(const Packet& packet, uint64_t flow_key) noexcept {
+        return shards_[shard_for_key(flow_key)]->enqueue(packet);
+    }
+
+    bool enqueue(Packet&& packet, uint64_t flow_key) noexcept {
+        return shards_[shard_for_key(flow_key)]->enqueue(std::move(packet));
+    }
+
+    // Partition a burst by shard and hand each shard its packets as one
+    // batch. If a shard fills up, it rejects the rest of that shard's
+    // packets in the burst, so a flow never gets a gap followed by later
+    // packets, even if its consumer makes room before the burst is done.
+    // accepted, if given, receives a per-packet result; packets beyond its
+    // size are not sent. Returns the number of packets enqueued.
+    size_t enqueue_batch(my_std::span<const Packet> packets,
+                         my_std::span<bool> accepted = {}) noexcept {
+        return enqueue_partitioned(packets, [&](size_t i) { return flow_key(packets[i]); },
+                                   accepted);
+    }
+
+    // As above with one explicit flow key per packet
+    size_t enqueue_batch(my_std::span<const Packet> packets, my_std::span<const uint64_t> keys,
+                         my_std::span<bool> accepted = {}) noexcept {
+        return enqueue_partitioned(packets.first(std::min(packets.size(), keys.size())),
+                                   [&](size_t i) { return keys[i]; }, accepted);
+    }
+
+    // Consumer side: one consumer per shard
+    std::optional<Packet> dequeue(size_t shard) noexcept {
+        return shards_[shard]->dequeue();
+    }
+
+    size_t dequeue_batch(size_t shard, my_std::span<Packet> packets) noexcept {
+        return shards_[shard]->dequeue_batch(packets);
+    }
+
+    ShardQueue& shard(size_t index) noexcept {
+        return *shards_[index];
+    }
+
+    const ShardQueue& shard(size_t index) const noexcept {
+        return *shards_[index];
+    }
+
+    // Queue state queries
+    size_t shard_count() const noexcept {
+        return shards_.size();
+    }
+
+    size_t size() const noexcept {
+        size_t total = 0;
+        for (const auto& shard : shards_) total += shard->size();
+        return total;
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    // Memory usage estimation
+    size_t memory_usage() const noexcept {
+        size_t total = sizeof(*this) + (toeplitz_table_ ? sizeof(*toeplitz_table_) : 0);
+        for (const auto& shard : shards_) total += shard->memory_usage();
+        return total;
+    }
+};
@@ -0,0 +1,289 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include "flow_sharded_queue.h"
+
+TEST(FlowShardedQueueTest, SameFlowSameShard) {
+    FlowShardedQueueConfig config;
+    config.shard_count = 8;
+    config.flow_id_shift = 16;  // Low 16 bits are a per-flow sequence number
+    FlowShardedQueue<> queue(config);
+
+    std::vector<size_t> per_shard(config.shard_count, 0);
+    for (size_t flow = 0; flow < 256; ++flow) {
+        size_t shard = queue.shard_for_key(flow);
+        ASSERT_LT(shard, config.shard_count);
+        ++per_shard[shard];
+        for (size_t seq = 0; seq < 4; ++seq) {
+            Packet packet((flow << 16) | seq);
+            EXPECT_EQ(queue.shard_for(packet), shard);
+            EXPECT_TRUE(queue.enqueue(packet));
+        }
+    }
+    EXPECT_EQ(queue.size(), 1024);
+
+    // Fibonacci hashing spreads sequential flow ids evenly
+    for (size_t count : per_shard) {
+        EXPECT_GT(count, 16);
+        EXPECT_LT(count, 48);
+    }
+
+    // Each shard sees its flows in order
+    for (size_t s = 0; s < queue.shard_count(); ++s) {
+        std::vector<size_t> next_seq(256, 0);
+        while (auto packet = queue.dequeue(s)) {
+            size_t flow = packet->id >> 16;
+            EXPECT_EQ(queue.shard_for_key(flow), s);
+            EXPECT_EQ(packet->id & 0xffff, next_seq[flow]++);
+        }
+    }
+    EXPECT_TRUE(queue.empty());
+
+    config.shard_count = 0;
+    EXPECT_THROW(FlowShardedQueue<>{config}, std::invalid_argument);
+}
+
+TEST(FlowShardedQueueTest, ToeplitzMatchesRssVector) {
+    FlowShardedQueueConfig config;
+    config.shard_count = 4;
+    config.hash = FlowHash::Toeplitz;
+    FlowShardedQueue<> queue(config);
+
+    // Microsoft RSS verification suite, IPv4 without ports:
+    // 66.9.149.187 -> 161.142.100.80 hashes to 0x323e8fc2
+    EXPECT_EQ(queue.hash(0x420995bba18e6450ull), 0x323e8fc2u);
+    // 199.92.111.2 -> 65.69.140.83
+    EXPECT_EQ(queue.hash(0xc75c6f0241458c53ull), 0xd718262au);
+
+    EXPECT_EQ(queue.shard_for_key(0x420995bba18e6450ull),
+              (uint64_t(0x323e8fc2u) * 4) >> 32);
+}
+
+TEST(FlowShardedQueueTest, BatchPartitionsByShard) {
+    FlowShardedQueueConfig config;
+    config.shard_count = 4;
+    config.shard_capacity = 32;
+    FlowShardedQueue<> queue(config);
+
+    // 200 packets over 10 flows, interleaved; some shards overflow
+    std::vector<Packet> burst;
+    std::vector<uint64_t> keys;
+    for (size_t i = 0; i < 200; ++i) {
+        burst.emplace_back(i);
+        keys.push_back(i % 10);
+    }
+
+    std::unique_ptr<bool[]> accepted(new bool[burst.size()]);
+    size_t enqueued = queue.enqueue_batch(my_std::span<const Packet>(burst),
+                                          my_std::span<const uint64_t>(keys),
+                                          my_std::span<bool>(accepted.get(), burst.size()));
+    EXPECT_EQ(enqueued, queue.size());
+    EXPECT_LE(enqueued, 4 * config.shard_capacity);
+
+    size_t flagged = 0;
+    for (size_t i = 0; i < burst.size(); ++i) flagged += accepted[i];
+    EXPECT_EQ(flagged, enqueued);
+
+    // Every shard holds an accepted prefix of each of its flows, in order
+    std::vector<Packet> out(64);
+    for (size_t s = 0; s < queue.shard_count(); ++s) {
+        size_t n = queue.dequeue_batch(s, my_std::span<Packet>(out));
+        std::vector<size_t> last(10, SIZE_MAX);
+        for (size_t i = 0; i < n; ++i) {
+            size_t flow = out[i].id % 10;
+            EXPECT_EQ(queue.shard_for_key(flow), s);
+            EXPECT_TRUE(accepted[out[i].id]);
+            if (last[flow] != SIZE_MAX) {
+                EXPECT_EQ(out[i].id, last[flow] + 10);
+            }
+            last[flow] = out[i].id;
+        }
+    }
+    for (size_t i = 0; i < burst.size(); ++i) {
+        if (!accepted[i] && i + 10 < burst.size()) {
+            EXPECT_FALSE(accepted[i + 10]);
+        }
+    }
+}
+
+// Shard whose consumer takes one packet before every batch it is given,
+// i.e. between the partition chunks of one burst
+struct DrainingShard : MPSC_PacketQueue {
+    using MPSC_PacketQueue::MPSC_PacketQueue;
+    std::vector<size_t> drained;
+
+    size_t enqueue_batch(my_std::span<const Packet> packets) noexcept {
+        if (auto packet = dequeue()) drained.push_back(packet->id);
+        return MPSC_PacketQueue::enqueue_batch(packets);
+    }
+};
+
+TEST(FlowShardedQueueTest, FullShardStaysClosedForRestOfBurst) {
+    FlowShardedQueueConfig config;
+    config.shard_count = 2;
+    config.shard_capacity = 8;
+    FlowShardedQueue<DrainingShard> queue(config);
+
+    // One flow over several chunks, then both flows interleaved
+    std::vector<Packet> burst;
+    std::vector<uint64_t> keys;
+    for (size_t i = 0; i < 300; ++i) {
+        burst.emplace_back(i);
+        keys.push_back(i < 150 ? 0 : i % 2);
+    }
+    std::unique_ptr<bool[]> accepted(new bool[burst.size()]);
+    size_t enqueued = queue.enqueue_batch(my_std::span<const Packet>(burst),
+                                          my_std::span<const uint64_t>(keys),
+                                          my_std::span<bool>(accepted.get(), burst.size()));
+
+    // Room freed by the consumer mid-burst is not used
+    bool rejected[2] = {false, false};
+    for (size_t i = 0; i < burst.size(); ++i) {
+        if (!accepted[i]) {
+            rejected[keys[i]] = true;
+        } else {
+            EXPECT_FALSE(rejected[keys[i]]) << "Gap before packet " << i;
+        }
+    }
+    size_t drained = 0;
+    for (size_t s = 0; s < queue.shard_count(); ++s) drained += queue.shard(s).drained.size();
+    EXPECT_EQ(enqueued, queue.size() + drained);
+    EXPECT_EQ(enqueued, 16);
+
+    // A short accepted span limits the burst
+    std::vector<Packet> out(8);
+    for (size_t s = 0; s < queue.shard_count(); ++s) queue.dequeue_batch(s, my_std::span<Packet>(out));
+    bool two[2];
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst), my_std::span<bool>(two, 2)), 2);
+    EXPECT_EQ(queue.size(), 2);
+}
+
+TEST(FlowShardedQueueTest, BurstsWhileConsumerDrains) {
+    constexpr size_t rounds = 50;
+    constexpr size_t burst_size = 4096;  // Many partition chunks
+
+    FlowShardedQueueConfig config;
+    config.shard_count = 2;
+    config.shard_capacity = 8;
+    FlowShardedQueue<> queue(config);
+    ASSERT_NE(queue.shard_for_key(0), queue.shard_for_key(1));
+
+    // Runs of 1000 packets per flow, so chunks go to one shard or to both
+    std::vector<Packet> burst(burst_size);
+    std::vector<uint64_t> keys(burst_size);
+    for (size_t i = 0; i < burst_size; ++i) keys[i] = (i / 1000) % 2;
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> consumed{0};
+    std::atomic<bool> ordered{true};
+    std::thread consumer([&]() {
+        std::vector<size_t> last(2, 0);
+        std::vector<Packet> out(4);
+        while (true) {
+            bool finished = done.load();
+            size_t drained = 0;
+            for (size_t s = 0; s < config.shard_count; ++s) {
+                size_t n = queue.dequeue_batch(s, my_std::span<Packet>(out));
+                for (size_t i = 0; i < n; ++i) {
+                    size_t flow = keys[out[i].id % burst_size];
+                    if (out[i].id + 1 <= last[flow]) ordered = false;
+                    last[flow] = out[i].id + 1;
+                }
+                drained += n;
+            }
+            consumed.fetch_add(drained);
+            if (finished && drained == 0) break;
+        }
+    });
+
+    size_t enqueued = 0;
+    std::unique_ptr<bool[]> accepted(new bool[burst_size]);
+    for (size_t round = 0; round < rounds; ++round) {
+        for (size_t i = 0; i < burst_size; ++i) burst[i] = Packet(round * burst_size + i);
+        enqueued += queue.enqueue_batch(my_std::span<const Packet>(burst),
+                                        my_std::span<const uint64_t>(keys),
+                                        my_std::span<bool>(accepted.get(), burst_size));
+
+        // Within a flow, nothing is accepted after a rejection
+        bool rejected[2] = {false, false};
+        for (size_t i = 0; i < burst_size; ++i) {
+            if (!accepted[i]) {
+                rejected[keys[i]] = true;
+            } else {
+                EXPECT_FALSE(rejected[keys[i]]) << "Gap before packet " << i << " in round " << round;
+            }
+        }
+    }
+    done = true;
+    consumer.join();
+
+    EXPECT_TRUE(ordered.load());
+    EXPECT_EQ(consumed.load(), enqueued);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(FlowShardedQueueTest, ConcurrentDispatchPreservesFlowOrder) {
+    constexpr size_t num_producers = 4;
+    constexpr size_t flows_per_producer = 16;
+    constexpr size_t packets_per_flow = 500;
+
+    FlowShardedQueueConfig config;
+    config.shard_count = 4;
+    config.shard_capacity = 256;
+    config.flow_id_shift = 32;
+    FlowShardedQueue<> queue(config);
+
+    std::atomic<size_t> consumed{0};
+    constexpr size_t total = num_producers * flows_per_producer * packets_per_flow;
+    std::atomic<bool> ordered{true};
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < num_producers; ++p) {
+        threads.emplace_back([&, p]() {
+            std::vector<Packet> burst, retry;
+            bool accepted[flows_per_producer];
+            for (size_t seq = 0; seq < packets_per_flow; ++seq) {
+                burst.clear();
+                for (size_t f = 0; f < flows_per_producer; ++f) {
+                    size_t flow = p * flows_per_producer + f;
+                    burst.emplace_back((flow << 32) | seq);
+                }
+                // Resend only what was rejected; each flow appears once per
+                // burst, so this keeps per-flow order
+                while (!burst.empty()) {
+                    queue.enqueue_batch(my_std::span<const Packet>(burst),
+                                        my_std::span<bool>(accepted, burst.size()));
+                    retry.clear();
+                    for (size_t i = 0; i < burst.size(); ++i) {
+                        if (!accepted[i]) retry.push_back(burst[i]);
+                    }
+                    burst.swap(retry);
+                    if (!burst.empty()) std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    for (size_t s = 0; s < config.shard_count; ++s) {
+        threads.emplace_back([&, s]() {
+            std::vector<size_t> next_seq(num_producers * flows_per_producer, 0);
+            std::vector<Packet> out(32);
+            while (consumed.load() < total) {
+                size_t n = queue.dequeue_batch(s, my_std::span<Packet>(out));
+                for (size_t i = 0; i < n; ++i) {
+                    size_t flow = out[i].id >> 32;
+                    if ((out[i].id & 0xffffffff) != next_seq[flow]++) ordered = false;
+                }
+                consumed.fetch_add(n);
+                if (n == 0) std::this_thread::yield();
+            }
+        });
+    }
+
+    for (auto& t : threads) t.join();
+    EXPECT_EQ(consumed.load(), total);
+    EXPECT_TRUE(ordered.load());
+    EXPECT_TRUE(queue.empty());
+}
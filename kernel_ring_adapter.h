@@ -0,0 +1,427 @@
+#pragma once
+
+// Burst adapters between kernel packet rings (AF_XDP, io_uring) and a
+// BasicMPMCQueue. Linux only.
+#if defined(__linux__)
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+#include <linux/if_xdp.h>
+#include <linux/io_uring.h>
+
+#include "mpmc_packet_queue.h"
+
+namespace detail {
+
+// Ring indexes are plain words in memory mapped from the kernel
+inline uint32_t ring_load_acquire(const uint32_t* word) noexcept {
+    return __atomic_load_n(word, __ATOMIC_ACQUIRE);
+}
+
+inline void ring_store_release(uint32_t* word, uint32_t value) noexcept {
+    __atomic_store_n(word, value, __ATOMIC_RELEASE);
+}
+
+inline uint32_t validate_ring_size(uint32_t size) {
+    if (size == 0 || (size & (size - 1)) != 0) {
+        throw std::invalid_argument("Ring size must be a power of 2");
+    }
+    return size;
+}
+
+inline uint32_t* ring_word(void* map, uint64_t offset) noexcept {
+    return reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(map) + offset);
+}
+
+// Element access for the descriptor types the adapters write and read
+inline void set_rx(Packet& packet, uint8_t* data, uint32_t length,
+                   PacketPriority priority, uint64_t id) noexcept {
+    packet.data = data;
+    packet.length = length;
+    packet.priority = priority;
+    packet.id = static_cast<size_t>(id);
+}
+
+inline void set_rx(CompactPacket& packet, uint8_t* data, uint32_t length,
+                   PacketPriority priority, uint64_t id) noexcept {
+    packet.set_data(data);
+    packet.set_length(length);
+    packet.set_priority(priority);
+    packet.set_id(id & CompactPacket::MAX_ID);
+}
+
+inline uint8_t* tx_data(const Packet& packet) noexcept { return packet.data; }
+inline uint8_t* tx_data(const CompactPacket& packet) noexcept { return packet.data(); }
+inline uint32_t tx_length(const Packet& packet) noexcept { return static_cast<uint32_t>(packet.length); }
+inline uint32_t tx_length(const CompactPacket& packet) noexcept { return static_cast<uint32_t>(packet.length()); }
+
+} // namespace detail
+
+// Consumer end of a single-producer ring shared with the kernel: AF_XDP RX
+// and completion rings, the io_uring completion queue. The producer index
+// is re-read only once the cached one is used up, as in libxdp.
+template <typename Desc>
+class KernelConsumerRing {
+private:
+    uint32_t* producer_ = nullptr;
+    uint32_t* consumer_ = nullptr;
+    Desc* entries_ = nullptr;
+    uint32_t mask_ = 0;
+    uint32_t cached_prod_ = 0;
+    uint32_t cached_cons_ = 0;
+
+public:
+    KernelConsumerRing() = default;
+
+    KernelConsumerRing(uint32_t* producer, uint32_t* consumer, Desc* entries, uint32_t size)
+        : producer_(producer), consumer_(consumer), entries_(entries),
+          mask_(detail::validate_ring_size(size) - 1),
+          cached_prod_(detail::ring_load_acquire(producer)),
+          cached_cons_(*consumer) {}
+
+    // Claim up to max filled entries starting at index
+    uint32_t peek(uint32_t max, uint32_t& index) noexcept {
+        uint32_t entries = cached_prod_ - cached_cons_;
+        if (entries < max) {
+            cached_prod_ = detail::ring_load_acquire(producer_);
+            entries = cached_prod_ - cached_cons_;
+        }
+        uint32_t count = std::min(entries, max);
+        index = cached_cons_;
+        cached_cons_ += count;
+        return count;
+    }
+
+    // Hand back the last count peeked entries unread
+    void cancel(uint32_t count) noexcept { cached_cons_ -= count; }
+
+    // Return count entries to the kernel once they have been read
+    void release(uint32_t count) noexcept {
+        if (count != 0) detail::ring_store_release(consumer_, *consumer_ + count);
+    }
+
+    const Desc& operator[](uint32_t index) const noexcept { return entries_[index & mask_]; }
+    uint32_t size() const noexcept { return mask_ + 1; }
+};
+
+// Producer end of a single-consumer ring shared with the kernel: AF_XDP TX
+// and fill rings, the io_uring submission queue index array
+template <typename Desc>
+class KernelProducerRing {
+private:
+    uint32_t* producer_ = nullptr;
+    uint32_t* consumer_ = nullptr;
+    uint32_t* flags_ = nullptr;
+    Desc* entries_ = nullptr;
+    uint32_t mask_ = 0;
+    uint32_t wakeup_flag_ = 0;
+    uint32_t cached_prod_ = 0;
+    uint32_t cached_cons_ = 0;  // Consumer index plus the ring size
+
+public:
+    KernelProducerRing() = default;
+
+    KernelProducerRing(uint32_t* producer, uint32_t* consumer, Desc* entries, uint32_t size,
+                       uint32_t* flags = nullptr, uint32_t wakeup_flag = 0)
+        : producer_(producer), consumer_(consumer), flags_(flags), entries_(entries),
+          mask_(detail::validate_ring_size(size) - 1), wakeup_flag_(wakeup_flag),
+          cached_prod_(*producer),
+          cached_cons_(detail::ring_load_acquire(consumer) + size) {}
+
+    // Claim up to max free entries starting at index
+    uint32_t reserve(uint32_t max, uint32_t& index) noexcept {
+        uint32_t free = cached_cons_ - cached_prod_;
+        if (free < max) {
+            cached_cons_ = detail::ring_load_acquire(consumer_) + mask_ + 1;
+            free = cached_cons_ - cached_prod_;
+        }
+        uint32_t count = std::min(free, max);
+        index = cached_prod_;
+        cached_prod_ += count;
+        return count;
+    }
+
+    // Hand back the last count reserved entries unused
+    void cancel(uint32_t count) noexcept { cached_prod_ -= count; }
+
+    // Publish count filled entries to the kernel
+    void submit(uint32_t count) noexcept {
+        if (count != 0) detail::ring_store_release(producer_, *producer_ + count);
+    }
+
+    Desc& operator[](uint32_t index) noexcept { return entries_[index & mask_]; }
+    uint32_t size() const noexcept { return mask_ + 1; }
+
+    // The kernel asks for a kick (sendto() for AF_XDP TX, io_uring_enter()
+    // with SQPOLL) before it looks at the ring again
+    bool needs_wakeup() const noexcept {
+        return flags_ != nullptr && (detail::ring_load_acquire(flags_) & wakeup_flag_) != 0;
+    }
+};
+
+using XskRxRing = KernelConsumerRing<xdp_desc>;
+using XskTxRing = KernelProducerRing<xdp_desc>;
+using XskFillRing = KernelProducerRing<uint64_t>;
+using XskCompletionRing = KernelConsumerRing<uint64_t>;
+using UringCompletionRing = KernelConsumerRing<io_uring_cqe>;
+
+// Ring views over an AF_XDP socket's mappings, from the XDP_MMAP_OFFSETS
+// getsockopt and the ring size passed to setsockopt
+template <typename Desc>
+KernelConsumerRing<Desc> xsk_consumer_ring(void* map, const xdp_ring_offset& offsets, uint32_t size) {
+    return KernelConsumerRing<Desc>(detail::ring_word(map, offsets.producer),
+                                    detail::ring_word(map, offsets.consumer),
+                                    reinterpret_cast<Desc*>(static_cast<uint8_t*>(map) + offsets.desc),
+                                    size);
+}
+
+template <typename Desc>
+KernelProducerRing<Desc> xsk_producer_ring(void* map, const xdp_ring_offset& offsets, uint32_t size) {
+    return KernelProducerRing<Desc>(detail::ring_word(map, offsets.producer),
+                                    detail::ring_word(map, offsets.consumer),
+                                    reinterpret_cast<Desc*>(static_cast<uint8_t*>(map) + offsets.desc),
+                                    size, detail::ring_word(map, offsets.flags), XDP_RING_NEED_WAKEUP);
+}
+
+// Completion queue view over the mapping described by io_uring_params
+inline UringCompletionRing uring_completion_ring(void* map, const io_cqring_offsets& offsets) {
+    return UringCompletionRing(detail::ring_word(map, offsets.tail),
+                               detail::ring_word(map, offsets.head),
+                               reinterpret_cast<io_uring_cqe*>(static_cast<uint8_t*>(map) + offsets.cqes),
+                               *detail::ring_word(map, offsets.ring_entries));
+}
+
+// Submission queue: the index array is the ring, the SQE array is mapped
+// separately. Entry i of the ring always names SQE i.
+class UringSubmissionRing {
+private:
+    KernelProducerRing<uint32_t> ring_;
+    io_uring_sqe* sqes_ = nullptr;
+
+public:
+    UringSubmissionRing() = default;
+
+    UringSubmissionRing(void* map, const io_sqring_offsets& offsets, io_uring_sqe* sqes)
+        : ring_(detail::ring_word(map, offsets.tail), detail::ring_word(map, offsets.head),
+                reinterpret_cast<uint32_t*>(static_cast<uint8_t*>(map) + offsets.array),
+                *detail::ring_word(map, offsets.ring_entries),
+                detail::ring_word(map, offsets.flags), IORING_SQ_NEED_WAKEUP),
+          sqes_(sqes) {}
+
+    uint32_t reserve(uint32_t max, uint32_t& index) noexcept { return ring_.reserve(max, index); }
+    void cancel(uint32_t count) noexcept { ring_.cancel(count); }
+    void submit(uint32_t count) noexcept { ring_.submit(count); }
+    bool needs_wakeup() const noexcept { return ring_.needs_wakeup(); }
+    uint32_t size() const noexcept { return ring_.size(); }
+
+    // Cleared SQE for a reserved index
+    io_uring_sqe& sqe(uint32_t index) noexcept {
+        uint32_t slot = index & (ring_.size() - 1);
+        ring_[index] = slot;
+        std::memset(&sqes_[slot], 0, sizeof(io_uring_sqe));
+        return sqes_[slot];
+    }
+};
+
+// Packet memory shared with the kernel: an AF_XDP UMEM, or the buffer area
+// behind an io_uring provided-buffer ring (buffer id i at i * frame_size).
+// AF_XDP addresses may carry an unaligned-chunk offset in their top bits.
+struct UmemArea {
+    uint8_t* base = nullptr;
+    uint32_t frame_size = 0;
+
+    uint8_t* data(uint64_t addr) const noexcept {
+        return base + (addr & XSK_UNALIGNED_BUF_ADDR_MASK) + (addr >> XSK_UNALIGNED_BUF_OFFSET_SHIFT);
+    }
+
+    uint64_t addr(const uint8_t* data) const noexcept {
+        return static_cast<uint64_t>(data - base);
+    }
+
+    uint8_t* buffer(uint32_t id) const noexcept {
+        return base + static_cast<size_t>(id) * frame_size;
+    }
+};
+
+// Every adapter moves at most this many descriptors per call by default
+constexpr uint32_t DEFAULT_RING_BURST = 64;
+
+// AF_XDP receive path. A burst of RX descriptors maps onto one
+// reserve_write_batch() of the queue and is written straight into its
+// slots: Packet::data points into the UMEM, length is the frame length and
+// id counts received frames. Descriptors the queue has no room for stay on
+// the RX ring for the next poll. Frames must go back to the fill ring once
+// consumers are done with them; refill() does that for a burst.
+template <typename Queue = MPMC_PacketQueue>
+class XdpIngress {
+private:
+    UmemArea umem_;
+    PacketPriority priority_;
+    uint64_t next_id_ = 0;
+
+public:
+    explicit XdpIngress(const UmemArea& umem, PacketPriority priority = PacketPriority::Low) noexcept
+        : umem_(umem), priority_(priority) {}
+
+    // Move up to max received frames into queue
+    size_t poll(XskRxRing& rx, Queue& queue, uint32_t max = DEFAULT_RING_BURST) noexcept {
+        uint32_t index;
+        uint32_t count = rx.peek(max, index);
+        if (count == 0) return 0;
+
+        auto slots = queue.reserve_write_batch(count);
+        const uint32_t taken = static_cast<uint32_t>(slots.size());
+        for (uint32_t i = 0; i < taken; ++i) {
+            const xdp_desc& desc = rx[index + i];
+            detail::set_rx(slots[i], umem_.data(desc.addr), desc.len, priority_, next_id_++);
+        }
+        slots.commit();
+        rx.cancel(count - taken);
+        rx.release(taken);
+        return taken;
+    }
+
+    // Give frames back to the kernel for reception; returns how many fit
+    size_t refill(XskFillRing& fill, my_std::span<uint8_t* const> frames) noexcept {
+        uint32_t index;
+        uint32_t count = fill.reserve(static_cast<uint32_t>(frames.size()), index);
+        for (uint32_t i = 0; i < count; ++i) fill[index + i] = umem_.addr(frames[i]);
+        fill.submit(count);
+        return count;
+    }
+
+    uint64_t received() const noexcept { return next_id_; }
+};
+
+// AF_XDP transmit path: drains the queue with consume_batch() straight into
+// TX descriptors, as many as the TX ring has room for. Check
+// tx.needs_wakeup() afterwards and kick the socket with sendto() if set.
+template <typename Queue = MPMC_PacketQueue>
+class XdpEgress {
+private:
+    UmemArea umem_;
+
+public:
+    explicit XdpEgress(const UmemArea& umem) noexcept : umem_(umem) {}
+
+    size_t drain(Queue& queue, XskTxRing& tx, uint32_t max = DEFAULT_RING_BURST) noexcept {
+        uint32_t index;
+        uint32_t count = tx.reserve(max, index);
+        if (count == 0) return 0;
+
+        uint32_t filled = 0;
+        queue.consume_batch(count, [&](typename Queue::value_type& packet) {
+            xdp_desc& desc = tx[index + filled++];
+            desc.addr = umem_.addr(detail::tx_data(packet));
+            desc.len = detail::tx_length(packet);
+            desc.options = 0;
+        });
+        tx.cancel(count - filled);
+        tx.submit(filled);
+        return filled;
+    }
+
+    // Frames the kernel has finished sending, ready for reuse
+    size_t reap(XskCompletionRing& completions, my_std::span<uint8_t*> frames) noexcept {
+        uint32_t index;
+        uint32_t count = completions.peek(static_cast<uint32_t>(frames.size()), index);
+        for (uint32_t i = 0; i < count; ++i) frames[i] = umem_.data(completions[index + i]);
+        completions.release(count);
+        return count;
+    }
+};
+
+// io_uring receive path for recv requests that use a provided-buffer ring
+// (IOSQE_BUFFER_SELECT or multishot recv). Completions that carry data
+// are written straight into reserved queue slots, with Packet::data
+// pointing at the selected buffer. Error and empty completions carry no
+// data; they are consumed and counted in errors(), and a request that ended
+// without IORING_CQE_F_MORE has to be re-armed by the caller. The
+// completion queue must serve only these receives.
+template <typename Queue = MPMC_PacketQueue>
+class UringIngress {
+private:
+    UmemArea buffers_;
+    PacketPriority priority_;
+    uint64_t next_id_ = 0;
+    uint64_t errors_ = 0;
+
+    static bool has_data(const io_uring_cqe& cqe) noexcept {
+        return cqe.res > 0 && (cqe.flags & IORING_CQE_F_BUFFER) != 0;
+    }
+
+public:
+    explicit UringIngress(const UmemArea& buffers, PacketPriority priority = PacketPriority::Low) noexcept
+        : buffers_(buffers), priority_(priority) {}
+
+    size_t poll(UringCompletionRing& cq, Queue& queue, uint32_t max = DEFAULT_RING_BURST) noexcept {
+        uint32_t index;
+        uint32_t count = cq.peek(max, index);
+        if (count == 0) return 0;
+
+        // Size the reservation by the completions that carry data
+        size_t wanted = 0;
+        for (uint32_t i = 0; i < count; ++i) wanted += has_data(cq[index + i]);
+        auto slots = queue.reserve_write_batch(wanted);
+
+        size_t filled = 0;
+        uint32_t used = 0;
+        for (; used < count; ++used) {
+            const io_uring_cqe& cqe = cq[index + used];
+            if (!has_data(cqe)) {
+                ++errors_;
+                continue;
+            }
+            if (filled == slots.size()) break;
+            detail::set_rx(slots[filled++], buffers_.buffer(cqe.flags >> IORING_CQE_BUFFER_SHIFT),
+                           static_cast<uint32_t>(cqe.res), priority_, next_id_++);
+        }
+        slots.commit();
+        cq.cancel(count - used);
+        cq.release(used);
+        return filled;
+    }
+
+    uint64_t received() const noexcept { return next_id_; }
+    uint64_t errors() const noexcept { return errors_; }
+};
+
+// io_uring transmit path: one IORING_OP_SEND per packet on fd, written
+// straight from the queue with consume_batch(). user_data is the payload
+// pointer, so the buffer can be reused once its completion arrives. Call
+// io_uring_enter() afterwards unless the ring runs with SQPOLL and
+// sq.needs_wakeup() is clear.
+template <typename Queue = MPMC_PacketQueue>
+class UringEgress {
+private:
+    int fd_;
+
+public:
+    explicit UringEgress(int fd) noexcept : fd_(fd) {}
+
+    size_t drain(Queue& queue, UringSubmissionRing& sq, uint32_t max = DEFAULT_RING_BURST) noexcept {
+        uint32_t index;
+        uint32_t count = sq.reserve(max, index);
+        if (count == 0) return 0;
+
+        uint32_t filled = 0;
+        queue.consume_batch(count, [&](typename Queue::value_type& packet) {
+            io_uring_sqe& sqe = sq.sqe(index + filled++);
+            uint8_t* data = detail::tx_data(packet);
+            sqe.opcode = IORING_OP_SEND;
+            sqe.fd = fd_;
+            sqe.addr = reinterpret_cast<uint64_t>(data);
+            sqe.len = detail::tx_length(packet);
+            sqe.user_data = reinterpret_cast<uint64_t>(data);
+        });
+        sq.cancel(count - filled);
+        sq.submit(filled);
+        return filled;
+    }
+};
+
+#endif // defined(__linux__)
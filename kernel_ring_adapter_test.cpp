@@ -0,0 +1,273 @@
+#include <gtest/gtest.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+#include "kernel_ring_adapter.h"
+
+namespace {
+
+// Kernel side of one ring, laid out in plain memory. The indexes start just
+// below 2^32 so every test crosses the wrap.
+template <typename Desc, uint32_t Size>
+struct FakeRing {
+    static constexpr uint32_t START = UINT32_MAX - 5;
+
+    uint32_t producer = START;
+    uint32_t consumer = START;
+    uint32_t flags = 0;
+    Desc entries[Size] = {};
+
+    // Kernel producing into a consumer ring
+    void push(const Desc& desc) {
+        entries[producer & (Size - 1)] = desc;
+        ++producer;
+    }
+
+    // Kernel consuming from a producer ring
+    Desc pop() { return entries[consumer++ & (Size - 1)]; }
+
+    uint32_t filled() const { return producer - consumer; }
+};
+
+constexpr uint32_t FRAME_SIZE = 2048;
+
+io_uring_cqe recv_cqe(int32_t res, uint32_t buffer_id) {
+    io_uring_cqe cqe{};
+    cqe.res = res;
+    cqe.flags = IORING_CQE_F_BUFFER | (buffer_id << IORING_CQE_BUFFER_SHIFT);
+    return cqe;
+}
+
+} // namespace
+
+TEST(KernelRingAdapterTest, RingViewsFollowKernelIndexes) {
+    FakeRing<uint64_t, 8> ring;
+    XskCompletionRing consumer(&ring.producer, &ring.consumer, ring.entries, 8);
+    for (uint64_t i = 0; i < 5; ++i) ring.push(i * 10);
+
+    uint32_t index;
+    EXPECT_EQ(consumer.peek(3, index), 3);
+    EXPECT_EQ(consumer[index + 2], 20);
+    consumer.cancel(1);
+    consumer.release(2);
+    EXPECT_EQ(ring.filled(), 3);
+    EXPECT_EQ(consumer.peek(8, index), 3);
+    EXPECT_EQ(consumer[index], 20);
+    consumer.release(3);
+
+    FakeRing<uint64_t, 4> fill;
+    XskFillRing producer(&fill.producer, &fill.consumer, fill.entries, 4, &fill.flags, XDP_RING_NEED_WAKEUP);
+    EXPECT_EQ(producer.reserve(8, index), 4);
+    for (uint32_t i = 0; i < 4; ++i) producer[index + i] = 100 + i;
+    producer.submit(4);
+    EXPECT_EQ(producer.reserve(1, index), 0);  // Until the kernel consumes
+    EXPECT_EQ(fill.pop(), 100);
+    EXPECT_EQ(producer.reserve(1, index), 1);
+    EXPECT_FALSE(producer.needs_wakeup());
+    fill.flags = XDP_RING_NEED_WAKEUP;
+    EXPECT_TRUE(producer.needs_wakeup());
+
+    EXPECT_THROW(XskCompletionRing(&ring.producer, &ring.consumer, ring.entries, 6), std::invalid_argument);
+
+    // The same view built from mmap offsets
+    struct Mapped {
+        uint32_t producer;
+        uint32_t pad0[15];
+        uint32_t consumer;
+        uint32_t flags;
+        uint32_t pad1[14];
+        xdp_desc descs[4];
+    } mapped{};
+    xdp_ring_offset offsets{offsetof(Mapped, producer), offsetof(Mapped, consumer),
+                            offsetof(Mapped, descs), offsetof(Mapped, flags)};
+    XskTxRing tx = xsk_producer_ring<xdp_desc>(&mapped, offsets, 4);
+    EXPECT_EQ(tx.reserve(2, index), 2);
+    tx[index + 1].len = 77;
+    tx.submit(2);
+    EXPECT_EQ(mapped.producer, 2);
+    EXPECT_EQ(mapped.descs[1].len, 77);
+}
+
+TEST(KernelRingAdapterTest, XdpIngressFillsReservedSlots) {
+    std::vector<uint8_t> umem_memory(64 * FRAME_SIZE);
+    UmemArea umem{umem_memory.data(), FRAME_SIZE};
+    FakeRing<xdp_desc, 64> rx;
+    for (uint64_t i = 0; i < 40; ++i) rx.push(xdp_desc{i * FRAME_SIZE + 256, static_cast<uint32_t>(60 + i), 0});
+    // Unaligned-chunk mode: offset carried in the top bits
+    rx.push(xdp_desc{(uint64_t(64) << XSK_UNALIGNED_BUF_OFFSET_SHIFT) | (41 * FRAME_SIZE), 100, 0});
+
+    XskRxRing ring(&rx.producer, &rx.consumer, rx.entries, 64);
+    XdpIngress<> ingress(umem, PacketPriority::High);
+    MPMC_PacketQueue queue(32);
+
+    // The queue takes 32; the rest stays on the RX ring
+    EXPECT_EQ(ingress.poll(ring, queue, 64), 32);
+    EXPECT_EQ(rx.filled(), 9);
+    std::vector<Packet> batch(64);
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(batch)), 32);
+    for (size_t i = 0; i < 32; ++i) {
+        EXPECT_EQ(batch[i].data, umem.base + i * FRAME_SIZE + 256);
+        EXPECT_EQ(batch[i].length, 60 + i);
+        EXPECT_EQ(batch[i].priority, PacketPriority::High);
+        EXPECT_EQ(batch[i].id, i);
+    }
+
+    EXPECT_EQ(ingress.poll(ring, queue, 4), 4);
+    EXPECT_EQ(ingress.poll(ring, queue), 5);
+    EXPECT_EQ(ingress.poll(ring, queue), 0);
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(batch)), 9);
+    EXPECT_EQ(batch[8].data, umem.base + 41 * FRAME_SIZE + 64);
+    EXPECT_EQ(ingress.received(), 41);
+
+    // Frames go back on the fill ring as UMEM addresses
+    FakeRing<uint64_t, 4> fill;
+    XskFillRing fill_ring(&fill.producer, &fill.consumer, fill.entries, 4);
+    std::vector<uint8_t*> frames = {batch[0].data, batch[1].data, batch[2].data, batch[3].data, batch[4].data};
+    EXPECT_EQ(ingress.refill(fill_ring, my_std::span<uint8_t* const>(frames.data(), frames.size())), 4);
+    EXPECT_EQ(fill.pop(), umem.addr(batch[0].data));
+
+    // Compact descriptors are filled the same way
+    CompactPacketQueue compact(8);
+    XdpIngress<CompactPacketQueue> compact_ingress(umem);
+    rx.push(xdp_desc{3 * FRAME_SIZE, 1500, 0});
+    EXPECT_EQ(compact_ingress.poll(ring, compact), 1);
+    auto packet = compact.dequeue();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->data(), umem.base + 3 * FRAME_SIZE);
+    EXPECT_EQ(packet->length(), 1500);
+}
+
+TEST(KernelRingAdapterTest, XdpEgressDrainsIntoTxRing) {
+    std::vector<uint8_t> umem_memory(16 * FRAME_SIZE);
+    UmemArea umem{umem_memory.data(), FRAME_SIZE};
+    MPMC_PacketQueue queue(32);
+    for (size_t i = 0; i < 12; ++i) {
+        ASSERT_TRUE(queue.enqueue(Packet(umem.buffer(static_cast<uint32_t>(i)), 64 + i, PacketPriority::Low, i)));
+    }
+
+    FakeRing<xdp_desc, 8> tx;
+    XskTxRing tx_ring(&tx.producer, &tx.consumer, tx.entries, 8);
+    XdpEgress<> egress(umem);
+    EXPECT_EQ(egress.drain(queue, tx_ring), 8);  // TX ring room
+    EXPECT_EQ(queue.size(), 4);
+    EXPECT_EQ(tx.filled(), 8);
+    for (size_t i = 0; i < 8; ++i) {
+        xdp_desc desc = tx.pop();
+        EXPECT_EQ(desc.addr, i * FRAME_SIZE);
+        EXPECT_EQ(desc.len, 64 + i);
+    }
+    EXPECT_EQ(egress.drain(queue, tx_ring, 2), 2);
+    EXPECT_EQ(egress.drain(queue, tx_ring), 2);
+    EXPECT_EQ(egress.drain(queue, tx_ring), 0);  // Queue empty; nothing reserved
+    EXPECT_EQ(tx.filled(), 4);
+
+    // Completed frames come back as payload pointers
+    FakeRing<uint64_t, 8> completions;
+    completions.push(3 * FRAME_SIZE);
+    completions.push(5 * FRAME_SIZE);
+    XskCompletionRing completion_ring(&completions.producer, &completions.consumer, completions.entries, 8);
+    std::vector<uint8_t*> frames(8);
+    EXPECT_EQ(egress.reap(completion_ring, my_std::span<uint8_t*>(frames)), 2);
+    EXPECT_EQ(frames[0], umem.buffer(3));
+    EXPECT_EQ(frames[1], umem.buffer(5));
+    EXPECT_EQ(completions.filled(), 0);
+}
+
+TEST(KernelRingAdapterTest, UringIngressSkipsErrorCompletions) {
+    std::vector<uint8_t> buffer_memory(16 * FRAME_SIZE);
+    UmemArea buffers{buffer_memory.data(), FRAME_SIZE};
+
+    // A completion queue laid out as mapped, with offsets as in io_uring_params
+    struct Mapped {
+        uint32_t head;
+        uint32_t tail;
+        uint32_t ring_mask;
+        uint32_t ring_entries;
+        io_uring_cqe cqes[8];
+    } mapped{FakeRing<int, 8>::START, FakeRing<int, 8>::START, 7, 8, {}};
+    io_cqring_offsets offsets{};
+    offsets.head = offsetof(Mapped, head);
+    offsets.tail = offsetof(Mapped, tail);
+    offsets.ring_mask = offsetof(Mapped, ring_mask);
+    offsets.ring_entries = offsetof(Mapped, ring_entries);
+    offsets.cqes = offsetof(Mapped, cqes);
+    auto push = [&](const io_uring_cqe& cqe) { mapped.cqes[mapped.tail++ & 7] = cqe; };
+
+    push(recv_cqe(100, 4));
+    io_uring_cqe error{};
+    error.res = -ENOBUFS;
+    push(error);
+    push(recv_cqe(200, 9));
+    push(recv_cqe(300, 2));
+    push(recv_cqe(400, 7));
+
+    UringCompletionRing cq = uring_completion_ring(&mapped, offsets);
+    UringIngress<> ingress(buffers);
+    MPMC_PacketQueue queue(2);
+    EXPECT_EQ(ingress.poll(cq, queue), 2);
+    EXPECT_EQ(ingress.errors(), 1);
+    EXPECT_EQ(mapped.tail - mapped.head, 2);  // Error consumed, the rest left
+
+    std::vector<Packet> batch(4);
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(batch)), 2);
+    EXPECT_EQ(batch[0].data, buffers.buffer(4));
+    EXPECT_EQ(batch[0].length, 100);
+    EXPECT_EQ(batch[1].data, buffers.buffer(9));
+    EXPECT_EQ(batch[1].length, 200);
+
+    EXPECT_EQ(ingress.poll(cq, queue), 2);
+    EXPECT_EQ(mapped.tail, mapped.head);
+    EXPECT_EQ(queue.dequeue()->data, buffers.buffer(2));
+    EXPECT_EQ(ingress.received(), 4);
+}
+
+TEST(KernelRingAdapterTest, UringEgressWritesSendRequests) {
+    std::vector<uint8_t> buffer_memory(8 * FRAME_SIZE);
+    UmemArea buffers{buffer_memory.data(), FRAME_SIZE};
+    MPMC_PacketQueue queue(16);
+    for (uint32_t i = 0; i < 6; ++i) {
+        ASSERT_TRUE(queue.enqueue(Packet(buffers.buffer(i), 128 + i, PacketPriority::Low, i)));
+    }
+
+    struct Mapped {
+        uint32_t head;
+        uint32_t tail;
+        uint32_t ring_mask;
+        uint32_t ring_entries;
+        uint32_t flags;
+        uint32_t array[4];
+    } mapped{FakeRing<int, 4>::START, FakeRing<int, 4>::START, 3, 4, 0, {}};
+    io_sqring_offsets offsets{};
+    offsets.head = offsetof(Mapped, head);
+    offsets.tail = offsetof(Mapped, tail);
+    offsets.ring_mask = offsetof(Mapped, ring_mask);
+    offsets.ring_entries = offsetof(Mapped, ring_entries);
+    offsets.flags = offsetof(Mapped, flags);
+    offsets.array = offsetof(Mapped, array);
+    io_uring_sqe sqes[4];
+    std::memset(sqes, 0xff, sizeof(sqes));
+
+    UringSubmissionRing sq(&mapped, offsets, sqes);
+    UringEgress<> egress(42);
+    EXPECT_EQ(egress.drain(queue, sq), 4);
+    EXPECT_EQ(mapped.tail - mapped.head, 4);
+    for (uint32_t i = 0; i < 4; ++i) {
+        uint32_t slot = (FakeRing<int, 4>::START + i) & 3;
+        EXPECT_EQ(mapped.array[slot], slot);
+        const io_uring_sqe& sqe = sqes[slot];
+        EXPECT_EQ(sqe.opcode, IORING_OP_SEND);
+        EXPECT_EQ(sqe.fd, 42);
+        EXPECT_EQ(sqe.addr, reinterpret_cast<uint64_t>(buffers.buffer(i)));
+        EXPECT_EQ(sqe.len, 128 + i);
+        EXPECT_EQ(sqe.user_data, sqe.addr);
+        EXPECT_EQ(sqe.flags, 0);  // Stale contents cleared
+    }
+
+    // Full until the kernel consumes submissions
+    EXPECT_EQ(egress.drain(queue, sq), 0);
+    EXPECT_EQ(queue.size(), 2);
+    mapped.head += 4;
+    EXPECT_EQ(egress.drain(queue, sq), 2);
+    EXPECT_FALSE(sq.needs_wakeup());
+}
@@ -0,0 +1,264 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "thread_index.h"
+
+// Point-in-time copy of a LatencyHistogram
+struct LatencySnapshot {
+    std::vector<uint64_t> counts;  // Indexed like LatencyHistogram buckets
+    uint64_t total = 0;
+    uint64_t sum_ns = 0;
+
+    uint64_t count() const noexcept { return total; }
+
+    double mean_ns() const noexcept {
+        return total == 0 ? 0.0 : static_cast<double>(sum_ns) / static_cast<double>(total);
+    }
+
+    // Smallest bucket upper bound that covers fraction p (0..1) of the
+    // samples; 0 for an empty snapshot. Accurate to one bucket width.
+    inline uint64_t percentile(double p) const noexcept;
+
+    void merge(const LatencySnapshot& other) {
+        if (counts.size() < other.counts.size()) counts.resize(other.counts.size(), 0);
+        for (size_t i = 0; i < other.counts.size(); ++i) counts[i] += other.counts[i];
+        total += other.total;
+        sum_ns += other.sum_ns;
+    }
+};
+
+// Log-linear (HDR-style) histogram of nanosecond latencies.
+//
+// Values below 2^SUB_BUCKET_BITS get one bucket each; above that every power
+// of two is split into 2^SUB_BUCKET_BITS linear buckets, so any value is
+// within 1/32 (about 3%) of its bucket bounds across the full 64-bit range.
+//
+// Each ThreadIndex records into its own shard, allocated on first use. A
+// shard has one writer, so recording is a plain load and store on
+// thread-private lines with no atomic read-modify-write. Resets never write
+// to shards: the reader keeps a baseline and reports differences, which is
+// what lets snapshot_and_reset() run while threads keep recording. Threads
+// beyond ThreadIndex::MAX_THREADS share one overflow shard updated with
+// fetch_add.
+class LatencyHistogram {
+public:
+    static constexpr unsigned SUB_BUCKET_BITS = 5;
+    static constexpr size_t SUB_BUCKETS = size_t(1) << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static constexpr size_t bucket_of(uint64_t value) noexcept {
+        if (value < SUB_BUCKETS) return static_cast<size_t>(value);
+        unsigned top = 63u - static_cast<unsigned>(__builtin_clzll(value));
+        unsigned shift = top - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS + static_cast<size_t>((value >> shift) - SUB_BUCKETS);
+    }
+
+    // Smallest and largest value that land in bucket
+    static constexpr uint64_t bucket_lower(size_t bucket) noexcept {
+        if (bucket < SUB_BUCKETS) return bucket;
+        unsigned shift = static_cast<unsigned>(bucket / SUB_BUCKETS) - 1;
+        return (static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS)) << shift;
+    }
+
+    static constexpr uint64_t bucket_upper(size_t bucket) noexcept {
+        if (bucket < SUB_BUCKETS) return bucket;
+        unsigned shift = static_cast<unsigned>(bucket / SUB_BUCKETS) - 1;
+        return bucket_lower(bucket) + ((uint64_t(1) << shift) - 1);
+    }
+
+private:
+    struct alignas(64) Shard {
+        std::array<std::atomic<uint64_t>, BUCKET_COUNT> counts{};
+        std::atomic<uint64_t> total{0};
+        std::atomic<uint64_t> sum_ns{0};
+    };
+
+    std::array<std::atomic<Shard*>, ThreadIndex::MAX_THREADS> shards_{};
+    Shard overflow_;
+
+    // Reader side: what the last reset saw
+    mutable std::mutex reset_mutex_;
+    LatencySnapshot baseline_;
+
+    static void bump(std::atomic<uint64_t>& counter, uint64_t delta) noexcept {
+        counter.store(counter.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+    }
+
+    Shard* local_shard() noexcept {
+        size_t index = ThreadIndex::get();
+        if (index >= ThreadIndex::MAX_THREADS) return nullptr;
+
+        // Only this thread installs its index's shard
+        Shard* shard = shards_[index].load(std::memory_order_acquire);
+        if (shard == nullptr) {
+            shard = new (std::nothrow) Shard();
+            shards_[index].store(shard, std::memory_order_release);
+        }
+        return shard;
+    }
+
+    static void add_shard(LatencySnapshot& out, const Shard& shard) noexcept {
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+            out.counts[i] += shard.counts[i].load(std::memory_order_relaxed);
+        }
+        out.total += shard.total.load(std::memory_order_relaxed);
+        out.sum_ns += shard.sum_ns.load(std::memory_order_relaxed);
+    }
+
+    // Everything recorded since construction
+    LatencySnapshot cumulative() const {
+        LatencySnapshot out;
+        out.counts.assign(BUCKET_COUNT, 0);
+        for (const auto& shard : shards_) {
+            if (const Shard* s = shard.load(std::memory_order_acquire)) add_shard(out, *s);
+        }
+        add_shard(out, overflow_);
+        return out;
+    }
+
+    LatencySnapshot since_baseline(const LatencySnapshot& now) const {
+        LatencySnapshot out = now;
+        for (size_t i = 0; i < BUCKET_COUNT; ++i) out.counts[i] -= baseline_.counts[i];
+        out.total -= baseline_.total;
+        out.sum_ns -= baseline_.sum_ns;
+        return out;
+    }
+
+public:
+    LatencyHistogram() {
+        baseline_.counts.assign(BUCKET_COUNT, 0);
+    }
+
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    ~LatencyHistogram() {
+        for (auto& shard : shards_) delete shard.load(std::memory_order_relaxed);
+    }
+
+    void record(uint64_t value_ns) noexcept {
+        record(value_ns, 1);
+    }
+
+    // count samples of the same value, e.g. one per element of a batch
+    void record(uint64_t value_ns, uint64_t count) noexcept {
+        Shard* shard = local_shard();
+        if (shard == nullptr) {
+            overflow_.counts[bucket_of(value_ns)].fetch_add(count, std::memory_order_relaxed);
+            overflow_.total.fetch_add(count, std::memory_order_relaxed);
+            overflow_.sum_ns.fetch_add(value_ns * count, std::memory_order_relaxed);
+            return;
+        }
+        bump(shard->counts[bucket_of(value_ns)], count);
+        bump(shard->total, count);
+        bump(shard->sum_ns, value_ns * count);
+    }
+
+    // Samples recorded since the last reset
+    LatencySnapshot snapshot() const {
+        LatencySnapshot now = cumulative();
+        std::lock_guard<std::mutex> lock(reset_mutex_);
+        return since_baseline(now);
+    }
+
+    // snapshot(), then reset; no sample is lost or counted twice across
+    // consecutive calls
+    LatencySnapshot snapshot_and_reset() {
+        LatencySnapshot now = cumulative();
+        std::lock_guard<std::mutex> lock(reset_mutex_);
+        LatencySnapshot out = since_baseline(now);
+        baseline_ = std::move(now);
+        return out;
+    }
+
+    void reset() {
+        snapshot_and_reset();
+    }
+
+    // Memory usage estimation
+    size_t memory_usage() const noexcept {
+        size_t total = sizeof(*this) + BUCKET_COUNT * sizeof(uint64_t);
+        for (const auto& shard : shards_) {
+            if (shard.load(std::memory_order_relaxed) != nullptr) total += sizeof(Shard);
+        }
+        return total;
+    }
+};
+
+inline uint64_t LatencySnapshot::percentile(double p) const noexcept {
+    if (total == 0) return 0;
+    p = std::min(std::max(p, 0.0), 1.0);
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(p * static_cast<double>(total) + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        seen += counts[i];
+        if (seen >= rank) return LatencyHistogram::bucket_upper(i);
+    }
+    return LatencyHistogram::bucket_upper(counts.size() - 1);
+}
+
+// Clocks for queue latency timing (the latency_clock member of a queue
+// policy). now() returns ticks; to_ns() converts a tick difference.
+
+struct SteadyLatencyClock {
+    static uint64_t now() noexcept {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    static uint64_t to_ns(uint64_t ticks) noexcept { return ticks; }
+
+    static void calibrate() noexcept {}
+};
+
+// Raw TSC reads, a few nanoseconds cheaper than steady_clock. Assumes an
+// invariant TSC synchronised across cores, as on current x86 servers. The
+// tick rate is measured against steady_clock once, in calibrate(), which
+// timed queues call from their constructor. Other architectures use
+// steady_clock.
+struct TscLatencyClock {
+#if defined(__x86_64__) || defined(__i386__)
+    static uint64_t now() noexcept { return __rdtsc(); }
+
+    static uint64_t to_ns(uint64_t ticks) noexcept {
+        return static_cast<uint64_t>(static_cast<double>(ticks) * ns_per_tick());
+    }
+
+    static void calibrate() noexcept { (void)ns_per_tick(); }
+
+private:
+    static double ns_per_tick() noexcept {
+        static const double ratio = [] {
+            auto start = std::chrono::steady_clock::now();
+            uint64_t tsc_start = __rdtsc();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            uint64_t tsc_end = __rdtsc();
+            auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            return tsc_end > tsc_start
+                ? static_cast<double>(elapsed) / static_cast<double>(tsc_end - tsc_start)
+                : 1.0;
+        }();
+        return ratio;
+    }
+#else
+    static uint64_t now() noexcept { return SteadyLatencyClock::now(); }
+    static uint64_t to_ns(uint64_t ticks) noexcept { return ticks; }
+    static void calibrate() noexcept {}
+#endif
+};
@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include "mpmc_packet_queue.h"
+
+struct TimedQueuePolicy : DefaultQueuePolicy {
+    using latency_clock = SteadyLatencyClock;
+};
+
+struct TscTimedQueuePolicy : PackedQueuePolicy {
+    using latency_clock = TscLatencyClock;
+};
+
+TEST(LatencyHistogramTest, BucketsCoverEveryValue) {
+    for (uint64_t v : {0ull, 1ull, 31ull, 32ull, 33ull, 63ull, 64ull, 1000ull, 123456789ull,
+                       (1ull << 40) + 12345, ~0ull}) {
+        size_t b = LatencyHistogram::bucket_of(v);
+        ASSERT_LT(b, LatencyHistogram::BUCKET_COUNT);
+        EXPECT_LE(LatencyHistogram::bucket_lower(b), v);
+        EXPECT_GE(LatencyHistogram::bucket_upper(b), v);
+        // Relative bucket width stays within 1/32
+        EXPECT_LE(LatencyHistogram::bucket_upper(b) - LatencyHistogram::bucket_lower(b),
+                  LatencyHistogram::bucket_lower(b) / 32);
+    }
+    EXPECT_EQ(LatencyHistogram::bucket_of(~0ull), LatencyHistogram::BUCKET_COUNT - 1);
+
+    LatencyHistogram histogram;
+    for (uint64_t v = 1; v <= 1000; ++v) histogram.record(v * 1000);
+    LatencySnapshot s = histogram.snapshot();
+    EXPECT_EQ(s.count(), 1000);
+    EXPECT_NEAR(static_cast<double>(s.percentile(0.5)), 500000.0, 500000.0 / 32);
+    EXPECT_NEAR(static_cast<double>(s.percentile(0.99)), 990000.0, 990000.0 / 32);
+    EXPECT_NEAR(s.mean_ns(), 500500.0, 1.0);
+
+    // Snapshot-and-reset hands every sample out exactly once
+    EXPECT_EQ(histogram.snapshot_and_reset().count(), 1000);
+    EXPECT_EQ(histogram.snapshot().count(), 0);
+    EXPECT_EQ(histogram.snapshot().percentile(0.99), 0);
+    histogram.record(7, 3);
+    EXPECT_EQ(histogram.snapshot().count(), 3);
+    EXPECT_EQ(histogram.snapshot().percentile(1.0), 7);
+}
+
+TEST(LatencyHistogramTest, ConcurrentRecordAndReset) {
+    constexpr size_t num_threads = 4;
+    constexpr size_t per_thread = 50000;
+    LatencyHistogram histogram;
+    std::atomic<bool> done{false};
+
+    // Periodic snapshot-and-reset while threads record; the parts must add up
+    uint64_t collected = 0;
+    std::thread reader([&]() {
+        while (!done.load()) {
+            collected += histogram.snapshot_and_reset().count();
+            std::this_thread::yield();
+        }
+    });
+
+    std::vector<std::thread> writers;
+    for (size_t t = 0; t < num_threads; ++t) {
+        writers.emplace_back([&, t]() {
+            for (size_t i = 0; i < per_thread; ++i) histogram.record(t * 1000 + i % 1000);
+        });
+    }
+    for (auto& w : writers) w.join();
+    done = true;
+    reader.join();
+
+    collected += histogram.snapshot_and_reset().count();
+    EXPECT_EQ(collected, num_threads * per_thread);
+}
+
+TEST(LatencyHistogramTest, QueueRecordsSojournTime) {
+    BasicMPMCQueue<Packet, 64, TimedQueuePolicy> queue;
+    EXPECT_TRUE(queue.latency_timing());
+
+    EXPECT_TRUE(queue.enqueue(Packet(1)));
+    std::vector<Packet> burst(8);
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst)), 8);
+    std::this_thread::sleep_for(std::chrono::milliseconds(2));
+
+    EXPECT_TRUE(queue.dequeue().has_value());
+    std::vector<Packet> out(8);
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(out)), 8);
+
+    LatencySnapshot s = queue.latency_snapshot();
+    EXPECT_EQ(s.count(), 9);
+    EXPECT_GE(s.percentile(0.0), 2000000u * 31 / 32);
+    EXPECT_LT(s.percentile(1.0), 10000000000ull);
+
+    // Zero-copy reservations are timed too
+    {
+        auto w = queue.try_reserve_write();
+        ASSERT_TRUE(w);
+        w->id = 42;
+    }
+    {
+        auto r = queue.try_reserve_read();
+        ASSERT_TRUE(r);
+        EXPECT_EQ(r->id, 42);
+    }
+    EXPECT_EQ(queue.latency_snapshot_and_reset().count(), 10);
+    EXPECT_EQ(queue.latency_snapshot().count(), 0);
+
+    // Untimed queues report nothing and keep their slot size
+    MPMC_PacketQueue plain(16);
+    EXPECT_FALSE(plain.latency_timing());
+    EXPECT_TRUE(plain.enqueue(Packet(1)));
+    EXPECT_TRUE(plain.dequeue().has_value());
+    EXPECT_EQ(plain.latency_snapshot().count(), 0);
+}
+
+TEST(LatencyHistogramTest, TscClockAcrossThreads) {
+    constexpr size_t num_packets = 20000;
+    BasicMPMCQueue<Packet, 256, TscTimedQueuePolicy> queue;
+    std::atomic<size_t> consumed{0};
+
+    std::thread producer([&]() {
+        for (size_t i = 0; i < num_packets; ++i) {
+            while (!queue.enqueue(Packet(i))) std::this_thread::yield();
+        }
+    });
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < 2; ++c) {
+        consumers.emplace_back([&]() {
+            std::vector<Packet> out(16);
+            while (consumed.load() < num_packets) {
+                size_t n = queue.dequeue_batch(my_std::span<Packet>(out));
+                if (n == 0) std::this_thread::yield();
+                consumed.fetch_add(n);
+            }
+        });
+    }
+    producer.join();
+    for (auto& c : consumers) c.join();
+
+    LatencySnapshot s = queue.latency_snapshot();
+    EXPECT_EQ(s.count(), num_packets);
+    EXPECT_LE(s.percentile(0.5), s.percentile(0.99));
+}
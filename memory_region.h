@@ -0,0 +1,179 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+
+#if defined(__linux__)
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// What actually backs a MemoryRegion
+enum class PageBacking : uint8_t {
+    Regular,          // Normal pages (heap on non-Linux targets)
+    TransparentHuge,  // Normal mapping with a transparent-hugepage hint
+    HugeTlb           // Explicit hugetlbfs pages (MAP_HUGETLB)
+};
+
+struct MemoryRegionOptions {
+    // Try MAP_HUGETLB first, then fall back to a THP-hinted mapping
+    bool huge_pages = true;
+
+    // Bind the pages to this NUMA node before first touch; -1 leaves the
+    // kernel's default (first-touch) policy in place
+    int numa_node = -1;
+};
+
+// Where a block of memory actually ended up
+struct MemoryPlacement {
+    PageBacking backing = PageBacking::Regular;
+    int numa_node = -1;   // Node of the first page, or -1 if unknown
+};
+
+// NUMA node currently backing addr, or -1 if it cannot be determined
+inline int numa_node_of(const void* addr) noexcept {
+#if defined(__linux__) && defined(SYS_get_mempolicy)
+    int node = -1;
+    if (syscall(SYS_get_mempolicy, &node, nullptr, 0UL, const_cast<void*>(addr),
+                MPOL_F_NODE | MPOL_F_ADDR) == 0) {
+        return node;
+    }
+    return -1;
+#else
+    (void)addr;
+    return -1;
+#endif
+}
+
+// Owning, page-aligned anonymous memory mapping. Falls back gracefully when
+// hugepages are not reserved on the host; backing() reports what was used.
+// The memory is zero-filled. Throws std::bad_alloc if nothing can be mapped
+// and std::invalid_argument if the requested NUMA node cannot be used.
+class MemoryRegion {
+public:
+    static constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+    static constexpr int MAX_NUMA_NODES = 1024;
+
+private:
+    void* base_ = nullptr;
+    size_t size_ = 0;
+    PageBacking backing_ = PageBacking::Regular;
+
+    static size_t round_up(size_t bytes, size_t alignment) noexcept {
+        return (bytes + alignment - 1) & ~(alignment - 1);
+    }
+
+#if defined(__linux__)
+    // Must run before the pages are first touched
+    static bool bind_to_node(void* p, size_t size, int node) noexcept {
+        constexpr size_t bits = sizeof(unsigned long) * 8;
+        unsigned long mask[MAX_NUMA_NODES / bits] = {};
+        mask[node / bits] = 1UL << (node % bits);
+        // The kernel reads maxnode - 1 bits
+        long rc = syscall(SYS_mbind, p, size, MPOL_BIND, mask,
+                          static_cast<unsigned long>(MAX_NUMA_NODES + 1), 0U);
+        // Kernels without NUMA support have just node 0
+        return rc == 0 || (errno == ENOSYS && node == 0);
+    }
+
+    void* map(size_t size, int extra_flags, int numa_node) {
+        void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | extra_flags, -1, 0);
+        if (p == MAP_FAILED) return nullptr;
+        if (numa_node >= 0 && !bind_to_node(p, size, numa_node)) {
+            munmap(p, size);
+            throw std::invalid_argument("Cannot bind memory to NUMA node");
+        }
+        return p;
+    }
+#endif
+
+    void release() noexcept {
+        if (base_ == nullptr) return;
+#if defined(__linux__)
+        munmap(base_, size_);
+#else
+        ::operator delete(base_, std::align_val_t(HUGE_PAGE_SIZE));
+#endif
+        base_ = nullptr;
+        size_ = 0;
+    }
+
+public:
+    MemoryRegion() = default;
+
+    explicit MemoryRegion(size_t bytes, const MemoryRegionOptions& options = {}) {
+        if (bytes == 0) return;
+        if (options.numa_node >= MAX_NUMA_NODES) {
+            throw std::invalid_argument("NUMA node out of range");
+        }
+#if defined(__linux__)
+        if (options.huge_pages) {
+            size_t huge_size = round_up(bytes, HUGE_PAGE_SIZE);
+            void* p = map(huge_size, MAP_HUGETLB, options.numa_node);
+            if (p != nullptr) {
+                base_ = p;
+                size_ = huge_size;
+                backing_ = PageBacking::HugeTlb;
+                return;
+            }
+        }
+
+        size_t size = options.huge_pages ? round_up(bytes, HUGE_PAGE_SIZE) : round_up(bytes, 4096);
+        void* p = map(size, 0, options.numa_node);
+        if (p == nullptr) {
+            throw std::bad_alloc();
+        }
+        base_ = p;
+        size_ = size;
+        backing_ = PageBacking::Regular;
+#if defined(MADV_HUGEPAGE)
+        if (options.huge_pages && madvise(p, size, MADV_HUGEPAGE) == 0) {
+            backing_ = PageBacking::TransparentHuge;
+        }
+#endif
+#else
+        (void)options;
+        size_ = round_up(bytes, HUGE_PAGE_SIZE);
+        base_ = ::operator new(size_, std::align_val_t(HUGE_PAGE_SIZE));
+        std::memset(base_, 0, size_);
+#endif
+    }
+
+    MemoryRegion(MemoryRegion&& other) noexcept
+        : base_(other.base_), size_(other.size_), backing_(other.backing_) {
+        other.base_ = nullptr;
+        other.size_ = 0;
+    }
+
+    MemoryRegion& operator=(MemoryRegion&& other) noexcept {
+        if (this != &other) {
+            release();
+            base_ = other.base_;
+            size_ = other.size_;
+            backing_ = other.backing_;
+            other.base_ = nullptr;
+            other.size_ = 0;
+        }
+        return *this;
+    }
+
+    MemoryRegion(const MemoryRegion&) = delete;
+    MemoryRegion& operator=(const MemoryRegion&) = delete;
+
+    ~MemoryRegion() { release(); }
+
+    void* data() const noexcept { return base_; }
+    size_t size() const noexcept { return size_; }
+    PageBacking backing() const noexcept { return backing_; }
+
+    MemoryPlacement placement() const noexcept {
+        return {backing_, base_ != nullptr ? numa_node_of(base_) : -1};
+    }
+};
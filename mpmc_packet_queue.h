@@ -9,8 +9,34 @@
 #include <stdexcept>
 #include <memory>
 #include <type_traits>
+#include <chrono>
+#include <iterator>
+#include <algorithm>
 
+#include "latency_histogram.h"
+#include "memory_region.h"
 #include "my_span.h"
+#include "queue_trace.h"
+#include "thread_index.h"
+#include "wait_event.h"
+#include "wait_strategy.h"
+
+// Coroutine awaitables (async_dequeue() and friends) need C++20 coroutines
+// and are compiled in whenever the compiler has them. Define
+// MPMC_QUEUE_COROUTINES to 0 to leave them out.
+#if !defined(MPMC_QUEUE_COROUTINES)
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define MPMC_QUEUE_COROUTINES 1
+#endif
+#endif
+#endif
+#if !defined(MPMC_QUEUE_COROUTINES)
+#define MPMC_QUEUE_COROUTINES 0
+#endif
+#if MPMC_QUEUE_COROUTINES
+#include <coroutine>
+#endif
 
 // Cache line size for most modern processors
 constexpr size_t CACHE_LINE_SIZE = 64;
@@ -94,6 +120,120 @@ struct Packet {
     }
 };
 
+// 16-byte packet descriptor, for rings too large to hold a 32-byte Packet
+// per slot. The first word packs a 48-bit payload handle with a 16-bit
+// length; the second a 62-bit id with the 2-bit priority. The handle is
+// normally a user-space pointer (48 bits on x86-64 and AArch64), but can be
+// any 48-bit value, such as a buffer pool index. Values out of range are
+// truncated; use fits() to check a Packet before converting it.
+class CompactPacket {
+public:
+    static constexpr unsigned HANDLE_BITS = 48;
+    static constexpr uint64_t HANDLE_MASK = (uint64_t(1) << HANDLE_BITS) - 1;
+    static constexpr size_t MAX_LENGTH = 0xFFFF;
+    static constexpr uint64_t MAX_ID = (uint64_t(1) << 62) - 1;
+
+private:
+    uint64_t payload_ = 0;  // handle | length << 48
+    uint64_t tag_ = 0;      // id | priority << 62
+
+public:
+    CompactPacket() = default;
+
+    // Constructor for testing
+    explicit CompactPacket(uint64_t id) noexcept : tag_(id & MAX_ID) {}
+
+    CompactPacket(uint8_t* data, size_t length, PacketPriority priority, uint64_t id = 0) noexcept
+        : payload_((reinterpret_cast<uintptr_t>(data) & HANDLE_MASK) |
+                   (static_cast<uint64_t>(length & MAX_LENGTH) << HANDLE_BITS)),
+          tag_((id & MAX_ID) | (static_cast<uint64_t>(priority) << 62)) {}
+
+    explicit CompactPacket(const Packet& packet) noexcept
+        : CompactPacket(packet.data, packet.length, packet.priority, packet.id) {}
+
+    // Whether packet converts without losing any field
+    static bool fits(const Packet& packet) noexcept {
+        CompactPacket compact(packet);
+        return compact.data() == packet.data && compact.length() == packet.length &&
+               compact.id() == packet.id;
+    }
+
+    Packet to_packet() const noexcept {
+        return Packet(data(), length(), priority(), static_cast<size_t>(id()));
+    }
+
+    // The handle as a pointer, sign-extended as a canonical address
+    uint8_t* data() const noexcept {
+        int64_t address = static_cast<int64_t>(payload_ << (64 - HANDLE_BITS)) >> (64 - HANDLE_BITS);
+        return reinterpret_cast<uint8_t*>(static_cast<intptr_t>(address));
+    }
+
+    uint64_t handle() const noexcept { return payload_ & HANDLE_MASK; }
+    size_t length() const noexcept { return static_cast<size_t>(payload_ >> HANDLE_BITS); }
+    PacketPriority priority() const noexcept { return static_cast<PacketPriority>(tag_ >> 62); }
+    uint64_t id() const noexcept { return tag_ & MAX_ID; }
+
+    void set_handle(uint64_t handle) noexcept {
+        payload_ = (payload_ & ~HANDLE_MASK) | (handle & HANDLE_MASK);
+    }
+
+    void set_data(uint8_t* data) noexcept {
+        set_handle(reinterpret_cast<uintptr_t>(data));
+    }
+
+    void set_length(size_t length) noexcept {
+        payload_ = handle() | (static_cast<uint64_t>(length & MAX_LENGTH) << HANDLE_BITS);
+    }
+
+    void set_priority(PacketPriority priority) noexcept {
+        tag_ = id() | (static_cast<uint64_t>(priority) << 62);
+    }
+
+    void set_id(uint64_t id) noexcept {
+        tag_ = (tag_ & ~MAX_ID) | (id & MAX_ID);
+    }
+
+    bool operator==(const CompactPacket& other) const noexcept {
+        return tag_ == other.tag_;
+    }
+
+    bool operator!=(const CompactPacket& other) const noexcept {
+        return !(*this == other);
+    }
+
+    bool is_valid() const noexcept {
+        return handle() != 0 && length() > 0;
+    }
+
+    void reset() noexcept {
+        payload_ = 0;
+        tag_ = 0;
+    }
+};
+
+static_assert(sizeof(CompactPacket) == 16, "CompactPacket must stay 16 bytes");
+
+// Plain copy of the queue counters, safe to pass around and compare
+struct QueueStatsSnapshot {
+    uint64_t enqueue_attempts = 0;
+    uint64_t enqueue_successes = 0;
+    uint64_t dequeue_attempts = 0;
+    uint64_t dequeue_successes = 0;
+    uint64_t batch_enqueues = 0;
+    uint64_t batch_dequeues = 0;
+    uint64_t contention_events = 0;
+
+    double get_enqueue_success_rate() const noexcept {
+        if (enqueue_attempts == 0) return 0.0;
+        return static_cast<double>(enqueue_successes) / enqueue_attempts;
+    }
+
+    double get_dequeue_success_rate() const noexcept {
+        if (dequeue_attempts == 0) return 0.0;
+        return static_cast<double>(dequeue_successes) / dequeue_attempts;
+    }
+};
+
 // Statistics for monitoring queue performance
 struct QueueStats {
     std::atomic<uint64_t> enqueue_attempts{0};
@@ -114,162 +254,1348 @@ struct QueueStats {
         contention_events.store(0, std::memory_order_relaxed);
     }
 
-    double get_enqueue_success_rate() const noexcept {
-        auto attempts = enqueue_attempts.load(std::memory_order_relaxed);
-        if (attempts == 0) return 0.0;
-        return static_cast<double>(enqueue_successes.load(std::memory_order_relaxed)) / attempts;
-    }
+    double get_enqueue_success_rate() const noexcept {
+        auto attempts = enqueue_attempts.load(std::memory_order_relaxed);
+        if (attempts == 0) return 0.0;
+        return static_cast<double>(enqueue_successes.load(std::memory_order_relaxed)) / attempts;
+    }
+
+    double get_dequeue_success_rate() const noexcept {
+        auto attempts = dequeue_attempts.load(std::memory_order_relaxed);
+        if (attempts == 0) return 0.0;
+        return static_cast<double>(dequeue_successes.load(std::memory_order_relaxed)) / attempts;
+    }
+
+    QueueStatsSnapshot snapshot() const noexcept {
+        QueueStatsSnapshot s;
+        s.enqueue_attempts = enqueue_attempts.load(std::memory_order_relaxed);
+        s.enqueue_successes = enqueue_successes.load(std::memory_order_relaxed);
+        s.dequeue_attempts = dequeue_attempts.load(std::memory_order_relaxed);
+        s.dequeue_successes = dequeue_successes.load(std::memory_order_relaxed);
+        s.batch_enqueues = batch_enqueues.load(std::memory_order_relaxed);
+        s.batch_dequeues = batch_dequeues.load(std::memory_order_relaxed);
+        s.contention_events = contention_events.load(std::memory_order_relaxed);
+        return s;
+    }
+};
+
+// How a queue collects statistics.
+//   Disabled  - no counting at all
+//   Shared    - one QueueStats block updated by every thread
+//   PerThread - one cache-line shard per thread, summed on read. Use this
+//               when stats stay on under multi-core load.
+enum class StatsMode : uint8_t {
+    Disabled,
+    Shared,
+    PerThread
+};
+
+// QueueStats split into cache-line-sized shards indexed by ThreadIndex.
+// Each thread normally owns its shard, so the relaxed fetch_add never
+// bounces a line between cores; threads that collide on a shard are still
+// counted correctly, just with some sharing.
+class ShardedQueueStats {
+private:
+    struct alignas(CACHE_LINE_SIZE) Shard : QueueStats {};
+
+    const size_t mask_;
+    std::unique_ptr<Shard[]> shards_;
+
+    static size_t shard_count() noexcept {
+        size_t n = 1;
+        size_t threads = std::thread::hardware_concurrency();
+        while (n < threads && n < ThreadIndex::MAX_THREADS) n <<= 1;
+        return n;
+    }
+
+public:
+    ShardedQueueStats()
+        : mask_(shard_count() - 1),
+          shards_(std::make_unique<Shard[]>(mask_ + 1)) {}
+
+    QueueStats& local() noexcept {
+        return shards_[ThreadIndex::get() & mask_];
+    }
+
+    QueueStatsSnapshot snapshot() const noexcept {
+        QueueStatsSnapshot total;
+        for (size_t i = 0; i <= mask_; ++i) {
+            QueueStatsSnapshot s = shards_[i].snapshot();
+            total.enqueue_attempts += s.enqueue_attempts;
+            total.enqueue_successes += s.enqueue_successes;
+            total.dequeue_attempts += s.dequeue_attempts;
+            total.dequeue_successes += s.dequeue_successes;
+            total.batch_enqueues += s.batch_enqueues;
+            total.batch_dequeues += s.batch_dequeues;
+            total.contention_events += s.contention_events;
+        }
+        return total;
+    }
+
+    void reset() noexcept {
+        for (size_t i = 0; i <= mask_; ++i) shards_[i].reset();
+    }
+
+    size_t memory_usage() const noexcept {
+        return sizeof(*this) + (mask_ + 1) * sizeof(Shard);
+    }
+};
+
+// Statistics storage for one queue in the selected StatsMode
+class QueueStatsCollector {
+private:
+    mutable QueueStats stats_;
+    const StatsMode mode_;
+    std::unique_ptr<ShardedQueueStats> sharded_;
+
+public:
+    explicit QueueStatsCollector(StatsMode mode)
+        : mode_(mode),
+          sharded_(mode == StatsMode::PerThread ? std::make_unique<ShardedQueueStats>() : nullptr) {}
+
+    StatsMode mode() const noexcept {
+        return mode_;
+    }
+
+    void record(std::atomic<uint64_t> QueueStats::*counter) noexcept {
+        if (mode_ == StatsMode::Disabled) return;
+        QueueStats& target = mode_ == StatsMode::PerThread ? sharded_->local() : stats_;
+        (target.*counter).fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // In PerThread mode the shards are summed into the returned block on
+    // every call, so the reference reflects the counts as of the last call
+    // rather than live values.
+    const QueueStats& get() const noexcept {
+        if (mode_ == StatsMode::PerThread) {
+            QueueStatsSnapshot s = sharded_->snapshot();
+            stats_.enqueue_attempts.store(s.enqueue_attempts, std::memory_order_relaxed);
+            stats_.enqueue_successes.store(s.enqueue_successes, std::memory_order_relaxed);
+            stats_.dequeue_attempts.store(s.dequeue_attempts, std::memory_order_relaxed);
+            stats_.dequeue_successes.store(s.dequeue_successes, std::memory_order_relaxed);
+            stats_.batch_enqueues.store(s.batch_enqueues, std::memory_order_relaxed);
+            stats_.batch_dequeues.store(s.batch_dequeues, std::memory_order_relaxed);
+            stats_.contention_events.store(s.contention_events, std::memory_order_relaxed);
+        }
+        return stats_;
+    }
+
+    QueueStatsSnapshot snapshot() const noexcept {
+        if (mode_ == StatsMode::PerThread) {
+            return sharded_->snapshot();
+        }
+        return stats_.snapshot();
+    }
+
+    void reset() noexcept {
+        stats_.reset();
+        if (sharded_) sharded_->reset();
+    }
+
+    // Heap memory owned beyond sizeof(QueueStatsCollector)
+    size_t memory_usage() const noexcept {
+        return sharded_ ? sharded_->memory_usage() : 0;
+    }
+};
+
+// Utility function to round up to power of two
+constexpr size_t round_up_to_power_of_two(size_t v) noexcept {
+    if (v <= 1) return 2; // Minimum capacity 2
+    if (v > (SIZE_MAX >> 1)) return SIZE_MAX; // Prevent overflow
+
+    // Use builtin if available (GCC/Clang)
+    #if defined(__GNUC__) || defined(__clang__)
+    return size_t(1) << (64 - __builtin_clzll(v - 1));
+    #else
+    // Fallback implementation
+    v--;
+    v |= v >> 1; v |= v >> 2; v |= v >> 4; v |= v >> 8; v |= v >> 16;
+    #if SIZE_MAX > 0xFFFFFFFF
+    v |= v >> 32;
+    #endif
+    return ++v;
+    #endif
+}
+
+// Capacity value meaning "chosen at construction time"
+constexpr size_t dynamic_capacity = 0;
+
+// How slots are laid out in the ring.
+//   Padded - every slot on its own cache line, so neighbouring slots never
+//            false-share. The right default for MPMC traffic on Packet.
+//   Packed - slots are only naturally aligned, so several small slots
+//            (e.g. 8- or 16-byte descriptors) share a line. Uses a fraction
+//            of the memory when false sharing is not the bottleneck.
+//   Split  - structure of arrays: the sequence numbers form one array and
+//            the elements another, so a ring of 16-byte descriptors costs
+//            24 bytes per slot and the elements stay densely packed.
+enum class SlotLayout : uint8_t {
+    Padded,
+    Packed,
+    Split
+};
+
+// How many threads may use one side of a queue at the same time.
+// A Single side skips the CAS on its index: it owns the index outright and
+// uses plain loads and stores. Its operations are wait-free and report
+// full/empty if the next slot is still being used by the other side.
+enum class Cardinality : uint8_t {
+    Multi,
+    Single
+};
+
+// Compile-time queue options. Derive from DefaultQueuePolicy and override
+// only the members you need to change.
+struct DefaultQueuePolicy {
+    static constexpr SlotLayout slot_layout = SlotLayout::Padded;
+    static constexpr Cardinality producers = Cardinality::Multi;
+    static constexpr Cardinality consumers = Cardinality::Multi;
+    using wait_strategy = BackoffWait<>;  // See wait_strategy.h
+    // true makes every successful operation signal the queue's wait events,
+    // which enqueue_wait(), dequeue_wait(), the coroutine awaitables and
+    // SpinParkWait sleep on. The signal costs a full fence per operation;
+    // false compiles it out and those waits with it.
+    static constexpr bool blocking = false;
+    using instrumentation = NoInstrumentation;  // See queue_trace.h
+    // false compiles the QueueStats counters out; StatsMode is then ignored
+    static constexpr bool collect_stats = true;
+    // SteadyLatencyClock or TscLatencyClock stamps every element on enqueue
+    // and records its time in the queue (see latency_histogram.h)
+    using latency_clock = void;
+    // Refresh approx_size() every this many operations per side; 0 = never
+    static constexpr size_t occupancy_hint_interval = 32;
+    // consume_batch() prefetches the payload this many elements ahead of
+    // the callback and the slot twice as far; 0 = no prefetch
+    static constexpr size_t prefetch_distance = 4;
+    // Type of the ticket counters in the indexes and slots. uint32_t halves
+    // the sequence words and avoids 64-bit atomics on 32-bit cores; the
+    // counters then wrap every 2^32 operations, which is handled, and the
+    // capacity is limited to 2^30. A CAS could only be fooled (ABA) by a
+    // thread stalled between its load and CAS for an exact multiple of 2^32
+    // operations, i.e. for about 40 seconds at 100M operations per second.
+    using sequence_type = size_t;
+    // Where the counters start. Setting it just below the wrap point, as
+    // the Linux kernel does with INITIAL_JIFFIES, makes tests cross it early.
+    static constexpr uint64_t initial_sequence = 0;
+};
+
+struct BlockingQueuePolicy : DefaultQueuePolicy {
+    static constexpr bool blocking = true;
+};
+
+struct PackedQueuePolicy : DefaultQueuePolicy {
+    static constexpr SlotLayout slot_layout = SlotLayout::Packed;
+};
+
+struct SplitQueuePolicy : DefaultQueuePolicy {
+    static constexpr SlotLayout slot_layout = SlotLayout::Split;
+};
+
+struct SPSCQueuePolicy : DefaultQueuePolicy {
+    static constexpr Cardinality producers = Cardinality::Single;
+    static constexpr Cardinality consumers = Cardinality::Single;
+};
+
+struct MPSCQueuePolicy : DefaultQueuePolicy {
+    static constexpr Cardinality consumers = Cardinality::Single;
+};
+
+struct SPMCQueuePolicy : DefaultQueuePolicy {
+    static constexpr Cardinality producers = Cardinality::Single;
+};
+
+// Caller-owned memory for a queue's control block and slots, e.g. part of a
+// shared-memory segment. Size it with BasicMPMCQueue::storage_bytes() and
+// align it to storage_alignment(). Construct initialises the block; Attach
+// adopts one that a queue of the same type and capacity initialised,
+// possibly in another process. The queue never frees or destroys it.
+struct ExternalQueueMemory {
+    enum class Init : uint8_t {
+        Construct,
+        Attach
+    };
+
+    void* data = nullptr;
+    size_t bytes = 0;
+    Init init = Init::Construct;
+    bool process_shared = false;  // Park waiters on process-shared futexes
+};
+
+namespace detail {
+
+template <typename T, SlotLayout Layout, typename Seq = size_t>
+struct QueueSlot;
+
+template <typename T, typename Seq>
+struct alignas(CACHE_LINE_SIZE) QueueSlot<T, SlotLayout::Padded, Seq> {
+    T value;
+    std::atomic<Seq> seq;
+
+    QueueSlot() : value(), seq(0) {}
+};
+
+template <typename T, typename Seq>
+struct QueueSlot<T, SlotLayout::Packed, Seq> {
+    T value;
+    std::atomic<Seq> seq;
+
+    QueueSlot() : value(), seq(0) {}
+};
+
+// Slot with the enqueue timestamp used for latency timing
+template <typename T, SlotLayout Layout, typename Seq = size_t>
+struct TimedQueueSlot : QueueSlot<T, Layout, Seq> {
+    uint64_t stamp = 0;
+};
+
+// SlotLayout::Split keeps only the sequence (and timestamp) per slot; the
+// element lives at the same index of a separate array
+template <bool Timed, typename Seq = size_t>
+struct SplitSlotMeta {
+    std::atomic<Seq> seq;
+
+    SplitSlotMeta() : seq(0) {}
+};
+
+template <typename Seq>
+struct SplitSlotMeta<true, Seq> : SplitSlotMeta<false, Seq> {
+    uint64_t stamp = 0;
+};
+
+// The two halves of one split slot, used where a whole slot would be
+template <typename T, typename Meta, typename Seq = size_t>
+struct SplitSlotRef {
+    std::atomic<Seq>& seq;
+    T& value;
+    Meta& meta;
+};
+
+// Elements that reach their payload through a `data` pointer, like Packet,
+// or a data() accessor, like CompactPacket
+template <typename T, typename = void>
+struct has_payload_member : std::false_type {};
+
+template <typename T>
+struct has_payload_member<T, std::void_t<decltype(std::declval<const T&>().data)>>
+    : std::is_pointer<decltype(std::declval<const T&>().data)> {};
+
+template <typename T, typename = void>
+struct has_payload_accessor : std::false_type {};
+
+template <typename T>
+struct has_payload_accessor<T, std::void_t<decltype(std::declval<const T&>().data())>>
+    : std::is_pointer<decltype(std::declval<const T&>().data())> {};
+
+template <typename T>
+struct has_payload_pointer
+    : std::integral_constant<bool, has_payload_member<T>::value || has_payload_accessor<T>::value> {};
+
+template <typename T>
+const void* payload_of(const T& value) noexcept {
+    if constexpr (has_payload_member<T>::value) {
+        return value.data;
+    } else {
+        return value.data();
+    }
+}
+
+inline void prefetch_read(const void* address) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address, 0, 3);
+#else
+    (void)address;
+#endif
+}
+
+// Capacity and index mask; compile-time constants when Capacity is fixed
+template <size_t Capacity>
+struct QueueCapacity {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "Fixed capacity must be a power of two and at least 2");
+
+    static constexpr size_t capacity_ = Capacity;
+    static constexpr size_t mask_ = Capacity - 1;
+};
+
+template <>
+struct QueueCapacity<dynamic_capacity> {
+    const size_t capacity_;
+    const size_t mask_;
+
+    // max_capacity is the largest ring the queue's counters can index
+    explicit QueueCapacity(size_t capacity, size_t max_capacity = SIZE_MAX >> 1)
+        : capacity_(round_up_to_power_of_two(capacity)),
+          mask_(capacity_ - 1) {
+
+        if (capacity == 0) {
+            throw std::invalid_argument("Capacity must be greater than 0");
+        }
+
+        if (capacity_ > max_capacity) {
+            throw std::invalid_argument("Capacity too large");
+        }
+    }
+};
+
+// Control words of one queue, each on its own line: the producer and
+// consumer indexes, the occupancy hint and the two parking spots
+template <typename Seq = size_t>
+struct QueueControl {
+    alignas(CACHE_LINE_SIZE) std::atomic<Seq> head{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<Seq> tail{0};
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> occupancy_hint{0};
+    alignas(CACHE_LINE_SIZE) WaitEvent not_empty;
+    alignas(CACHE_LINE_SIZE) WaitEvent not_full;
+
+    QueueControl() = default;
+    explicit QueueControl(bool process_shared) noexcept
+        : not_empty(process_shared), not_full(process_shared) {}
+};
+
+// One block holding the control words followed by the slot array, either
+// on the heap (placed by first touch), in a MemoryRegion bound to a NUMA
+// node and/or backed by hugepages, or in caller-owned external memory.
+// With a Value type, the slots hold only sequence numbers and a second,
+// line-aligned array of Value follows them.
+template <typename Slot, typename Value = void, typename Seq = size_t>
+class QueueStorage {
+public:
+    using Control = QueueControl<Seq>;
+
+    static constexpr bool split = !std::is_void<Value>::value;
+    static constexpr size_t VALUE_ALIGNMENT = alignof(std::conditional_t<split, Value, char>);
+
+    static constexpr size_t SLOTS_OFFSET =
+        (sizeof(Control) + alignof(Slot) - 1) & ~(alignof(Slot) - 1);
+    static constexpr size_t ALIGNMENT = std::max({alignof(Slot), VALUE_ALIGNMENT, CACHE_LINE_SIZE});
+
+    static constexpr size_t values_offset(size_t count) noexcept {
+        return (SLOTS_OFFSET + count * sizeof(Slot) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    }
+
+    static constexpr size_t bytes_for(size_t count) noexcept {
+        if constexpr (split) {
+            return values_offset(count) + count * sizeof(Value);
+        } else {
+            return SLOTS_OFFSET + count * sizeof(Slot);
+        }
+    }
+
+private:
+    const size_t count_;
+    MemoryRegion region_;
+    void* base_;
+    const bool external_ = false;
+
+    void construct(bool process_shared = false) {
+        new (base_) Control(process_shared);
+        Slot* slots = this->slots();
+        size_t i = 0;
+        try {
+            for (; i < count_; ++i) new (&slots[i]) Slot();
+        } catch (...) {
+            while (i != 0) slots[--i].~Slot();
+            free_block();
+            throw;
+        }
+        if constexpr (split) {
+            Value* values = this->values();
+            i = 0;
+            try {
+                for (; i < count_; ++i) new (&values[i]) Value();
+            } catch (...) {
+                while (i != 0) values[--i].~Value();
+                for (size_t j = 0; j < count_; ++j) slots[j].~Slot();
+                free_block();
+                throw;
+            }
+        }
+    }
+
+    void free_block() noexcept {
+        if (region_.data() == nullptr && !external_) {
+            ::operator delete(base_, std::align_val_t(ALIGNMENT));
+        }
+    }
+
+public:
+    explicit QueueStorage(size_t count)
+        : count_(count),
+          base_(::operator new(bytes_for(count), std::align_val_t(ALIGNMENT))) {
+        construct();
+    }
+
+    QueueStorage(size_t count, const MemoryRegionOptions& placement)
+        : count_(count),
+          region_(bytes_for(count), placement),
+          base_(region_.data()) {
+        construct();
+    }
+
+    QueueStorage(size_t count, const ExternalQueueMemory& memory)
+        : count_(count),
+          base_(memory.data),
+          external_(true) {
+        if (memory.data == nullptr || memory.bytes < bytes_for(count)) {
+            throw std::invalid_argument("External queue memory too small");
+        }
+        if (reinterpret_cast<uintptr_t>(memory.data) % ALIGNMENT != 0) {
+            throw std::invalid_argument("External queue memory misaligned");
+        }
+        if (memory.init == ExternalQueueMemory::Init::Construct) {
+            construct(memory.process_shared);
+        }
+    }
+
+    QueueStorage(const QueueStorage&) = delete;
+    QueueStorage& operator=(const QueueStorage&) = delete;
+
+    ~QueueStorage() {
+        // External memory may still be in use by other queues attached to it
+        if (external_) return;
+        Slot* slots = this->slots();
+        for (size_t i = 0; i < count_; ++i) slots[i].~Slot();
+        if constexpr (split) {
+            Value* values = this->values();
+            for (size_t i = 0; i < count_; ++i) values[i].~Value();
+        }
+        control().~Control();
+        free_block();
+    }
+
+    Control& control() noexcept {
+        return *static_cast<Control*>(base_);
+    }
+
+    Slot* slots() noexcept {
+        return reinterpret_cast<Slot*>(static_cast<unsigned char*>(base_) + SLOTS_OFFSET);
+    }
+
+    // The element array of a split layout; nullptr otherwise
+    auto values() noexcept {
+        if constexpr (split) {
+            return reinterpret_cast<Value*>(static_cast<unsigned char*>(base_) + values_offset(count_));
+        } else {
+            return nullptr;
+        }
+    }
+
+    // Bytes reserved for the block; whole pages for a MemoryRegion
+    size_t bytes() const noexcept {
+        return region_.data() != nullptr ? region_.size() : bytes_for(count_);
+    }
+
+    bool external() const noexcept {
+        return external_;
+    }
+
+    MemoryPlacement placement() const noexcept {
+        if (region_.data() != nullptr) return region_.placement();
+        return {PageBacking::Regular, numa_node_of(base_)};
+    }
+};
+
+} // namespace detail
+
+// Lock-free bounded MPMC queue over any default-constructible element type.
+//
+// Capacity fixes the ring size at compile time (the index mask becomes an
+// immediate), or leave it as dynamic_capacity to pick it per instance.
+// Policy selects compile-time options such as the slot layout.
+template <typename T, size_t Capacity = dynamic_capacity, typename Policy = DefaultQueuePolicy>
+class BasicMPMCQueue : private detail::QueueCapacity<Capacity> {
+private:
+    static_assert(std::is_default_constructible<T>::value,
+                  "BasicMPMCQueue elements must be default constructible");
+    static_assert(std::is_nothrow_move_assignable<T>::value,
+                  "BasicMPMCQueue elements must be nothrow move assignable");
+
+    // Enqueue-to-dequeue timing; adds a timestamp to every slot
+    static constexpr bool timed = !std::is_void<typename Policy::latency_clock>::value;
+    using LatencyClock = std::conditional_t<timed, typename Policy::latency_clock, SteadyLatencyClock>;
+
+    // Split keeps sequences and elements in two arrays of one block
+    static constexpr bool split = Policy::slot_layout == SlotLayout::Split;
+
+    // Ticket counters wrap around; they are only ever compared through
+    // seq_distance(), never with < or >=
+    using Seq = typename Policy::sequence_type;
+    using SignedSeq = std::make_signed_t<Seq>;
+    static_assert(std::is_unsigned<Seq>::value && sizeof(Seq) >= sizeof(unsigned),
+                  "sequence_type must be an unsigned type of at least 32 bits");
+    static constexpr size_t MAX_CAPACITY = std::min<size_t>(Seq(-1) >> 1, SIZE_MAX >> 1);
+    static_assert(Capacity <= MAX_CAPACITY, "Capacity too large for the sequence type");
+
+    using Slot = std::conditional_t<
+        split, detail::SplitSlotMeta<timed, Seq>,
+        std::conditional_t<timed, detail::TimedQueueSlot<T, Policy::slot_layout, Seq>,
+                           detail::QueueSlot<T, Policy::slot_layout, Seq>>>;
+    using Storage = detail::QueueStorage<Slot, std::conditional_t<split, T, void>, Seq>;
+
+    static constexpr bool single_producer = Policy::producers == Cardinality::Single;
+    static constexpr bool single_consumer = Policy::consumers == Cardinality::Single;
+    using detail::QueueCapacity<Capacity>::capacity_;
+    using detail::QueueCapacity<Capacity>::mask_;
+
+    // Hot-path hooks; every call site is compiled out when disabled
+    using Instrument = typename Policy::instrumentation;
+    static constexpr bool traced = Instrument::enabled;
+
+    // What to do while an operation cannot make progress. Instrumented
+    // queues wrap the strategy to report retries and slot waits.
+    using Backoff = std::conditional_t<traced,
+                                       detail::TracedWait<typename Policy::wait_strategy, Instrument>,
+                                       typename Policy::wait_strategy>;
+
+    static constexpr size_t hint_interval = Policy::occupancy_hint_interval;
+    static_assert((hint_interval & (hint_interval - 1)) == 0,
+                  "occupancy_hint_interval must be 0 or a power of two");
+
+    static constexpr bool blocking = Policy::blocking;
+    static_assert(blocking || !detail::parks_on_event<typename Policy::wait_strategy>::value,
+                  "a wait_strategy that parks on the queue's events needs blocking = true");
+
+    // Slots and every shared control word live in storage_; the members
+    // below are read-only after construction and share one line
+    Storage storage_;
+    alignas(CACHE_LINE_SIZE) Slot* const buffer_;
+    T* const values_;  // Split layout only
+    std::atomic<Seq>& head_seq_;
+    std::atomic<Seq>& tail_seq_;
+
+    // Occupancy estimate for approx_size(), refreshed by whichever side
+    // moves its index across a multiple of occupancy_hint_interval. Readers
+    // such as QueueGroup never touch the head/tail lines.
+    std::atomic<size_t>& occupancy_hint_;
+
+    // Parking spots for dequeue_wait()/enqueue_wait(). Producers signal
+    // not_empty_, consumers signal not_full_; both are no-ops without waiters,
+    // and compiled out unless the policy is blocking.
+    WaitEvent& not_empty_;
+    WaitEvent& not_full_;
+
+    void signal_not_empty() noexcept {
+        if constexpr (blocking) not_empty_.notify_all();
+    }
+
+    void signal_not_full() noexcept {
+        if constexpr (blocking) not_full_.notify_all();
+    }
+    
+    // Statistics (optional, can be disabled for performance)
+    QueueStatsCollector stats_;
+    std::unique_ptr<LatencyHistogram> latency_;
+
+    void record_stat(std::atomic<uint64_t> QueueStats::*counter) noexcept {
+        if constexpr (Policy::collect_stats) {
+            stats_.record(counter);
+        }
+    }
+
+    static constexpr StatsMode effective_stats_mode(StatsMode mode) noexcept {
+        return Policy::collect_stats ? mode : StatsMode::Disabled;
+    }
+
+    Backoff make_backoff(TraceOp op) const noexcept {
+        if constexpr (traced) {
+            return Backoff(this, op);
+        } else {
+            (void)op;
+            return Backoff();
+        }
+    }
+
+    void trace_cas_failure(TraceOp op) const noexcept {
+        if constexpr (traced) Instrument::cas_failure(this, op);
+    }
+
+    void trace_batch(TraceOp op, size_t requested, size_t achieved) const noexcept {
+        if constexpr (traced) Instrument::batch(this, op, requested, achieved);
+    }
+
+    // Latency timing; no-ops unless the policy sets latency_clock
+    static uint64_t latency_now() noexcept {
+        if constexpr (timed) {
+            return LatencyClock::now();
+        } else {
+            return 0;
+        }
+    }
+
+    // The slot holding position pos: a Slot&, or for the split layout a
+    // SplitSlotRef to its sequence and element
+    decltype(auto) slot_at(size_t pos) noexcept {
+        if constexpr (split) {
+            Slot& meta = buffer_[pos & mask_];
+            return detail::SplitSlotRef<T, Slot, Seq>{meta.seq, values_[pos & mask_], meta};
+        } else {
+            return (buffer_[pos & mask_]);
+        }
+    }
+
+    template <typename S>
+    static decltype(auto) slot_meta(S& slot) noexcept {
+        if constexpr (split) {
+            return (slot.meta);
+        } else {
+            return (slot);
+        }
+    }
+
+    template <typename S>
+    static void stamp(S& slot, uint64_t now) noexcept {
+        if constexpr (timed) {
+            slot_meta(slot).stamp = now;
+        } else {
+            (void)slot;
+            (void)now;
+        }
+    }
+
+    template <typename S>
+    void record_latency(S& slot, uint64_t now) noexcept {
+        if constexpr (timed) {
+            // Clamp ticks that went backwards across cores
+            const uint64_t stamped = slot_meta(slot).stamp;
+            latency_->record(LatencyClock::to_ns(now > stamped ? now - stamped : 0));
+        } else {
+            (void)slot;
+            (void)now;
+        }
+    }
+
+    // How far to is ahead of from, negative if behind. Correct across a
+    // wrap as long as the two are less than half the counter range apart,
+    // which MAX_CAPACITY guarantees for every pair the queue compares.
+    static constexpr SignedSeq seq_distance(Seq from, Seq to) noexcept {
+        return static_cast<SignedSeq>(static_cast<Seq>(to - from));
+    }
+
+    static constexpr bool crosses_hint_boundary(Seq first, size_t n) noexcept {
+        return (first & ~(hint_interval - 1)) != (static_cast<Seq>(first + n) & ~(hint_interval - 1));
+    }
+
+    void store_hint(SignedSeq occupancy) noexcept {
+        // The two indexes are read at different times; clamp a torn pair
+        size_t value = occupancy < 0 ? 0 : std::min(static_cast<size_t>(occupancy), capacity_);
+        occupancy_hint_.store(value, std::memory_order_relaxed);
+    }
+
+    // [first, first + n) was just published by a producer
+    void refresh_hint_after_push(Seq first, size_t n) noexcept {
+        if constexpr (hint_interval != 0) {
+            if (crosses_hint_boundary(first, n)) {
+                store_hint(seq_distance(head_seq_.load(std::memory_order_relaxed),
+                                        static_cast<Seq>(first + n)));
+            }
+        }
+    }
+
+    // [first, first + n) was just released by a consumer
+    void refresh_hint_after_pop(Seq first, size_t n) noexcept {
+        if constexpr (hint_interval != 0) {
+            if (crosses_hint_boundary(first, n)) {
+                store_hint(seq_distance(static_cast<Seq>(first + n),
+                                        tail_seq_.load(std::memory_order_relaxed)));
+            }
+        }
+    }
+
+    // Initialize sequence numbers, unless attaching to a block another
+    // queue initialised, and process-local state
+    void init_sequences(bool attach = false) {
+        if (!attach) {
+            const Seq first = static_cast<Seq>(Policy::initial_sequence);
+            for (size_t i = 0; i < capacity_; ++i) {
+                slot_at(first + i).seq.store(static_cast<Seq>(first + i), std::memory_order_relaxed);
+            }
+            head_seq_.store(first, std::memory_order_relaxed);
+            tail_seq_.store(first, std::memory_order_relaxed);
+        }
+        if constexpr (timed) {
+            LatencyClock::calibrate();
+            latency_ = std::make_unique<LatencyHistogram>();
+        }
+    }
+
+    // Single-producer enqueue. The slot's own sequence tells us whether it
+    // is free, so the consumer index is never read on this path; the tail
+    // is published after the slot so consumers never see it run ahead.
+    template <typename U>
+    bool push_single_producer(U&& packet) noexcept {
+        Seq tail = tail_seq_.load(std::memory_order_relaxed);
+        auto&& slot = slot_at(tail);
+        if (slot.seq.load(std::memory_order_acquire) != tail) {
+            return false;
+        }
+        slot.value = std::forward<U>(packet);
+        stamp(slot, latency_now());
+        slot.seq.store(tail + 1, std::memory_order_release);
+        tail_seq_.store(tail + 1, std::memory_order_release);
+        refresh_hint_after_push(tail, 1);
+        return true;
+    }
+
+    // Single-consumer dequeue, the mirror of push_single_producer
+    std::optional<T> pop_single_consumer() noexcept {
+        Seq head = head_seq_.load(std::memory_order_relaxed);
+        auto&& slot = slot_at(head);
+        if (slot.seq.load(std::memory_order_acquire) != head + 1) {
+            return std::nullopt;
+        }
+        T packet = std::move(slot.value);
+        record_latency(slot, latency_now());
+        slot.seq.store(head + capacity_, std::memory_order_release);
+        head_seq_.store(head + 1, std::memory_order_release);
+        refresh_hint_after_pop(head, 1);
+        return packet;
+    }
+
+    template <typename Source>
+    size_t push_batch_single_producer(size_t n, Source& source) noexcept {
+        Seq tail = tail_seq_.load(std::memory_order_relaxed);
+        const uint64_t now = latency_now();
+        size_t count = 0;
+        for (; count < n; ++count) {
+            auto&& slot = slot_at(tail + count);
+            if (slot.seq.load(std::memory_order_acquire) != static_cast<Seq>(tail + count)) break;
+            slot.value = source(count);
+            stamp(slot, now);
+            slot.seq.store(tail + count + 1, std::memory_order_release);
+        }
+        tail_seq_.store(tail + count, std::memory_order_release);
+        refresh_hint_after_push(tail, count);
+        return count;
+    }
+
+    // Run fn on up to n claimed elements starting at head, in place, then
+    // hand all their slots back at once. A single consumer stops at the
+    // first unpublished slot; a multi consumer owns [head, head + n) and
+    // waits for each producer to publish.
+    template <typename F>
+    size_t consume_claimed(Seq head, size_t n, F& fn, Backoff& backoff) noexcept {
+        constexpr size_t distance = Policy::prefetch_distance;
+        const uint64_t now = latency_now();
+        size_t count = 0;
+        for (; count < n; ++count) {
+            auto&& slot = slot_at(head + count);
+            Seq seq = slot.seq.load(std::memory_order_acquire);
+            if constexpr (single_consumer) {
+                if (seq != static_cast<Seq>(head + count + 1)) break;
+            } else {
+                while (seq != static_cast<Seq>(head + count + 1)) {
+                    backoff.wait(slot.seq, seq, not_empty_);
+                    seq = slot.seq.load(std::memory_order_acquire);
+                }
+            }
+
+            if constexpr (distance != 0) {
+                detail::prefetch_read(&buffer_[(head + count + 2 * distance) & mask_]);
+                if constexpr (split) {
+                    detail::prefetch_read(&values_[(head + count + 2 * distance) & mask_]);
+                }
+                if constexpr (detail::has_payload_pointer<T>::value) {
+                    // Only a published slot's element may be read
+                    auto&& ahead = slot_at(head + count + distance);
+                    if (count + distance < n &&
+                        ahead.seq.load(std::memory_order_acquire) == static_cast<Seq>(head + count + distance + 1) &&
+                        detail::payload_of(ahead.value) != nullptr) {
+                        detail::prefetch_read(detail::payload_of(ahead.value));
+                    }
+                }
+            }
+
+            fn(slot.value);
+            record_latency(slot, now);
+        }
+
+        for (size_t i = 0; i < count; ++i) {
+            buffer_[(head + i) & mask_].seq.store(head + i + capacity_, std::memory_order_release);
+        }
+        if constexpr (single_consumer) {
+            head_seq_.store(head + count, std::memory_order_release);
+        }
+        refresh_hint_after_pop(head, count);
+        return count;
+    }
+
+    size_t pop_batch_single_consumer(my_std::span<T> packets) noexcept {
+        Seq head = head_seq_.load(std::memory_order_relaxed);
+        const uint64_t now = latency_now();
+        size_t count = 0;
+        for (; count < packets.size(); ++count) {
+            auto&& slot = slot_at(head + count);
+            if (slot.seq.load(std::memory_order_acquire) != static_cast<Seq>(head + count + 1)) break;
+            packets[count] = std::move(slot.value);
+            record_latency(slot, now);
+            slot.seq.store(head + count + capacity_, std::memory_order_release);
+        }
+        head_seq_.store(head + count, std::memory_order_release);
+        refresh_hint_after_pop(head, count);
+        return count;
+    }
+
+    // Batch enqueue of up to n elements. source(i) yields element i and is
+    // called once per accepted element, in order, so it may consume a
+    // forward-only sequence.
+    template <typename Source>
+    size_t enqueue_batch_n(size_t n, Source&& source) noexcept {
+        if (n == 0) return 0;
+        
+        record_stat(&QueueStats::batch_enqueues);
+
+        size_t enqueued_count = 0;
+        Backoff backoff = make_backoff(TraceOp::EnqueueBatch);
+
+        if constexpr (single_producer) {
+            enqueued_count = push_batch_single_producer(n, source);
+        } else {
+            while (enqueued_count < n) {
+                Seq tail = tail_seq_.load(std::memory_order_acquire);
+                Seq head = head_seq_.load(std::memory_order_acquire);
+            
+                if (static_cast<Seq>(tail - head) >= capacity_) {
+                    break; // Queue is full
+                }
+
+                size_t available_space = capacity_ - static_cast<Seq>(tail - head);
+                size_t batch_size = std::min(n - enqueued_count, available_space);
+            
+                if (batch_size == 0) {
+                    backoff();
+                    continue;
+                }
+
+                if (tail_seq_.compare_exchange_weak(tail, tail + batch_size,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_acquire)) {
+                    // Successfully reserved slots
+                    const uint64_t now = latency_now();
+                    for (size_t i = 0; i < batch_size; ++i) {
+                        auto&& slot = slot_at(tail + i);
+                    
+                        // Wait for the previous lap's consumer to release it
+                        Seq seq;
+                        while ((seq = slot.seq.load(std::memory_order_acquire)) != static_cast<Seq>(tail + i)) {
+                            backoff.wait(slot.seq, seq, not_full_);
+                        }
+                    
+                        slot.value = source(enqueued_count + i);
+                        stamp(slot, now);
+                        slot.seq.store(tail + i + 1, std::memory_order_release);
+                    }
+                    refresh_hint_after_push(tail, batch_size);
+                    enqueued_count += batch_size;
+                    backoff.reset();
+                } else {
+                    trace_cas_failure(TraceOp::EnqueueBatch);
+                    backoff();
+                }
+            }
+        }
+        trace_batch(TraceOp::EnqueueBatch, n, enqueued_count);
+        if (enqueued_count != 0) {
+            signal_not_empty();
+        }
+        return enqueued_count;
+    }
+
+    // One claim attempt; gives up on a full queue or a lost race
+    template <typename U>
+    bool try_push(U&& packet) noexcept {
+        if constexpr (single_producer) {
+            if (!push_single_producer(std::forward<U>(packet))) return false;
+            signal_not_empty();
+            return true;
+        }
+
+        Seq tail = tail_seq_.load(std::memory_order_relaxed);
+        auto&& slot = slot_at(tail);
+        Seq seq = slot.seq.load(std::memory_order_acquire);
+        
+        if (seq == tail && tail_seq_.compare_exchange_strong(tail, tail + 1,
+                                                            std::memory_order_relaxed,
+                                                            std::memory_order_relaxed)) {
+            slot.value = std::forward<U>(packet);
+            stamp(slot, latency_now());
+            slot.seq.store(tail + 1, std::memory_order_release);
+            refresh_hint_after_push(tail, 1);
+            signal_not_empty();
+            return true;
+        }
+        return false;
+    }
+
+    // Retry op until it succeeds, parking on event between attempts
+    template <typename Rep, typename Period, typename Op>
+    bool wait_until_done(WaitEvent& event, const std::chrono::duration<Rep, Period>& timeout,
+                         Op&& op) noexcept {
+        if (op()) return true;
+
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+        while (true) {
+            uint32_t key = event.prepare_wait();
+            if (op()) {
+                event.cancel_wait();
+                return true;
+            }
+            if (!event.wait(key, deadline)) {
+                return op(); // One last try after the timeout
+            }
+            if (op()) return true;
+        }
+    }
+
+public:
+    using value_type = T;
+
+    // Producer handle to one reserved slot. Fill packet() in place, then
+    // commit() to publish it. The slot still holds whatever its previous
+    // occupant left behind, so set every field you rely on. A handle that is
+    // destroyed without commit() is committed as-is: its ticket is already
+    // claimed and consumers cannot skip over it.
+    class WriteReservation {
+    private:
+        friend class BasicMPMCQueue;
+
+        BasicMPMCQueue* queue_ = nullptr;
+        T* value_ = nullptr;
+        Seq seq_ = 0;
+
+        WriteReservation(BasicMPMCQueue* queue, T* value, Seq seq) noexcept
+            : queue_(queue), value_(value), seq_(seq) {}
+
+    public:
+        WriteReservation() = default;
+
+        WriteReservation(WriteReservation&& other) noexcept
+            : queue_(other.queue_), value_(other.value_), seq_(other.seq_) {
+            other.value_ = nullptr;
+        }
+
+        WriteReservation& operator=(WriteReservation&& other) noexcept {
+            if (this != &other) {
+                commit();
+                queue_ = other.queue_;
+                value_ = other.value_;
+                seq_ = other.seq_;
+                other.value_ = nullptr;
+            }
+            return *this;
+        }
 
-    double get_dequeue_success_rate() const noexcept {
-        auto attempts = dequeue_attempts.load(std::memory_order_relaxed);
-        if (attempts == 0) return 0.0;
-        return static_cast<double>(dequeue_successes.load(std::memory_order_relaxed)) / attempts;
-    }
-};
+        WriteReservation(const WriteReservation&) = delete;
+        WriteReservation& operator=(const WriteReservation&) = delete;
 
-class MPMC_PacketQueue {
-private:
-    struct alignas(CACHE_LINE_SIZE) Slot {
-        Packet packet;
-        std::atomic<size_t> seq;
-        
-        Slot() : packet(), seq(0) {}
-        
-        static_assert(sizeof(Packet) + sizeof(std::atomic<size_t>) <= CACHE_LINE_SIZE, 
-                      "The combined size of Packet and std::atomic<size_t> must not exceed CACHE_LINE_SIZE.");
-        // Prevent false sharing by padding
-        char padding[CACHE_LINE_SIZE - sizeof(Packet) - sizeof(std::atomic<size_t>)];
+        ~WriteReservation() { commit(); }
+
+        explicit operator bool() const noexcept { return value_ != nullptr; }
+
+        T& value() noexcept { return *value_; }
+        T& packet() noexcept { return *value_; }
+        T& operator*() noexcept { return *value_; }
+        T* operator->() noexcept { return value_; }
+
+        // Publish the slot to consumers
+        void commit() noexcept {
+            if (value_ == nullptr) return;
+            auto&& slot = queue_->slot_at(seq_);
+            queue_->stamp(slot, latency_now());
+            slot.seq.store(seq_ + 1, std::memory_order_release);
+            value_ = nullptr;
+            queue_->refresh_hint_after_push(seq_, 1);
+            queue_->signal_not_empty();
+        }
     };
 
-    // Utility function to round up to power of two
-    static constexpr size_t round_up_to_power_of_two(size_t v) noexcept {
-        if (v <= 1) return 2; // Minimum capacity 2
-        if (v > (SIZE_MAX >> 1)) return SIZE_MAX; // Prevent overflow
-        
-        // Use builtin if available (GCC/Clang)
-        #if defined(__GNUC__) || defined(__clang__)
-        return size_t(1) << (64 - __builtin_clzll(v - 1));
-        #else
-        // Fallback implementation
-        v--;
-        v |= v >> 1; v |= v >> 2; v |= v >> 4; v |= v >> 8; v |= v >> 16;
-        #if SIZE_MAX > 0xFFFFFFFF
-        v |= v >> 32;
-        #endif
-        return ++v;
-        #endif
-    }
-
-    // Backoff strategy for contention
-    class Backoff {
-        static constexpr int MAX_SPINS = 16;
-        static constexpr int MAX_YIELDS = 64;
-        int count_ = 0;
+    // Consumer handle to one reserved slot. Read or modify packet() in
+    // place, then release() to hand the slot back to producers. Destroying
+    // the handle releases it.
+    class ReadReservation {
+    private:
+        friend class BasicMPMCQueue;
+
+        BasicMPMCQueue* queue_ = nullptr;
+        T* value_ = nullptr;
+        Seq seq_ = 0;
+
+        ReadReservation(BasicMPMCQueue* queue, T* value, Seq seq) noexcept
+            : queue_(queue), value_(value), seq_(seq) {
+            auto&& slot = queue_->slot_at(seq_);
+            queue_->record_latency(slot, latency_now());
+        }
 
     public:
-        void operator()() noexcept {
-            if (count_ < MAX_SPINS) {
-                // Spin with CPU pause
-                for (int i = 0; i < (1 << count_); ++i) {
-                    #if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
-                    __builtin_ia32_pause();
-                    #elif defined(__aarch64__) || defined(_M_ARM64)
-                    __asm__ __volatile__("yield" ::: "memory");
-                    #endif
-                }
-                ++count_;
-            } else if (count_ < MAX_SPINS + MAX_YIELDS) {
-                std::this_thread::yield();
-                ++count_;
-            } else {
-                std::this_thread::sleep_for(std::chrono::microseconds(1));
+        ReadReservation() = default;
+
+        ReadReservation(ReadReservation&& other) noexcept
+            : queue_(other.queue_), value_(other.value_), seq_(other.seq_) {
+            other.value_ = nullptr;
+        }
+
+        ReadReservation& operator=(ReadReservation&& other) noexcept {
+            if (this != &other) {
+                release();
+                queue_ = other.queue_;
+                value_ = other.value_;
+                seq_ = other.seq_;
+                other.value_ = nullptr;
             }
+            return *this;
         }
 
-        void reset() noexcept { count_ = 0; }
+        ReadReservation(const ReadReservation&) = delete;
+        ReadReservation& operator=(const ReadReservation&) = delete;
+
+        ~ReadReservation() { release(); }
+
+        explicit operator bool() const noexcept { return value_ != nullptr; }
+
+        T& value() noexcept { return *value_; }
+        T& packet() noexcept { return *value_; }
+        T& operator*() noexcept { return *value_; }
+        T* operator->() noexcept { return value_; }
+
+        // Return the slot to producers
+        void release() noexcept {
+            if (value_ == nullptr) return;
+            queue_->slot_at(seq_).seq.store(seq_ + queue_->capacity_, std::memory_order_release);
+            value_ = nullptr;
+            queue_->refresh_hint_after_pop(seq_, 1);
+            queue_->signal_not_full();
+        }
     };
 
-    const size_t capacity_;
-    const size_t mask_;
-    
-    // Align to cache line boundaries to prevent false sharing
-    alignas(CACHE_LINE_SIZE) std::unique_ptr<Slot[]> buffer_;
-    alignas(CACHE_LINE_SIZE) std::atomic<size_t> head_seq_;
-    alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail_seq_;
-    
-    // Statistics (optional, can be disabled for performance)
-    mutable QueueStats stats_;
-    const bool enable_stats_;
+    // Producer handle to a run of consecutive reserved slots, for filling a
+    // whole burst in place, e.g. straight from a NIC descriptor ring. Fill
+    // elements 0 .. size() - 1, then commit() to publish them in ring order.
+    // As with WriteReservation the tickets are already claimed, so every
+    // slot must be filled; a handle destroyed without commit() is committed
+    // as-is.
+    class WriteBatchReservation {
+    private:
+        friend class BasicMPMCQueue;
 
-public:
-    explicit MPMC_PacketQueue(size_t capacity, bool enable_stats = false)
-        : capacity_(round_up_to_power_of_two(capacity)),
-          mask_(capacity_ - 1),
-          buffer_(std::make_unique<Slot[]>(capacity_)),
-          head_seq_(0),
-          tail_seq_(0),
-          enable_stats_(enable_stats) {
-        
-        if (capacity == 0) {
-            throw std::invalid_argument("Capacity must be greater than 0");
+        BasicMPMCQueue* queue_ = nullptr;
+        Seq first_ = 0;
+        size_t count_ = 0;
+
+        WriteBatchReservation(BasicMPMCQueue* queue, Seq first, size_t count) noexcept
+            : queue_(queue), first_(first), count_(count) {}
+
+    public:
+        WriteBatchReservation() = default;
+
+        WriteBatchReservation(WriteBatchReservation&& other) noexcept
+            : queue_(other.queue_), first_(other.first_), count_(other.count_) {
+            other.count_ = 0;
         }
-        
-        if (capacity_ > (SIZE_MAX >> 1)) {
-            throw std::invalid_argument("Capacity too large");
+
+        WriteBatchReservation& operator=(WriteBatchReservation&& other) noexcept {
+            if (this != &other) {
+                commit();
+                queue_ = other.queue_;
+                first_ = other.first_;
+                count_ = other.count_;
+                other.count_ = 0;
+            }
+            return *this;
+        }
+
+        WriteBatchReservation(const WriteBatchReservation&) = delete;
+        WriteBatchReservation& operator=(const WriteBatchReservation&) = delete;
+
+        ~WriteBatchReservation() { commit(); }
+
+        explicit operator bool() const noexcept { return count_ != 0; }
+        size_t size() const noexcept { return count_; }
+
+        T& operator[](size_t index) noexcept {
+            return queue_->slot_at(static_cast<Seq>(first_ + index)).value;
         }
 
-        // Initialize sequence numbers
-        for (size_t i = 0; i < capacity_; ++i) {
-            buffer_[i].seq.store(i, std::memory_order_relaxed);
+        // Publish every slot to consumers
+        void commit() noexcept {
+            if (count_ == 0) return;
+            const uint64_t now = latency_now();
+            for (size_t i = 0; i < count_; ++i) {
+                auto&& slot = queue_->slot_at(static_cast<Seq>(first_ + i));
+                queue_->stamp(slot, now);
+                slot.seq.store(static_cast<Seq>(first_ + i + 1), std::memory_order_release);
+            }
+            queue_->refresh_hint_after_push(first_, count_);
+            count_ = 0;
+            queue_->signal_not_empty();
         }
+    };
+
+    // Runtime capacity, rounded up to the next power of two
+    template <size_t C = Capacity, std::enable_if_t<C == dynamic_capacity, int> = 0>
+    explicit BasicMPMCQueue(size_t capacity, bool enable_stats = false)
+        : BasicMPMCQueue(capacity, enable_stats ? StatsMode::Shared : StatsMode::Disabled) {}
+
+    template <size_t C = Capacity, std::enable_if_t<C == dynamic_capacity, int> = 0>
+    BasicMPMCQueue(size_t capacity, StatsMode stats_mode)
+        : detail::QueueCapacity<Capacity>(capacity, MAX_CAPACITY),
+          storage_(capacity_),
+          buffer_(storage_.slots()),
+          values_(storage_.values()),
+          head_seq_(storage_.control().head),
+          tail_seq_(storage_.control().tail),
+          occupancy_hint_(storage_.control().occupancy_hint),
+          not_empty_(storage_.control().not_empty),
+          not_full_(storage_.control().not_full),
+          stats_(effective_stats_mode(stats_mode)) {
+        init_sequences();
+    }
+
+    // Place the ring and indexes in a MemoryRegion, e.g. hugepages bound to
+    // the NUMA node its consumers run on. Throws std::invalid_argument if
+    // the node cannot be used.
+    template <size_t C = Capacity, std::enable_if_t<C == dynamic_capacity, int> = 0>
+    BasicMPMCQueue(size_t capacity, StatsMode stats_mode, const MemoryRegionOptions& placement)
+        : detail::QueueCapacity<Capacity>(capacity, MAX_CAPACITY),
+          storage_(capacity_, placement),
+          buffer_(storage_.slots()),
+          values_(storage_.values()),
+          head_seq_(storage_.control().head),
+          tail_seq_(storage_.control().tail),
+          occupancy_hint_(storage_.control().occupancy_hint),
+          not_empty_(storage_.control().not_empty),
+          not_full_(storage_.control().not_full),
+          stats_(effective_stats_mode(stats_mode)) {
+        init_sequences();
+    }
+
+    // Compile-time capacity
+    template <size_t C = Capacity, std::enable_if_t<C != dynamic_capacity, int> = 0>
+    explicit BasicMPMCQueue(bool enable_stats = false)
+        : BasicMPMCQueue(enable_stats ? StatsMode::Shared : StatsMode::Disabled) {}
+
+    template <size_t C = Capacity, std::enable_if_t<C != dynamic_capacity, int> = 0>
+    explicit BasicMPMCQueue(StatsMode stats_mode)
+        : storage_(capacity_),
+          buffer_(storage_.slots()),
+          values_(storage_.values()),
+          head_seq_(storage_.control().head),
+          tail_seq_(storage_.control().tail),
+          occupancy_hint_(storage_.control().occupancy_hint),
+          not_empty_(storage_.control().not_empty),
+          not_full_(storage_.control().not_full),
+          stats_(effective_stats_mode(stats_mode)) {
+        init_sequences();
+    }
+
+    template <size_t C = Capacity, std::enable_if_t<C != dynamic_capacity, int> = 0>
+    BasicMPMCQueue(StatsMode stats_mode, const MemoryRegionOptions& placement)
+        : storage_(capacity_, placement),
+          buffer_(storage_.slots()),
+          values_(storage_.values()),
+          head_seq_(storage_.control().head),
+          tail_seq_(storage_.control().tail),
+          occupancy_hint_(storage_.control().occupancy_hint),
+          not_empty_(storage_.control().not_empty),
+          not_full_(storage_.control().not_full),
+          stats_(effective_stats_mode(stats_mode)) {
+        init_sequences();
+    }
+
+    // Run on caller-owned memory, e.g. a shared-memory segment mapped by
+    // several processes. Throws std::invalid_argument if the memory is too
+    // small or misaligned.
+    template <size_t C = Capacity, std::enable_if_t<C == dynamic_capacity, int> = 0>
+    BasicMPMCQueue(size_t capacity, const ExternalQueueMemory& memory,
+                   StatsMode stats_mode = StatsMode::Disabled)
+        : detail::QueueCapacity<Capacity>(capacity, MAX_CAPACITY),
+          storage_(capacity_, memory),
+          buffer_(storage_.slots()),
+          values_(storage_.values()),
+          head_seq_(storage_.control().head),
+          tail_seq_(storage_.control().tail),
+          occupancy_hint_(storage_.control().occupancy_hint),
+          not_empty_(storage_.control().not_empty),
+          not_full_(storage_.control().not_full),
+          stats_(effective_stats_mode(stats_mode)) {
+        init_sequences(memory.init == ExternalQueueMemory::Init::Attach);
+    }
+
+    template <size_t C = Capacity, std::enable_if_t<C != dynamic_capacity, int> = 0>
+    explicit BasicMPMCQueue(const ExternalQueueMemory& memory,
+                            StatsMode stats_mode = StatsMode::Disabled)
+        : storage_(capacity_, memory),
+          buffer_(storage_.slots()),
+          values_(storage_.values()),
+          head_seq_(storage_.control().head),
+          tail_seq_(storage_.control().tail),
+          occupancy_hint_(storage_.control().occupancy_hint),
+          not_empty_(storage_.control().not_empty),
+          not_full_(storage_.control().not_full),
+          stats_(effective_stats_mode(stats_mode)) {
+        init_sequences(memory.init == ExternalQueueMemory::Init::Attach);
+    }
+
+    // Size and alignment of the ExternalQueueMemory for a given capacity
+    static constexpr size_t storage_bytes(size_t capacity) noexcept {
+        return Storage::bytes_for(
+            Capacity == dynamic_capacity ? round_up_to_power_of_two(capacity) : Capacity);
+    }
+
+    static constexpr size_t storage_alignment() noexcept {
+        return Storage::ALIGNMENT;
     }
 
     // Deleted copy/move operations due to atomics and const members
-    MPMC_PacketQueue(const MPMC_PacketQueue&) = delete;
-    MPMC_PacketQueue& operator=(const MPMC_PacketQueue&) = delete;
-    MPMC_PacketQueue(MPMC_PacketQueue&&) = delete;
-    MPMC_PacketQueue& operator=(MPMC_PacketQueue&&) = delete;
+    BasicMPMCQueue(const BasicMPMCQueue&) = delete;
+    BasicMPMCQueue& operator=(const BasicMPMCQueue&) = delete;
+    BasicMPMCQueue(BasicMPMCQueue&&) = delete;
+    BasicMPMCQueue& operator=(BasicMPMCQueue&&) = delete;
 
-    ~MPMC_PacketQueue() = default;
+    ~BasicMPMCQueue() = default;
 
     // Single packet enqueue with improved performance
-    bool enqueue(const Packet& packet) noexcept {
-        if (enable_stats_) {
-            stats_.enqueue_attempts.fetch_add(1, std::memory_order_relaxed);
+    bool enqueue(const T& packet) noexcept {
+        record_stat(&QueueStats::enqueue_attempts);
+
+        if constexpr (single_producer) {
+            if (!push_single_producer(packet)) return false;
+            record_stat(&QueueStats::enqueue_successes);
+            signal_not_empty();
+            return true;
         }
 
-        Backoff backoff;
-        size_t tail = tail_seq_.load(std::memory_order_relaxed);
+        Backoff backoff = make_backoff(TraceOp::Enqueue);
+        Seq tail = tail_seq_.load(std::memory_order_relaxed);
 
         while (true) {
-            Slot& slot = buffer_[tail & mask_];
-            size_t seq = slot.seq.load(std::memory_order_acquire);
-            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(tail);
+            auto&& slot = slot_at(tail);
+            Seq seq = slot.seq.load(std::memory_order_acquire);
+            SignedSeq diff = seq_distance(tail, seq);
 
             if (diff == 0) {
                 // Slot is ready, try to claim it
                 if (tail_seq_.compare_exchange_weak(tail, tail + 1,
                                                     std::memory_order_relaxed,
                                                     std::memory_order_relaxed)) {
-                    slot.packet = packet;
+                    slot.value = packet;
+                    stamp(slot, latency_now());
                     slot.seq.store(tail + 1, std::memory_order_release);
+                    refresh_hint_after_push(tail, 1);
                     
-                    if (enable_stats_) {
-                        stats_.enqueue_successes.fetch_add(1, std::memory_order_relaxed);
-                    }
+                    record_stat(&QueueStats::enqueue_successes);
+                    signal_not_empty();
                     return true;
                 }
+                trace_cas_failure(TraceOp::Enqueue);
                 backoff.reset();
             } else if (diff < 0) {
                 // Queue might be full, check explicitly
-                size_t head = head_seq_.load(std::memory_order_acquire);
-                if (tail - head >= capacity_) {
+                Seq head = head_seq_.load(std::memory_order_acquire);
+                if (static_cast<Seq>(tail - head) >= capacity_) {
                     return false; // Queue is definitively full
                 }
                 
-                if (enable_stats_) {
-                    stats_.contention_events.fetch_add(1, std::memory_order_relaxed);
-                }
+                record_stat(&QueueStats::contention_events);
                 backoff();
                 tail = tail_seq_.load(std::memory_order_relaxed);
             } else {
@@ -281,41 +1607,46 @@ public:
     }
 
     // Move version for better performance
-    bool enqueue(Packet&& packet) noexcept {
-        if (enable_stats_) {
-            stats_.enqueue_attempts.fetch_add(1, std::memory_order_relaxed);
+    bool enqueue(T&& packet) noexcept {
+        record_stat(&QueueStats::enqueue_attempts);
+
+        if constexpr (single_producer) {
+            if (!push_single_producer(std::move(packet))) return false;
+            record_stat(&QueueStats::enqueue_successes);
+            signal_not_empty();
+            return true;
         }
 
-        Backoff backoff;
-        size_t tail = tail_seq_.load(std::memory_order_relaxed);
+        Backoff backoff = make_backoff(TraceOp::Enqueue);
+        Seq tail = tail_seq_.load(std::memory_order_relaxed);
 
         while (true) {
-            Slot& slot = buffer_[tail & mask_];
-            size_t seq = slot.seq.load(std::memory_order_acquire);
-            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(tail);
+            auto&& slot = slot_at(tail);
+            Seq seq = slot.seq.load(std::memory_order_acquire);
+            SignedSeq diff = seq_distance(tail, seq);
 
             if (diff == 0) {
                 if (tail_seq_.compare_exchange_weak(tail, tail + 1,
                                                     std::memory_order_relaxed,
                                                     std::memory_order_relaxed)) {
-                    slot.packet = std::move(packet);
+                    slot.value = std::move(packet);
+                    stamp(slot, latency_now());
                     slot.seq.store(tail + 1, std::memory_order_release);
+                    refresh_hint_after_push(tail, 1);
                     
-                    if (enable_stats_) {
-                        stats_.enqueue_successes.fetch_add(1, std::memory_order_relaxed);
-                    }
+                    record_stat(&QueueStats::enqueue_successes);
+                    signal_not_empty();
                     return true;
                 }
+                trace_cas_failure(TraceOp::Enqueue);
                 backoff.reset();
             } else if (diff < 0) {
-                size_t head = head_seq_.load(std::memory_order_acquire);
-                if (tail - head >= capacity_) {
+                Seq head = head_seq_.load(std::memory_order_acquire);
+                if (static_cast<Seq>(tail - head) >= capacity_) {
                     return false;
                 }
                 
-                if (enable_stats_) {
-                    stats_.contention_events.fetch_add(1, std::memory_order_relaxed);
-                }
+                record_stat(&QueueStats::contention_events);
                 backoff();
                 tail = tail_seq_.load(std::memory_order_relaxed);
             } else {
@@ -326,43 +1657,50 @@ public:
     }
 
     // Single packet dequeue with improved performance
-    std::optional<Packet> dequeue() noexcept {
-        if (enable_stats_) {
-            stats_.dequeue_attempts.fetch_add(1, std::memory_order_relaxed);
+    std::optional<T> dequeue() noexcept {
+        record_stat(&QueueStats::dequeue_attempts);
+
+        if constexpr (single_consumer) {
+            std::optional<T> packet = pop_single_consumer();
+            if (packet.has_value()) {
+                record_stat(&QueueStats::dequeue_successes);
+                signal_not_full();
+            }
+            return packet;
         }
 
-        Backoff backoff;
-        size_t head = head_seq_.load(std::memory_order_relaxed);
+        Backoff backoff = make_backoff(TraceOp::Dequeue);
+        Seq head = head_seq_.load(std::memory_order_relaxed);
 
         while (true) {
-            Slot& slot = buffer_[head & mask_];
-            size_t seq = slot.seq.load(std::memory_order_acquire);
-            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(head + 1);
+            auto&& slot = slot_at(head);
+            Seq seq = slot.seq.load(std::memory_order_acquire);
+            SignedSeq diff = seq_distance(static_cast<Seq>(head + 1), seq);
 
             if (diff == 0) {
                 // Slot has data, try to claim it
                 if (head_seq_.compare_exchange_weak(head, head + 1,
                                                     std::memory_order_relaxed,
                                                     std::memory_order_relaxed)) {
-                    Packet packet = std::move(slot.packet);
+                    T packet = std::move(slot.value);
+                    record_latency(slot, latency_now());
                     slot.seq.store(head + capacity_, std::memory_order_release);
+                    refresh_hint_after_pop(head, 1);
                     
-                    if (enable_stats_) {
-                        stats_.dequeue_successes.fetch_add(1, std::memory_order_relaxed);
-                    }
+                    record_stat(&QueueStats::dequeue_successes);
+                    signal_not_full();
                     return packet;
                 }
+                trace_cas_failure(TraceOp::Dequeue);
                 backoff.reset();
             } else if (diff < 0) {
                 // Queue might be empty, check explicitly
-                size_t tail = tail_seq_.load(std::memory_order_acquire);
-                if (head >= tail) {
+                Seq tail = tail_seq_.load(std::memory_order_acquire);
+                if (seq_distance(head, tail) <= 0) {
                     return std::nullopt; // Queue is definitively empty
                 }
                 
-                if (enable_stats_) {
-                    stats_.contention_events.fetch_add(1, std::memory_order_relaxed);
-                }
+                record_stat(&QueueStats::contention_events);
                 backoff();
                 head = head_seq_.load(std::memory_order_relaxed);
             } else {
@@ -374,143 +1712,460 @@ public:
     }
 
     // Improved batch enqueue
-    size_t enqueue_batch(my_std::span<const Packet> packets) noexcept {
+    size_t enqueue_batch(my_std::span<const T> packets) noexcept {
+        return enqueue_batch_n(packets.size(), [&](size_t i) -> const T& { return packets[i]; });
+    }
+
+    // Batch enqueue that moves elements out of packets instead of copying.
+    // The accepted prefix [0, result) is left moved-from; the rest is
+    // untouched.
+    size_t enqueue_batch_move(my_std::span<T> packets) noexcept {
+        return enqueue_batch_n(packets.size(), [&](size_t i) -> T&& { return std::move(packets[i]); });
+    }
+
+    // Batch enqueue from a forward iterator range, assigning *it for each
+    // accepted element. Wrap the iterators in std::make_move_iterator to
+    // move from a container.
+    template <typename ForwardIt,
+              typename = std::enable_if_t<std::is_base_of<
+                  std::forward_iterator_tag,
+                  typename std::iterator_traits<ForwardIt>::iterator_category>::value>>
+    size_t enqueue_batch(ForwardIt first, ForwardIt last) noexcept {
+        size_t n = static_cast<size_t>(std::distance(first, last));
+        return enqueue_batch_n(n, [&](size_t) -> decltype(auto) { return *first++; });
+    }
+
+    // Improved batch dequeue
+    size_t dequeue_batch(my_std::span<T> packets) noexcept {
         if (packets.empty()) return 0;
         
-        if (enable_stats_) {
-            stats_.batch_enqueues.fetch_add(1, std::memory_order_relaxed);
-        }
+        record_stat(&QueueStats::batch_dequeues);
 
-        size_t enqueued_count = 0;
-        Backoff backoff;
+        size_t dequeued_count = 0;
+        Backoff backoff = make_backoff(TraceOp::DequeueBatch);
 
-        while (enqueued_count < packets.size()) {
-            size_t tail = tail_seq_.load(std::memory_order_acquire);
-            size_t head = head_seq_.load(std::memory_order_acquire);
+        if constexpr (single_consumer) {
+            dequeued_count = pop_batch_single_consumer(packets);
+        } else {
+            while (dequeued_count < packets.size()) {
+                Seq head = head_seq_.load(std::memory_order_acquire);
+                Seq tail = tail_seq_.load(std::memory_order_acquire);
             
-            if (tail - head >= capacity_) {
-                break; // Queue is full
-            }
+                if (seq_distance(head, tail) <= 0) {
+                    break; // Queue is empty
+                }
 
-            size_t available_space = capacity_ - (tail - head);
-            size_t batch_size = std::min(packets.size() - enqueued_count, available_space);
+                size_t available = static_cast<Seq>(tail - head);
+                size_t batch_size = std::min(packets.size() - dequeued_count, available);
             
-            if (batch_size == 0) {
-                backoff();
-                continue;
-            }
+                if (batch_size == 0) {
+                    backoff();
+                    continue;
+                }
 
-            if (tail_seq_.compare_exchange_weak(tail, tail + batch_size,
-                                               std::memory_order_acq_rel,
-                                               std::memory_order_acquire)) {
-                // Successfully reserved slots
-                for (size_t i = 0; i < batch_size; ++i) {
-                    Slot& slot = buffer_[(tail + i) & mask_];
+                if (head_seq_.compare_exchange_weak(head, head + batch_size,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_acquire)) {
+                    // Successfully reserved slots
+                    const uint64_t now = latency_now();
+                    for (size_t i = 0; i < batch_size; ++i) {
+                        auto&& slot = slot_at(head + i);
                     
-                    // Wait for slot to be ready
-                    while (slot.seq.load(std::memory_order_acquire) != tail + i) {
-                        std::this_thread::yield();
-                    }
+                        // Wait for the producer that reserved it to publish
+                        Seq seq;
+                        while ((seq = slot.seq.load(std::memory_order_acquire)) != static_cast<Seq>(head + i + 1)) {
+                            backoff.wait(slot.seq, seq, not_empty_);
+                        }
                     
-                    slot.packet = packets[enqueued_count + i];
-                    slot.seq.store(tail + i + 1, std::memory_order_release);
+                        packets[dequeued_count + i] = std::move(slot.value);
+                        record_latency(slot, now);
+                        slot.seq.store(head + i + capacity_, std::memory_order_release);
+                    }
+                    refresh_hint_after_pop(head, batch_size);
+                    dequeued_count += batch_size;
+                    backoff.reset();
+                } else {
+                    trace_cas_failure(TraceOp::DequeueBatch);
+                    backoff();
                 }
-                enqueued_count += batch_size;
-                backoff.reset();
-            } else {
-                backoff();
             }
         }
-        return enqueued_count;
+        trace_batch(TraceOp::DequeueBatch, packets.size(), dequeued_count);
+        if (dequeued_count != 0) {
+            signal_not_full();
+        }
+        return dequeued_count;
     }
 
-    // Improved batch dequeue
-    size_t dequeue_batch(my_std::span<Packet> packets) noexcept {
-        if (packets.empty()) return 0;
-        
-        if (enable_stats_) {
-            stats_.batch_dequeues.fetch_add(1, std::memory_order_relaxed);
-        }
+    // Batch dequeue without copying out: claims up to max elements and calls
+    // fn(T&) on each in place, in FIFO order, while its slot is still
+    // reserved. Slots are handed back to producers together once the whole
+    // burst has been visited. fn may modify or move from the element; it
+    // must not throw and must not call back into this queue's consumer side.
+    // Returns the number of elements visited.
+    template <typename F>
+    size_t consume_batch(size_t max, F&& fn) noexcept {
+        if (max == 0) return 0;
 
-        size_t dequeued_count = 0;
-        Backoff backoff;
+        record_stat(&QueueStats::batch_dequeues);
 
-        while (dequeued_count < packets.size()) {
-            size_t head = head_seq_.load(std::memory_order_acquire);
-            size_t tail = tail_seq_.load(std::memory_order_acquire);
-            
-            if (head >= tail) {
-                break; // Queue is empty
-            }
+        size_t consumed = 0;
+        Backoff backoff = make_backoff(TraceOp::DequeueBatch);
 
-            size_t available = tail - head;
-            size_t batch_size = std::min(packets.size() - dequeued_count, available);
-            
-            if (batch_size == 0) {
-                backoff();
-                continue;
-            }
+        if constexpr (single_consumer) {
+            consumed = consume_claimed(head_seq_.load(std::memory_order_relaxed), max, fn, backoff);
+        } else {
+            while (consumed < max) {
+                Seq head = head_seq_.load(std::memory_order_acquire);
+                Seq tail = tail_seq_.load(std::memory_order_acquire);
 
-            if (head_seq_.compare_exchange_weak(head, head + batch_size,
-                                               std::memory_order_acq_rel,
-                                               std::memory_order_acquire)) {
-                // Successfully reserved slots
-                for (size_t i = 0; i < batch_size; ++i) {
-                    Slot& slot = buffer_[(head + i) & mask_];
-                    
-                    // Wait for slot to have data
-                    while (slot.seq.load(std::memory_order_acquire) != head + i + 1) {
-                        std::this_thread::yield();
-                    }
-                    
-                    packets[dequeued_count + i] = std::move(slot.packet);
-                    slot.seq.store(head + i + capacity_, std::memory_order_release);
+                if (seq_distance(head, tail) <= 0) {
+                    break; // Queue is empty
+                }
+
+                size_t batch_size = std::min<size_t>(max - consumed, static_cast<Seq>(tail - head));
+                if (head_seq_.compare_exchange_weak(head, head + batch_size,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_acquire)) {
+                    consumed += consume_claimed(head, batch_size, fn, backoff);
+                    backoff.reset();
+                } else {
+                    trace_cas_failure(TraceOp::DequeueBatch);
+                    backoff();
                 }
-                dequeued_count += batch_size;
-                backoff.reset();
-            } else {
-                backoff();
             }
         }
-        return dequeued_count;
+        trace_batch(TraceOp::DequeueBatch, max, consumed);
+        if (consumed != 0) {
+            signal_not_full();
+        }
+        return consumed;
     }
 
     // Non-blocking try variants
-    bool try_enqueue(const Packet& packet) noexcept {
-        size_t tail = tail_seq_.load(std::memory_order_relaxed);
-        Slot& slot = buffer_[tail & mask_];
-        size_t seq = slot.seq.load(std::memory_order_acquire);
+    bool try_enqueue(const T& packet) noexcept {
+        return try_push(packet);
+    }
+
+    bool try_enqueue(T&& packet) noexcept {
+        return try_push(std::move(packet));
+    }
+
+    std::optional<T> try_dequeue() noexcept {
+        if constexpr (single_consumer) {
+            std::optional<T> packet = pop_single_consumer();
+            if (packet.has_value()) signal_not_full();
+            return packet;
+        }
+
+        Seq head = head_seq_.load(std::memory_order_relaxed);
+        auto&& slot = slot_at(head);
+        Seq seq = slot.seq.load(std::memory_order_acquire);
         
+        if (seq == head + 1 && head_seq_.compare_exchange_strong(head, head + 1,
+                                                                std::memory_order_relaxed,
+                                                                std::memory_order_relaxed)) {
+            T packet = std::move(slot.value);
+            record_latency(slot, latency_now());
+            slot.seq.store(head + capacity_, std::memory_order_release);
+            refresh_hint_after_pop(head, 1);
+            signal_not_full();
+            return packet;
+        }
+        return std::nullopt;
+    }
+
+    // Zero-copy variants: claim a slot without moving an element in or out.
+    // Returns an empty handle if the queue is full/empty (or contended, as
+    // with try_enqueue/try_dequeue).
+    WriteReservation try_reserve_write() noexcept {
+        Seq tail = tail_seq_.load(std::memory_order_relaxed);
+        auto&& slot = slot_at(tail);
+        Seq seq = slot.seq.load(std::memory_order_acquire);
+
+        if constexpr (single_producer) {
+            if (seq != tail) return WriteReservation();
+            tail_seq_.store(tail + 1, std::memory_order_relaxed);
+            return WriteReservation(this, &slot.value, tail);
+        }
+
         if (seq == tail && tail_seq_.compare_exchange_strong(tail, tail + 1,
                                                             std::memory_order_relaxed,
                                                             std::memory_order_relaxed)) {
-            slot.packet = packet;
-            slot.seq.store(tail + 1, std::memory_order_release);
-            return true;
+            return WriteReservation(this, &slot.value, tail);
         }
-        return false;
+        return WriteReservation();
     }
 
-    std::optional<Packet> try_dequeue() noexcept {
-        size_t head = head_seq_.load(std::memory_order_relaxed);
-        Slot& slot = buffer_[head & mask_];
-        size_t seq = slot.seq.load(std::memory_order_acquire);
-        
+    ReadReservation try_reserve_read() noexcept {
+        Seq head = head_seq_.load(std::memory_order_relaxed);
+        auto&& slot = slot_at(head);
+        Seq seq = slot.seq.load(std::memory_order_acquire);
+
+        if constexpr (single_consumer) {
+            if (seq != head + 1) return ReadReservation();
+            head_seq_.store(head + 1, std::memory_order_relaxed);
+            return ReadReservation(this, &slot.value, head);
+        }
+
         if (seq == head + 1 && head_seq_.compare_exchange_strong(head, head + 1,
                                                                 std::memory_order_relaxed,
                                                                 std::memory_order_relaxed)) {
-            Packet packet = std::move(slot.packet);
-            slot.seq.store(head + capacity_, std::memory_order_release);
-            return packet;
+            return ReadReservation(this, &slot.value, head);
         }
-        return std::nullopt;
+        return ReadReservation();
+    }
+
+    // Claim up to max consecutive slots for in-place filling; fewer when the
+    // ring is short of space, an empty handle when it is full. Lost races
+    // with other producers are retried, as in enqueue_batch.
+    WriteBatchReservation reserve_write_batch(size_t max) noexcept {
+        if (max == 0) return WriteBatchReservation();
+
+        if constexpr (single_producer) {
+            Seq tail = tail_seq_.load(std::memory_order_relaxed);
+            size_t count = 0;
+            while (count < max &&
+                   slot_at(static_cast<Seq>(tail + count)).seq.load(std::memory_order_acquire) ==
+                       static_cast<Seq>(tail + count)) {
+                ++count;
+            }
+            trace_batch(TraceOp::EnqueueBatch, max, count);
+            if (count == 0) return WriteBatchReservation();
+            tail_seq_.store(static_cast<Seq>(tail + count), std::memory_order_relaxed);
+            return WriteBatchReservation(this, tail, count);
+        }
+
+        Backoff backoff = make_backoff(TraceOp::EnqueueBatch);
+        while (true) {
+            Seq tail = tail_seq_.load(std::memory_order_acquire);
+            Seq head = head_seq_.load(std::memory_order_acquire);
+
+            if (static_cast<Seq>(tail - head) >= capacity_) {
+                trace_batch(TraceOp::EnqueueBatch, max, 0);
+                return WriteBatchReservation(); // Queue is full
+            }
+
+            size_t count = std::min<size_t>(max, capacity_ - static_cast<Seq>(tail - head));
+            if (tail_seq_.compare_exchange_weak(tail, static_cast<Seq>(tail + count),
+                                               std::memory_order_acq_rel,
+                                               std::memory_order_acquire)) {
+                // Wait for the previous lap's consumers to release the slots
+                for (size_t i = 0; i < count; ++i) {
+                    auto&& slot = slot_at(static_cast<Seq>(tail + i));
+                    Seq seq;
+                    while ((seq = slot.seq.load(std::memory_order_acquire)) != static_cast<Seq>(tail + i)) {
+                        backoff.wait(slot.seq, seq, not_full_);
+                    }
+                }
+                trace_batch(TraceOp::EnqueueBatch, max, count);
+                return WriteBatchReservation(this, tail, count);
+            }
+            trace_cas_failure(TraceOp::EnqueueBatch);
+            backoff();
+        }
+    }
+
+    // Blocking variants. A caller that finds the queue full/empty parks on
+    // a futex until the other side makes progress or the timeout expires;
+    // it does not spin or sleep in fixed steps while it waits. Only
+    // available with a blocking policy, e.g. BlockingQueuePolicy.
+    template <typename Rep, typename Period>
+    bool enqueue_wait(const T& packet, const std::chrono::duration<Rep, Period>& timeout) noexcept {
+        static_assert(blocking, "enqueue_wait() needs a policy with blocking = true");
+        return wait_until_done(not_full_, timeout, [&]() { return enqueue(packet); });
+    }
+
+    template <typename Rep, typename Period>
+    bool enqueue_wait(T&& packet, const std::chrono::duration<Rep, Period>& timeout) noexcept {
+        static_assert(blocking, "enqueue_wait() needs a policy with blocking = true");
+        // enqueue(T&&) only moves from packet on success, so retrying is safe
+        return wait_until_done(not_full_, timeout, [&]() { return enqueue(std::move(packet)); });
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<T> dequeue_wait(const std::chrono::duration<Rep, Period>& timeout) noexcept {
+        static_assert(blocking, "dequeue_wait() needs a policy with blocking = true");
+        std::optional<T> result;
+        wait_until_done(not_empty_, timeout, [&]() {
+            result = dequeue();
+            return result.has_value();
+        });
+        return result;
+    }
+
+#if MPMC_QUEUE_COROUTINES
+private:
+    // Whether the next dequeue/enqueue would find its slot ready. Only a
+    // hint for parked coroutines: it may be stale by the time it is acted on.
+    bool front_published() noexcept {
+        Seq head = head_seq_.load(std::memory_order_acquire);
+        return slot_at(head).seq.load(std::memory_order_acquire) == static_cast<Seq>(head + 1);
+    }
+
+    bool back_free() noexcept {
+        Seq tail = tail_seq_.load(std::memory_order_acquire);
+        return slot_at(tail).seq.load(std::memory_order_acquire) == tail;
+    }
+
+    // One operation of an awaitable: operator() makes one non-blocking
+    // attempt, event() is where to park and ready() whether it is worth
+    // another attempt right away
+    struct DequeueOp {
+        std::optional<T> value;
+
+        bool operator()(BasicMPMCQueue& queue) noexcept {
+            value = queue.dequeue();
+            return value.has_value();
+        }
+        static WaitEvent& event(BasicMPMCQueue& queue) noexcept { return queue.not_empty_; }
+        static bool ready(BasicMPMCQueue& queue) noexcept { return queue.front_published(); }
+        T result() noexcept { return std::move(*value); }
+    };
+
+    struct EnqueueOp {
+        T value;
+
+        bool operator()(BasicMPMCQueue& queue) noexcept { return queue.enqueue(std::move(value)); }
+        static WaitEvent& event(BasicMPMCQueue& queue) noexcept { return queue.not_full_; }
+        static bool ready(BasicMPMCQueue& queue) noexcept { return queue.back_free(); }
+        void result() noexcept {}
+    };
+
+    struct DequeueBatchOp {
+        my_std::span<T> items;
+        size_t count = 0;
+
+        bool operator()(BasicMPMCQueue& queue) noexcept {
+            count = queue.dequeue_batch(items);
+            return count != 0 || items.empty();
+        }
+        static WaitEvent& event(BasicMPMCQueue& queue) noexcept { return queue.not_empty_; }
+        static bool ready(BasicMPMCQueue& queue) noexcept { return queue.front_published(); }
+        size_t result() noexcept { return count; }
+    };
+
+    struct EnqueueBatchOp {
+        my_std::span<const T> items;
+        size_t count = 0;
+
+        bool operator()(BasicMPMCQueue& queue) noexcept {
+            count = queue.enqueue_batch(items);
+            return count != 0 || items.empty();
+        }
+        static WaitEvent& event(BasicMPMCQueue& queue) noexcept { return queue.not_full_; }
+        static bool ready(BasicMPMCQueue& queue) noexcept { return queue.back_free(); }
+        size_t result() noexcept { return count; }
+    };
+
+public:
+    // Awaitable queue operation for coroutines. If the operation succeeds
+    // straight away the coroutine does not suspend. Otherwise it parks on
+    // the queue's WaitEvent without holding a thread; the thread whose
+    // enqueue or dequeue next makes room retries the oldest parked
+    // operation on its behalf and, once it succeeds, hands the coroutine to
+    // executor.post(), so it resumes on the executor with the result
+    // already in hand. A notify retries one operation, not every parked
+    // one. No thread spins or sleeps for a parked coroutine.
+    //
+    // Executor is any type with post(std::coroutine_handle<>), called once
+    // per suspension from whichever thread completed the operation. A
+    // suspended operation cannot be cancelled: the queue must outlive it
+    // and the coroutine must not be destroyed until it has resumed. Needs a
+    // blocking policy; not for queues in process-shared memory.
+    template <typename Executor, typename Op>
+    class AsyncOperation : private AsyncWaiter {
+    private:
+        friend class BasicMPMCQueue;
+        static_assert(blocking, "coroutine awaitables need a policy with blocking = true");
+
+        BasicMPMCQueue* queue_;
+        Executor* executor_;
+        Op op_;
+        std::coroutine_handle<> handle_;
+
+        AsyncOperation(BasicMPMCQueue* queue, Executor& executor, Op op) noexcept
+            : queue_(queue), executor_(&executor), op_(std::move(op)) {}
+
+        // Register, then look again in case the queue changed before the
+        // registration was visible to the other side. Once registered,
+        // another thread may complete the operation and resume the
+        // coroutine, which frees *this, so only locals are used after that.
+        void park() noexcept {
+            BasicMPMCQueue& queue = *queue_;
+            WaitEvent& event = Op::event(queue);
+            event.add_async_waiter(*this);
+            if (Op::ready(queue)) event.notify_async_waiter();
+        }
+
+        // Each notify wakes one waiter. If this one completes and the
+        // queue still has data/room, it passes the wake to the next.
+        static void wake(AsyncWaiter* waiter) noexcept {
+            auto* self = static_cast<AsyncOperation*>(waiter);
+            BasicMPMCQueue& queue = *self->queue_;
+            if (!self->op_(queue)) {
+                self->park(); // Another thread got there first
+                return;
+            }
+            self->executor_->post(self->handle_);
+            if (Op::ready(queue)) Op::event(queue).notify_async_waiter();
+        }
+
+    public:
+        AsyncOperation(const AsyncOperation&) = delete;
+        AsyncOperation& operator=(const AsyncOperation&) = delete;
+
+        bool await_ready() noexcept { return op_(*queue_); }
+
+        void await_suspend(std::coroutine_handle<> handle) noexcept {
+            handle_ = handle;
+            notify = &wake;
+            park();
+        }
+
+        decltype(auto) await_resume() noexcept { return op_.result(); }
+    };
+
+    // co_await yields the dequeued element
+    template <typename Executor>
+    AsyncOperation<Executor, DequeueOp> async_dequeue(Executor& executor) noexcept {
+        return AsyncOperation<Executor, DequeueOp>(this, executor, DequeueOp{});
+    }
+
+    // co_await completes once packet is in the queue
+    template <typename Executor>
+    AsyncOperation<Executor, EnqueueOp> async_enqueue(const T& packet, Executor& executor) noexcept {
+        return AsyncOperation<Executor, EnqueueOp>(this, executor, EnqueueOp{packet});
+    }
+
+    template <typename Executor>
+    AsyncOperation<Executor, EnqueueOp> async_enqueue(T&& packet, Executor& executor) noexcept {
+        return AsyncOperation<Executor, EnqueueOp>(this, executor, EnqueueOp{std::move(packet)});
+    }
+
+    // co_await yields how many elements were dequeued into packets: at
+    // least one unless packets is empty. packets must stay valid until then.
+    template <typename Executor>
+    AsyncOperation<Executor, DequeueBatchOp> async_dequeue_batch(my_std::span<T> packets,
+                                                                 Executor& executor) noexcept {
+        return AsyncOperation<Executor, DequeueBatchOp>(this, executor, DequeueBatchOp{packets});
     }
 
+    // co_await yields how many leading elements of packets were enqueued:
+    // at least one unless packets is empty. Await again for the rest.
+    template <typename Executor>
+    AsyncOperation<Executor, EnqueueBatchOp> async_enqueue_batch(my_std::span<const T> packets,
+                                                                 Executor& executor) noexcept {
+        return AsyncOperation<Executor, EnqueueBatchOp>(this, executor, EnqueueBatchOp{packets});
+    }
+#endif
+
     // Queue state queries
     size_t size() const noexcept {
-        size_t tail = tail_seq_.load(std::memory_order_acquire);
-        size_t head = head_seq_.load(std::memory_order_acquire);
-        return tail - head;
+        Seq tail = tail_seq_.load(std::memory_order_acquire);
+        Seq head = head_seq_.load(std::memory_order_acquire);
+        SignedSeq size = seq_distance(head, tail);
+        return size > 0 ? static_cast<size_t>(size) : 0;
     }
 
     size_t capacity() const noexcept {
@@ -521,21 +2176,82 @@ public:
         return size() == 0;
     }
 
+    // Cheap occupancy estimate for load balancing. Reads one relaxed word
+    // on its own cache line instead of both indexes, and may lag the real
+    // size by up to occupancy_hint_interval operations per side. Falls back
+    // to size() when the policy disables the hint.
+    size_t approx_size() const noexcept {
+        if constexpr (hint_interval != 0) {
+            return occupancy_hint_.load(std::memory_order_relaxed);
+        } else {
+            return size();
+        }
+    }
+
+    bool approx_empty() const noexcept {
+        return approx_size() == 0;
+    }
+
     bool full() const noexcept {
         return size() >= capacity_;
     }
 
-    // Statistics access
+    StatsMode stats_mode() const noexcept {
+        return stats_.mode();
+    }
+
+    // Statistics access. In PerThread mode this sums the shards first; use
+    // stats_snapshot() for a plain copy.
     const QueueStats& get_stats() const noexcept {
-        return stats_;
+        return stats_.get();
+    }
+
+    // Point-in-time copy of the counters, valid in every stats mode
+    QueueStatsSnapshot stats_snapshot() const noexcept {
+        return stats_.snapshot();
     }
 
     void reset_stats() noexcept {
         stats_.reset();
     }
 
+    // Enqueue-to-dequeue latency since the last reset. Empty unless the
+    // policy sets latency_clock.
+    static constexpr bool latency_timing() noexcept {
+        return timed;
+    }
+
+    LatencySnapshot latency_snapshot() const {
+        return latency_ ? latency_->snapshot() : LatencySnapshot{};
+    }
+
+    LatencySnapshot latency_snapshot_and_reset() {
+        return latency_ ? latency_->snapshot_and_reset() : LatencySnapshot{};
+    }
+
     // Memory usage estimation
     size_t memory_usage() const noexcept {
-        return sizeof(*this) + (capacity_ * sizeof(Slot));
+        return sizeof(*this) + storage_.bytes() + stats_.memory_usage() +
+               (latency_ ? latency_->memory_usage() : 0);
+    }
+
+    // Page backing and NUMA node of the slot array and indexes
+    MemoryPlacement memory_placement() const noexcept {
+        return storage_.placement();
     }
 };
+
+// The original packet queue: runtime capacity, one cache line per slot
+using MPMC_PacketQueue = BasicMPMCQueue<Packet>;
+
+// Same queue with enqueue_wait()/dequeue_wait() and the coroutine awaitables
+using BlockingPacketQueue = BasicMPMCQueue<Packet, dynamic_capacity, BlockingQueuePolicy>;
+
+// Same API with one or both sides restricted to a single thread
+using SPSC_PacketQueue = BasicMPMCQueue<Packet, dynamic_capacity, SPSCQueuePolicy>;
+using MPSC_PacketQueue = BasicMPMCQueue<Packet, dynamic_capacity, MPSCQueuePolicy>;
+using SPMC_PacketQueue = BasicMPMCQueue<Packet, dynamic_capacity, SPMCQueuePolicy>;
+
+// 16-byte descriptors with sequences and descriptors in separate arrays:
+// 24 bytes per slot instead of 64
+using CompactPacketQueue = BasicMPMCQueue<CompactPacket, dynamic_capacity, SplitQueuePolicy>;
@@ -0,0 +1,291 @@
+// Built as a C++20 target of its own; see CMakeLists.txt
+
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "mpmc_packet_queue.h"
+
+#if MPMC_QUEUE_COROUTINES
+
+namespace {
+
+// Fire-and-forget coroutine; the frame frees itself when the body ends
+struct Task {
+    struct promise_type {
+        Task get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+// Holds posted coroutines until the test runs them
+class ManualExecutor {
+private:
+    std::mutex mutex_;
+    std::vector<std::coroutine_handle<>> ready_;
+
+public:
+    void post(std::coroutine_handle<> handle) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ready_.push_back(handle);
+    }
+
+    size_t pending() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return ready_.size();
+    }
+
+    size_t run() {
+        std::vector<std::coroutine_handle<>> batch;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            batch.swap(ready_);
+        }
+        for (auto handle : batch) handle.resume();
+        return batch.size();
+    }
+};
+
+// A few threads resuming whatever is posted
+class ThreadPoolExecutor {
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> ready_;
+    bool stop_ = false;
+    std::vector<std::thread> workers_;
+
+public:
+    explicit ThreadPoolExecutor(size_t threads) {
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this]() {
+                while (true) {
+                    std::coroutine_handle<> handle;
+                    {
+                        std::unique_lock<std::mutex> lock(mutex_);
+                        cv_.wait(lock, [this]() { return stop_ || !ready_.empty(); });
+                        if (ready_.empty()) return;
+                        handle = ready_.front();
+                        ready_.pop_front();
+                    }
+                    handle.resume();
+                }
+            });
+        }
+    }
+
+    ~ThreadPoolExecutor() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stop_ = true;
+        }
+        cv_.notify_all();
+        for (auto& worker : workers_) worker.join();
+    }
+
+    void post(std::coroutine_handle<> handle) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready_.push_back(handle);
+        }
+        cv_.notify_one();
+    }
+};
+
+Task dequeue_one(BlockingPacketQueue& queue, ManualExecutor& executor, std::atomic<size_t>& id) {
+    Packet packet = co_await queue.async_dequeue(executor);
+    id = packet.id;
+}
+
+Task enqueue_one(BlockingPacketQueue& queue, ManualExecutor& executor, Packet packet,
+                 std::atomic<bool>& done) {
+    co_await queue.async_enqueue(std::move(packet), executor);
+    done = true;
+}
+
+} // namespace
+
+TEST(MPMCQueueCoroutineTest, ReadyOperationsDoNotSuspend) {
+    BlockingPacketQueue queue(4);
+    ManualExecutor executor;
+    ASSERT_TRUE(queue.enqueue(Packet(7)));
+
+    std::atomic<size_t> id{0};
+    dequeue_one(queue, executor, id);
+    EXPECT_EQ(id.load(), 7);
+
+    std::atomic<bool> done{false};
+    enqueue_one(queue, executor, Packet(8), done);
+    EXPECT_TRUE(done.load());
+    EXPECT_EQ(executor.pending(), 0);
+    EXPECT_EQ(queue.size(), 1);
+}
+
+TEST(MPMCQueueCoroutineTest, DequeueResumesOnExecutorAfterEnqueue) {
+    BlockingPacketQueue queue(4);
+    ManualExecutor executor;
+
+    std::atomic<size_t> id{0};
+    dequeue_one(queue, executor, id);
+    EXPECT_EQ(executor.pending(), 0);
+    EXPECT_EQ(id.load(), 0);
+
+    // The producer claims the packet for the coroutine and posts it
+    ASSERT_TRUE(queue.enqueue(Packet(5)));
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(executor.pending(), 1);
+    EXPECT_EQ(id.load(), 0);
+    EXPECT_EQ(executor.run(), 1);
+    EXPECT_EQ(id.load(), 5);
+
+    // Two parked consumers, one packet: the other stays parked
+    std::atomic<size_t> first{0}, second{0};
+    dequeue_one(queue, executor, first);
+    dequeue_one(queue, executor, second);
+    ASSERT_TRUE(queue.enqueue(Packet(10)));
+    EXPECT_EQ(executor.run(), 1);
+    EXPECT_EQ(first.load() + second.load(), 10);
+    ASSERT_TRUE(queue.enqueue(Packet(20)));
+    EXPECT_EQ(executor.run(), 1);
+    EXPECT_EQ(first.load() + second.load(), 30);
+}
+
+TEST(MPMCQueueCoroutineTest, OneWakePerElement) {
+    BlockingPacketQueue queue(8);
+    ManualExecutor executor;
+
+    std::vector<std::atomic<size_t>> ids(4);
+    for (auto& id : ids) dequeue_one(queue, executor, id);
+
+    // One packet retries one parked consumer; the rest stay parked
+    ASSERT_TRUE(queue.enqueue(Packet(1)));
+    EXPECT_EQ(executor.pending(), 1);
+
+    // A burst is handed from consumer to consumer until it is used up
+    std::vector<Packet> burst = {Packet(2), Packet(3)};
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst)), 2);
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(executor.pending(), 3);
+    EXPECT_EQ(executor.run(), 3);
+    EXPECT_EQ(ids[0].load(), 1);  // Oldest waiter first
+    EXPECT_EQ(ids[3].load(), 0);
+
+    ASSERT_TRUE(queue.enqueue(Packet(4)));
+    EXPECT_EQ(executor.run(), 1);
+    EXPECT_EQ(ids[0] + ids[1] + ids[2] + ids[3], 10);
+}
+
+TEST(MPMCQueueCoroutineTest, EnqueueWaitsForRoom) {
+    BlockingPacketQueue queue(2);
+    ManualExecutor executor;
+    ASSERT_TRUE(queue.enqueue(Packet(1)));
+    ASSERT_TRUE(queue.enqueue(Packet(2)));
+
+    std::atomic<bool> done{false};
+    enqueue_one(queue, executor, Packet(3), done);
+    EXPECT_FALSE(done.load());
+
+    auto packet = queue.dequeue();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->id, 1);
+    EXPECT_EQ(queue.size(), 2);  // Packet 3 went in on the consumer's dequeue
+    EXPECT_EQ(executor.run(), 1);
+    EXPECT_TRUE(done.load());
+
+    EXPECT_EQ(queue.dequeue()->id, 2);
+    EXPECT_EQ(queue.dequeue()->id, 3);
+}
+
+TEST(MPMCQueueCoroutineTest, BatchVariants) {
+    BlockingPacketQueue queue(4);
+    ManualExecutor executor;
+
+    std::vector<Packet> out(8);
+    std::atomic<size_t> got{0};
+    auto consumer = [&]() -> Task {
+        got = co_await queue.async_dequeue_batch(my_std::span<Packet>(out), executor);
+    };
+    consumer();
+    EXPECT_EQ(got.load(), 0);
+
+    std::vector<Packet> burst = {Packet(1), Packet(2), Packet(3)};
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst)), 3);
+    EXPECT_EQ(executor.run(), 1);
+    EXPECT_EQ(got.load(), 3);
+    EXPECT_EQ(out[2].id, 3);
+
+    // A producer that writes six packets through a four-slot queue
+    std::vector<Packet> six;
+    for (size_t i = 0; i < 6; ++i) six.emplace_back(100 + i);
+    std::atomic<size_t> written{0};
+    auto producer = [&]() -> Task {
+        my_std::span<const Packet> rest(six);
+        while (!rest.empty()) {
+            size_t n = co_await queue.async_enqueue_batch(rest, executor);
+            written += n;
+            rest = rest.subspan(n);
+        }
+    };
+    producer();
+    EXPECT_EQ(written.load(), 4);
+
+    std::vector<Packet> drained(2);
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(drained)), 2);
+    EXPECT_EQ(executor.run(), 1);
+    EXPECT_EQ(written.load(), 6);
+    std::vector<size_t> ids;
+    while (auto packet = queue.dequeue()) ids.push_back(packet->id);
+    EXPECT_EQ(ids, (std::vector<size_t>{102, 103, 104, 105}));
+}
+
+TEST(MPMCQueueCoroutineTest, ManyPipelinesShareFewThreads) {
+    constexpr size_t PIPELINES = 500;
+    constexpr size_t PER_PIPELINE = 40;
+
+    BlockingPacketQueue queue(32);
+    std::atomic<size_t> finished{0};
+    std::atomic<uint64_t> sum{0};
+    {
+        ThreadPoolExecutor executor(2);
+        auto producer = [&](size_t p) -> Task {
+            for (size_t i = 0; i < PER_PIPELINE; ++i) {
+                co_await queue.async_enqueue(Packet(p * PER_PIPELINE + i), executor);
+            }
+            finished.fetch_add(1);
+        };
+        auto consumer = [&]() -> Task {
+            for (size_t i = 0; i < PER_PIPELINE; ++i) {
+                Packet packet = co_await queue.async_dequeue(executor);
+                sum.fetch_add(packet.id);
+            }
+            finished.fetch_add(1);
+        };
+
+        // Consumers first, so most of them park on an empty queue
+        std::thread starter([&]() {
+            for (size_t p = 0; p < PIPELINES; ++p) consumer();
+        });
+        for (size_t p = 0; p < PIPELINES; ++p) producer(p);
+        starter.join();
+
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(30);
+        while (finished.load() < 2 * PIPELINES && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    const uint64_t total = PIPELINES * PER_PIPELINE;
+    ASSERT_EQ(finished.load(), 2 * PIPELINES);
+    EXPECT_EQ(sum.load(), total * (total - 1) / 2);
+    EXPECT_TRUE(queue.empty());
+}
+
+#endif // MPMC_QUEUE_COROUTINES
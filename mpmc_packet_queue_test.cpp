@@ -9,6 +9,9 @@
 #include <random>
 #include <algorithm>
 #include <set>
+#include <memory>
+#include <numeric>
+#include <sstream>
 #include "mpmc_packet_queue.h" // Include the header file
 
 class MPMC_PacketQueueTest : public ::testing::Test {
@@ -211,6 +214,205 @@ TEST_F(MPMC_PacketQueueTest, PacketValidation) {
     EXPECT_FALSE(valid_packet.is_valid());
 }
 
+TEST_F(MPMC_PacketQueueTest, ZeroCopyReserveCommit) {
+    MPMC_PacketQueue queue(2);
+
+    {
+        auto writer = queue.try_reserve_write();
+        ASSERT_TRUE(writer);
+        writer->id = 10;
+        writer->priority = PacketPriority::High;
+        writer->length = 64;
+        // Not visible to consumers until committed
+        EXPECT_FALSE(queue.try_reserve_read());
+        writer.commit();
+        EXPECT_FALSE(writer);
+    }
+
+    auto reader = queue.try_reserve_read();
+    ASSERT_TRUE(reader);
+    EXPECT_EQ(reader->id, 10);
+    EXPECT_EQ(reader->priority, PacketPriority::High);
+    EXPECT_EQ(reader.packet().length, 64);
+    reader.release();
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(MPMC_PacketQueueTest, ZeroCopyFullAndEmpty) {
+    MPMC_PacketQueue queue(2);
+    EXPECT_FALSE(queue.try_reserve_read());
+
+    auto first = queue.try_reserve_write();
+    auto second = queue.try_reserve_write();
+    ASSERT_TRUE(first);
+    ASSERT_TRUE(second);
+    EXPECT_FALSE(queue.try_reserve_write());
+
+    first->id = 1;
+    second->id = 2;
+
+    // Slots publish independently, but consumers take them in ring order
+    second.commit();
+    EXPECT_FALSE(queue.try_reserve_read());
+    first.commit();
+
+    auto packet = queue.try_dequeue();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->id, 1);
+    packet = queue.try_dequeue();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->id, 2);
+}
+
+TEST_F(MPMC_PacketQueueTest, ZeroCopyHandlesAutoComplete) {
+    MPMC_PacketQueue queue(4);
+
+    {
+        auto writer = queue.try_reserve_write();
+        ASSERT_TRUE(writer);
+        writer->id = 5;
+    } // Committed on destruction
+    EXPECT_EQ(queue.size(), 1);
+
+    {
+        auto reader = queue.try_reserve_read();
+        ASSERT_TRUE(reader);
+        EXPECT_EQ(reader->id, 5);
+        MPMC_PacketQueue::ReadReservation moved = std::move(reader);
+        EXPECT_FALSE(reader);
+        EXPECT_TRUE(moved);
+    } // Released on destruction
+    EXPECT_TRUE(queue.empty());
+
+    // Regular enqueue/dequeue keep working on recycled slots
+    for (size_t i = 0; i < 8; ++i) {
+        EXPECT_TRUE(queue.enqueue(Packet(i)));
+        auto packet = queue.dequeue();
+        ASSERT_TRUE(packet.has_value());
+        EXPECT_EQ(packet->id, i);
+    }
+}
+
+TEST_F(MPMC_PacketQueueTest, ZeroCopyMultiThreaded) {
+    constexpr size_t num_packets = 20000;
+    MPMC_PacketQueue queue(64);
+    std::atomic<size_t> sum{0};
+
+    std::thread producer([&]() {
+        for (size_t i = 1; i <= num_packets; ++i) {
+            while (true) {
+                auto writer = queue.try_reserve_write();
+                if (writer) {
+                    writer->id = i;
+                    writer.commit();
+                    break;
+                }
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    std::thread consumer([&]() {
+        size_t received = 0;
+        while (received < num_packets) {
+            auto reader = queue.try_reserve_read();
+            if (reader) {
+                sum.fetch_add(reader->id);
+                reader.release();
+                ++received;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    producer.join();
+    consumer.join();
+    EXPECT_EQ(sum.load(), num_packets * (num_packets + 1) / 2);
+}
+
+TEST_F(MPMC_PacketQueueTest, DequeueWaitTimesOut) {
+    BlockingPacketQueue queue(8);
+
+    auto start = std::chrono::steady_clock::now();
+    auto packet = queue.dequeue_wait(std::chrono::milliseconds(20));
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    EXPECT_FALSE(packet.has_value());
+    EXPECT_GE(elapsed, std::chrono::milliseconds(20));
+}
+
+TEST_F(MPMC_PacketQueueTest, DequeueWaitWakesOnEnqueue) {
+    BlockingPacketQueue queue(8);
+
+    std::thread producer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        EXPECT_TRUE(queue.enqueue(Packet(7)));
+    });
+
+    auto packet = queue.dequeue_wait(std::chrono::seconds(10));
+    producer.join();
+
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->id, 7);
+}
+
+TEST_F(MPMC_PacketQueueTest, EnqueueWaitOnFullQueue) {
+    BlockingPacketQueue queue(2);
+    EXPECT_TRUE(queue.enqueue(Packet(1)));
+    EXPECT_TRUE(queue.enqueue(Packet(2)));
+
+    EXPECT_FALSE(queue.enqueue_wait(Packet(3), std::chrono::milliseconds(5)));
+
+    std::thread consumer([&]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        std::vector<Packet> out(2);
+        EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(out)), 2);
+    });
+
+    EXPECT_TRUE(queue.enqueue_wait(Packet(3), std::chrono::seconds(10)));
+    consumer.join();
+
+    auto packet = queue.dequeue();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->id, 3);
+}
+
+TEST_F(MPMC_PacketQueueTest, BlockingProducersConsumers) {
+    constexpr size_t num_producers = 2;
+    constexpr size_t num_consumers = 2;
+    constexpr size_t packets_per_producer = 5000;
+    constexpr size_t total_packets = num_producers * packets_per_producer;
+
+    BlockingPacketQueue queue(16);
+    std::atomic<size_t> consumed{0};
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < num_producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (size_t i = 0; i < packets_per_producer; ++i) {
+                EXPECT_TRUE(queue.enqueue_wait(Packet(p * packets_per_producer + i),
+                                               std::chrono::seconds(10)));
+            }
+        });
+    }
+    for (size_t c = 0; c < num_consumers; ++c) {
+        threads.emplace_back([&]() {
+            while (consumed.load() < total_packets) {
+                if (queue.dequeue_wait(std::chrono::milliseconds(10)).has_value()) {
+                    consumed.fetch_add(1);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    EXPECT_EQ(consumed.load(), total_packets);
+    EXPECT_TRUE(queue.empty());
+}
+
 // Multi-threading tests
 TEST_F(MPMC_PacketQueueTest, SingleProducerSingleConsumer) {
     constexpr size_t num_packets = 10000;
@@ -585,6 +787,334 @@ TEST_F(MPMC_PacketQueueTest, PowerOfTwoCapacity) {
     EXPECT_EQ(queue4.capacity(), 32);
 }
 
+TEST_F(MPMC_PacketQueueTest, FixedCapacityQueue) {
+    BasicMPMCQueue<Packet, 8> queue;
+    EXPECT_EQ(queue.capacity(), 8);
+
+    for (size_t i = 0; i < 8; ++i) {
+        EXPECT_TRUE(queue.enqueue(Packet(i)));
+    }
+    EXPECT_TRUE(queue.full());
+    EXPECT_FALSE(queue.enqueue(Packet(99)));
+
+    // Wrap around the fixed mask a few times
+    for (size_t i = 8; i < 40; ++i) {
+        auto packet = queue.dequeue();
+        ASSERT_TRUE(packet.has_value());
+        EXPECT_EQ(packet->id, i - 8);
+        EXPECT_TRUE(queue.enqueue(Packet(i)));
+    }
+
+    BasicMPMCQueue<Packet, 16> with_stats(StatsMode::Shared);
+    EXPECT_TRUE(with_stats.enqueue(Packet(1)));
+    EXPECT_EQ(with_stats.stats_snapshot().enqueue_successes, 1);
+}
+
+TEST_F(MPMC_PacketQueueTest, PackedDescriptorQueue) {
+    using IndexQueue = BasicMPMCQueue<uint32_t, 1024, PackedQueuePolicy>;
+    IndexQueue packed;
+    BasicMPMCQueue<uint32_t, 1024> padded;
+
+    // Several 16-byte slots share each cache line
+    EXPECT_LT(packed.memory_usage() * 3, padded.memory_usage());
+
+    std::vector<uint32_t> indexes(100);
+    std::iota(indexes.begin(), indexes.end(), 0u);
+    EXPECT_EQ(packed.enqueue_batch(my_std::span<const uint32_t>(indexes)), 100);
+
+    std::vector<uint32_t> out(100);
+    EXPECT_EQ(packed.dequeue_batch(my_std::span<uint32_t>(out)), 100);
+    EXPECT_EQ(out, indexes);
+}
+
+TEST_F(MPMC_PacketQueueTest, PackedQueueMultiThreaded) {
+    constexpr uint64_t num_values = 20000;
+    BasicMPMCQueue<uint64_t, dynamic_capacity, PackedQueuePolicy> queue(64);
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> received{0};
+
+    std::vector<std::thread> threads;
+    for (uint64_t p = 0; p < 2; ++p) {
+        threads.emplace_back([&, p]() {
+            for (uint64_t v = p + 1; v <= num_values; v += 2) {
+                while (!queue.enqueue(v)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (size_t c = 0; c < 2; ++c) {
+        threads.emplace_back([&]() {
+            while (received.load() < num_values) {
+                auto value = queue.dequeue();
+                if (value.has_value()) {
+                    sum.fetch_add(*value);
+                    received.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(sum.load(), num_values * (num_values + 1) / 2);
+}
+
+TEST_F(MPMC_PacketQueueTest, CompactPacketDescriptor) {
+    uint8_t buffer[64];
+    Packet packet(buffer, 1500, PacketPriority::High, 42);
+    ASSERT_TRUE(CompactPacket::fits(packet));
+    CompactPacket compact(packet);
+    EXPECT_EQ(compact.data(), buffer);
+    EXPECT_EQ(compact.length(), 1500);
+    EXPECT_EQ(compact.priority(), PacketPriority::High);
+    EXPECT_EQ(compact.id(), 42);
+    Packet back = compact.to_packet();
+    EXPECT_EQ(back.data, buffer);
+    EXPECT_EQ(back.length, 1500);
+    EXPECT_EQ(back, packet);
+
+    // Fields are independent
+    compact.set_length(CompactPacket::MAX_LENGTH);
+    compact.set_priority(PacketPriority::Control);
+    compact.set_id(CompactPacket::MAX_ID);
+    EXPECT_EQ(compact.data(), buffer);
+    EXPECT_EQ(compact.length(), CompactPacket::MAX_LENGTH);
+    EXPECT_EQ(compact.priority(), PacketPriority::Control);
+    EXPECT_EQ(compact.id(), CompactPacket::MAX_ID);
+
+    // A pool index in place of the pointer
+    compact.set_handle(7);
+    EXPECT_EQ(compact.handle(), 7);
+    EXPECT_EQ(compact.length(), CompactPacket::MAX_LENGTH);
+
+    EXPECT_FALSE(CompactPacket::fits(Packet(buffer, 70000, PacketPriority::Low)));
+    EXPECT_FALSE(CompactPacket::fits(Packet(nullptr, 0, PacketPriority::Low, size_t(1) << 63)));
+}
+
+TEST_F(MPMC_PacketQueueTest, SplitLayoutCompactQueue) {
+    constexpr size_t capacity = 1 << 14;
+    CompactPacketQueue compact(capacity);
+    MPMC_PacketQueue padded(capacity);
+
+    // 16-byte descriptors plus 8-byte sequences, against a 64-byte slot
+    EXPECT_LE(compact.memory_usage(), capacity * 24 + 4096);
+    EXPECT_LT(compact.memory_usage() * 2.5, padded.memory_usage());
+
+    std::vector<CompactPacket> in;
+    for (uint64_t i = 0; i < 100; ++i) in.emplace_back(nullptr, 64 + i, PacketPriority::Low, i);
+    EXPECT_EQ(compact.enqueue_batch(my_std::span<const CompactPacket>(in)), 100);
+    EXPECT_EQ(compact.dequeue()->id(), 0);
+
+    size_t seen = 1;
+    EXPECT_EQ(compact.consume_batch(49, [&](CompactPacket& p) {
+        EXPECT_EQ(p.id(), seen);
+        EXPECT_EQ(p.length(), 64 + seen);
+        ++seen;
+    }), 49);
+
+    // In-place reservations reach the element array
+    {
+        auto slot = compact.try_reserve_write();
+        ASSERT_TRUE(slot);
+        slot->set_id(1000);
+    }
+    std::vector<CompactPacket> out(64);
+    EXPECT_EQ(compact.dequeue_batch(my_std::span<CompactPacket>(out)), 51);
+    EXPECT_EQ(out[0].id(), 50);
+    EXPECT_EQ(out[50].id(), 1000);
+    EXPECT_TRUE(compact.empty());
+
+    // Timestamps move to the sequence array
+    struct TimedSplit : SplitQueuePolicy {
+        using latency_clock = SteadyLatencyClock;
+    };
+    BasicMPMCQueue<CompactPacket, 64, TimedSplit> timed;
+    for (uint64_t i = 0; i < 10; ++i) EXPECT_TRUE(timed.enqueue(CompactPacket(i)));
+    auto read = timed.try_reserve_read();
+    ASSERT_TRUE(read);
+    EXPECT_EQ(read->id(), 0);
+    read.release();
+    EXPECT_EQ(timed.dequeue_batch(my_std::span<CompactPacket>(out)), 9);
+    EXPECT_EQ(timed.latency_snapshot().total, 10);
+
+    // Both arrays live in caller-owned memory
+    using SplitRing = BasicMPMCQueue<CompactPacket, dynamic_capacity, SplitQueuePolicy>;
+    const size_t bytes = SplitRing::storage_bytes(256);
+    void* block = ::operator new(bytes, std::align_val_t(SplitRing::storage_alignment()));
+    {
+        SplitRing owner(256, ExternalQueueMemory{block, bytes});
+        SplitRing peer(256, ExternalQueueMemory{block, bytes, ExternalQueueMemory::Init::Attach});
+        EXPECT_TRUE(owner.enqueue(CompactPacket(5)));
+        EXPECT_EQ(peer.dequeue()->id(), 5);
+    }
+    ::operator delete(block, std::align_val_t(SplitRing::storage_alignment()));
+}
+
+TEST_F(MPMC_PacketQueueTest, SplitLayoutMultiThreaded) {
+    constexpr uint64_t num_values = 20000;
+    CompactPacketQueue queue(64);
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> received{0};
+
+    std::vector<std::thread> threads;
+    for (uint64_t p = 0; p < 2; ++p) {
+        threads.emplace_back([&, p]() {
+            for (uint64_t v = p + 1; v <= num_values; v += 2) {
+                while (!queue.enqueue(CompactPacket(nullptr, 1, PacketPriority::Low, v))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (size_t c = 0; c < 2; ++c) {
+        threads.emplace_back([&]() {
+            std::vector<CompactPacket> batch(8);
+            while (received.load() < num_values) {
+                size_t n = queue.dequeue_batch(my_std::span<CompactPacket>(batch));
+                for (size_t i = 0; i < n; ++i) sum.fetch_add(batch[i].id());
+                received.fetch_add(n);
+                if (n == 0) std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    EXPECT_EQ(sum.load(), num_values * (num_values + 1) / 2);
+}
+
+struct NearWrapPolicy : PackedQueuePolicy {
+    using sequence_type = uint32_t;
+    static constexpr uint64_t initial_sequence = UINT32_MAX - 1000;
+};
+
+TEST_F(MPMC_PacketQueueTest, SequenceWraparound32) {
+    using IndexRing = BasicMPMCQueue<uint32_t, dynamic_capacity, NearWrapPolicy>;
+
+    // 4-byte sequences: the packed slot of a 32-bit index shrinks to 8 bytes
+    EXPECT_EQ(IndexRing::storage_bytes(1024) - IndexRing::storage_bytes(512), 512 * 8);
+    EXPECT_THROW(IndexRing(size_t(1) << 31), std::invalid_argument);
+
+    // Many laps across the wrap, every path, checking order and occupancy
+    IndexRing queue(8);
+    std::vector<uint32_t> in(5), out(8);
+    uint32_t next_in = 0;
+    uint32_t next_out = 0;
+    for (int round = 0; round < 1000; ++round) {
+        for (auto& v : in) v = next_in++;
+        ASSERT_EQ(queue.enqueue_batch(my_std::span<const uint32_t>(in)), 5);
+        ASSERT_TRUE(queue.enqueue(next_in++));
+        ASSERT_EQ(queue.size(), 6);
+        {
+            auto slot = queue.try_reserve_write();
+            ASSERT_TRUE(slot);
+            *slot = next_in++;
+        }
+        ASSERT_TRUE(queue.try_enqueue(next_in++));
+        ASSERT_FALSE(queue.enqueue(0));  // Full at exactly the capacity
+        ASSERT_EQ(queue.size(), 8);
+
+        ASSERT_EQ(*queue.dequeue(), next_out++);
+        {
+            auto slot = queue.try_reserve_read();
+            ASSERT_TRUE(slot);
+            ASSERT_EQ(*slot, next_out++);
+        }
+        ASSERT_EQ(queue.consume_batch(2, [&](uint32_t& v) { EXPECT_EQ(v, next_out++); }), 2);
+        size_t n = queue.dequeue_batch(my_std::span<uint32_t>(out));
+        ASSERT_EQ(n, 4);
+        for (size_t i = 0; i < n; ++i) ASSERT_EQ(out[i], next_out++);
+        ASSERT_TRUE(queue.empty());
+        ASSERT_FALSE(queue.dequeue().has_value());
+    }
+
+    // Concurrent producers and consumers across the wrap
+    IndexRing shared(64);
+    constexpr uint32_t num_values = 20000;
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint32_t> received{0};
+    std::vector<std::thread> threads;
+    for (uint32_t p = 0; p < 2; ++p) {
+        threads.emplace_back([&, p]() {
+            for (uint32_t v = p + 1; v <= num_values; v += 2) {
+                while (!shared.enqueue(v)) std::this_thread::yield();
+            }
+        });
+    }
+    for (int c = 0; c < 2; ++c) {
+        threads.emplace_back([&]() {
+            std::vector<uint32_t> batch(8);
+            while (received.load() < num_values) {
+                size_t got = shared.dequeue_batch(my_std::span<uint32_t>(batch));
+                for (size_t i = 0; i < got; ++i) sum.fetch_add(batch[i]);
+                received.fetch_add(static_cast<uint32_t>(got));
+                if (got == 0) std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    EXPECT_EQ(sum.load(), uint64_t(num_values) * (num_values + 1) / 2);
+    EXPECT_TRUE(shared.empty());
+}
+
+TEST_F(MPMC_PacketQueueTest, MoveOnlyElements) {
+    BasicMPMCQueue<std::unique_ptr<int>> queue(4);
+
+    EXPECT_TRUE(queue.enqueue(std::make_unique<int>(5)));
+    auto value = queue.dequeue();
+    ASSERT_TRUE(value.has_value());
+    ASSERT_TRUE(*value);
+    EXPECT_EQ(**value, 5);
+}
+
+TEST_F(MPMC_PacketQueueTest, TryEnqueueAndBatchMove) {
+    BasicMPMCQueue<std::unique_ptr<int>> queue(4);
+
+    auto first = std::make_unique<int>(1);
+    EXPECT_TRUE(queue.try_enqueue(std::move(first)));
+    EXPECT_FALSE(first);
+
+    // Only the accepted prefix is moved from
+    std::vector<std::unique_ptr<int>> burst;
+    for (int i = 2; i <= 5; ++i) burst.push_back(std::make_unique<int>(i));
+    EXPECT_EQ(queue.enqueue_batch_move(my_std::span<std::unique_ptr<int>>(burst)), 3);
+    EXPECT_FALSE(burst[0]);
+    EXPECT_FALSE(burst[2]);
+    ASSERT_TRUE(burst[3]);
+    EXPECT_EQ(*burst[3], 5);
+
+    auto rejected = std::make_unique<int>(6);
+    EXPECT_FALSE(queue.try_enqueue(std::move(rejected)));
+    ASSERT_TRUE(rejected);
+
+    for (int i = 1; i <= 4; ++i) {
+        auto value = queue.dequeue();
+        ASSERT_TRUE(value.has_value());
+        EXPECT_EQ(**value, i);
+    }
+
+    // Iterator ranges, moving through std::make_move_iterator
+    std::vector<std::unique_ptr<int>> more;
+    for (int i = 0; i < 6; ++i) more.push_back(std::make_unique<int>(10 + i));
+    EXPECT_EQ(queue.enqueue_batch(std::make_move_iterator(more.begin()),
+                                  std::make_move_iterator(more.end())), 4);
+    EXPECT_FALSE(more[3]);
+    EXPECT_TRUE(more[4]);
+    for (int i = 0; i < 4; ++i) {
+        EXPECT_EQ(**queue.dequeue(), 10 + i);
+    }
+
+    // Copying iterator overload on a single-producer queue
+    SPSC_PacketQueue spsc(8);
+    std::vector<Packet> packets = create_test_packets(5);
+    EXPECT_EQ(spsc.enqueue_batch(packets.begin(), packets.end()), 5);
+    EXPECT_EQ(packets[4].id, 4);
+    EXPECT_EQ(spsc.size(), 5);
+}
+
 TEST_F(MPMC_PacketQueueTest, StatisticsTest) {
     MPMC_PacketQueue queue(8, true); // Enable statistics
     
@@ -612,6 +1142,61 @@ TEST_F(MPMC_PacketQueueTest, StatisticsTest) {
     EXPECT_EQ(stats.enqueue_successes.load(), 0);
 }
 
+TEST_F(MPMC_PacketQueueTest, PerThreadStatisticsTest) {
+    constexpr size_t num_threads = 4;
+    constexpr size_t ops_per_thread = 1000;
+    MPMC_PacketQueue queue(num_threads * ops_per_thread, StatsMode::PerThread);
+    EXPECT_EQ(queue.stats_mode(), StatsMode::PerThread);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&, t]() {
+            for (size_t i = 0; i < ops_per_thread; ++i) {
+                EXPECT_TRUE(queue.enqueue(Packet(t * ops_per_thread + i)));
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (size_t i = 0; i < ops_per_thread; ++i) {
+        EXPECT_TRUE(queue.dequeue().has_value());
+    }
+
+    // Shards are summed on read
+    QueueStatsSnapshot snapshot = queue.stats_snapshot();
+    EXPECT_EQ(snapshot.enqueue_attempts, num_threads * ops_per_thread);
+    EXPECT_EQ(snapshot.enqueue_successes, num_threads * ops_per_thread);
+    EXPECT_EQ(snapshot.dequeue_successes, ops_per_thread);
+    EXPECT_DOUBLE_EQ(snapshot.get_enqueue_success_rate(), 1.0);
+
+    const auto& stats = queue.get_stats();
+    EXPECT_EQ(stats.enqueue_successes.load(), num_threads * ops_per_thread);
+
+    queue.reset_stats();
+    EXPECT_EQ(queue.stats_snapshot().enqueue_attempts, 0);
+    EXPECT_EQ(queue.stats_snapshot().dequeue_successes, 0);
+}
+
+TEST_F(MPMC_PacketQueueTest, StatsSnapshotSharedMode) {
+    MPMC_PacketQueue queue(8, true);
+    EXPECT_EQ(queue.stats_mode(), StatsMode::Shared);
+
+    EXPECT_TRUE(queue.enqueue(Packet(1)));
+    QueueStatsSnapshot snapshot = queue.stats_snapshot();
+    EXPECT_EQ(snapshot.enqueue_successes, 1);
+
+    // A snapshot does not follow later operations
+    EXPECT_TRUE(queue.enqueue(Packet(2)));
+    EXPECT_EQ(snapshot.enqueue_successes, 1);
+    EXPECT_EQ(queue.stats_snapshot().enqueue_successes, 2);
+
+    MPMC_PacketQueue disabled(8);
+    EXPECT_TRUE(disabled.enqueue(Packet(1)));
+    EXPECT_EQ(disabled.stats_snapshot().enqueue_attempts, 0);
+}
+
 TEST_F(MPMC_PacketQueueTest, MemoryUsageTest) {
     MPMC_PacketQueue queue(64);
     size_t memory_usage = queue.memory_usage();
@@ -646,6 +1231,516 @@ TEST_F(MPMC_PacketQueueTest, LargeCapacityTest) {
     EXPECT_TRUE(queue.empty());
 }
 
+// The single-threaded API contract is the same for every cardinality policy
+// (and for the split slot layout and 32-bit sequences)
+template <typename Queue>
+class CardinalityPolicyTest : public ::testing::Test {};
+
+// 32-bit counters that start just below the wrap, so every test crosses it
+struct Wrap32Policy : DefaultQueuePolicy {
+    using sequence_type = uint32_t;
+    static constexpr uint64_t initial_sequence = UINT32_MAX - 2;
+};
+
+struct Wrap32SPSCPolicy : Wrap32Policy {
+    static constexpr Cardinality producers = Cardinality::Single;
+    static constexpr Cardinality consumers = Cardinality::Single;
+};
+
+using SplitPacketQueue = BasicMPMCQueue<Packet, dynamic_capacity, SplitQueuePolicy>;
+using Wrap32PacketQueue = BasicMPMCQueue<Packet, dynamic_capacity, Wrap32Policy>;
+using Wrap32SPSCQueue = BasicMPMCQueue<Packet, dynamic_capacity, Wrap32SPSCPolicy>;
+using CardinalityQueues = ::testing::Types<MPMC_PacketQueue, SPSC_PacketQueue,
+                                           MPSC_PacketQueue, SPMC_PacketQueue,
+                                           SplitPacketQueue, Wrap32PacketQueue,
+                                           Wrap32SPSCQueue>;
+TYPED_TEST_SUITE(CardinalityPolicyTest, CardinalityQueues);
+
+TYPED_TEST(CardinalityPolicyTest, SequentialOperations) {
+    TypeParam queue(4);
+
+    EXPECT_FALSE(queue.dequeue().has_value());
+    for (size_t i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.enqueue(Packet(i)));
+    }
+    EXPECT_TRUE(queue.full());
+    EXPECT_FALSE(queue.enqueue(Packet(99)));
+    EXPECT_FALSE(queue.try_enqueue(Packet(99)));
+
+    auto packet = queue.try_dequeue();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->id, 0);
+
+    std::vector<Packet> batch(8);
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(batch)), 3);
+    EXPECT_EQ(batch[0].id, 1);
+    EXPECT_EQ(batch[2].id, 3);
+    EXPECT_TRUE(queue.empty());
+
+    std::vector<Packet> burst;
+    for (size_t i = 0; i < 6; ++i) {
+        burst.emplace_back(10 + i);
+    }
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst)), 4);
+    EXPECT_EQ(queue.size(), 4);
+
+    {
+        auto reader = queue.try_reserve_read();
+        ASSERT_TRUE(reader);
+        EXPECT_EQ(reader->id, 10);
+    }
+    {
+        auto writer = queue.try_reserve_write();
+        ASSERT_TRUE(writer);
+        writer->id = 20;
+    }
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(batch)), 4);
+    EXPECT_EQ(batch[3].id, 20);
+}
+
+TYPED_TEST(CardinalityPolicyTest, ConsumeBatchInPlace) {
+    TypeParam queue(8);
+    EXPECT_EQ(queue.consume_batch(4, [](Packet&) { FAIL(); }), 0);
+
+    // Wrap the ring so the burst spans its end
+    for (size_t i = 0; i < 6; ++i) EXPECT_TRUE(queue.enqueue(Packet(i)));
+    for (size_t i = 0; i < 6; ++i) EXPECT_TRUE(queue.dequeue().has_value());
+    for (size_t i = 0; i < 8; ++i) EXPECT_TRUE(queue.enqueue(Packet(100 + i)));
+
+    std::vector<size_t> seen;
+    EXPECT_EQ(queue.consume_batch(5, [&](Packet& p) { seen.push_back(p.id); }), 5);
+    EXPECT_EQ(seen, (std::vector<size_t>{100, 101, 102, 103, 104}));
+    EXPECT_EQ(queue.size(), 3);
+
+    // Released slots are reusable straight away
+    for (size_t i = 0; i < 5; ++i) EXPECT_TRUE(queue.enqueue(Packet(200 + i)));
+    EXPECT_TRUE(queue.full());
+
+    seen.clear();
+    EXPECT_EQ(queue.consume_batch(0, [&](Packet& p) { seen.push_back(p.id); }), 0);
+    EXPECT_EQ(queue.consume_batch(64, [&](Packet& p) { seen.push_back(p.id); }), 8);
+    EXPECT_EQ(seen.front(), 105);
+    EXPECT_EQ(seen.back(), 204);
+    EXPECT_TRUE(queue.empty());
+}
+
+TYPED_TEST(CardinalityPolicyTest, ReserveWriteBatch) {
+    TypeParam queue(8);
+    EXPECT_FALSE(queue.reserve_write_batch(0));
+
+    // Wrap the ring so the reserved run spans its end
+    for (size_t i = 0; i < 6; ++i) EXPECT_TRUE(queue.enqueue(Packet(i)));
+    for (size_t i = 0; i < 6; ++i) EXPECT_TRUE(queue.dequeue().has_value());
+    EXPECT_TRUE(queue.enqueue(Packet(50)));
+
+    {
+        auto slots = queue.reserve_write_batch(16);  // Short of space
+        ASSERT_EQ(slots.size(), 7);
+        for (size_t i = 0; i < slots.size(); ++i) slots[i] = Packet(100 + i);
+        EXPECT_EQ(queue.dequeue()->id, 50);
+        EXPECT_FALSE(queue.try_dequeue().has_value());  // Not published yet
+        slots.commit();
+        EXPECT_FALSE(slots);
+    }
+    EXPECT_EQ(queue.size(), 7);
+
+    {
+        auto slots = queue.reserve_write_batch(4);
+        ASSERT_EQ(slots.size(), 1);
+        slots[0].id = 200;
+    } // Committed on destruction
+    EXPECT_TRUE(queue.full());
+    EXPECT_FALSE(queue.reserve_write_batch(1));
+
+    std::vector<Packet> batch(8);
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(batch)), 8);
+    for (size_t i = 0; i < 7; ++i) EXPECT_EQ(batch[i].id, 100 + i);
+    EXPECT_EQ(batch[7].id, 200);
+}
+
+TEST_F(MPMC_PacketQueueTest, ZeroCopyBatchReserveMultiThreaded) {
+    constexpr size_t per_producer = 20000;
+    MPMC_PacketQueue queue(64);
+    std::atomic<uint64_t> sum{0};
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < 2; ++p) {
+        threads.emplace_back([&, p]() {
+            size_t next = 0;
+            while (next < per_producer) {
+                auto slots = queue.reserve_write_batch(std::min<size_t>(13, per_producer - next));
+                for (size_t i = 0; i < slots.size(); ++i) slots[i].id = p * per_producer + next++;
+                if (!slots) std::this_thread::yield();
+            }
+        });
+    }
+    threads.emplace_back([&]() {
+        std::vector<Packet> batch(16);
+        size_t received = 0;
+        while (received < 2 * per_producer) {
+            size_t n = queue.dequeue_batch(my_std::span<Packet>(batch));
+            for (size_t i = 0; i < n; ++i) sum.fetch_add(batch[i].id);
+            received += n;
+            if (n == 0) std::this_thread::yield();
+        }
+    });
+    for (auto& t : threads) t.join();
+
+    const uint64_t total = 2 * per_producer;
+    EXPECT_EQ(sum.load(), total * (total - 1) / 2);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(MPMC_PacketQueueTest, SPSCOrderedStream) {
+    constexpr size_t num_packets = 100000;
+    SPSC_PacketQueue queue(256);
+    bool in_order = true;
+
+    std::thread consumer([&]() {
+        size_t expected = 0;
+        std::vector<Packet> batch(32);
+        while (expected < num_packets) {
+            size_t n = queue.dequeue_batch(my_std::span<Packet>(batch));
+            for (size_t i = 0; i < n; ++i) {
+                in_order &= batch[i].id == expected++;
+            }
+            if (n == 0) std::this_thread::yield();
+        }
+    });
+
+    for (size_t i = 0; i < num_packets; ++i) {
+        while (!queue.enqueue(Packet(i))) {
+            std::this_thread::yield();
+        }
+    }
+    consumer.join();
+
+    EXPECT_TRUE(in_order);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(MPMC_PacketQueueTest, MPSCManyProducers) {
+    constexpr size_t num_producers = 4;
+    constexpr size_t packets_per_producer = 5000;
+    MPSC_PacketQueue queue(128);
+    std::vector<size_t> next_expected(num_producers, 0);
+    bool per_producer_order = true;
+
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&, p]() {
+            for (size_t i = 0; i < packets_per_producer; ++i) {
+                while (!queue.enqueue(Packet(p * packets_per_producer + i))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    size_t received = 0;
+    while (received < num_producers * packets_per_producer) {
+        auto packet = queue.dequeue();
+        if (!packet.has_value()) {
+            std::this_thread::yield();
+            continue;
+        }
+        size_t producer = packet->id / packets_per_producer;
+        per_producer_order &= packet->id % packets_per_producer == next_expected[producer]++;
+        ++received;
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+
+    EXPECT_TRUE(per_producer_order);
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST_F(MPMC_PacketQueueTest, SPMCManyConsumers) {
+    constexpr size_t num_consumers = 4;
+    constexpr size_t num_packets = 20000;
+    SPMC_PacketQueue queue(128);
+    std::atomic<size_t> received{0};
+    std::vector<std::set<size_t>> seen(num_consumers);
+
+    std::vector<std::thread> consumers;
+    for (size_t c = 0; c < num_consumers; ++c) {
+        consumers.emplace_back([&, c]() {
+            while (received.load() < num_packets) {
+                auto packet = queue.dequeue();
+                if (packet.has_value()) {
+                    seen[c].insert(packet->id);
+                    received.fetch_add(1);
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    auto packets = create_test_packets(num_packets);
+    size_t sent = 0;
+    while (sent < num_packets) {
+        size_t n = std::min<size_t>(16, num_packets - sent);
+        size_t accepted = queue.enqueue_batch(my_std::span<const Packet>(packets).subspan(sent, n));
+        sent += accepted;
+        if (accepted == 0) std::this_thread::yield();
+    }
+    for (auto& consumer : consumers) {
+        consumer.join();
+    }
+
+    std::set<size_t> all;
+    for (const auto& ids : seen) {
+        for (size_t id : ids) {
+            EXPECT_TRUE(all.insert(id).second) << "Packet " << id << " consumed multiple times";
+        }
+    }
+    EXPECT_EQ(all.size(), num_packets);
+}
+
+// Every wait strategy must carry contended batch traffic without loss
+template <typename Strategy>
+struct WaitStrategyPolicy : DefaultQueuePolicy {
+    using wait_strategy = Strategy;
+    static constexpr bool blocking = true;  // SpinParkWait sleeps on the events
+};
+
+template <typename Strategy>
+class WaitStrategyTest : public ::testing::Test {};
+
+using WaitStrategies = ::testing::Types<BackoffWait<>, BusySpinWait<>, SpinYieldWait<>,
+                                        SpinParkWait<2, 200>, UmwaitWait<>>;
+TYPED_TEST_SUITE(WaitStrategyTest, WaitStrategies);
+
+TYPED_TEST(WaitStrategyTest, BatchTransfer) {
+    constexpr size_t num_threads = 2;
+    constexpr size_t per_producer = 5000;
+    BasicMPMCQueue<Packet, 64, WaitStrategyPolicy<TypeParam>> queue;
+    std::atomic<size_t> consumed{0};
+    std::atomic<size_t> id_sum{0};
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < num_threads; ++p) {
+        threads.emplace_back([&, p]() {
+            std::vector<Packet> burst(8);
+            for (size_t i = 0; i < per_producer; i += burst.size()) {
+                for (size_t j = 0; j < burst.size(); ++j) burst[j].id = p * per_producer + i + j;
+                size_t sent = 0;
+                while (sent < burst.size()) {
+                    size_t n = queue.enqueue_batch(my_std::span<const Packet>(burst).subspan(sent));
+                    sent += n;
+                    if (n == 0) std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (size_t c = 0; c < num_threads; ++c) {
+        threads.emplace_back([&]() {
+            std::vector<Packet> burst(8);
+            while (consumed.load() < num_threads * per_producer) {
+                size_t n = queue.dequeue_batch(my_std::span<Packet>(burst));
+                if (n == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (size_t j = 0; j < n; ++j) id_sum.fetch_add(burst[j].id);
+                consumed.fetch_add(n);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    const size_t total = num_threads * per_producer;
+    EXPECT_EQ(consumed.load(), total);
+    EXPECT_EQ(id_sum.load(), total * (total - 1) / 2);
+    EXPECT_TRUE(queue.empty());
+}
+
+// NUMA/hugepage placement
+TEST_F(MPMC_PacketQueueTest, PlacedOnNumaNode) {
+    MemoryRegionOptions placement;
+    placement.huge_pages = false;
+    placement.numa_node = 0;
+    MPMC_PacketQueue queue(1024, StatsMode::Disabled, placement);
+
+    MemoryPlacement where = queue.memory_placement();
+    EXPECT_EQ(where.backing, PageBacking::Regular);
+    EXPECT_TRUE(where.numa_node == 0 || where.numa_node == -1);
+    EXPECT_GE(queue.memory_usage(), 1024 * sizeof(Packet));
+
+    for (size_t i = 0; i < 1024; ++i) {
+        EXPECT_TRUE(queue.enqueue(Packet(i)));
+    }
+    EXPECT_TRUE(queue.full());
+    for (size_t i = 0; i < 1024; ++i) {
+        auto packet = queue.dequeue();
+        ASSERT_TRUE(packet.has_value());
+        EXPECT_EQ(packet->id, i);
+    }
+
+    // Hugepages fall back to regular pages when none are reserved
+    BasicMPMCQueue<uint32_t, 256, PackedQueuePolicy> fixed(StatsMode::Disabled, MemoryRegionOptions{});
+    EXPECT_TRUE(fixed.enqueue(7));
+    EXPECT_EQ(fixed.dequeue().value(), 7);
+
+    MemoryRegionOptions bad_node;
+    bad_node.numa_node = MemoryRegion::MAX_NUMA_NODES - 1;
+    EXPECT_THROW(MPMC_PacketQueue(64, StatsMode::Disabled, bad_node), std::invalid_argument);
+}
+
+// Compile-time instrumentation
+struct TracedPolicy : DefaultQueuePolicy {
+    using instrumentation = TraceInstrumentation;
+};
+
+struct NoStatsPolicy : DefaultQueuePolicy {
+    static constexpr bool collect_stats = false;
+};
+
+TEST_F(MPMC_PacketQueueTest, TracesHotPathEvents) {
+    BasicMPMCQueue<Packet, 64, TracedPolicy> queue;
+    TraceLog::instance().clear();
+
+    std::vector<Packet> burst(100);
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst)), 64);
+    std::vector<Packet> out(10);
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(out)), 10);
+
+    // Contended traffic; CAS failures and backoff are likely but not certain
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([&]() {
+            for (int i = 0; i < 2000; ++i) {
+                while (!queue.enqueue(Packet(i))) std::this_thread::yield();
+                while (!queue.dequeue().has_value()) std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    std::vector<TraceEvent> batches;
+    for (const TraceEvent& e : TraceLog::instance().collect()) {
+        if (e.queue == &queue && e.type == TraceEventType::Batch) batches.push_back(e);
+        if (e.type == TraceEventType::Backoff) {
+            EXPECT_GT(e.value, 0);
+        }
+    }
+    ASSERT_EQ(batches.size(), 2);
+    EXPECT_EQ(batches[0].op, TraceOp::EnqueueBatch);
+    EXPECT_EQ(batches[0].detail, 100);
+    EXPECT_EQ(batches[0].value, 64);
+    EXPECT_EQ(batches[1].op, TraceOp::DequeueBatch);
+    EXPECT_EQ(batches[1].detail, 10);
+    EXPECT_EQ(batches[1].value, 10);
+
+    std::ostringstream json;
+    TraceLog::instance().write_chrome_trace(json);
+    EXPECT_EQ(json.str().rfind("{\"traceEvents\":[", 0), 0);
+    EXPECT_NE(json.str().find("\"name\":\"batch\",\"cat\":\"enqueue_batch\""), std::string::npos);
+
+    TraceLog::instance().clear();
+    for (const TraceEvent& e : TraceLog::instance().collect()) {
+        EXPECT_NE(e.queue, &queue);
+    }
+}
+
+TEST_F(MPMC_PacketQueueTest, TraceRingKeepsNewestEvents) {
+    std::thread([]() {
+        BasicMPMCQueue<Packet, 8, TracedPolicy> queue;
+        TraceLog::instance().clear();
+        std::vector<Packet> out(1);
+        for (size_t i = 0; i < TraceRing::CAPACITY + 100; ++i) {
+            queue.dequeue_batch(my_std::span<Packet>(out));  // One Batch event each
+        }
+
+        size_t seen = 0;
+        for (const TraceEvent& e : TraceLog::instance().collect()) {
+            if (e.queue == &queue) ++seen;
+        }
+        EXPECT_EQ(seen, TraceRing::CAPACITY - 1);
+    }).join();
+}
+
+TEST_F(MPMC_PacketQueueTest, StatsCompiledOut) {
+    BasicMPMCQueue<Packet, 16, NoStatsPolicy> queue(StatsMode::Shared);
+    EXPECT_EQ(queue.stats_mode(), StatsMode::Disabled);
+    EXPECT_TRUE(queue.enqueue(Packet(1)));
+    EXPECT_TRUE(queue.dequeue().has_value());
+    EXPECT_EQ(queue.stats_snapshot().enqueue_attempts, 0);
+}
+
+struct NoPrefetchPolicy : DefaultQueuePolicy {
+    static constexpr size_t prefetch_distance = 0;
+};
+
+TEST_F(MPMC_PacketQueueTest, ConsumeBatchReadsPayloads) {
+    MPMC_PacketQueue queue(64);
+    BasicMPMCQueue<Packet, 64, NoPrefetchPolicy> unprefetched;
+    for (size_t i = 0; i < 40; ++i) {
+        EXPECT_TRUE(queue.enqueue(create_packet_with_data(i, "payload " + std::to_string(i))));
+        EXPECT_TRUE(unprefetched.enqueue(create_packet_with_data(i, "payload " + std::to_string(i))));
+    }
+    EXPECT_TRUE(queue.enqueue(Packet(40)));  // No payload to prefetch
+
+    size_t next = 0;
+    bool payloads_match = true;
+    auto check = [&](Packet& p) {
+        if (p.id != next++) payloads_match = false;
+        if (p.data != nullptr) {
+            std::string expected = "payload " + std::to_string(p.id);
+            if (std::string(reinterpret_cast<const char*>(p.data), p.length) != expected) {
+                payloads_match = false;
+            }
+        }
+    };
+    EXPECT_EQ(queue.consume_batch(64, check), 41);
+    next = 0;
+    EXPECT_EQ(unprefetched.consume_batch(64, check), 40);
+    EXPECT_TRUE(payloads_match);
+
+    // The callback may move the element out of its slot
+    std::vector<std::unique_ptr<int>> taken;
+    BasicMPMCQueue<std::unique_ptr<int>, 8> owners;
+    EXPECT_TRUE(owners.enqueue(std::make_unique<int>(7)));
+    EXPECT_EQ(owners.consume_batch(8, [&](std::unique_ptr<int>& p) { taken.push_back(std::move(p)); }), 1);
+    ASSERT_EQ(taken.size(), 1);
+    EXPECT_EQ(*taken[0], 7);
+}
+
+TEST_F(MPMC_PacketQueueTest, ConsumeBatchMultiThreaded) {
+    MPMC_PacketQueue queue(256);
+    constexpr size_t num_producers = 2;
+    constexpr size_t num_consumers = 2;
+    constexpr size_t per_producer = 20000;
+    std::vector<std::atomic<int>> seen(num_producers * per_producer);
+    std::atomic<size_t> consumed{0};
+    std::atomic<bool> done{false};
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < num_producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (size_t i = 0; i < per_producer; ++i) {
+                while (!queue.enqueue(Packet(p * per_producer + i))) std::this_thread::yield();
+            }
+        });
+    }
+    for (size_t c = 0; c < num_consumers; ++c) {
+        threads.emplace_back([&]() {
+            while (!done.load()) {
+                size_t n = queue.consume_batch(32, [&](Packet& p) { seen[p.id].fetch_add(1); });
+                if (n == 0) std::this_thread::yield();
+                if (consumed.fetch_add(n) + n == seen.size()) done.store(true);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    EXPECT_EQ(consumed.load(), seen.size());
+    EXPECT_TRUE(std::all_of(seen.begin(), seen.end(), [](const std::atomic<int>& v) { return v.load() == 1; }));
+    EXPECT_TRUE(queue.empty());
+}
+
 // Test main function
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
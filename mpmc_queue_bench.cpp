@@ -0,0 +1,287 @@
+// Google Benchmark suite for the packet queues.
+//
+//   ./mpmc_queue_bench --benchmark_filter='Transfer<MPMC_PacketQueue>'
+//
+// Transfer benchmarks run P producer and C consumer threads, each pinned to
+// its own CPU (round-robin when there are fewer CPUs than threads), and move
+// a fixed number of packets per iteration. Producers stamp every packet with
+// its enqueue time, so besides items/s each run reports p50/p99/p999
+// enqueue-to-dequeue latency in nanoseconds.
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "bulk_packet_queue.h"
+#include "mpmc_packet_queue.h"
+
+namespace {
+
+constexpr size_t PACKETS_PER_ITERATION = size_t(1) << 16;
+// Per consumer thread, so long runs keep bounded memory
+constexpr size_t MAX_LATENCY_SAMPLES = size_t(1) << 20;
+
+uint64_t now_ns() noexcept {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+void pin_to_cpu(size_t slot) noexcept {
+#if defined(__linux__)
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(slot % cpus, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)slot;
+#endif
+}
+
+StatsMode stats_mode_arg(int64_t arg) noexcept {
+    switch (arg) {
+    case 1: return StatsMode::Shared;
+    case 2: return StatsMode::PerThread;
+    default: return StatsMode::Disabled;
+    }
+}
+
+const char* stats_mode_name(StatsMode mode) noexcept {
+    switch (mode) {
+    case StatsMode::Shared: return "stats:shared";
+    case StatsMode::PerThread: return "stats:per_thread";
+    default: return "stats:off";
+    }
+}
+
+void report_latency(benchmark::State& state, std::vector<uint64_t>& samples) {
+    if (samples.empty()) return;
+    auto percentile = [&](double p) {
+        size_t rank = std::min(samples.size() - 1, static_cast<size_t>(p * samples.size()));
+        std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+        return static_cast<double>(samples[rank]);
+    };
+    state.counters["p50_ns"] = percentile(0.50);
+    state.counters["p99_ns"] = percentile(0.99);
+    state.counters["p999_ns"] = percentile(0.999);
+}
+
+// Producers and consumers exchange PACKETS_PER_ITERATION packets per
+// iteration. Args: producers, consumers, batch size, capacity, stats mode.
+template <typename Queue>
+void BM_Transfer(benchmark::State& state) {
+    const size_t producers = static_cast<size_t>(state.range(0));
+    const size_t consumers = static_cast<size_t>(state.range(1));
+    const size_t batch = static_cast<size_t>(state.range(2));
+    const size_t capacity = static_cast<size_t>(state.range(3));
+    const StatsMode stats = stats_mode_arg(state.range(4));
+
+    Queue queue(capacity, stats);
+    std::vector<std::vector<uint64_t>> latencies(consumers);
+    for (auto& samples : latencies) {
+        samples.reserve(PACKETS_PER_ITERATION / consumers + batch);
+    }
+
+    for (auto _ : state) {
+        std::atomic<size_t> consumed{0};
+        std::atomic<bool> start{false};
+        std::vector<std::thread> threads;
+        threads.reserve(producers + consumers);
+
+        const size_t per_producer = PACKETS_PER_ITERATION / producers;
+        const size_t total = per_producer * producers;
+
+        for (size_t p = 0; p < producers; ++p) {
+            threads.emplace_back([&, p]() {
+                pin_to_cpu(p);
+                std::vector<Packet> burst(batch);
+                while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+
+                size_t sent = 0;
+                while (sent < per_producer) {
+                    size_t n = std::min(batch, per_producer - sent);
+                    uint64_t stamp = now_ns();
+                    for (size_t i = 0; i < n; ++i) burst[i].id = stamp;
+
+                    size_t accepted = (n == 1)
+                        ? static_cast<size_t>(queue.enqueue(burst[0]))
+                        : queue.enqueue_batch(my_std::span<const Packet>(burst.data(), n));
+                    sent += accepted;
+                    if (accepted == 0) std::this_thread::yield();
+                }
+            });
+        }
+
+        for (size_t c = 0; c < consumers; ++c) {
+            threads.emplace_back([&, c]() {
+                pin_to_cpu(producers + c);
+                std::vector<Packet> burst(batch);
+                std::vector<uint64_t>& samples = latencies[c];
+                while (!start.load(std::memory_order_acquire)) std::this_thread::yield();
+
+                while (consumed.load(std::memory_order_relaxed) < total) {
+                    size_t n;
+                    if (batch == 1) {
+                        auto packet = queue.dequeue();
+                        n = packet.has_value() ? 1 : 0;
+                        if (n != 0) burst[0] = std::move(*packet);
+                    } else {
+                        n = queue.dequeue_batch(my_std::span<Packet>(burst.data(), batch));
+                    }
+                    if (n == 0) {
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    if (samples.size() < MAX_LATENCY_SAMPLES) {
+                        uint64_t stamp = now_ns();
+                        for (size_t i = 0; i < n; ++i) samples.push_back(stamp - burst[i].id);
+                    }
+                    consumed.fetch_add(n, std::memory_order_relaxed);
+                }
+            });
+        }
+
+        start.store(true, std::memory_order_release);
+        for (auto& t : threads) t.join();
+        benchmark::DoNotOptimize(consumed.load());
+    }
+
+    std::vector<uint64_t> all;
+    for (auto& samples : latencies) all.insert(all.end(), samples.begin(), samples.end());
+    report_latency(state, all);
+
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()) *
+                            static_cast<int64_t>(PACKETS_PER_ITERATION / producers * producers));
+    state.SetLabel(stats_mode_name(stats));
+}
+
+// Uncontended enqueue+dequeue on one thread. Args: capacity, stats mode.
+template <typename Queue>
+void BM_SingleThreadRoundTrip(benchmark::State& state) {
+    Queue queue(static_cast<size_t>(state.range(0)), stats_mode_arg(state.range(1)));
+    Packet packet(1);
+
+    for (auto _ : state) {
+        queue.enqueue(packet);
+        auto out = queue.dequeue();
+        benchmark::DoNotOptimize(out);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations()));
+    state.SetLabel(stats_mode_name(stats_mode_arg(state.range(1))));
+}
+
+// Uncontended batch round trip on one thread. Args: batch size, stats mode.
+template <typename Queue>
+void BM_SingleThreadBatch(benchmark::State& state) {
+    const size_t batch = static_cast<size_t>(state.range(0));
+    Queue queue(1024, stats_mode_arg(state.range(1)));
+    std::vector<Packet> in(batch), out(batch);
+
+    for (auto _ : state) {
+        size_t n = queue.enqueue_batch(my_std::span<const Packet>(in));
+        n = queue.dequeue_batch(my_std::span<Packet>(out.data(), n));
+        benchmark::DoNotOptimize(n);
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch));
+    state.SetLabel(stats_mode_name(stats_mode_arg(state.range(1))));
+}
+
+// Drain bursts and read each packet's first payload byte, with payloads
+// scattered over a pool much larger than the LLC. Args: batch size, mode
+// (0 = dequeue_batch then loop, 1 = consume_batch in place).
+void BM_DrainTouchPayload(benchmark::State& state) {
+    const size_t batch = static_cast<size_t>(state.range(0));
+    const bool in_place = state.range(1) != 0;
+    constexpr size_t pool_packets = size_t(1) << 16;
+    constexpr size_t stride = 2048;
+    std::vector<uint8_t> pool(pool_packets * stride, 1);
+    std::vector<Packet> in(batch), out(batch);
+    MPMC_PacketQueue queue(1024);
+    uint64_t sum = 0;
+    size_t next = 0;
+
+    for (auto _ : state) {
+        for (auto& packet : in) {
+            next = (next + 40503) & (pool_packets - 1);  // Odd step visits every buffer
+            packet = Packet(&pool[next * stride], stride, PacketPriority::Low);
+        }
+        queue.enqueue_batch(my_std::span<const Packet>(in));
+        if (in_place) {
+            queue.consume_batch(batch, [&](Packet& p) { sum += p.data[0]; });
+        } else {
+            size_t n = queue.dequeue_batch(my_std::span<Packet>(out));
+            for (size_t i = 0; i < n; ++i) sum += out[i].data[0];
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch));
+    state.SetLabel(in_place ? "consume_batch" : "dequeue_batch");
+}
+
+// Stream through a 1M-slot ring holding a standing backlog, so every batch
+// touches slots that have left the cache. Compares the 64-byte padded Packet
+// slot with the 24-byte split CompactPacket slot.
+template <typename Queue>
+void BM_LargeRingStream(benchmark::State& state) {
+    using Element = typename Queue::value_type;
+    constexpr size_t capacity = size_t(1) << 20;
+    constexpr size_t batch = 64;
+    Queue queue(capacity);
+    std::vector<Element> in(batch), out(batch);
+    for (size_t i = 0; i < batch; ++i) in[i] = Element(i);
+    while (queue.enqueue_batch(my_std::span<const Element>(in)) == batch &&
+           queue.size() < capacity / 2) {
+    }
+
+    for (auto _ : state) {
+        queue.enqueue_batch(my_std::span<const Element>(in));
+        benchmark::DoNotOptimize(queue.dequeue_batch(my_std::span<Element>(out)));
+    }
+    state.SetItemsProcessed(static_cast<int64_t>(state.iterations() * batch));
+    state.counters["ring_MB"] = static_cast<double>(queue.memory_usage()) / (1 << 20);
+}
+
+void transfer_args(benchmark::internal::Benchmark* b) {
+    b->ArgNames({"P", "C", "batch", "cap", "stats"})
+     ->ArgsProduct({{1, 2, 4}, {1, 2, 4}, {1, 16, 256}, {1024, 16384}, {0, 1, 2}})
+     ->UseRealTime()
+     ->Unit(benchmark::kMillisecond);
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(BM_SingleThreadRoundTrip, MPMC_PacketQueue)
+    ->ArgNames({"cap", "stats"})
+    ->ArgsProduct({{64, 1024, 65536}, {0, 1, 2}});
+BENCHMARK_TEMPLATE(BM_SingleThreadRoundTrip, MPMC_BulkPacketQueue)
+    ->ArgNames({"cap", "stats"})
+    ->ArgsProduct({{64, 1024, 65536}, {0, 1, 2}});
+
+BENCHMARK_TEMPLATE(BM_SingleThreadBatch, MPMC_PacketQueue)
+    ->ArgNames({"batch", "stats"})
+    ->ArgsProduct({{1, 4, 16, 64, 256}, {0, 1}});
+BENCHMARK_TEMPLATE(BM_SingleThreadBatch, MPMC_BulkPacketQueue)
+    ->ArgNames({"batch", "stats"})
+    ->ArgsProduct({{1, 4, 16, 64, 256}, {0, 1}});
+
+BENCHMARK(BM_DrainTouchPayload)
+    ->ArgNames({"batch", "in_place"})
+    ->ArgsProduct({{16, 64, 256}, {0, 1}});
+
+BENCHMARK_TEMPLATE(BM_LargeRingStream, MPMC_PacketQueue);
+BENCHMARK_TEMPLATE(BM_LargeRingStream, CompactPacketQueue);
+
+BENCHMARK_TEMPLATE(BM_Transfer, MPMC_PacketQueue)->Apply(transfer_args);
+BENCHMARK_TEMPLATE(BM_Transfer, MPMC_BulkPacketQueue)->Apply(transfer_args);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,709 @@
+// Contention stress and profiling harness for BasicMPMCQueue.
+//
+//   ./mpmc_queue_stress --producers=1,2,4 --consumers=2 --ratios=0,0.5,1
+//       --cpus=0,2,4,6,1,3 --raw=hitm:0x4d2 --output=host.jsonl
+//
+// Every configuration (producers x consumers x batch ratio x repeat) moves
+// a fixed number of packets between threads pinned to --cpus, producers
+// first, and writes one record of the results: JSON Lines by default,
+// --format=csv for a header row plus one row per configuration.
+//
+// The workload is deterministic. Each thread decides between a batch and a
+// single operation from its own generator, seeded from --seed, the run
+// number and the thread's index, so a given configuration makes the same
+// sequence of choices every time it is run. The batch ratio is the share
+// of calls that are enqueue_batch()/dequeue_batch() rather than
+// enqueue()/dequeue().
+// The ids received are summed and checked against the ids sent.
+//
+// Each thread counts cycles, instructions and last-level cache misses with
+// perf_event_open, for user space only, and the harness reports their sums
+// per moved packet. There is no generic event for HITM (loads that hit a
+// line modified in another core's cache), so it and any other model
+// specific event are added as raw PMU configs with --raw=name:config; on
+// Skylake-SP MEM_LOAD_L3_HIT_RETIRED.XSNP_HITM is --raw=hitm:0x4d2. Counters
+// that cannot be opened, e.g. under a strict perf_event_paranoid, are
+// reported as null. CAS failures, backoff rounds and slot waits come
+// from the queue's instrumentation hooks and are always there.
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "mpmc_packet_queue.h"
+
+namespace {
+
+// Per-thread contention counts, fed by the queue's instrumentation hooks
+struct ContentionCounts {
+    uint64_t cas_failures = 0;
+    uint64_t backoff_rounds = 0;
+    uint64_t slot_waits = 0;
+
+    ContentionCounts& operator+=(const ContentionCounts& other) noexcept {
+        cas_failures += other.cas_failures;
+        backoff_rounds += other.backoff_rounds;
+        slot_waits += other.slot_waits;
+        return *this;
+    }
+};
+
+thread_local ContentionCounts contention;
+
+struct CountingInstrumentation {
+    static constexpr bool enabled = true;
+
+    static void cas_failure(const void*, TraceOp) noexcept { ++contention.cas_failures; }
+    static void backoff(const void*, TraceOp, unsigned, uint32_t rounds) noexcept {
+        contention.backoff_rounds += rounds;
+    }
+    static void batch(const void*, TraceOp, size_t, size_t) noexcept {}
+    static void slot_wait(const void*, TraceOp, uint32_t spins) noexcept {
+        contention.slot_waits += spins;
+    }
+};
+
+struct StressQueuePolicy : DefaultQueuePolicy {
+    using instrumentation = CountingInstrumentation;
+    static constexpr bool collect_stats = false;
+};
+
+using StressQueue = BasicMPMCQueue<Packet, dynamic_capacity, StressQueuePolicy>;
+
+struct CounterSpec {
+    std::string name;
+    uint32_t type;
+    uint64_t config;
+};
+
+std::vector<CounterSpec> default_counters() {
+#if defined(__linux__)
+    return {
+        {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {"llc_misses", PERF_TYPE_HW_CACHE,
+         PERF_COUNT_HW_CACHE_LL | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+             (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+    };
+#else
+    return {};
+#endif
+}
+
+// One perf_event_open group counting the calling thread. Members that
+// cannot be opened are left out and read back as unavailable.
+class ThreadCounters {
+private:
+    std::vector<int> fds_;      // -1 where a counter is unavailable
+    std::vector<size_t> slot_;  // Position of each counter in the group read
+    int leader_ = -1;
+    size_t opened_ = 0;
+
+public:
+    explicit ThreadCounters(const std::vector<CounterSpec>& specs)
+        : fds_(specs.size(), -1), slot_(specs.size(), 0) {
+#if defined(__linux__)
+        for (size_t i = 0; i < specs.size(); ++i) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = specs[i].type;
+            attr.config = specs[i].config;
+            attr.disabled = leader_ < 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+            int fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, leader_, 0));
+            if (fd < 0) continue;
+            if (leader_ < 0) leader_ = fd;
+            fds_[i] = fd;
+            slot_[i] = opened_++;
+        }
+#endif
+    }
+
+    ~ThreadCounters() {
+#if defined(__linux__)
+        // Members first, then the leader
+        for (int fd : fds_) {
+            if (fd >= 0 && fd != leader_) close(fd);
+        }
+        if (leader_ >= 0) close(leader_);
+#endif
+    }
+
+    ThreadCounters(const ThreadCounters&) = delete;
+    ThreadCounters& operator=(const ThreadCounters&) = delete;
+
+    void start() noexcept {
+#if defined(__linux__)
+        if (leader_ < 0) return;
+        ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+    }
+
+    // Counts since start(), scaled up if the group was multiplexed; -1 for
+    // counters that are unavailable
+    std::vector<double> stop() noexcept {
+        std::vector<double> values(fds_.size(), -1.0);
+#if defined(__linux__)
+        if (leader_ < 0) return values;
+        ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+        // nr, time_enabled, time_running, then one value per member
+        std::vector<uint64_t> data(3 + opened_);
+        ssize_t bytes = read(leader_, data.data(), data.size() * sizeof(uint64_t));
+        if (bytes < static_cast<ssize_t>(3 * sizeof(uint64_t)) || data[2] == 0) return values;
+        const double scale = static_cast<double>(data[1]) / static_cast<double>(data[2]);
+        for (size_t i = 0; i < fds_.size(); ++i) {
+            if (fds_[i] >= 0 && slot_[i] < data[0]) {
+                values[i] = static_cast<double>(data[3 + slot_[i]]) * scale;
+            }
+        }
+#endif
+        return values;
+    }
+};
+
+struct Options {
+    std::vector<size_t> producers = {2};
+    std::vector<size_t> consumers = {2};
+    std::vector<int> cpus;  // Empty: 0, 1, 2, ... round robin
+    std::vector<double> ratios = {0.0, 0.25, 0.5, 0.75, 1.0};
+    size_t packets = size_t(1) << 20;  // Per producer
+    size_t capacity = 1024;
+    size_t batch = 16;
+    uint64_t seed = 1;
+    size_t repeat = 1;
+    int numa_node = -1;
+    bool huge_pages = false;
+    bool csv = false;
+    std::string output;
+    std::vector<CounterSpec> counters = default_counters();
+};
+
+// CPU for thread t of a run, producers first
+int cpu_for(const Options& options, size_t thread) noexcept {
+    if (options.cpus.empty()) {
+        return static_cast<int>(thread % std::max(1u, std::thread::hardware_concurrency()));
+    }
+    return options.cpus[thread % options.cpus.size()];
+}
+
+void pin_to_cpu(int cpu) noexcept {
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#else
+    (void)cpu;
+#endif
+}
+
+// splitmix64: a small, fast, well-mixed generator, reproducible everywhere
+class StressRandom {
+private:
+    uint64_t state_;
+
+public:
+    explicit StressRandom(uint64_t seed) noexcept : state_(seed) {}
+
+    uint64_t next() noexcept {
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // true with probability ratio
+    bool chance(double ratio) noexcept {
+        return static_cast<double>(next() >> 11) * 0x1.0p-53 < ratio;
+    }
+};
+
+
+struct RunResult {
+    uint64_t elapsed_ns = 0;
+    uint64_t received = 0;
+    bool verified = false;
+    uint64_t enqueue_calls = 0;
+    uint64_t dequeue_calls = 0;
+    uint64_t full_retries = 0;
+    uint64_t empty_polls = 0;
+    ContentionCounts contention;
+    std::vector<double> producer_counts;  // Sums over threads; -1 = unavailable
+    std::vector<double> consumer_counts;
+    MemoryPlacement placement;
+};
+
+struct ThreadReport {
+    uint64_t calls = 0;
+    uint64_t idle = 0;  // Calls that moved nothing
+    uint64_t id_sum = 0;
+    uint64_t received = 0;
+    ContentionCounts contention;
+    std::vector<double> counts;
+};
+
+void add_counts(std::vector<double>& total, const std::vector<double>& counts) {
+    if (total.empty()) total.assign(counts.size(), 0.0);
+    for (size_t i = 0; i < counts.size(); ++i) {
+        if (counts[i] < 0 || total[i] < 0) {
+            total[i] = -1.0;
+        } else {
+            total[i] += counts[i];
+        }
+    }
+}
+
+RunResult run_once(const Options& options, size_t producers, size_t consumers, double ratio,
+                   size_t run) {
+    std::unique_ptr<StressQueue> queue;
+    if (options.numa_node >= 0 || options.huge_pages) {
+        MemoryRegionOptions placement;
+        placement.huge_pages = options.huge_pages;
+        placement.numa_node = options.numa_node;
+        queue = std::make_unique<StressQueue>(options.capacity, StatsMode::Disabled, placement);
+    } else {
+        queue = std::make_unique<StressQueue>(options.capacity, StatsMode::Disabled);
+    }
+
+    const size_t threads = producers + consumers;
+    const uint64_t total = static_cast<uint64_t>(producers) * options.packets;
+    auto seed_for = [&](size_t thread) {
+        return options.seed * 0x100000001b3ULL + (static_cast<uint64_t>(run) << 32) + thread;
+    };
+
+    std::vector<ThreadReport> reports(threads);
+    std::atomic<size_t> ready{0};
+    std::atomic<bool> go{false};
+    std::atomic<uint64_t> consumed{0};
+    std::vector<std::thread> workers;
+    workers.reserve(threads);
+
+    // Wait until every thread is pinned and has its counters open, so
+    // setup never lands inside the measured interval
+    auto rendezvous = [&]() {
+        ready.fetch_add(1, std::memory_order_acq_rel);
+        while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+    };
+
+    for (size_t p = 0; p < producers; ++p) {
+        workers.emplace_back([&, p]() {
+            pin_to_cpu(cpu_for(options, p));
+            ThreadReport& report = reports[p];
+            StressRandom random(seed_for(p));
+            std::vector<Packet> burst(options.batch);
+            ThreadCounters counters(options.counters);
+            contention = ContentionCounts{};
+            rendezvous();
+            counters.start();
+
+            uint64_t next = p * options.packets;
+            const uint64_t end = next + options.packets;
+            while (next < end) {
+                size_t accepted;
+                ++report.calls;
+                if (options.batch > 1 && random.chance(ratio)) {
+                    size_t n = static_cast<size_t>(std::min<uint64_t>(options.batch, end - next));
+                    for (size_t i = 0; i < n; ++i) burst[i].id = next + i;
+                    accepted = queue->enqueue_batch(my_std::span<const Packet>(burst.data(), n));
+                } else {
+                    accepted = queue->enqueue(Packet(next)) ? 1 : 0;
+                }
+                next += accepted;
+                if (accepted == 0) {
+                    ++report.idle;
+                    std::this_thread::yield();
+                }
+            }
+
+            report.counts = counters.stop();
+            report.contention = contention;
+        });
+    }
+
+    for (size_t c = 0; c < consumers; ++c) {
+        workers.emplace_back([&, c]() {
+            const size_t thread = producers + c;
+            pin_to_cpu(cpu_for(options, thread));
+            ThreadReport& report = reports[thread];
+            StressRandom random(seed_for(thread));
+            std::vector<Packet> burst(options.batch);
+            ThreadCounters counters(options.counters);
+            contention = ContentionCounts{};
+            rendezvous();
+            counters.start();
+
+            while (consumed.load(std::memory_order_relaxed) < total) {
+                size_t n;
+                ++report.calls;
+                if (options.batch > 1 && random.chance(ratio)) {
+                    n = queue->dequeue_batch(my_std::span<Packet>(burst));
+                } else {
+                    auto packet = queue->dequeue();
+                    n = packet.has_value() ? 1 : 0;
+                    if (n != 0) burst[0] = *packet;
+                }
+                if (n == 0) {
+                    ++report.idle;
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (size_t i = 0; i < n; ++i) report.id_sum += burst[i].id;
+                report.received += n;
+                consumed.fetch_add(n, std::memory_order_relaxed);
+            }
+
+            report.counts = counters.stop();
+            report.contention = contention;
+        });
+    }
+
+    while (ready.load(std::memory_order_acquire) < threads) std::this_thread::yield();
+    auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& worker : workers) worker.join();
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    RunResult result;
+    result.elapsed_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    uint64_t id_sum = 0;
+    for (size_t t = 0; t < threads; ++t) {
+        const ThreadReport& report = reports[t];
+        result.contention += report.contention;
+        if (t < producers) {
+            result.enqueue_calls += report.calls;
+            result.full_retries += report.idle;
+            add_counts(result.producer_counts, report.counts);
+        } else {
+            result.dequeue_calls += report.calls;
+            result.empty_polls += report.idle;
+            result.received += report.received;
+            id_sum += report.id_sum;
+            add_counts(result.consumer_counts, report.counts);
+        }
+    }
+    result.verified = result.received == total && id_sum == total * (total - 1) / 2 &&
+                      queue->empty();
+    result.placement = queue->memory_placement();
+    return result;
+}
+
+// One output record: ordered name/value pairs, rendered as JSON or CSV
+class Record {
+private:
+    struct Field {
+        std::string name;
+        std::string json;
+        std::string csv;
+    };
+    std::vector<Field> fields_;
+
+public:
+    void add(const std::string& name, uint64_t value) {
+        std::string text = std::to_string(value);
+        fields_.push_back({name, text, text});
+    }
+
+    // Negative values mean unavailable: null in JSON, empty in CSV
+    void add(const std::string& name, double value) {
+        if (value < 0) {
+            fields_.push_back({name, "null", ""});
+            return;
+        }
+        char text[32];
+        std::snprintf(text, sizeof(text), "%.6g", value);
+        fields_.push_back({name, text, text});
+    }
+
+    void add(const std::string& name, bool value) {
+        fields_.push_back({name, value ? "true" : "false", value ? "1" : "0"});
+    }
+
+    void add(const std::string& name, const std::string& value) {
+        fields_.push_back({name, "\"" + value + "\"", value});
+    }
+
+    void write_json(FILE* out) const {
+        std::fputc('{', out);
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            std::fprintf(out, "%s\"%s\":%s", i ? "," : "", fields_[i].name.c_str(),
+                         fields_[i].json.c_str());
+        }
+        std::fputs("}\n", out);
+    }
+
+    void write_csv_header(FILE* out) const {
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            std::fprintf(out, "%s%s", i ? "," : "", fields_[i].name.c_str());
+        }
+        std::fputc('\n', out);
+    }
+
+    void write_csv(FILE* out) const {
+        for (size_t i = 0; i < fields_.size(); ++i) {
+            std::fprintf(out, "%s%s", i ? "," : "", fields_[i].csv.c_str());
+        }
+        std::fputc('\n', out);
+    }
+};
+
+const char* backing_name(PageBacking backing) noexcept {
+    switch (backing) {
+    case PageBacking::TransparentHuge: return "thp";
+    case PageBacking::HugeTlb: return "hugetlb";
+    default: return "regular";
+    }
+}
+
+Record make_record(const Options& options, size_t producers, size_t consumers, double ratio,
+                   size_t run, const RunResult& result) {
+    std::string cpus;
+    for (size_t t = 0; t < producers + consumers; ++t) {
+        cpus += (t ? " " : "") + std::to_string(cpu_for(options, t));
+    }
+
+    Record record;
+    record.add("producers", static_cast<uint64_t>(producers));
+    record.add("consumers", static_cast<uint64_t>(consumers));
+    record.add("cpus", cpus);
+    record.add("batch_ratio", ratio);
+    record.add("batch", static_cast<uint64_t>(options.batch));
+    record.add("capacity", static_cast<uint64_t>(options.capacity));
+    record.add("seed", options.seed);
+    record.add("run", static_cast<uint64_t>(run));
+    record.add("numa_node", static_cast<double>(result.placement.numa_node));  // null if unknown
+    record.add("backing", std::string(backing_name(result.placement.backing)));
+    record.add("packets", result.received);
+    record.add("verified", result.verified);
+    record.add("elapsed_ns", result.elapsed_ns);
+    const double packets = static_cast<double>(std::max<uint64_t>(result.received, 1));
+    record.add("mpackets_per_s", packets * 1e3 / static_cast<double>(std::max<uint64_t>(result.elapsed_ns, 1)));
+    record.add("enqueue_calls", result.enqueue_calls);
+    record.add("dequeue_calls", result.dequeue_calls);
+    record.add("full_retries", result.full_retries);
+    record.add("empty_polls", result.empty_polls);
+    record.add("cas_failures", result.contention.cas_failures);
+    record.add("cas_failures_per_packet", static_cast<double>(result.contention.cas_failures) / packets);
+    record.add("backoff_rounds", result.contention.backoff_rounds);
+    record.add("slot_waits", result.contention.slot_waits);
+
+    for (size_t i = 0; i < options.counters.size(); ++i) {
+        const std::string& name = options.counters[i].name;
+        double produced = result.producer_counts.empty() ? -1.0 : result.producer_counts[i];
+        double consumed = result.consumer_counts.empty() ? -1.0 : result.consumer_counts[i];
+        double total = produced < 0 || consumed < 0 ? -1.0 : produced + consumed;
+        record.add("producer_" + name, produced);
+        record.add("consumer_" + name, consumed);
+        record.add(name + "_per_packet", total < 0 ? -1.0 : total / packets);
+    }
+    return record;
+}
+
+template <typename T, typename Parse>
+std::vector<T> parse_list(const std::string& text, Parse parse) {
+    std::vector<T> values;
+    size_t begin = 0;
+    while (begin <= text.size()) {
+        size_t end = text.find(',', begin);
+        if (end == std::string::npos) end = text.size();
+        values.push_back(parse(text.substr(begin, end - begin)));
+        begin = end + 1;
+    }
+    return values;
+}
+
+size_t parse_size(const std::string& text) {
+    size_t used = 0;
+    unsigned long long value = std::stoull(text, &used, 0);
+    if (used != text.size()) throw std::invalid_argument("Not a number: " + text);
+    return static_cast<size_t>(value);
+}
+
+double parse_ratio(const std::string& text) {
+    size_t used = 0;
+    double value = std::stod(text, &used);
+    if (used != text.size() || value < 0.0 || value > 1.0) {
+        throw std::invalid_argument("Batch ratio must be in [0, 1]: " + text);
+    }
+    return value;
+}
+
+void print_usage(FILE* out) {
+    std::fputs(
+        "Usage: mpmc_queue_stress [options]\n"
+        "  --producers=LIST   producer thread counts to sweep (default 2)\n"
+        "  --consumers=LIST   consumer thread counts to sweep (default 2)\n"
+        "  --cpus=LIST        CPUs to pin to, producers first, reused round robin\n"
+        "                     (default 0, 1, 2, ...)\n"
+        "  --ratios=LIST      shares of batch calls to sweep (default 0,0.25,0.5,0.75,1)\n"
+        "  --batch=N          elements per batch call (default 16)\n"
+        "  --packets=N        packets per producer (default 1048576)\n"
+        "  --capacity=N       queue capacity (default 1024)\n"
+        "  --numa-node=N      bind the ring to NUMA node N\n"
+        "  --huge-pages       back the ring with hugepages where available\n"
+        "  --seed=N           workload seed (default 1)\n"
+        "  --repeat=N         runs per configuration (default 1)\n"
+        "  --raw=NAME:CONFIG  also count raw PMU event CONFIG, e.g. hitm:0x4d2\n"
+        "  --no-perf          do not open perf counters\n"
+        "  --format=json|csv  JSON Lines (default) or CSV\n"
+        "  --output=PATH      write results to PATH instead of stdout\n",
+        out);
+}
+
+Options parse_options(int argc, char** argv) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        std::string value;
+        size_t eq = arg.find('=');
+        if (eq != std::string::npos) {
+            value = arg.substr(eq + 1);
+            arg.resize(eq);
+        }
+
+        if (arg == "--producers") {
+            options.producers = parse_list<size_t>(value, parse_size);
+        } else if (arg == "--consumers") {
+            options.consumers = parse_list<size_t>(value, parse_size);
+        } else if (arg == "--cpus") {
+            options.cpus = parse_list<int>(value, [](const std::string& s) {
+                return static_cast<int>(parse_size(s));
+            });
+        } else if (arg == "--ratios") {
+            options.ratios = parse_list<double>(value, parse_ratio);
+        } else if (arg == "--batch") {
+            options.batch = parse_size(value);
+        } else if (arg == "--packets") {
+            options.packets = parse_size(value);
+        } else if (arg == "--capacity") {
+            options.capacity = parse_size(value);
+        } else if (arg == "--numa-node") {
+            options.numa_node = static_cast<int>(parse_size(value));
+        } else if (arg == "--huge-pages") {
+            options.huge_pages = true;
+        } else if (arg == "--seed") {
+            options.seed = parse_size(value);
+        } else if (arg == "--repeat") {
+            options.repeat = parse_size(value);
+        } else if (arg == "--raw") {
+            size_t colon = value.find(':');
+            if (colon == std::string::npos || colon == 0) {
+                throw std::invalid_argument("--raw expects NAME:CONFIG");
+            }
+#if defined(__linux__)
+            options.counters.push_back(
+                {value.substr(0, colon), PERF_TYPE_RAW, parse_size(value.substr(colon + 1))});
+#endif
+        } else if (arg == "--no-perf") {
+            options.counters.clear();
+        } else if (arg == "--format") {
+            if (value != "json" && value != "csv") throw std::invalid_argument("Unknown format: " + value);
+            options.csv = value == "csv";
+        } else if (arg == "--output") {
+            options.output = value;
+        } else if (arg == "--help" || arg == "-h") {
+            print_usage(stdout);
+            std::exit(0);
+        } else {
+            throw std::invalid_argument("Unknown option: " + std::string(argv[i]));
+        }
+    }
+
+    auto positive = [](const std::vector<size_t>& counts) {
+        return !counts.empty() &&
+               std::none_of(counts.begin(), counts.end(), [](size_t n) { return n == 0; });
+    };
+    if (!positive(options.producers) || !positive(options.consumers)) {
+        throw std::invalid_argument("Thread counts must be greater than 0");
+    }
+    if (options.batch == 0 || options.packets == 0 || options.repeat == 0) {
+        throw std::invalid_argument("--batch, --packets and --repeat must be greater than 0");
+    }
+    return options;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    try {
+        options = parse_options(argc, argv);
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "mpmc_queue_stress: %s\n", e.what());
+        print_usage(stderr);
+        return 2;
+    }
+
+    FILE* out = stdout;
+    if (!options.output.empty()) {
+        out = std::fopen(options.output.c_str(), "w");
+        if (out == nullptr) {
+            std::fprintf(stderr, "mpmc_queue_stress: cannot open %s: %s\n",
+                         options.output.c_str(), std::strerror(errno));
+            return 2;
+        }
+    }
+
+    bool all_verified = true;
+    bool header = options.csv;
+    try {
+        for (size_t producers : options.producers) {
+            for (size_t consumers : options.consumers) {
+                for (double ratio : options.ratios) {
+                    for (size_t run = 0; run < options.repeat; ++run) {
+                        RunResult result = run_once(options, producers, consumers, ratio, run);
+                        all_verified &= result.verified;
+                        Record record = make_record(options, producers, consumers, ratio, run, result);
+                        if (header) {
+                            record.write_csv_header(out);
+                            header = false;
+                        }
+                        if (options.csv) {
+                            record.write_csv(out);
+                        } else {
+                            record.write_json(out);
+                        }
+                        std::fflush(out);
+                    }
+                }
+            }
+        }
+    } catch (const std::exception& e) {
+        std::fprintf(stderr, "mpmc_queue_stress: %s\n", e.what());
+        if (out != stdout) std::fclose(out);
+        return 2;
+    }
+
+    if (out != stdout) std::fclose(out);
+    if (!all_verified) {
+        std::fprintf(stderr, "mpmc_queue_stress: a run lost or duplicated packets\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,275 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+
+#include "memory_region.h"
+#include "mpmc_packet_queue.h"
+#include "thread_index.h"
+
+class PacketBufferPool;
+
+// Move-only owner of one pool buffer, wrapped as a Packet. The buffer goes
+// back to its pool when the handle is reset or destroyed, so a queue of
+// PooledPacket (BasicMPMCQueue<PooledPacket>) hands ownership from producer
+// to consumer without any explicit free call.
+class PooledPacket {
+private:
+    PacketBufferPool* pool_ = nullptr;
+    Packet packet_;
+
+    friend class PacketBufferPool;
+
+    PooledPacket(PacketBufferPool* pool, uint8_t* data) noexcept
+        : pool_(pool), packet_(data, 0, PacketPriority::Low) {}
+
+public:
+    PooledPacket() = default;
+
+    PooledPacket(PooledPacket&& other) noexcept
+        : pool_(other.pool_), packet_(std::move(other.packet_)) {
+        other.pool_ = nullptr;
+    }
+
+    PooledPacket& operator=(PooledPacket&& other) noexcept {
+        if (this != &other) {
+            reset();
+            pool_ = other.pool_;
+            packet_ = std::move(other.packet_);
+            other.pool_ = nullptr;
+        }
+        return *this;
+    }
+
+    PooledPacket(const PooledPacket&) = delete;
+    PooledPacket& operator=(const PooledPacket&) = delete;
+
+    ~PooledPacket() { reset(); }
+
+    explicit operator bool() const noexcept { return pool_ != nullptr; }
+
+    Packet& packet() noexcept { return packet_; }
+    const Packet& packet() const noexcept { return packet_; }
+    Packet& operator*() noexcept { return packet_; }
+    Packet* operator->() noexcept { return &packet_; }
+    const Packet* operator->() const noexcept { return &packet_; }
+
+    uint8_t* data() const noexcept { return packet_.data; }
+    inline size_t capacity() const noexcept;
+
+    // Give up ownership and return the bare Packet, e.g. to pass it through
+    // an MPMC_PacketQueue. Hand it back with PacketBufferPool::adopt() or
+    // PacketBufferPool::free().
+    Packet release() noexcept {
+        pool_ = nullptr;
+        return std::move(packet_);
+    }
+
+    // Return the buffer to the pool now
+    inline void reset() noexcept;
+};
+
+// Fixed-size packet buffers carved out of one hugepage-backed region.
+//
+// Free buffers are tracked by index in a global MPMC free list (a packed
+// BasicMPMCQueue<uint32_t>), fronted by a small per-thread cache indexed by
+// ThreadIndex. Steady-state allocate/free on one thread touches only its own
+// cache line; the free list is hit once per cache_size / 2 operations, with
+// one batch transfer. Threads beyond ThreadIndex::MAX_THREADS use the free
+// list directly.
+//
+// Buffers cached by a thread stay cached after it exits and are picked up by
+// the next thread that reuses its index; call flush_local_cache() before a
+// thread exits if other threads must see them sooner.
+class PacketBufferPool {
+public:
+    static constexpr size_t DEFAULT_CACHE_SIZE = 32;
+    static constexpr size_t MAX_CACHE_SIZE = 256;
+
+private:
+    using FreeList = BasicMPMCQueue<uint32_t, dynamic_capacity, PackedQueuePolicy>;
+
+    // Owned by one thread index at a time; no atomics needed
+    struct alignas(CACHE_LINE_SIZE) LocalCache {
+        size_t count = 0;
+        uint32_t items[MAX_CACHE_SIZE];
+    };
+
+    const size_t buffer_size_;
+    const size_t stride_;
+    const size_t buffer_count_;
+    const size_t cache_size_;
+
+    MemoryRegion region_;
+    uint8_t* base_;
+    FreeList free_list_;
+    std::unique_ptr<LocalCache[]> caches_;
+
+    static size_t validate_count(size_t buffer_count) {
+        if (buffer_count == 0) {
+            throw std::invalid_argument("Buffer count must be greater than 0");
+        }
+        if (buffer_count > UINT32_MAX) {
+            throw std::invalid_argument("Buffer count too large");
+        }
+        return buffer_count;
+    }
+
+    static size_t validate_size(size_t buffer_size) {
+        if (buffer_size == 0) {
+            throw std::invalid_argument("Buffer size must be greater than 0");
+        }
+        // Every buffer starts on its own cache line
+        return (buffer_size + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+    }
+
+    LocalCache* local_cache() noexcept {
+        if (cache_size_ == 0) return nullptr;
+        size_t index = ThreadIndex::get();
+        return index < ThreadIndex::MAX_THREADS ? &caches_[index] : nullptr;
+    }
+
+    uint8_t* buffer_at(uint32_t index) const noexcept {
+        return base_ + static_cast<size_t>(index) * stride_;
+    }
+
+    uint32_t index_of(const uint8_t* data) const noexcept {
+        return static_cast<uint32_t>(static_cast<size_t>(data - base_) / stride_);
+    }
+
+    uint8_t* allocate_index() noexcept {
+        LocalCache* cache = local_cache();
+        if (cache == nullptr) {
+            auto index = free_list_.dequeue();
+            return index ? buffer_at(*index) : nullptr;
+        }
+
+        if (cache->count == 0) {
+            // Refill to half, leaving room for frees before the next spill
+            cache->count = free_list_.dequeue_batch(
+                my_std::span<uint32_t>(cache->items, std::max<size_t>(cache_size_ / 2, 1)));
+            if (cache->count == 0) return nullptr;
+        }
+        return buffer_at(cache->items[--cache->count]);
+    }
+
+    void free_index(uint32_t index) noexcept {
+        LocalCache* cache = local_cache();
+        if (cache == nullptr) {
+            // The free list holds every index, so this cannot fail
+            free_list_.enqueue(index);
+            return;
+        }
+
+        if (cache->count == cache_size_) {
+            // Spill the older half back to the free list
+            size_t spill = std::max<size_t>(cache_size_ / 2, 1);
+            free_list_.enqueue_batch(my_std::span<const uint32_t>(cache->items, spill));
+            std::copy(cache->items + spill, cache->items + cache->count, cache->items);
+            cache->count -= spill;
+        }
+        cache->items[cache->count++] = index;
+    }
+
+public:
+    PacketBufferPool(size_t buffer_count, size_t buffer_size,
+                     size_t cache_size = DEFAULT_CACHE_SIZE,
+                     const MemoryRegionOptions& options = {})
+        : buffer_size_(buffer_size),
+          stride_(validate_size(buffer_size)),
+          buffer_count_(validate_count(buffer_count)),
+          cache_size_(std::min(cache_size, MAX_CACHE_SIZE)),
+          region_(stride_ * buffer_count_, options),
+          base_(static_cast<uint8_t*>(region_.data())),
+          free_list_(buffer_count_),
+          caches_(cache_size_ != 0 ? std::make_unique<LocalCache[]>(ThreadIndex::MAX_THREADS)
+                                   : nullptr) {
+        for (size_t i = 0; i < buffer_count_; ++i) {
+            free_list_.enqueue(static_cast<uint32_t>(i));
+        }
+    }
+
+    // Deleted copy/move operations; handles point back at the pool
+    PacketBufferPool(const PacketBufferPool&) = delete;
+    PacketBufferPool& operator=(const PacketBufferPool&) = delete;
+    PacketBufferPool(PacketBufferPool&&) = delete;
+    PacketBufferPool& operator=(PacketBufferPool&&) = delete;
+
+    // All handles must be gone before the pool is destroyed
+    ~PacketBufferPool() = default;
+
+    // Take a buffer; the handle is empty if the pool is exhausted
+    PooledPacket allocate() noexcept {
+        uint8_t* data = allocate_index();
+        return data != nullptr ? PooledPacket(this, data) : PooledPacket();
+    }
+
+    // Raw interface for buffers that travel as bare Packets. Returns nullptr
+    // if the pool is exhausted.
+    uint8_t* allocate_raw() noexcept {
+        return allocate_index();
+    }
+
+    void free(uint8_t* data) noexcept {
+        if (data != nullptr) free_index(index_of(data));
+    }
+
+    void free(Packet& packet) noexcept {
+        free(packet.data);
+        packet.data = nullptr;
+    }
+
+    // Re-wrap a Packet whose buffer came from this pool, taking ownership
+    PooledPacket adopt(Packet&& packet) noexcept {
+        PooledPacket handle;
+        if (packet.data != nullptr) {
+            handle.pool_ = this;
+            handle.packet_ = std::move(packet);
+        }
+        return handle;
+    }
+
+    // Return the calling thread's cached buffers to the shared free list
+    void flush_local_cache() noexcept {
+        LocalCache* cache = local_cache();
+        if (cache == nullptr || cache->count == 0) return;
+        free_list_.enqueue_batch(my_std::span<const uint32_t>(cache->items, cache->count));
+        cache->count = 0;
+    }
+
+    bool owns(const uint8_t* data) const noexcept {
+        return data >= base_ && data < base_ + stride_ * buffer_count_ &&
+               static_cast<size_t>(data - base_) % stride_ == 0;
+    }
+
+    size_t buffer_size() const noexcept { return buffer_size_; }
+    size_t buffer_stride() const noexcept { return stride_; }
+    size_t buffer_count() const noexcept { return buffer_count_; }
+    size_t cache_size() const noexcept { return cache_size_; }
+    PageBacking page_backing() const noexcept { return region_.backing(); }
+    MemoryPlacement memory_placement() const noexcept { return region_.placement(); }
+
+    // Buffers in the shared free list; excludes per-thread caches
+    size_t available() const noexcept { return free_list_.size(); }
+
+    // Memory usage estimation
+    size_t memory_usage() const noexcept {
+        return sizeof(*this) + region_.size() + free_list_.memory_usage() +
+               (caches_ ? ThreadIndex::MAX_THREADS * sizeof(LocalCache) : 0);
+    }
+};
+
+inline size_t PooledPacket::capacity() const noexcept {
+    return pool_ != nullptr ? pool_->buffer_size() : 0;
+}
+
+inline void PooledPacket::reset() noexcept {
+    if (pool_ != nullptr) {
+        pool_->free(packet_);
+        pool_ = nullptr;
+    }
+    packet_ = Packet();
+}
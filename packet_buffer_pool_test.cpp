@@ -0,0 +1,142 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <set>
+#include <cstring>
+#include "packet_buffer_pool.h"
+
+TEST(PacketBufferPoolTest, AllocateAndExhaust) {
+    PacketBufferPool pool(16, 1500, 4);
+    EXPECT_EQ(pool.buffer_count(), 16);
+    EXPECT_EQ(pool.buffer_size(), 1500);
+    EXPECT_EQ(pool.buffer_stride() % CACHE_LINE_SIZE, 0);
+
+    std::vector<PooledPacket> held;
+    std::set<uint8_t*> seen;
+    for (int i = 0; i < 16; ++i) {
+        PooledPacket p = pool.allocate();
+        ASSERT_TRUE(p);
+        EXPECT_TRUE(pool.owns(p.data()));
+        EXPECT_EQ(reinterpret_cast<uintptr_t>(p.data()) % CACHE_LINE_SIZE, 0);
+        EXPECT_EQ(p.capacity(), 1500);
+        std::memset(p.data(), i, p.capacity());
+        EXPECT_TRUE(seen.insert(p.data()).second);
+        held.push_back(std::move(p));
+    }
+    EXPECT_FALSE(pool.allocate());
+    EXPECT_EQ(pool.allocate_raw(), nullptr);
+
+    // Releasing the handles returns every buffer
+    held.clear();
+    for (int i = 0; i < 16; ++i) {
+        held.push_back(pool.allocate());
+        EXPECT_TRUE(held.back());
+    }
+
+    EXPECT_THROW(PacketBufferPool(0, 64), std::invalid_argument);
+    EXPECT_THROW(PacketBufferPool(4, 0), std::invalid_argument);
+}
+
+TEST(PacketBufferPoolTest, RawPacketRoundTrip) {
+    PacketBufferPool pool(8, 256);
+    MPMC_PacketQueue queue(8);
+
+    PooledPacket handle = pool.allocate();
+    ASSERT_TRUE(handle);
+    handle->length = 64;
+    handle->id = 7;
+    uint8_t* buffer = handle.data();
+
+    // Ownership leaves the handle and travels as a plain Packet
+    EXPECT_TRUE(queue.enqueue(handle.release()));
+    EXPECT_FALSE(handle);
+
+    auto packet = queue.dequeue();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->data, buffer);
+    PooledPacket adopted = pool.adopt(std::move(*packet));
+    ASSERT_TRUE(adopted);
+    EXPECT_EQ(adopted->id, 7);
+    EXPECT_EQ(adopted->length, 64);
+
+    uint8_t* raw = pool.allocate_raw();
+    ASSERT_NE(raw, nullptr);
+    EXPECT_TRUE(pool.owns(raw));
+    EXPECT_FALSE(pool.owns(raw + 1));
+    pool.free(raw);
+}
+
+TEST(PacketBufferPoolTest, FlushLocalCache) {
+    PacketBufferPool pool(64, 128, 16);
+    {
+        std::vector<PooledPacket> held;
+        for (int i = 0; i < 20; ++i) held.push_back(pool.allocate());
+    }
+    // Some freed buffers are parked in this thread's cache
+    EXPECT_LT(pool.available(), 64);
+    pool.flush_local_cache();
+    EXPECT_EQ(pool.available(), 64);
+
+    // With caching disabled everything goes straight to the free list
+    PacketBufferPool uncached(8, 128, 0);
+    PooledPacket p = uncached.allocate();
+    EXPECT_EQ(uncached.available(), 7);
+    p.reset();
+    EXPECT_EQ(uncached.available(), 8);
+}
+
+TEST(PacketBufferPoolTest, OwnershipHandoffAcrossThreads) {
+    const int num_producers = 2;
+    const int packets_per_producer = 5000;
+    PacketBufferPool pool(256, 512, 16);
+    BasicMPMCQueue<PooledPacket> queue(64);
+
+    std::atomic<int> consumed{0};
+    std::atomic<bool> corrupted{false};
+    std::vector<std::thread> threads;
+
+    for (int p = 0; p < num_producers; ++p) {
+        threads.emplace_back([&, p]() {
+            for (int i = 0; i < packets_per_producer; ++i) {
+                PooledPacket packet = pool.allocate();
+                while (!packet) {
+                    std::this_thread::yield();
+                    packet = pool.allocate();
+                }
+                uint8_t tag = static_cast<uint8_t>(p * 31 + i);
+                std::memset(packet.data(), tag, 64);
+                packet->length = 64;
+                packet->id = tag;
+                while (!queue.enqueue(std::move(packet))) {
+                    std::this_thread::yield();
+                }
+            }
+            pool.flush_local_cache();
+        });
+    }
+
+    threads.emplace_back([&]() {
+        while (consumed.load() < num_producers * packets_per_producer) {
+            auto packet = queue.dequeue();
+            if (!packet) {
+                std::this_thread::yield();
+                continue;
+            }
+            for (size_t b = 0; b < packet->packet().length; ++b) {
+                if (packet->data()[b] != static_cast<uint8_t>(packet->packet().id)) {
+                    corrupted = true;
+                }
+            }
+            consumed.fetch_add(1);
+            // The buffer returns to the pool when packet goes out of scope
+        }
+        pool.flush_local_cache();
+    });
+
+    for (auto& t : threads) t.join();
+
+    EXPECT_FALSE(corrupted.load());
+    EXPECT_EQ(consumed.load(), num_producers * packets_per_producer);
+    EXPECT_EQ(pool.available(), 256);
+}
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+#include "mpmc_packet_queue.h"
+
+// One lane per PacketPriority value
+constexpr size_t PRIORITY_LANE_COUNT = 4;
+
+static_assert(static_cast<size_t>(PacketPriority::Control) + 1 == PRIORITY_LANE_COUNT,
+              "PRIORITY_LANE_COUNT must cover every PacketPriority value");
+
+// Lane configuration for PriorityPacketQueue.
+//
+// A lane with weight 0 is strict-priority: it is always drained before any
+// weighted lane. Lanes with a non-zero weight share what is left in
+// proportion to their weights (weighted round-robin), so a saturated High
+// lane cannot starve Low forever. The default is pure strict priority.
+struct PriorityQueueConfig {
+    std::array<size_t, PRIORITY_LANE_COUNT> lane_capacity{};
+    std::array<uint32_t, PRIORITY_LANE_COUNT> lane_weight{};
+    StatsMode stats_mode = StatsMode::Disabled;
+
+    static PriorityQueueConfig uniform(size_t capacity_per_lane, bool enable_stats = false) {
+        PriorityQueueConfig config;
+        config.lane_capacity.fill(capacity_per_lane);
+        config.stats_mode = enable_stats ? StatsMode::Shared : StatsMode::Disabled;
+        return config;
+    }
+};
+
+// Multi-lane queue that honors Packet::priority. Each PacketPriority value
+// gets its own lock-free MPMC_PacketQueue ring, and consumers always look at
+// higher lanes first, so a Control packet never waits behind Low traffic.
+class PriorityPacketQueue {
+private:
+    // Upper bound on the precomputed round-robin schedule
+    static constexpr size_t MAX_SCHEDULE_LENGTH = 256;
+
+    std::array<std::unique_ptr<MPMC_PacketQueue>, PRIORITY_LANE_COUNT> lanes_;
+    std::array<uint32_t, PRIORITY_LANE_COUNT> weights_;
+    uint32_t total_weight_ = 0;
+
+    // Strict lanes first, highest priority first; weighted lanes follow in
+    // priority order and are used as the work-conserving fallback.
+    std::array<uint8_t, PRIORITY_LANE_COUNT> scan_order_{};
+    size_t strict_lane_count_ = 0;
+
+    // Smooth weighted round-robin sequence of weighted lanes, used by
+    // single-packet dequeue. Empty when every lane is strict.
+    std::vector<uint8_t> schedule_;
+    alignas(CACHE_LINE_SIZE) std::atomic<size_t> schedule_cursor_{0};
+
+    static size_t lane_index(PacketPriority priority) noexcept {
+        return static_cast<size_t>(priority) & (PRIORITY_LANE_COUNT - 1);
+    }
+
+    void build_schedule() {
+        // Strict lanes, highest priority first
+        for (size_t i = PRIORITY_LANE_COUNT; i-- > 0;) {
+            if (weights_[i] == 0) {
+                scan_order_[strict_lane_count_++] = static_cast<uint8_t>(i);
+            }
+        }
+        size_t next = strict_lane_count_;
+        for (size_t i = PRIORITY_LANE_COUNT; i-- > 0;) {
+            if (weights_[i] != 0) {
+                scan_order_[next++] = static_cast<uint8_t>(i);
+                total_weight_ += weights_[i];
+            }
+        }
+
+        if (total_weight_ == 0) return;
+        if (total_weight_ > MAX_SCHEDULE_LENGTH) {
+            throw std::invalid_argument("Sum of lane weights too large");
+        }
+
+        // Smooth WRR (as in nginx) interleaves lanes instead of emitting
+        // runs, which keeps the per-lane gap bounded.
+        std::array<int64_t, PRIORITY_LANE_COUNT> current{};
+        schedule_.reserve(total_weight_);
+        for (uint32_t n = 0; n < total_weight_; ++n) {
+            size_t best = PRIORITY_LANE_COUNT;
+            for (size_t i = PRIORITY_LANE_COUNT; i-- > 0;) {
+                if (weights_[i] == 0) continue;
+                current[i] += weights_[i];
+                if (best == PRIORITY_LANE_COUNT || current[i] > current[best]) {
+                    best = i;
+                }
+            }
+            current[best] -= total_weight_;
+            schedule_.push_back(static_cast<uint8_t>(best));
+        }
+    }
+
+public:
+    // Pure strict priority with the same capacity on every lane
+    explicit PriorityPacketQueue(size_t capacity_per_lane, bool enable_stats = false)
+        : PriorityPacketQueue(PriorityQueueConfig::uniform(capacity_per_lane, enable_stats)) {}
+
+    explicit PriorityPacketQueue(const PriorityQueueConfig& config)
+        : weights_(config.lane_weight) {
+        for (size_t i = 0; i < PRIORITY_LANE_COUNT; ++i) {
+            lanes_[i] = std::make_unique<MPMC_PacketQueue>(config.lane_capacity[i],
+                                                           config.stats_mode);
+        }
+        build_schedule();
+    }
+
+    PriorityPacketQueue(const PriorityPacketQueue&) = delete;
+    PriorityPacketQueue& operator=(const PriorityPacketQueue&) = delete;
+    PriorityPacketQueue(PriorityPacketQueue&&) = delete;
+    PriorityPacketQueue& operator=(PriorityPacketQueue&&) = delete;
+
+    ~PriorityPacketQueue() = default;
+
+    // Enqueue into the lane selected by packet.priority
+    bool enqueue(const Packet& packet) noexcept {
+        return lanes_[lane_index(packet.priority)]->enqueue(packet);
+    }
+
+    bool enqueue(Packet&& packet) noexcept {
+        MPMC_PacketQueue& lane = *lanes_[lane_index(packet.priority)];
+        return lane.enqueue(std::move(packet));
+    }
+
+    bool try_enqueue(const Packet& packet) noexcept {
+        return lanes_[lane_index(packet.priority)]->try_enqueue(packet);
+    }
+
+    bool try_enqueue(Packet&& packet) noexcept {
+        MPMC_PacketQueue& lane = *lanes_[lane_index(packet.priority)];
+        return lane.try_enqueue(std::move(packet));
+    }
+
+    // Enqueue a burst, handing each run of same-priority packets to its lane
+    // as one batch. Stops at the first packet whose lane is full, so the
+    // return value is always a prefix length as with MPMC_PacketQueue.
+    size_t enqueue_batch(my_std::span<const Packet> packets) noexcept {
+        size_t enqueued = 0;
+        while (enqueued < packets.size()) {
+            PacketPriority priority = packets[enqueued].priority;
+            size_t run = 1;
+            while (enqueued + run < packets.size() &&
+                   packets[enqueued + run].priority == priority) {
+                ++run;
+            }
+
+            size_t accepted = lanes_[lane_index(priority)]->enqueue_batch(
+                packets.subspan(enqueued, run));
+            enqueued += accepted;
+            if (accepted < run) break;
+        }
+        return enqueued;
+    }
+
+    // As enqueue_batch, moving the accepted prefix out of packets
+    size_t enqueue_batch_move(my_std::span<Packet> packets) noexcept {
+        size_t enqueued = 0;
+        while (enqueued < packets.size()) {
+            PacketPriority priority = packets[enqueued].priority;
+            size_t run = 1;
+            while (enqueued + run < packets.size() &&
+                   packets[enqueued + run].priority == priority) {
+                ++run;
+            }
+
+            size_t accepted = lanes_[lane_index(priority)]->enqueue_batch_move(
+                packets.subspan(enqueued, run));
+            enqueued += accepted;
+            if (accepted < run) break;
+        }
+        return enqueued;
+    }
+
+    // Dequeue one packet. Strict lanes are always checked first; weighted
+    // lanes take turns according to the round-robin schedule and fall back
+    // to priority order when the scheduled lane is empty.
+    std::optional<Packet> dequeue() noexcept {
+        for (size_t i = 0; i < strict_lane_count_; ++i) {
+            auto packet = lanes_[scan_order_[i]]->dequeue();
+            if (packet.has_value()) return packet;
+        }
+
+        if (!schedule_.empty()) {
+            size_t turn = schedule_cursor_.fetch_add(1, std::memory_order_relaxed);
+            auto packet = lanes_[schedule_[turn % schedule_.size()]]->dequeue();
+            if (packet.has_value()) return packet;
+        }
+
+        for (size_t i = strict_lane_count_; i < PRIORITY_LANE_COUNT; ++i) {
+            auto packet = lanes_[scan_order_[i]]->dequeue();
+            if (packet.has_value()) return packet;
+        }
+        return std::nullopt;
+    }
+
+    std::optional<Packet> try_dequeue() noexcept {
+        for (size_t i = 0; i < PRIORITY_LANE_COUNT; ++i) {
+            auto packet = lanes_[scan_order_[i]]->try_dequeue();
+            if (packet.has_value()) return packet;
+        }
+        return std::nullopt;
+    }
+
+    // Dequeue up to packets.size() packets. Strict lanes are drained first.
+    // The remaining room is split between weighted lanes in proportion to
+    // their weights, and any share a lane could not use goes to the other
+    // lanes in priority order. No shared cursor is touched on this path.
+    size_t dequeue_batch(my_std::span<Packet> packets) noexcept {
+        size_t dequeued = 0;
+
+        for (size_t i = 0; i < strict_lane_count_ && dequeued < packets.size(); ++i) {
+            dequeued += lanes_[scan_order_[i]]->dequeue_batch(packets.subspan(dequeued));
+        }
+
+        if (total_weight_ != 0 && dequeued < packets.size()) {
+            size_t room = packets.size() - dequeued;
+            for (size_t i = strict_lane_count_; i < PRIORITY_LANE_COUNT && dequeued < packets.size(); ++i) {
+                size_t lane = scan_order_[i];
+                size_t share = (room * weights_[lane] + total_weight_ - 1) / total_weight_;
+                share = std::min(share, packets.size() - dequeued);
+                dequeued += lanes_[lane]->dequeue_batch(packets.subspan(dequeued, share));
+            }
+        }
+
+        for (size_t i = strict_lane_count_; i < PRIORITY_LANE_COUNT && dequeued < packets.size(); ++i) {
+            dequeued += lanes_[scan_order_[i]]->dequeue_batch(packets.subspan(dequeued));
+        }
+        return dequeued;
+    }
+
+    // Queue state queries
+    size_t size() const noexcept {
+        size_t total = 0;
+        for (const auto& lane : lanes_) total += lane->size();
+        return total;
+    }
+
+    size_t lane_size(PacketPriority priority) const noexcept {
+        return lanes_[lane_index(priority)]->size();
+    }
+
+    size_t capacity() const noexcept {
+        size_t total = 0;
+        for (const auto& lane : lanes_) total += lane->capacity();
+        return total;
+    }
+
+    bool empty() const noexcept {
+        for (const auto& lane : lanes_) {
+            if (!lane->empty()) return false;
+        }
+        return true;
+    }
+
+    // Direct access to one lane, e.g. for per-lane statistics
+    MPMC_PacketQueue& lane(PacketPriority priority) noexcept {
+        return *lanes_[lane_index(priority)];
+    }
+
+    const MPMC_PacketQueue& lane(PacketPriority priority) const noexcept {
+        return *lanes_[lane_index(priority)];
+    }
+
+    // Memory usage estimation
+    size_t memory_usage() const noexcept {
+        size_t total = sizeof(*this) + schedule_.capacity();
+        for (const auto& lane : lanes_) total += lane->memory_usage();
+        return total;
+    }
+};
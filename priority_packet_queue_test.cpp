@@ -0,0 +1,195 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <set>
+#include "priority_packet_queue.h"
+
+namespace {
+
+Packet make_packet(size_t id, PacketPriority priority) {
+    Packet packet(id);
+    packet.priority = priority;
+    return packet;
+}
+
+} // namespace
+
+TEST(PriorityPacketQueueTest, StrictPriorityOrder) {
+    PriorityPacketQueue queue(16);
+
+    EXPECT_TRUE(queue.enqueue(make_packet(1, PacketPriority::Low)));
+    EXPECT_TRUE(queue.enqueue(make_packet(2, PacketPriority::Medium)));
+    EXPECT_TRUE(queue.enqueue(make_packet(3, PacketPriority::Control)));
+    EXPECT_TRUE(queue.enqueue(make_packet(4, PacketPriority::High)));
+    EXPECT_TRUE(queue.enqueue(make_packet(5, PacketPriority::Control)));
+    EXPECT_EQ(queue.size(), 5);
+    EXPECT_EQ(queue.lane_size(PacketPriority::Control), 2);
+
+    std::vector<size_t> order;
+    while (auto packet = queue.dequeue()) {
+        order.push_back(packet->id);
+    }
+    EXPECT_EQ(order, (std::vector<size_t>{3, 5, 4, 2, 1}));
+    EXPECT_TRUE(queue.empty());
+}
+
+TEST(PriorityPacketQueueTest, ControlNotBlockedByFullLowLane) {
+    PriorityPacketQueue queue(4);
+
+    for (size_t i = 0; i < 4; ++i) {
+        EXPECT_TRUE(queue.enqueue(make_packet(i, PacketPriority::Low)));
+    }
+    EXPECT_FALSE(queue.enqueue(make_packet(99, PacketPriority::Low)));
+
+    // The Low lane is full, but Control has its own ring
+    EXPECT_TRUE(queue.enqueue(make_packet(100, PacketPriority::Control)));
+
+    auto packet = queue.try_dequeue();
+    ASSERT_TRUE(packet.has_value());
+    EXPECT_EQ(packet->id, 100);
+}
+
+TEST(PriorityPacketQueueTest, BatchEnqueueRoutesByPriority) {
+    PriorityPacketQueue queue(8);
+
+    std::vector<Packet> burst;
+    burst.push_back(make_packet(0, PacketPriority::Low));
+    burst.push_back(make_packet(1, PacketPriority::Low));
+    burst.push_back(make_packet(2, PacketPriority::High));
+    burst.push_back(make_packet(3, PacketPriority::Control));
+    burst.push_back(make_packet(4, PacketPriority::Low));
+
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst)), burst.size());
+    EXPECT_EQ(queue.lane_size(PacketPriority::Low), 3);
+    EXPECT_EQ(queue.lane_size(PacketPriority::High), 1);
+    EXPECT_EQ(queue.lane_size(PacketPriority::Control), 1);
+
+    std::vector<Packet> out(8);
+    size_t dequeued = queue.dequeue_batch(my_std::span<Packet>(out));
+    ASSERT_EQ(dequeued, 5);
+    EXPECT_EQ(out[0].id, 3);
+    EXPECT_EQ(out[1].id, 2);
+    EXPECT_EQ(out[2].id, 0);
+    EXPECT_EQ(out[3].id, 1);
+    EXPECT_EQ(out[4].id, 4);
+}
+
+TEST(PriorityPacketQueueTest, BatchEnqueueStopsAtFullLane) {
+    PriorityPacketQueue queue(2);
+
+    std::vector<Packet> burst;
+    for (size_t i = 0; i < 3; ++i) {
+        burst.push_back(make_packet(i, PacketPriority::Medium));
+    }
+    burst.push_back(make_packet(3, PacketPriority::Control));
+
+    // Only a prefix is accepted so the caller can retry the rest in order
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst)), 2);
+    EXPECT_EQ(queue.lane_size(PacketPriority::Control), 0);
+}
+
+TEST(PriorityPacketQueueTest, WeightedRoundRobinPreventsStarvation) {
+    PriorityQueueConfig config = PriorityQueueConfig::uniform(1024);
+    config.lane_weight = {1, 1, 2, 0}; // Control strict, High:Medium:Low = 2:1:1
+    PriorityPacketQueue queue(config);
+
+    for (size_t i = 0; i < 400; ++i) {
+        EXPECT_TRUE(queue.enqueue(make_packet(i, PacketPriority::High)));
+        EXPECT_TRUE(queue.enqueue(make_packet(1000 + i, PacketPriority::Low)));
+    }
+    EXPECT_TRUE(queue.enqueue(make_packet(5000, PacketPriority::Control)));
+
+    auto first = queue.dequeue();
+    ASSERT_TRUE(first.has_value());
+    EXPECT_EQ(first->priority, PacketPriority::Control);
+
+    size_t low = 0;
+    size_t high = 0;
+    for (size_t i = 0; i < 300; ++i) {
+        auto packet = queue.dequeue();
+        ASSERT_TRUE(packet.has_value());
+        if (packet->priority == PacketPriority::Low) ++low;
+        if (packet->priority == PacketPriority::High) ++high;
+    }
+    // Low still gets served while High is saturated
+    EXPECT_GT(low, 50);
+    EXPECT_GT(high, low);
+}
+
+TEST(PriorityPacketQueueTest, WeightedBatchDequeueSharesRoom) {
+    PriorityQueueConfig config = PriorityQueueConfig::uniform(256);
+    config.lane_weight = {1, 0, 3, 0};
+    PriorityPacketQueue queue(config);
+
+    for (size_t i = 0; i < 100; ++i) {
+        EXPECT_TRUE(queue.enqueue(make_packet(i, PacketPriority::High)));
+        EXPECT_TRUE(queue.enqueue(make_packet(i, PacketPriority::Low)));
+    }
+
+    std::vector<Packet> out(40);
+    ASSERT_EQ(queue.dequeue_batch(my_std::span<Packet>(out)), 40);
+    size_t low = 0;
+    for (const auto& packet : out) {
+        if (packet.priority == PacketPriority::Low) ++low;
+    }
+    EXPECT_EQ(low, 10);
+}
+
+TEST(PriorityPacketQueueTest, InvalidWeightsRejected) {
+    PriorityQueueConfig config = PriorityQueueConfig::uniform(8);
+    config.lane_weight = {200, 200, 0, 0};
+    EXPECT_THROW(PriorityPacketQueue queue(config), std::invalid_argument);
+
+    EXPECT_THROW(PriorityPacketQueue queue(0), std::invalid_argument);
+}
+
+TEST(PriorityPacketQueueTest, MultiThreadedNoLoss) {
+    constexpr size_t num_producers = 4;
+    constexpr size_t packets_per_producer = 2000;
+    constexpr size_t total_packets = num_producers * packets_per_producer;
+
+    PriorityPacketQueue queue(256);
+    std::atomic<size_t> consumed{0};
+    std::vector<std::set<size_t>> seen(2);
+
+    std::vector<std::thread> producers;
+    for (size_t p = 0; p < num_producers; ++p) {
+        producers.emplace_back([&, p]() {
+            for (size_t i = 0; i < packets_per_producer; ++i) {
+                size_t id = p * packets_per_producer + i;
+                auto priority = static_cast<PacketPriority>(id % PRIORITY_LANE_COUNT);
+                while (!queue.enqueue(make_packet(id, priority))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<std::thread> consumers;
+    for (size_t c = 0; c < seen.size(); ++c) {
+        consumers.emplace_back([&, c]() {
+            std::vector<Packet> batch(16);
+            while (consumed.load() < total_packets) {
+                size_t n = queue.dequeue_batch(my_std::span<Packet>(batch));
+                for (size_t i = 0; i < n; ++i) {
+                    seen[c].insert(batch[i].id);
+                }
+                consumed.fetch_add(n);
+                if (n == 0) std::this_thread::yield();
+            }
+        });
+    }
+
+    for (auto& t : producers) t.join();
+    for (auto& t : consumers) t.join();
+
+    std::set<size_t> all;
+    for (const auto& s : seen) {
+        for (size_t id : s) {
+            EXPECT_TRUE(all.insert(id).second) << "Packet " << id << " consumed multiple times";
+        }
+    }
+    EXPECT_EQ(all.size(), total_packets);
+    EXPECT_TRUE(queue.empty());
+}
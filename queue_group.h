@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "mpmc_packet_queue.h"
+#include "thread_index.h"
+
+// Power-of-two-choices load balancing over a set of queues.
+//
+// Each selection samples two members at random and picks the one whose
+// approx_size() is lower. That reads one occupancy-hint line per sampled
+// queue and never touches any head/tail index, so a dispatcher can balance
+// across dozens of worker queues without pulling their hot lines over.
+// Two random choices keep the maximum load within O(log log n) of the
+// mean, close to what scanning every queue would achieve.
+//
+// The group does not own its queues; they must outlive it.
+template <typename Queue = MPMC_PacketQueue>
+class QueueGroup {
+public:
+    using value_type = typename Queue::value_type;
+
+private:
+    std::vector<Queue*> queues_;
+
+    // xorshift64*, one state per thread
+    static uint64_t next_random() noexcept {
+        thread_local uint64_t state =
+            (0x9E3779B97F4A7C15ull * (ThreadIndex::get() + 1) ^
+             reinterpret_cast<uintptr_t>(&state)) | 1;
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 0x2545F4914F6CDD1Dull;
+    }
+
+    // Uniform in [0, n) without a division
+    static size_t scale(uint32_t r, size_t n) noexcept {
+        return static_cast<size_t>((static_cast<uint64_t>(r) * n) >> 32);
+    }
+
+    // Two distinct members (the same one twice when there is only one)
+    std::pair<size_t, size_t> pick_two() const noexcept {
+        size_t n = queues_.size();
+        uint64_t r = next_random();
+        size_t first = scale(static_cast<uint32_t>(r), n);
+        if (n == 1) return {first, first};
+        size_t second = (first + 1 + scale(static_cast<uint32_t>(r >> 32), n - 1)) % n;
+        return {first, second};
+    }
+
+    template <typename U>
+    bool enqueue_impl(U&& value, size_t* chosen) noexcept {
+        auto [a, b] = pick_two();
+        if (queues_[b]->approx_size() < queues_[a]->approx_size()) std::swap(a, b);
+
+        // Fall back to the other choice if the preferred one is full. A
+        // failed enqueue leaves value untouched, so it can be retried.
+        if (queues_[a]->enqueue(std::forward<U>(value))) {
+            if (chosen) *chosen = a;
+            return true;
+        }
+        if (a != b && queues_[b]->enqueue(std::forward<U>(value))) {
+            if (chosen) *chosen = b;
+            return true;
+        }
+        return false;
+    }
+
+public:
+    QueueGroup() = default;
+
+    explicit QueueGroup(std::vector<Queue*> queues) : queues_(std::move(queues)) {
+        for (Queue* queue : queues_) {
+            if (queue == nullptr) {
+                throw std::invalid_argument("QueueGroup members must not be null");
+            }
+        }
+    }
+
+    void add(Queue& queue) {
+        queues_.push_back(&queue);
+    }
+
+    size_t size() const noexcept { return queues_.size(); }
+    bool empty() const noexcept { return queues_.empty(); }
+
+    Queue& operator[](size_t index) noexcept { return *queues_[index]; }
+    const Queue& operator[](size_t index) const noexcept { return *queues_[index]; }
+
+    // Index of the less loaded of two random members. The group must not
+    // be empty.
+    size_t select() const noexcept {
+        auto [a, b] = pick_two();
+        return queues_[b]->approx_size() < queues_[a]->approx_size() ? b : a;
+    }
+
+    // Enqueue to the less loaded of two random members, trying the other
+    // one if it is full. chosen, if given, receives the member used.
+    // Returns false if the group is empty or both choices are full.
+    bool enqueue(const value_type& value, size_t* chosen = nullptr) noexcept {
+        return !queues_.empty() && enqueue_impl(value, chosen);
+    }
+
+    bool enqueue(value_type&& value, size_t* chosen = nullptr) noexcept {
+        return !queues_.empty() && enqueue_impl(std::move(value), chosen);
+    }
+
+    // Sum of the members' approx_size()
+    size_t approx_size() const noexcept {
+        size_t total = 0;
+        for (const Queue* queue : queues_) total += queue->approx_size();
+        return total;
+    }
+};
@@ -0,0 +1,109 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include "queue_group.h"
+
+struct NoHintPolicy : DefaultQueuePolicy {
+    static constexpr size_t occupancy_hint_interval = 0;
+};
+
+TEST(QueueGroupTest, ApproxSizeTracksOccupancy) {
+    MPMC_PacketQueue queue(256);
+    EXPECT_EQ(queue.approx_size(), 0);
+    EXPECT_TRUE(queue.approx_empty());
+
+    // The hint refreshes every occupancy_hint_interval operations
+    for (size_t i = 0; i < 64; ++i) {
+        EXPECT_TRUE(queue.enqueue(Packet(i)));
+    }
+    EXPECT_EQ(queue.approx_size(), 64);
+
+    std::vector<Packet> out(32);
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(out)), 32);
+    EXPECT_EQ(queue.approx_size(), 32);
+
+    for (size_t i = 0; i < 32; ++i) {
+        EXPECT_TRUE(queue.dequeue().has_value());
+    }
+    EXPECT_EQ(queue.approx_size(), 0);
+    EXPECT_LE(queue.approx_size(), queue.capacity());
+
+    // With the hint disabled approx_size() is exact
+    BasicMPMCQueue<Packet, 8, NoHintPolicy> exact;
+    EXPECT_TRUE(exact.enqueue(Packet(1)));
+    EXPECT_EQ(exact.approx_size(), 1);
+}
+
+TEST(QueueGroupTest, PrefersLessLoadedQueue) {
+    std::vector<std::unique_ptr<MPMC_PacketQueue>> queues;
+    QueueGroup<> group;
+    for (int i = 0; i < 2; ++i) {
+        queues.push_back(std::make_unique<MPMC_PacketQueue>(1024));
+        group.add(*queues.back());
+    }
+
+    // Queue 0 is visibly loaded; the other choice must always win
+    for (size_t i = 0; i < 64; ++i) {
+        EXPECT_TRUE(queues[0]->enqueue(Packet(i)));
+    }
+    for (int i = 0; i < 20; ++i) {
+        EXPECT_EQ(group.select(), 1);
+    }
+
+    size_t chosen = 0;
+    EXPECT_TRUE(group.enqueue(Packet(100), &chosen));
+    EXPECT_EQ(chosen, 1);
+    EXPECT_EQ(group.approx_size(), 64);
+
+    EXPECT_THROW(QueueGroup<>(std::vector<MPMC_PacketQueue*>{nullptr}), std::invalid_argument);
+    QueueGroup<> empty_group;
+    EXPECT_FALSE(empty_group.enqueue(Packet(1)));
+}
+
+TEST(QueueGroupTest, FallsBackWhenFull) {
+    MPMC_PacketQueue small(2);
+    MPMC_PacketQueue large(64);
+    QueueGroup<> group({&small, &large});
+
+    size_t accepted = 0;
+    for (size_t i = 0; i < 40; ++i) {
+        if (group.enqueue(Packet(i))) ++accepted;
+    }
+    EXPECT_EQ(accepted, 40);
+    EXPECT_EQ(small.size() + large.size(), 40);
+    EXPECT_TRUE(small.full());
+}
+
+TEST(QueueGroupTest, BalancesAcrossWorkers) {
+    constexpr size_t num_queues = 8;
+    constexpr size_t num_packets = 8000;
+    std::vector<std::unique_ptr<MPMC_PacketQueue>> queues;
+    QueueGroup<> group;
+    for (size_t i = 0; i < num_queues; ++i) {
+        queues.push_back(std::make_unique<MPMC_PacketQueue>(2048));
+        group.add(*queues.back());
+    }
+
+    std::vector<std::thread> producers;
+    for (int p = 0; p < 2; ++p) {
+        producers.emplace_back([&, p]() {
+            for (size_t i = 0; i < num_packets / 2; ++i) {
+                while (!group.enqueue(Packet(p * num_packets + i))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : producers) t.join();
+
+    size_t total = 0;
+    for (const auto& queue : queues) {
+        // Far from a uniform-random split; each member near the mean of 1000
+        EXPECT_GT(queue->size(), num_packets / num_queues / 2);
+        EXPECT_LT(queue->size(), num_packets / num_queues * 3 / 2);
+        total += queue->size();
+    }
+    EXPECT_EQ(total, num_packets);
+}
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include "mpmc_packet_queue.h"
+#include "priority_packet_queue.h"
+#include "wait_event.h"
+
+// Select-like consumer over many queues.
+//
+// Every member has one bit in a shared ready word. Producers that go
+// through the poll set set their queue's bit when it is clear, and
+// consumers clear it when they find the queue empty. A poll therefore reads
+// the ready word instead of a slot in each member, and only touches queues
+// that have something. An idle consumer parks on one WaitEvent for all the
+// members, which producers wake only when a bit goes from clear to set.
+//
+// Members have a PacketPriority. Higher levels are drained first; within a
+// level the queues are served round robin, up to quantum elements each per
+// pass.
+//
+// The poll set does not own its queues; they must outlive it. Members must
+// be added before the set is shared between threads. Producers that
+// enqueue to a member directly must call mark_ready() afterwards, or a
+// consumer parked in dequeue_batch_wait() may not notice.
+template <typename Queue = MPMC_PacketQueue>
+class QueuePollSet {
+public:
+    using value_type = typename Queue::value_type;
+
+    static constexpr size_t MAX_QUEUES = 64;
+    static constexpr size_t DEFAULT_QUANTUM = 32;
+
+private:
+    struct Member {
+        Queue* queue;
+        PacketPriority priority;
+    };
+
+    const size_t quantum_;
+    std::vector<Member> members_;
+    std::array<uint64_t, PRIORITY_LANE_COUNT> level_masks_{};
+
+    // Mostly read: producers only write it when a bit changes
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> ready_{0};
+    alignas(CACHE_LINE_SIZE) std::array<std::atomic<uint32_t>, PRIORITY_LANE_COUNT> cursors_{};
+    alignas(CACHE_LINE_SIZE) WaitEvent ready_event_;
+
+    static size_t validate_quantum(size_t quantum) {
+        if (quantum == 0) {
+            throw std::invalid_argument("Quantum must be greater than 0");
+        }
+        return quantum;
+    }
+
+    static constexpr uint64_t bit(size_t index) noexcept {
+        return uint64_t(1) << index;
+    }
+
+    // Dequeue from one member. A short batch means the queue looked empty:
+    // clear its bit, then look again in case a producer raced past the
+    // bit while it was still set. One of the two fences sees the other
+    // side's write, so a queued element never sits behind a clear bit.
+    size_t take(size_t index, my_std::span<value_type> items) noexcept {
+        Queue& queue = *members_[index].queue;
+        size_t count = queue.dequeue_batch(items);
+        if (count < items.size()) {
+            ready_.fetch_and(~bit(index), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!queue.empty()) ready_.fetch_or(bit(index), std::memory_order_relaxed);
+        }
+        return count;
+    }
+
+    // Serve the ready members of one level round robin, starting after the
+    // last one served
+    size_t poll_level(size_t level, my_std::span<value_type> items) noexcept {
+        const uint64_t mask = level_masks_[level];
+        size_t count = 0;
+        bool progress = true;
+        while (progress && count < items.size()) {
+            uint64_t ready = ready_.load(std::memory_order_acquire) & mask;
+            if (ready == 0) break;
+
+            progress = false;
+            const uint32_t start = cursors_[level].load(std::memory_order_relaxed);
+            const uint64_t upper = ready & (~uint64_t(0) << start);
+            for (uint64_t bits : {upper, ready & ~upper}) {
+                while (bits != 0 && count < items.size()) {
+                    size_t index = static_cast<size_t>(__builtin_ctzll(bits));
+                    bits &= bits - 1;
+                    size_t want = std::min(quantum_, items.size() - count);
+                    size_t got = take(index, items.subspan(count, want));
+                    count += got;
+                    progress |= got != 0;
+                    cursors_[level].store(static_cast<uint32_t>((index + 1) % MAX_QUEUES),
+                                          std::memory_order_relaxed);
+                }
+            }
+        }
+        return count;
+    }
+
+    // Publish that member index has something. The fence pairs with the
+    // one in take(); it also covers the waiter check of the notify.
+    void publish(size_t index) noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (ready_.load(std::memory_order_relaxed) & bit(index)) return;
+        ready_.fetch_or(bit(index), std::memory_order_release);
+        ready_event_.notify_all();
+    }
+
+public:
+    explicit QueuePollSet(size_t quantum = DEFAULT_QUANTUM)
+        : quantum_(validate_quantum(quantum)) {
+        members_.reserve(MAX_QUEUES);
+    }
+
+    QueuePollSet(const QueuePollSet&) = delete;
+    QueuePollSet& operator=(const QueuePollSet&) = delete;
+    QueuePollSet(QueuePollSet&&) = delete;
+    QueuePollSet& operator=(QueuePollSet&&) = delete;
+
+    // Add a member and return its index. A queue that already holds
+    // elements starts out ready. Throws std::length_error past MAX_QUEUES.
+    size_t add(Queue& queue, PacketPriority priority = PacketPriority::Low) {
+        if (members_.size() == MAX_QUEUES) {
+            throw std::length_error("Too many queues in poll set");
+        }
+        size_t index = members_.size();
+        members_.push_back(Member{&queue, priority});
+        level_masks_[static_cast<size_t>(priority) & (PRIORITY_LANE_COUNT - 1)] |= bit(index);
+        if (!queue.empty()) ready_.fetch_or(bit(index), std::memory_order_relaxed);
+        return index;
+    }
+
+    size_t size() const noexcept { return members_.size(); }
+    size_t quantum() const noexcept { return quantum_; }
+
+    Queue& operator[](size_t index) noexcept { return *members_[index].queue; }
+    const Queue& operator[](size_t index) const noexcept { return *members_[index].queue; }
+
+    // Producer side: enqueue to member index and mark it ready
+    bool enqueue(size_t index, const value_type& value) noexcept {
+        if (!members_[index].queue->enqueue(value)) return false;
+        publish(index);
+        return true;
+    }
+
+    bool enqueue(size_t index, value_type&& value) noexcept {
+        if (!members_[index].queue->enqueue(std::move(value))) return false;
+        publish(index);
+        return true;
+    }
+
+    size_t enqueue_batch(size_t index, my_std::span<const value_type> values) noexcept {
+        size_t count = members_[index].queue->enqueue_batch(values);
+        if (count != 0) publish(index);
+        return count;
+    }
+
+    // For producers that enqueued to member index directly
+    void mark_ready(size_t index) noexcept { publish(index); }
+
+    // Dequeue up to items.size() elements across the ready members,
+    // highest priority first. Returns 0 when none of them had anything.
+    size_t dequeue_batch(my_std::span<value_type> items) noexcept {
+        size_t count = 0;
+        for (size_t level = PRIORITY_LANE_COUNT; level-- > 0 && count < items.size();) {
+            if (level_masks_[level] != 0) count += poll_level(level, items.subspan(count));
+        }
+        return count;
+    }
+
+    // As dequeue_batch, but parks until some member becomes ready or the
+    // timeout expires. Returns 0 only on timeout.
+    template <typename Rep, typename Period>
+    size_t dequeue_batch_wait(my_std::span<value_type> items,
+                              const std::chrono::duration<Rep, Period>& timeout) noexcept {
+        size_t count = dequeue_batch(items);
+        if (count != 0 || items.empty()) return count;
+
+        auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(timeout);
+        while (true) {
+            uint32_t key = ready_event_.prepare_wait();
+            if (any_ready()) {
+                ready_event_.cancel_wait();
+            } else if (!ready_event_.wait(key, deadline)) {
+                return dequeue_batch(items); // One last try after the timeout
+            }
+            if ((count = dequeue_batch(items)) != 0) return count;
+        }
+    }
+
+    // Bitmap of members marked ready; a set bit may belong to a queue that
+    // has just been drained
+    uint64_t ready_mask() const noexcept { return ready_.load(std::memory_order_acquire); }
+    bool any_ready() const noexcept { return ready_mask() != 0; }
+};
@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "queue_poll_set.h"
+
+namespace {
+
+std::vector<std::unique_ptr<MPMC_PacketQueue>> make_queues(size_t count, size_t capacity = 64) {
+    std::vector<std::unique_ptr<MPMC_PacketQueue>> queues;
+    for (size_t i = 0; i < count; ++i) queues.push_back(std::make_unique<MPMC_PacketQueue>(capacity));
+    return queues;
+}
+
+} // namespace
+
+TEST(QueuePollSetTest, ReadyBitsFollowProducersAndConsumers) {
+    EXPECT_THROW(QueuePollSet<>(0), std::invalid_argument);
+
+    auto queues = make_queues(3);
+    ASSERT_TRUE(queues[2]->enqueue(Packet(7)));
+    QueuePollSet<> poll;
+    for (auto& queue : queues) poll.add(*queue);
+    EXPECT_EQ(poll.size(), 3);
+    EXPECT_EQ(poll.ready_mask(), 0b100);  // Already holding a packet
+
+    EXPECT_TRUE(poll.enqueue(0, Packet(1)));
+    std::vector<Packet> burst = {Packet(2), Packet(3)};
+    EXPECT_EQ(poll.enqueue_batch(0, my_std::span<const Packet>(burst)), 2);
+    EXPECT_EQ(poll.ready_mask(), 0b101);
+
+    std::vector<Packet> batch(8);
+    EXPECT_EQ(poll.dequeue_batch(my_std::span<Packet>(batch)), 4);
+    EXPECT_FALSE(poll.any_ready());  // Both drained, both cleared
+    EXPECT_EQ(poll.dequeue_batch(my_std::span<Packet>(batch)), 0);
+
+    // A direct enqueue stays invisible until it is marked
+    ASSERT_TRUE(queues[1]->enqueue(Packet(9)));
+    EXPECT_EQ(poll.dequeue_batch(my_std::span<Packet>(batch)), 0);
+    poll.mark_ready(1);
+    EXPECT_EQ(poll.dequeue_batch(my_std::span<Packet>(batch)), 1);
+    EXPECT_EQ(batch[0].id, 9);
+
+    MPMC_PacketQueue spare(8);
+    QueuePollSet<> full;
+    for (size_t i = 0; i < QueuePollSet<>::MAX_QUEUES; ++i) full.add(spare);
+    EXPECT_THROW(full.add(spare), std::length_error);
+}
+
+TEST(QueuePollSetTest, RoundRobinWithinLevel) {
+    auto queues = make_queues(3);
+    QueuePollSet<> poll(2);
+    for (auto& queue : queues) poll.add(*queue);
+    for (size_t q = 0; q < 3; ++q) {
+        for (size_t i = 0; i < 4; ++i) ASSERT_TRUE(poll.enqueue(q, Packet(q * 100 + i)));
+    }
+
+    // Two per queue per pass, resuming after the last queue served
+    std::vector<Packet> batch(4);
+    std::vector<size_t> ids;
+    while (size_t n = poll.dequeue_batch(my_std::span<Packet>(batch))) {
+        for (size_t i = 0; i < n; ++i) ids.push_back(batch[i].id);
+    }
+    EXPECT_EQ(ids, (std::vector<size_t>{0, 1, 100, 101, 200, 201, 2, 3, 102, 103, 202, 203}));
+}
+
+TEST(QueuePollSetTest, HigherPriorityMembersFirst) {
+    auto queues = make_queues(3);
+    QueuePollSet<> poll;
+    poll.add(*queues[0], PacketPriority::Low);
+    poll.add(*queues[1], PacketPriority::Control);
+    poll.add(*queues[2], PacketPriority::High);
+    for (size_t q = 0; q < 3; ++q) {
+        for (size_t i = 0; i < 3; ++i) ASSERT_TRUE(poll.enqueue(q, Packet(q * 100 + i)));
+    }
+
+    std::vector<Packet> batch(5);
+    EXPECT_EQ(poll.dequeue_batch(my_std::span<Packet>(batch)), 5);
+    EXPECT_EQ(batch[0].id, 100);
+    EXPECT_EQ(batch[2].id, 102);
+    EXPECT_EQ(batch[3].id, 200);
+    EXPECT_EQ(batch[4].id, 201);
+    EXPECT_EQ(poll.ready_mask(), 0b101);
+}
+
+TEST(QueuePollSetTest, OneWaitCoversEveryMember) {
+    auto queues = make_queues(8);
+    QueuePollSet<> poll;
+    for (auto& queue : queues) poll.add(*queue);
+
+    std::vector<Packet> batch(8);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(poll.dequeue_batch_wait(my_std::span<Packet>(batch), std::chrono::milliseconds(20)), 0);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(20));
+
+    for (size_t target : {5, 0, 7}) {
+        std::atomic<size_t> got{0};
+        std::thread consumer([&]() {
+            std::vector<Packet> out(8);
+            got = poll.dequeue_batch_wait(my_std::span<Packet>(out), std::chrono::seconds(10));
+            if (got != 0) {
+                EXPECT_EQ(out[0].id, target);
+            }
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        ASSERT_TRUE(poll.enqueue(target, Packet(target)));
+        consumer.join();
+        EXPECT_EQ(got.load(), 1);
+    }
+}
+
+TEST(QueuePollSetTest, ConcurrentProducersAndWaitingConsumers) {
+    constexpr size_t PRODUCERS = 6;
+    constexpr size_t PER_PRODUCER = 20000;
+
+    auto queues = make_queues(PRODUCERS, 128);
+    QueuePollSet<> poll(8);
+    for (size_t p = 0; p < PRODUCERS; ++p) {
+        poll.add(*queues[p], p % 2 ? PacketPriority::High : PacketPriority::Low);
+    }
+
+    std::atomic<size_t> received{0};
+    std::atomic<uint64_t> sum{0};
+    std::vector<std::thread> threads;
+    for (int c = 0; c < 2; ++c) {
+        threads.emplace_back([&]() {
+            std::vector<Packet> batch(16);
+            while (received.load() < PRODUCERS * PER_PRODUCER) {
+                size_t n = poll.dequeue_batch_wait(my_std::span<Packet>(batch), std::chrono::milliseconds(50));
+                for (size_t i = 0; i < n; ++i) sum.fetch_add(batch[i].id);
+                received.fetch_add(n);
+            }
+        });
+    }
+    for (size_t p = 0; p < PRODUCERS; ++p) {
+        threads.emplace_back([&, p]() {
+            for (size_t i = 0; i < PER_PRODUCER; ++i) {
+                while (!poll.enqueue(p, Packet(p * PER_PRODUCER + i))) std::this_thread::yield();
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    const uint64_t total = PRODUCERS * PER_PRODUCER;
+    EXPECT_EQ(received.load(), total);
+    EXPECT_EQ(sum.load(), total * (total - 1) / 2);
+    std::vector<Packet> batch(16);
+    EXPECT_EQ(poll.dequeue_batch(my_std::span<Packet>(batch)), 0);
+    EXPECT_FALSE(poll.any_ready());
+}
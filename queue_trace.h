@@ -0,0 +1,338 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <new>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "thread_index.h"
+#include "wait_strategy.h"
+
+// Hot-path tracing for BasicMPMCQueue.
+//
+// Select an instrumentation type with the instrumentation member of a queue
+// policy. The default, NoInstrumentation, has enabled == false: the queue
+// guards every hook with if constexpr, so hooks and their counters are not
+// compiled in. TraceInstrumentation records events into TraceLog, a set of
+// per-thread flight-recorder rings that can be exported as a Chrome trace
+// (chrome://tracing, Perfetto).
+//
+// A custom instrumentation type (for example one that fires LTTng or USDT
+// tracepoints) needs enabled and the four static hooks below.
+
+// The queue operation an event belongs to
+enum class TraceOp : uint8_t {
+    Enqueue,
+    Dequeue,
+    EnqueueBatch,
+    DequeueBatch
+};
+
+enum class TraceEventType : uint8_t {
+    CasFailure,  // Lost an index CAS to another thread
+    Backoff,     // value = wait strategy calls, detail = WaitStage reached
+    Batch,       // value = elements moved, detail = elements requested
+    SlotWait     // value = waits for a reserved slot's owner, batch paths only
+};
+
+struct TraceEvent {
+    uint64_t timestamp_ns = 0;  // steady_clock
+    const void* queue = nullptr;
+    uint32_t value = 0;
+    uint32_t detail = 0;
+    TraceEventType type = TraceEventType::CasFailure;
+    TraceOp op = TraceOp::Enqueue;
+    uint16_t thread = 0;        // ThreadIndex of the recording thread
+};
+
+// Fixed-size per-thread event ring holding the newest CAPACITY - 1 events.
+// Only the owning thread writes; once the ring is full, new events overwrite
+// the oldest (the spare slot is the one being overwritten). Events are stored as
+// relaxed atomic words so readers can copy them while the owner writes, and
+// drop any that were overwritten during the copy.
+class TraceRing {
+public:
+    static constexpr size_t CAPACITY = 4096;
+
+private:
+    static constexpr size_t WORDS = 4;
+    static_assert(sizeof(TraceEvent) <= WORDS * sizeof(uint64_t), "TraceEvent too large");
+    static_assert((CAPACITY & (CAPACITY - 1)) == 0, "CAPACITY must be a power of two");
+
+    alignas(64) std::atomic<uint64_t> head_{0};
+    std::atomic<uint64_t> floor_{0};  // Events below this index were cleared
+    std::array<std::array<std::atomic<uint64_t>, WORDS>, CAPACITY> events_{};
+
+public:
+    void record(const TraceEvent& event) noexcept {
+        uint64_t words[WORDS] = {};
+        std::memcpy(words, &event, sizeof(event));
+
+        uint64_t index = head_.load(std::memory_order_relaxed);
+        auto& slot = events_[index & (CAPACITY - 1)];
+        for (size_t w = 0; w < WORDS; ++w) {
+            slot[w].store(words[w], std::memory_order_relaxed);
+        }
+        head_.store(index + 1, std::memory_order_release);
+    }
+
+    // Append the surviving events to out, oldest first
+    void collect(std::vector<TraceEvent>& out) const {
+        uint64_t head = head_.load(std::memory_order_acquire);
+        uint64_t first = std::max(floor_.load(std::memory_order_relaxed),
+                                  head >= CAPACITY ? head - CAPACITY + 1 : 0);
+        size_t start = out.size();
+        for (uint64_t i = first; i < head; ++i) {
+            uint64_t words[WORDS];
+            const auto& slot = events_[i & (CAPACITY - 1)];
+            for (size_t w = 0; w < WORDS; ++w) {
+                words[w] = slot[w].load(std::memory_order_relaxed);
+            }
+            TraceEvent event;
+            std::memcpy(&event, words, sizeof(event));
+            out.push_back(event);
+        }
+
+        // The owner may have lapped us; drop events it could have rewritten
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint64_t now = head_.load(std::memory_order_relaxed);
+        if (now >= first + CAPACITY) {
+            size_t lost = static_cast<size_t>(std::min(now - CAPACITY + 1 - first, head - first));
+            out.erase(out.begin() + static_cast<std::ptrdiff_t>(start),
+                      out.begin() + static_cast<std::ptrdiff_t>(start + lost));
+        }
+    }
+
+    void clear() noexcept {
+        floor_.store(head_.load(std::memory_order_acquire), std::memory_order_relaxed);
+    }
+
+    uint64_t recorded() const noexcept {
+        return head_.load(std::memory_order_relaxed);
+    }
+};
+
+// Process-wide home of the trace rings, one per ThreadIndex, allocated on a
+// thread's first event. Threads beyond ThreadIndex::MAX_THREADS, or whose
+// ring cannot be allocated, are counted in dropped() instead.
+class TraceLog {
+private:
+    std::array<std::atomic<TraceRing*>, ThreadIndex::MAX_THREADS> rings_{};
+    std::atomic<uint64_t> dropped_{0};
+
+    TraceLog() = default;
+
+    TraceRing* local_ring() noexcept {
+        size_t index = ThreadIndex::get();
+        if (index >= ThreadIndex::MAX_THREADS) return nullptr;
+
+        // Only this thread installs its index's ring
+        TraceRing* ring = rings_[index].load(std::memory_order_acquire);
+        if (ring == nullptr) {
+            ring = new (std::nothrow) TraceRing();
+            rings_[index].store(ring, std::memory_order_release);
+        }
+        return ring;
+    }
+
+    static const char* op_name(TraceOp op) noexcept {
+        switch (op) {
+        case TraceOp::Enqueue: return "enqueue";
+        case TraceOp::Dequeue: return "dequeue";
+        case TraceOp::EnqueueBatch: return "enqueue_batch";
+        default: return "dequeue_batch";
+        }
+    }
+
+    static const char* type_name(TraceEventType type) noexcept {
+        switch (type) {
+        case TraceEventType::CasFailure: return "cas_failure";
+        case TraceEventType::Backoff: return "backoff";
+        case TraceEventType::Batch: return "batch";
+        default: return "slot_wait";
+        }
+    }
+
+public:
+    static TraceLog& instance() noexcept {
+        static TraceLog log;
+        return log;
+    }
+
+    TraceLog(const TraceLog&) = delete;
+    TraceLog& operator=(const TraceLog&) = delete;
+
+    ~TraceLog() {
+        for (auto& ring : rings_) delete ring.load(std::memory_order_relaxed);
+    }
+
+    void record(TraceEventType type, TraceOp op, const void* queue,
+                uint32_t value, uint32_t detail = 0) noexcept {
+        TraceRing* ring = local_ring();
+        if (ring == nullptr) {
+            dropped_.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        TraceEvent event;
+        event.timestamp_ns = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        event.queue = queue;
+        event.value = value;
+        event.detail = detail;
+        event.type = type;
+        event.op = op;
+        event.thread = static_cast<uint16_t>(ThreadIndex::get());
+        ring->record(event);
+    }
+
+    // Events still held by every ring, ordered by timestamp
+    std::vector<TraceEvent> collect() const {
+        std::vector<TraceEvent> events;
+        for (const auto& ring : rings_) {
+            if (const TraceRing* r = ring.load(std::memory_order_acquire)) r->collect(events);
+        }
+        std::stable_sort(events.begin(), events.end(), [](const TraceEvent& a, const TraceEvent& b) {
+            return a.timestamp_ns < b.timestamp_ns;
+        });
+        return events;
+    }
+
+    // Forget every event recorded so far
+    void clear() noexcept {
+        for (auto& ring : rings_) {
+            if (TraceRing* r = ring.load(std::memory_order_acquire)) r->clear();
+        }
+        dropped_.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t dropped() const noexcept {
+        return dropped_.load(std::memory_order_relaxed);
+    }
+
+    // Chrome trace event format: one instant event per trace event, with
+    // the thread index as tid and the queue address in args
+    void write_chrome_trace(std::ostream& out) const {
+        std::vector<TraceEvent> events = collect();
+        out << "{\"traceEvents\":[";
+        for (size_t i = 0; i < events.size(); ++i) {
+            const TraceEvent& e = events[i];
+            char ts[32];
+            std::snprintf(ts, sizeof(ts), "%llu.%03llu",
+                          static_cast<unsigned long long>(e.timestamp_ns / 1000),
+                          static_cast<unsigned long long>(e.timestamp_ns % 1000));
+            out << (i == 0 ? "" : ",") << "\n{\"name\":\"" << type_name(e.type)
+                << "\",\"cat\":\"" << op_name(e.op) << "\",\"ph\":\"i\",\"s\":\"t\""
+                << ",\"ts\":" << ts << ",\"pid\":1,\"tid\":" << e.thread
+                << ",\"args\":{\"queue\":\"" << e.queue << "\",\"value\":" << e.value
+                << ",\"detail\":" << e.detail << "}}";
+        }
+        out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+    }
+};
+
+// Default: no hooks are compiled in
+struct NoInstrumentation {
+    static constexpr bool enabled = false;
+
+    static void cas_failure(const void*, TraceOp) noexcept {}
+    static void backoff(const void*, TraceOp, unsigned, uint32_t) noexcept {}
+    static void batch(const void*, TraceOp, size_t, size_t) noexcept {}
+    static void slot_wait(const void*, TraceOp, uint32_t) noexcept {}
+};
+
+// Records every hook into TraceLog::instance()
+struct TraceInstrumentation {
+    static constexpr bool enabled = true;
+
+    static void cas_failure(const void* queue, TraceOp op) noexcept {
+        TraceLog::instance().record(TraceEventType::CasFailure, op, queue, 1);
+    }
+
+    static void backoff(const void* queue, TraceOp op, unsigned stage, uint32_t rounds) noexcept {
+        TraceLog::instance().record(TraceEventType::Backoff, op, queue, rounds, stage);
+    }
+
+    static void batch(const void* queue, TraceOp op, size_t requested, size_t achieved) noexcept {
+        TraceLog::instance().record(TraceEventType::Batch, op, queue,
+                                    static_cast<uint32_t>(achieved),
+                                    static_cast<uint32_t>(requested));
+    }
+
+    static void slot_wait(const void* queue, TraceOp op, uint32_t spins) noexcept {
+        TraceLog::instance().record(TraceEventType::SlotWait, op, queue, spins);
+    }
+};
+
+namespace detail {
+
+template <typename Wait, typename = void>
+struct has_wait_stage : std::false_type {};
+
+template <typename Wait>
+struct has_wait_stage<Wait, std::void_t<decltype(std::declval<const Wait&>().stage())>>
+    : std::true_type {};
+
+// Wait strategy wrapper used by instrumented queues. Counts retries and slot
+// waits for one operation and reports them, with the deepest WaitStage the
+// retries reached, when progress is made or the operation ends.
+template <typename Wait, typename Instrument>
+class TracedWait {
+    Wait wait_;
+    const void* queue_;
+    TraceOp op_;
+    uint32_t rounds_ = 0;
+    uint32_t slot_waits_ = 0;
+    WaitStage stage_ = WaitStage::Spin;
+
+    void flush() noexcept {
+        if (rounds_ != 0) {
+            Instrument::backoff(queue_, op_, static_cast<unsigned>(stage_), rounds_);
+        }
+        if (slot_waits_ != 0) {
+            Instrument::slot_wait(queue_, op_, slot_waits_);
+        }
+        rounds_ = 0;
+        slot_waits_ = 0;
+        stage_ = WaitStage::Spin;
+    }
+
+public:
+    TracedWait(const void* queue, TraceOp op) noexcept : queue_(queue), op_(op) {}
+
+    TracedWait(const TracedWait&) = delete;
+    TracedWait& operator=(const TracedWait&) = delete;
+
+    ~TracedWait() { flush(); }
+
+    void operator()() noexcept {
+        if constexpr (has_wait_stage<Wait>::value) {
+            stage_ = std::max(stage_, wait_.stage());
+        }
+        ++rounds_;
+        wait_();
+    }
+
+    template <typename Word>
+    void wait(const std::atomic<Word>& word, Word seen, WaitEvent& event) noexcept {
+        ++slot_waits_;
+        wait_.wait(word, seen, event);
+    }
+
+    void reset() noexcept {
+        flush();
+        wait_.reset();
+    }
+};
+
+} // namespace detail
@@ -0,0 +1,377 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "mpmc_packet_queue.h"
+#include "thread_index.h"
+
+// Bounded queue whose ring can be replaced while traffic flows, e.g. to
+// start small and grow a queue that turns out to be hot.
+//
+// The queue is a chain of generations, each one BasicMPMCQueue ring.
+// Producers enqueue into the generation named by the current pointer and
+// consumers dequeue from the oldest one still holding elements. resize()
+// and migrate_to() link a new ring behind the current one and swing the
+// pointer to it; producers pick the new ring up on their next operation,
+// or straight away if the old one was full. Consumers drain the old ring
+// to completion before moving on, so no element is lost and FIFO order
+// holds per producer, as with BasicMPMCQueue.
+//
+// Producers and consumers stay lock-free. They reach generations through
+// hazard pointers, one block per ThreadIndex as in BasicSegmentedQueue,
+// which costs one full fence per operation, or per batch. A resize waits,
+// without a lock on the hot path, for producers still inside the old ring
+// to leave it and then seals it, so an empty sealed ring is final. Drained
+// rings are freed once no thread can still be inside them.
+//
+// Threads beyond ThreadIndex::MAX_THREADS are counted instead; while such a
+// producer runs a resize waits, and while any of them runs drained rings
+// are kept.
+template <typename Queue = MPMC_PacketQueue>
+class BasicResizableQueue {
+public:
+    using value_type = typename Queue::value_type;
+
+private:
+    using T = value_type;
+
+    struct Generation {
+        std::unique_ptr<Queue> ring;
+        alignas(CACHE_LINE_SIZE) std::atomic<Generation*> next{nullptr};
+        // Set once no producer can enqueue into ring any more
+        std::atomic<bool> sealed{false};
+
+        explicit Generation(std::unique_ptr<Queue> r) noexcept : ring(std::move(r)) {}
+    };
+
+    // [0] the generation a thread enqueues into, [1] the one it dequeues from
+    struct alignas(CACHE_LINE_SIZE) Hazard {
+        std::array<std::atomic<Generation*>, 2> generations{};
+    };
+
+    static constexpr size_t PRODUCER = 0;
+    static constexpr size_t CONSUMER = 1;
+
+    // Publishes the calling thread's hazards for one operation and clears
+    // them when it ends
+    class Guard {
+    private:
+        std::atomic<size_t>& unregistered_;
+        Hazard* hazard_;
+
+    public:
+        Guard(const BasicResizableQueue& queue, size_t role) noexcept
+            : unregistered_(queue.unregistered_[role]), hazard_(queue.local_hazard()) {
+            if (hazard_ == nullptr) unregistered_.fetch_add(1, std::memory_order_seq_cst);
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+            if (hazard_ == nullptr) {
+                unregistered_.fetch_sub(1, std::memory_order_release);
+                return;
+            }
+            for (auto& generation : hazard_->generations) {
+                generation.store(nullptr, std::memory_order_release);
+            }
+        }
+
+        // Load source and keep the generation it names from being freed,
+        // or, for a producer, from being sealed
+        Generation* protect(size_t i, const std::atomic<Generation*>& source) noexcept {
+            Generation* generation = source.load(std::memory_order_acquire);
+            if (hazard_ == nullptr) return generation;
+            while (true) {
+                hazard_->generations[i].store(generation, std::memory_order_seq_cst);
+                Generation* current = source.load(std::memory_order_seq_cst);
+                if (current == generation) return generation;
+                generation = current;
+            }
+        }
+    };
+
+    const StatsMode stats_mode_;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<Generation*> current_;  // Producers
+    alignas(CACHE_LINE_SIZE) std::atomic<Generation*> draining_;  // Consumers
+    // Threads beyond MAX_THREADS inside an operation, per role. Kept apart
+    // so that a resize, which waits for producers, never waits for a
+    // consumer that is itself waiting for the resize lock.
+    alignas(CACHE_LINE_SIZE) mutable std::array<std::atomic<size_t>, 2> unregistered_{};
+    mutable std::array<std::atomic<Hazard*>, ThreadIndex::MAX_THREADS> hazards_{};
+
+    // Slow path: resizing and freeing generations
+    mutable std::mutex generations_mutex_;
+    std::vector<Generation*> retired_;  // Drained, possibly still in use
+    size_t live_generations_ = 1;       // Linked or retired
+
+    Hazard* local_hazard() const noexcept {
+        size_t index = ThreadIndex::get();
+        if (index >= ThreadIndex::MAX_THREADS) return nullptr;
+
+        // Only this thread installs its index's block
+        Hazard* hazard = hazards_[index].load(std::memory_order_acquire);
+        if (hazard == nullptr) {
+            hazard = new (std::nothrow) Hazard();
+            // Ordered before this thread's first hazard, as the scans expect
+            hazards_[index].store(hazard, std::memory_order_seq_cst);
+        }
+        return hazard;
+    }
+
+    bool is_protected(const Generation* generation, size_t first, size_t last) const noexcept {
+        for (const auto& slot : hazards_) {
+            const Hazard* hazard = slot.load(std::memory_order_seq_cst);
+            if (hazard == nullptr) continue;
+            for (size_t i = first; i <= last; ++i) {
+                if (hazard->generations[i].load(std::memory_order_seq_cst) == generation) return true;
+            }
+        }
+        return false;
+    }
+
+    // Free every retired generation that no thread is inside any more
+    void reclaim_locked() noexcept {
+        if (retired_.empty()) return;
+        for (const auto& count : unregistered_) {
+            if (count.load(std::memory_order_seq_cst) != 0) return;
+        }
+
+        size_t kept = 0;
+        for (Generation* generation : retired_) {
+            if (is_protected(generation, PRODUCER, CONSUMER)) {
+                retired_[kept++] = generation;
+            } else {
+                delete generation;
+                --live_generations_;
+            }
+        }
+        retired_.resize(kept);
+    }
+
+    // The consumer found generation empty. If it is sealed and still empty,
+    // move draining_ past it. Returns the generation to dequeue from next,
+    // or nullptr if generation is the one producers are using.
+    Generation* after_empty(Guard& guard, Generation* generation) noexcept {
+        if (!generation->sealed.load(std::memory_order_acquire)) return nullptr;
+        // Sealed: every enqueue into it has completed, so empty is final
+        if (!generation->ring->empty()) return generation;
+
+        Generation* next = generation->next.load(std::memory_order_acquire);
+        Generation* expected = generation;
+        bool advanced = draining_.compare_exchange_strong(expected, next,
+                                                          std::memory_order_acq_rel,
+                                                          std::memory_order_acquire);
+        Generation* successor = guard.protect(CONSUMER, draining_);
+        if (advanced) {
+            std::lock_guard<std::mutex> lock(generations_mutex_);
+            retired_.push_back(generation);
+            reclaim_locked();
+        }
+        return successor;
+    }
+
+    // Retry op(ring) on the current generation while a resize swaps it
+    // under the producer. op returns how much it did; 0 means nothing.
+    template <typename Op>
+    size_t produce(Op&& op) noexcept {
+        Guard guard(*this, PRODUCER);
+        Generation* generation = guard.protect(PRODUCER, current_);
+        while (true) {
+            size_t done = op(*generation->ring);
+            if (done != 0) return done;
+            Generation* current = guard.protect(PRODUCER, current_);
+            if (current == generation) return 0; // Full, with no newer ring
+            generation = current;
+        }
+    }
+
+public:
+    explicit BasicResizableQueue(size_t capacity, StatsMode stats_mode = StatsMode::Disabled)
+        : BasicResizableQueue(std::make_unique<Queue>(capacity, stats_mode), stats_mode) {}
+
+    // Start from a caller-built ring, e.g. one placed on a NUMA node
+    explicit BasicResizableQueue(std::unique_ptr<Queue> ring,
+                                 StatsMode stats_mode = StatsMode::Disabled)
+        : stats_mode_(stats_mode) {
+        if (ring == nullptr) {
+            throw std::invalid_argument("Ring must not be null");
+        }
+        Generation* generation = new Generation(std::move(ring));
+        current_.store(generation, std::memory_order_relaxed);
+        draining_.store(generation, std::memory_order_relaxed);
+    }
+
+    BasicResizableQueue(const BasicResizableQueue&) = delete;
+    BasicResizableQueue& operator=(const BasicResizableQueue&) = delete;
+    BasicResizableQueue(BasicResizableQueue&&) = delete;
+    BasicResizableQueue& operator=(BasicResizableQueue&&) = delete;
+
+    // Requires quiescence: no thread may be using the queue
+    ~BasicResizableQueue() {
+        for (Generation* generation : retired_) delete generation;
+        Generation* generation = draining_.load(std::memory_order_relaxed);
+        while (generation != nullptr) {
+            Generation* next = generation->next.load(std::memory_order_relaxed);
+            delete generation;
+            generation = next;
+        }
+        for (auto& hazard : hazards_) delete hazard.load(std::memory_order_relaxed);
+    }
+
+    // Switch producers to a new ring of the given capacity with the
+    // queue's stats mode. Elements already queued stay where they are and
+    // are dequeued first. Throws std::invalid_argument for a capacity the
+    // ring type rejects; may be called from any thread, concurrently with
+    // producers and consumers.
+    void resize(size_t capacity) {
+        migrate_to(std::make_unique<Queue>(capacity, stats_mode_));
+    }
+
+    // As resize(), with a caller-built ring that no other thread uses.
+    // Returns once the old ring is sealed: producers that were inside it
+    // have left, and consumers will move on once it is empty.
+    void migrate_to(std::unique_ptr<Queue> ring) {
+        if (ring == nullptr) {
+            throw std::invalid_argument("Ring must not be null");
+        }
+
+        std::lock_guard<std::mutex> lock(generations_mutex_);
+        Generation* fresh = new Generation(std::move(ring));
+        Generation* old = current_.load(std::memory_order_relaxed);
+        old->next.store(fresh, std::memory_order_release);
+        current_.store(fresh, std::memory_order_seq_cst);
+        ++live_generations_;
+
+        // A producer that protects old from now on sees fresh when it
+        // re-checks current_, so only those already inside need to finish
+        while (is_protected(old, PRODUCER, PRODUCER) ||
+               unregistered_[PRODUCER].load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+        old->sealed.store(true, std::memory_order_release);
+        reclaim_locked();
+    }
+
+    bool enqueue(const T& value) noexcept {
+        return produce([&](Queue& ring) -> size_t { return ring.enqueue(value) ? 1 : 0; }) != 0;
+    }
+
+    // Only moves from value on success
+    bool enqueue(T&& value) noexcept {
+        return produce([&](Queue& ring) -> size_t {
+            return ring.enqueue(std::move(value)) ? 1 : 0;
+        }) != 0;
+    }
+
+    // Enqueue the leading elements of values that fit; returns how many.
+    // A burst that fills the old ring mid-resize continues in the new one.
+    size_t enqueue_batch(my_std::span<const T> values) noexcept {
+        if (values.empty()) return 0;
+        size_t count = 0;
+        while (count < values.size()) {
+            size_t pushed = produce([&](Queue& ring) {
+                return ring.enqueue_batch(values.subspan(count));
+            });
+            if (pushed == 0) break;
+            count += pushed;
+        }
+        return count;
+    }
+
+    std::optional<T> dequeue() noexcept {
+        Guard guard(*this, CONSUMER);
+        Generation* generation = guard.protect(CONSUMER, draining_);
+        while (generation != nullptr) {
+            if (auto value = generation->ring->dequeue()) return value;
+            generation = after_empty(guard, generation);
+        }
+        return std::nullopt;
+    }
+
+    // Dequeue up to values.size() elements, moving on to newer rings as
+    // the older ones run dry
+    size_t dequeue_batch(my_std::span<T> values) noexcept {
+        if (values.empty()) return 0;
+        Guard guard(*this, CONSUMER);
+        size_t count = 0;
+        Generation* generation = guard.protect(CONSUMER, draining_);
+        while (count < values.size() && generation != nullptr) {
+            size_t popped = generation->ring->dequeue_batch(values.subspan(count));
+            count += popped;
+            if (popped == 0) generation = after_empty(guard, generation);
+        }
+        return count;
+    }
+
+    // Elements in every generation; exact when quiescent. Takes the resize
+    // lock, which keeps the generations it walks from being freed.
+    size_t size() const noexcept {
+        std::lock_guard<std::mutex> lock(generations_mutex_);
+        size_t total = 0;
+        for (Generation* generation = draining_.load(std::memory_order_acquire);
+             generation != nullptr;
+             generation = generation->next.load(std::memory_order_acquire)) {
+            total += generation->ring->size();
+        }
+        return total;
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    // Capacity of the ring producers are filling
+    size_t capacity() const noexcept {
+        std::lock_guard<std::mutex> lock(generations_mutex_);
+        return current_.load(std::memory_order_acquire)->ring->capacity();
+    }
+
+    // Rings still allocated: the current one, older ones being drained and
+    // drained ones a thread may still be inside
+    size_t generation_count() const noexcept {
+        std::lock_guard<std::mutex> lock(generations_mutex_);
+        return live_generations_;
+    }
+
+    // Free drained rings that were kept because a thread was still inside
+    void shrink() noexcept {
+        std::lock_guard<std::mutex> lock(generations_mutex_);
+        reclaim_locked();
+    }
+
+    // Memory usage estimation; follows the rings still allocated
+    size_t memory_usage() const noexcept {
+        size_t rings = 0;
+        {
+            std::lock_guard<std::mutex> lock(generations_mutex_);
+            for (Generation* generation : retired_) rings += generation->ring->memory_usage();
+            for (Generation* generation = draining_.load(std::memory_order_acquire);
+                 generation != nullptr;
+                 generation = generation->next.load(std::memory_order_acquire)) {
+                rings += generation->ring->memory_usage();
+            }
+        }
+        size_t hazards = 0;
+        for (const auto& hazard : hazards_) {
+            if (hazard.load(std::memory_order_relaxed) != nullptr) hazards += sizeof(Hazard);
+        }
+        return sizeof(*this) + rings + hazards;
+    }
+};
+
+using ResizablePacketQueue = BasicResizableQueue<MPMC_PacketQueue>;
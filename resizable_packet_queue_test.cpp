@@ -0,0 +1,144 @@
+#include <gtest/gtest.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "resizable_packet_queue.h"
+
+TEST(ResizablePacketQueueTest, ConstructorValidation) {
+    EXPECT_THROW(ResizablePacketQueue(0), std::invalid_argument);
+    EXPECT_THROW(ResizablePacketQueue(std::unique_ptr<MPMC_PacketQueue>()), std::invalid_argument);
+
+    ResizablePacketQueue queue(5);
+    EXPECT_EQ(queue.capacity(), 8);
+    EXPECT_EQ(queue.generation_count(), 1);
+    EXPECT_THROW(queue.migrate_to(nullptr), std::invalid_argument);
+    EXPECT_THROW(queue.resize(0), std::invalid_argument);
+    EXPECT_EQ(queue.generation_count(), 1);
+}
+
+TEST(ResizablePacketQueueTest, GrowKeepsOrderAndFreesOldRing) {
+    ResizablePacketQueue queue(4);
+    for (size_t i = 0; i < 4; ++i) ASSERT_TRUE(queue.enqueue(Packet(i)));
+    EXPECT_FALSE(queue.enqueue(Packet(99)));
+
+    queue.resize(16);
+    EXPECT_EQ(queue.capacity(), 16);
+    EXPECT_EQ(queue.generation_count(), 2);
+    for (size_t i = 4; i < 10; ++i) ASSERT_TRUE(queue.enqueue(Packet(i)));
+    EXPECT_EQ(queue.size(), 10);
+
+    // The old ring drains first, then is freed once consumers leave it
+    for (size_t i = 0; i < 10; ++i) {
+        auto packet = queue.dequeue();
+        ASSERT_TRUE(packet.has_value());
+        EXPECT_EQ(packet->id, i);
+    }
+    EXPECT_FALSE(queue.dequeue().has_value());
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.generation_count(), 1);
+}
+
+TEST(ResizablePacketQueueTest, BatchesSpanGenerations) {
+    ResizablePacketQueue queue(4);
+    std::vector<Packet> burst;
+    for (size_t i = 0; i < 12; ++i) burst.emplace_back(i);
+
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst)), 4);
+    queue.resize(8);
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(burst).subspan(4)), 8);
+
+    std::vector<Packet> out(16);
+    ASSERT_EQ(queue.dequeue_batch(my_std::span<Packet>(out)), 12);
+    for (size_t i = 0; i < 12; ++i) EXPECT_EQ(out[i].id, i);
+    EXPECT_EQ(queue.generation_count(), 1);
+}
+
+TEST(ResizablePacketQueueTest, SeveralPendingMigrations) {
+    ResizablePacketQueue queue(2);
+    size_t next = 0;
+    for (size_t capacity : {4, 2, 8}) {
+        while (queue.enqueue(Packet(next))) ++next;
+        queue.migrate_to(std::make_unique<MPMC_PacketQueue>(capacity));
+    }
+    EXPECT_EQ(next, 2 + 4 + 2);
+    EXPECT_EQ(queue.generation_count(), 4);
+    EXPECT_EQ(queue.capacity(), 8);
+    EXPECT_GT(queue.memory_usage(), 4 * sizeof(MPMC_PacketQueue));
+
+    // Producers are on the newest ring while consumers are still on the first
+    ASSERT_TRUE(queue.enqueue(Packet(next++)));
+    for (size_t i = 0; i < next; ++i) {
+        auto packet = queue.dequeue();
+        ASSERT_TRUE(packet.has_value());
+        EXPECT_EQ(packet->id, i);
+    }
+    EXPECT_EQ(queue.generation_count(), 1);
+}
+
+TEST(ResizablePacketQueueTest, ResizeUnderTraffic) {
+    constexpr size_t PRODUCERS = 4;
+    constexpr size_t CONSUMERS = 2;
+    constexpr size_t PER_PRODUCER = 50000;
+
+    ResizablePacketQueue queue(8);
+    std::atomic<size_t> received{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<bool> ordered{true};
+
+    std::vector<std::thread> threads;
+    for (size_t c = 0; c < CONSUMERS; ++c) {
+        threads.emplace_back([&, c]() {
+            std::vector<int64_t> last(PRODUCERS, -1);
+            std::vector<Packet> batch(16);
+            auto take = [&](const Packet& packet) {
+                size_t producer = packet.id / PER_PRODUCER;
+                int64_t seq = static_cast<int64_t>(packet.id % PER_PRODUCER);
+                if (seq <= last[producer]) ordered = false;
+                last[producer] = seq;
+                sum.fetch_add(packet.id);
+            };
+            while (received.load() < PRODUCERS * PER_PRODUCER) {
+                size_t n = 0;
+                if (c % 2 != 0) {
+                    n = queue.dequeue_batch(my_std::span<Packet>(batch));
+                    for (size_t i = 0; i < n; ++i) take(batch[i]);
+                } else if (auto packet = queue.dequeue()) {
+                    take(*packet);
+                    n = 1;
+                }
+                if (n == 0) std::this_thread::yield();
+                received.fetch_add(n);
+            }
+        });
+    }
+    for (size_t p = 0; p < PRODUCERS; ++p) {
+        threads.emplace_back([&, p]() {
+            for (size_t i = 0; i < PER_PRODUCER; ++i) {
+                while (!queue.enqueue(Packet(p * PER_PRODUCER + i))) std::this_thread::yield();
+            }
+        });
+    }
+    // Grow at fixed points of the transfer, while both sides are busy
+    std::thread resizer([&]() {
+        size_t step = 1;
+        for (size_t capacity = 16; capacity <= 1024; capacity *= 2, ++step) {
+            while (received.load() < step * PRODUCERS * PER_PRODUCER / 8) std::this_thread::yield();
+            queue.resize(capacity);
+        }
+    });
+
+    resizer.join();
+    for (auto& t : threads) t.join();
+
+    const uint64_t total = PRODUCERS * PER_PRODUCER;
+    EXPECT_EQ(received.load(), total);
+    EXPECT_EQ(sum.load(), total * (total - 1) / 2);
+    EXPECT_TRUE(ordered.load());
+    EXPECT_TRUE(queue.empty());
+    EXPECT_EQ(queue.capacity(), 1024);
+
+    // A drained ring another consumer was still inside is freed later
+    queue.shrink();
+    EXPECT_EQ(queue.generation_count(), 1);
+}
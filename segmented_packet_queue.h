@@ -0,0 +1,645 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "mpmc_packet_queue.h"
+#include "thread_index.h"
+
+// Sizing for BasicSegmentedQueue
+struct SegmentedQueueConfig {
+    size_t segment_capacity = 1024;  // Elements per segment, rounded up to a power of two
+    size_t max_segments = 0;         // Live segments allowed; 0 = unbounded, otherwise at least 2
+    size_t cached_segments = 2;      // Drained segments kept for reuse; the rest are freed
+    StatsMode stats_mode = StatsMode::Disabled;
+};
+
+// Unbounded MPMC queue built from a linked list of fixed-size rings, in the
+// style of LCRQ. Producers push into the tail segment and consumers pop from
+// the head segment with the same per-slot sequence protocol as
+// BasicMPMCQueue, so an operation that stays within one segment is a plain
+// ring operation. A full tail segment is closed and a new one linked behind
+// it; a closed segment that consumers have drained is unlinked and recycled
+// through a small cache. Memory therefore follows the backlog instead of the
+// worst-case capacity chosen up front.
+//
+// Threads reach segments through hazard pointers, one block per ThreadIndex
+// (threads beyond ThreadIndex::MAX_THREADS hold off recycling while they
+// run instead), and a drained segment is reused only once no thread can
+// still be inside it. Publishing the hazard costs one full fence per
+// operation, or per batch for the batch operations.
+//
+// FIFO order holds per producer, as with BasicMPMCQueue. Of the queue
+// policy, only slot_layout and wait_strategy apply; slots are kept whole, so
+// SlotLayout::Split is laid out as Packed.
+template <typename T = Packet, typename Policy = DefaultQueuePolicy>
+class BasicSegmentedQueue {
+private:
+    using Slot = detail::QueueSlot<T, Policy::slot_layout == SlotLayout::Split ? SlotLayout::Packed
+                                                                              : Policy::slot_layout>;
+    using Backoff = typename Policy::wait_strategy;
+
+    // Set in a segment's tail once it accepts no more elements
+    static constexpr size_t CLOSED = size_t(1) << (sizeof(size_t) * 8 - 1);
+
+    struct Segment {
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> head{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<size_t> tail{0};
+        alignas(CACHE_LINE_SIZE) std::atomic<Segment*> next{nullptr};
+        size_t base = 0;  // Queue position of the segment's first element
+        std::unique_ptr<Slot[]> slots;
+
+        Segment(size_t capacity, size_t base_position)
+            : slots(std::make_unique<Slot[]>(capacity)) {
+            reset(capacity, base_position);
+        }
+
+        void reset(size_t capacity, size_t base_position) noexcept {
+            head.store(0, std::memory_order_relaxed);
+            tail.store(0, std::memory_order_relaxed);
+            next.store(nullptr, std::memory_order_relaxed);
+            base = base_position;
+            for (size_t i = 0; i < capacity; ++i) {
+                slots[i].seq.store(i, std::memory_order_relaxed);
+            }
+        }
+    };
+
+    // Segments one thread is working in; [0] for the operation's own end
+    // of the list, [1] when it also has to look at the other end
+    struct alignas(CACHE_LINE_SIZE) Hazard {
+        std::array<std::atomic<Segment*>, 2> segments{};
+    };
+
+    // Publishes the calling thread's hazards for one operation and clears
+    // them when it ends
+    class Guard {
+    private:
+        const BasicSegmentedQueue& queue_;
+        Hazard* hazard_;
+
+    public:
+        explicit Guard(const BasicSegmentedQueue& queue) noexcept
+            : queue_(queue), hazard_(queue.local_hazard()) {
+            if (hazard_ == nullptr) {
+                queue_.unregistered_readers_.fetch_add(1, std::memory_order_seq_cst);
+            }
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard() {
+            if (hazard_ == nullptr) {
+                queue_.unregistered_readers_.fetch_sub(1, std::memory_order_release);
+                return;
+            }
+            for (auto& segment : hazard_->segments) {
+                segment.store(nullptr, std::memory_order_release);
+            }
+        }
+
+        // Load source and keep the segment it names from being recycled
+        Segment* protect(size_t i, const std::atomic<Segment*>& source) noexcept {
+            Segment* segment = source.load(std::memory_order_acquire);
+            if (hazard_ == nullptr) return segment;
+            while (true) {
+                hazard_->segments[i].store(segment, std::memory_order_seq_cst);
+                Segment* current = source.load(std::memory_order_seq_cst);
+                if (current == segment) return segment;
+                segment = current;
+            }
+        }
+
+        void clear(size_t i) noexcept {
+            if (hazard_ != nullptr) hazard_->segments[i].store(nullptr, std::memory_order_release);
+        }
+    };
+
+    const size_t segment_capacity_;
+    const size_t mask_;
+    const size_t max_segments_;
+    const size_t cached_segments_;
+
+    alignas(CACHE_LINE_SIZE) std::atomic<Segment*> head_segment_;
+    alignas(CACHE_LINE_SIZE) std::atomic<Segment*> tail_segment_;
+    alignas(CACHE_LINE_SIZE) mutable std::atomic<size_t> unregistered_readers_{0};
+    mutable std::array<std::atomic<Hazard*>, ThreadIndex::MAX_THREADS> hazards_{};
+
+    // Slow path: linking, retiring and recycling segments
+    mutable std::mutex segments_mutex_;
+    std::vector<Segment*> retired_;  // Unlinked, possibly still in use
+    std::vector<Segment*> cached_;   // Free for reuse
+    size_t live_segments_ = 0;       // Linked, retired or being linked
+
+    QueueStatsCollector stats_;
+
+    void record_stat(std::atomic<uint64_t> QueueStats::*counter) noexcept {
+        stats_.record(counter);
+    }
+
+    Hazard* local_hazard() const noexcept {
+        size_t index = ThreadIndex::get();
+        if (index >= ThreadIndex::MAX_THREADS) return nullptr;
+
+        // Only this thread installs its index's block
+        Hazard* hazard = hazards_[index].load(std::memory_order_acquire);
+        if (hazard == nullptr) {
+            hazard = new (std::nothrow) Hazard();
+            // Ordered before this thread's first hazard, as is_protected() expects
+            hazards_[index].store(hazard, std::memory_order_seq_cst);
+        }
+        return hazard;
+    }
+
+    bool is_protected(const Segment* segment) const noexcept {
+        for (const auto& slot : hazards_) {
+            const Hazard* hazard = slot.load(std::memory_order_seq_cst);
+            if (hazard == nullptr) continue;
+            for (const auto& protected_segment : hazard->segments) {
+                if (protected_segment.load(std::memory_order_seq_cst) == segment) return true;
+            }
+        }
+        return false;
+    }
+
+    void recycle_locked(Segment* segment) noexcept {
+        --live_segments_;
+        if (cached_.size() < cached_segments_) {
+            cached_.push_back(segment);
+        } else {
+            delete segment;
+        }
+    }
+
+    // Recycle every retired segment that no thread protects any more
+    void reclaim_locked() noexcept {
+        if (retired_.empty()) return;
+        if (unregistered_readers_.load(std::memory_order_seq_cst) != 0) return;
+
+        size_t kept = 0;
+        for (Segment* segment : retired_) {
+            if (is_protected(segment)) {
+                retired_[kept++] = segment;
+            } else {
+                recycle_locked(segment);
+            }
+        }
+        retired_.resize(kept);
+    }
+
+    // A reset segment starting at queue position base, or nullptr at
+    // max_segments or when out of memory
+    Segment* acquire_segment(size_t base) noexcept {
+        std::lock_guard<std::mutex> lock(segments_mutex_);
+        reclaim_locked();
+        if (max_segments_ != 0 && live_segments_ >= max_segments_) return nullptr;
+
+        Segment* segment = nullptr;
+        if (!cached_.empty()) {
+            segment = cached_.back();
+            cached_.pop_back();
+            segment->reset(segment_capacity_, base);
+        } else {
+            try {
+                segment = new Segment(segment_capacity_, base);
+            } catch (const std::bad_alloc&) {
+                return nullptr;
+            }
+        }
+        ++live_segments_;
+        return segment;
+    }
+
+    void release_segment(Segment* segment) noexcept {
+        std::lock_guard<std::mutex> lock(segments_mutex_);
+        recycle_locked(segment);
+    }
+
+    void retire(Segment* segment) noexcept {
+        std::lock_guard<std::mutex> lock(segments_mutex_);
+        retired_.push_back(segment);
+        reclaim_locked();
+    }
+
+    // Push into one segment. Returns false once the segment is closed,
+    // closing it first if it is full; value is only consumed on success.
+    template <typename U>
+    bool push(Segment& segment, U&& value, Backoff& backoff) noexcept {
+        size_t tail = segment.tail.load(std::memory_order_relaxed);
+        while ((tail & CLOSED) == 0) {
+            Slot& slot = segment.slots[tail & mask_];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(tail);
+
+            if (diff == 0) {
+                if (segment.tail.compare_exchange_weak(tail, tail + 1,
+                                                       std::memory_order_relaxed,
+                                                       std::memory_order_relaxed)) {
+                    slot.value = std::forward<U>(value);
+                    slot.seq.store(tail + 1, std::memory_order_release);
+                    return true;
+                }
+                record_stat(&QueueStats::contention_events);
+            } else if (diff < 0) {
+                // Full: close it so later elements start a new segment
+                if (segment.tail.compare_exchange_weak(tail, tail | CLOSED,
+                                                       std::memory_order_relaxed,
+                                                       std::memory_order_relaxed)) {
+                    return false;
+                }
+            } else {
+                backoff();
+                tail = segment.tail.load(std::memory_order_relaxed);
+            }
+        }
+        return false;
+    }
+
+    // Push up to n elements source(0..n) into one segment with one tail
+    // CAS. Returns 0 only once the segment is closed.
+    template <typename Source>
+    size_t push_batch(Segment& segment, size_t n, Source& source, Backoff& backoff) noexcept {
+        while (true) {
+            // Head first, so tail - head never underflows
+            size_t head = segment.head.load(std::memory_order_acquire);
+            size_t tail = segment.tail.load(std::memory_order_acquire);
+            if ((tail & CLOSED) != 0) return 0;
+
+            size_t used = tail - head;
+            if (used >= segment_capacity_) {
+                // Full, or head was stale; push() closes it only if it is full
+                return push(segment, source(0), backoff) ? 1 : 0;
+            }
+
+            size_t count = std::min(n, segment_capacity_ - used);
+            if (segment.tail.compare_exchange_weak(tail, tail + count,
+                                                   std::memory_order_relaxed,
+                                                   std::memory_order_relaxed)) {
+                for (size_t i = 0; i < count; ++i) {
+                    Slot& slot = segment.slots[(tail + i) & mask_];
+                    // Wait for the consumer that claimed it last lap
+                    while (slot.seq.load(std::memory_order_acquire) != tail + i) {
+                        backoff();
+                    }
+                    slot.value = source(i);
+                    slot.seq.store(tail + i + 1, std::memory_order_release);
+                }
+                return count;
+            }
+            record_stat(&QueueStats::contention_events);
+            backoff();
+        }
+    }
+
+    std::optional<T> pop(Segment& segment, Backoff& backoff) noexcept {
+        size_t head = segment.head.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = segment.slots[head & mask_];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(seq) - static_cast<intptr_t>(head + 1);
+
+            if (diff == 0) {
+                if (segment.head.compare_exchange_weak(head, head + 1,
+                                                       std::memory_order_relaxed,
+                                                       std::memory_order_relaxed)) {
+                    T value = std::move(slot.value);
+                    slot.seq.store(head + segment_capacity_, std::memory_order_release);
+                    return value;
+                }
+                record_stat(&QueueStats::contention_events);
+            } else if (diff < 0) {
+                size_t tail = segment.tail.load(std::memory_order_acquire) & ~CLOSED;
+                if (head >= tail) return std::nullopt;
+                backoff();
+                head = segment.head.load(std::memory_order_relaxed);
+            } else {
+                backoff();
+                head = segment.head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // Pop up to out.size() elements from one segment with one head CAS
+    size_t pop_batch(Segment& segment, my_std::span<T> out, Backoff& backoff) noexcept {
+        while (true) {
+            size_t head = segment.head.load(std::memory_order_acquire);
+            size_t tail = segment.tail.load(std::memory_order_acquire) & ~CLOSED;
+            if (head >= tail) return 0;
+
+            size_t count = std::min(out.size(), tail - head);
+            if (segment.head.compare_exchange_weak(head, head + count,
+                                                   std::memory_order_relaxed,
+                                                   std::memory_order_relaxed)) {
+                for (size_t i = 0; i < count; ++i) {
+                    Slot& slot = segment.slots[(head + i) & mask_];
+                    // Wait for the producer that reserved it to publish
+                    while (slot.seq.load(std::memory_order_acquire) != head + i + 1) {
+                        backoff();
+                    }
+                    out[i] = std::move(slot.value);
+                    slot.seq.store(head + i + segment_capacity_, std::memory_order_release);
+                }
+                return count;
+            }
+            record_stat(&QueueStats::contention_events);
+            backoff();
+        }
+    }
+
+    // The segment after a closed one, linking a new one if nobody has yet.
+    // nullptr if max_segments is reached.
+    Segment* next_segment(Segment* closed) noexcept {
+        Segment* next = closed->next.load(std::memory_order_acquire);
+        if (next != nullptr) return next;
+
+        size_t count = closed->tail.load(std::memory_order_relaxed) & ~CLOSED;
+        Segment* fresh = acquire_segment(closed->base + count);
+        if (fresh == nullptr) return closed->next.load(std::memory_order_acquire);
+
+        if (closed->next.compare_exchange_strong(next, fresh,
+                                                 std::memory_order_acq_rel,
+                                                 std::memory_order_acquire)) {
+            return fresh;
+        }
+        release_segment(fresh);  // Another producer linked one first
+        return next;
+    }
+
+    // Unlink segment from the head if it is closed, fully consumed and has
+    // a successor. Returns true if this thread unlinked it and so must
+    // retire it.
+    bool unlink_if_drained(Segment* segment) noexcept {
+        size_t tail = segment->tail.load(std::memory_order_acquire);
+        if ((tail & CLOSED) == 0) return false;
+        if (segment->head.load(std::memory_order_acquire) < (tail & ~CLOSED)) return false;
+        Segment* next = segment->next.load(std::memory_order_acquire);
+        if (next == nullptr) return false;
+
+        // Move tail first, so the retired segment is reachable from neither end
+        Segment* expected = segment;
+        tail_segment_.compare_exchange_strong(expected, next);
+        expected = segment;
+        return head_segment_.compare_exchange_strong(expected, next);
+    }
+
+    // At max_segments the head segment may be drained and only waiting for
+    // a consumer to come back and unlink it; producers do it themselves
+    bool unlink_drained_head(Guard& guard) noexcept {
+        Segment* head = guard.protect(1, head_segment_);
+        bool unlinked = unlink_if_drained(head);
+        guard.clear(1);
+        if (unlinked) retire(head);
+        return unlinked;
+    }
+
+    // Called once the tail segment refused a push. Returns the segment to
+    // push into next, or nullptr if no segment can be linked.
+    Segment* after_closed(Guard& guard, Segment* segment) noexcept {
+        Segment* next = next_segment(segment);
+        if (next == nullptr && unlink_drained_head(guard)) next = next_segment(segment);
+        if (next == nullptr) return nullptr;
+
+        Segment* expected = segment;
+        tail_segment_.compare_exchange_strong(expected, next);
+        return guard.protect(0, tail_segment_);
+    }
+
+    // Called once a pop found segment empty. Returns the same segment if
+    // it filled meanwhile, the new head once it is drained for good, or
+    // nullptr if the queue is empty.
+    Segment* after_empty(Guard& guard, Segment* segment) noexcept {
+        size_t tail = segment->tail.load(std::memory_order_acquire);
+        if ((tail & CLOSED) == 0) return nullptr;
+        if (segment->head.load(std::memory_order_acquire) < (tail & ~CLOSED)) return segment;
+
+        if (segment->next.load(std::memory_order_acquire) == nullptr) {
+            return nullptr;  // Its successor is still being linked
+        }
+
+        bool unlinked = unlink_if_drained(segment);
+        Segment* head = guard.protect(0, head_segment_);
+        if (unlinked) retire(segment);
+        return head;
+    }
+
+    template <typename U>
+    bool push_value(U&& value) noexcept {
+        Guard guard(*this);
+        Backoff backoff;
+        Segment* segment = guard.protect(0, tail_segment_);
+        while (segment != nullptr) {
+            if (push(*segment, std::forward<U>(value), backoff)) return true;
+            segment = after_closed(guard, segment);
+        }
+        return false;
+    }
+
+    template <typename Source>
+    size_t enqueue_batch_n(size_t n, Source&& source) noexcept {
+        Guard guard(*this);
+        Backoff backoff;
+        size_t count = 0;
+        Segment* segment = guard.protect(0, tail_segment_);
+        while (count < n && segment != nullptr) {
+            auto rest = [&](size_t i) -> decltype(auto) { return source(count + i); };
+            size_t pushed = push_batch(*segment, n - count, rest, backoff);
+            count += pushed;
+            if (pushed == 0) segment = after_closed(guard, segment);
+        }
+        return count;
+    }
+
+    size_t segment_bytes() const noexcept {
+        return sizeof(Segment) + segment_capacity_ * sizeof(Slot);
+    }
+
+public:
+    explicit BasicSegmentedQueue(const SegmentedQueueConfig& config = SegmentedQueueConfig())
+        : segment_capacity_(round_up_to_power_of_two(config.segment_capacity)),
+          mask_(segment_capacity_ - 1),
+          max_segments_(config.max_segments),
+          cached_segments_(config.cached_segments),
+          stats_(config.stats_mode) {
+
+        if (config.segment_capacity < 2) {
+            throw std::invalid_argument("Segment capacity must be at least 2");
+        }
+        if (segment_capacity_ > (SIZE_MAX >> 2)) {
+            throw std::invalid_argument("Segment capacity too large");
+        }
+        if (max_segments_ == 1) {
+            throw std::invalid_argument("max_segments must be 0 or at least 2");
+        }
+
+        cached_.reserve(cached_segments_);
+        Segment* first = new Segment(segment_capacity_, 0);
+        live_segments_ = 1;
+        head_segment_.store(first, std::memory_order_relaxed);
+        tail_segment_.store(first, std::memory_order_relaxed);
+    }
+
+    // Deleted copy/move operations due to atomics and const members
+    BasicSegmentedQueue(const BasicSegmentedQueue&) = delete;
+    BasicSegmentedQueue& operator=(const BasicSegmentedQueue&) = delete;
+    BasicSegmentedQueue(BasicSegmentedQueue&&) = delete;
+    BasicSegmentedQueue& operator=(BasicSegmentedQueue&&) = delete;
+
+    ~BasicSegmentedQueue() {
+        Segment* segment = head_segment_.load(std::memory_order_relaxed);
+        while (segment != nullptr) {
+            Segment* next = segment->next.load(std::memory_order_relaxed);
+            delete segment;
+            segment = next;
+        }
+        for (Segment* retired : retired_) delete retired;
+        for (Segment* cached : cached_) delete cached;
+        for (auto& hazard : hazards_) delete hazard.load(std::memory_order_relaxed);
+    }
+
+    // Returns false only at max_segments or when a segment cannot be allocated
+    bool enqueue(const T& value) noexcept {
+        record_stat(&QueueStats::enqueue_attempts);
+        if (!push_value(value)) return false;
+        record_stat(&QueueStats::enqueue_successes);
+        return true;
+    }
+
+    // value is only moved from on success
+    bool enqueue(T&& value) noexcept {
+        record_stat(&QueueStats::enqueue_attempts);
+        if (!push_value(std::move(value))) return false;
+        record_stat(&QueueStats::enqueue_successes);
+        return true;
+    }
+
+    std::optional<T> dequeue() noexcept {
+        record_stat(&QueueStats::dequeue_attempts);
+
+        Guard guard(*this);
+        Backoff backoff;
+        Segment* segment = guard.protect(0, head_segment_);
+        while (segment != nullptr) {
+            std::optional<T> value = pop(*segment, backoff);
+            if (value.has_value()) {
+                record_stat(&QueueStats::dequeue_successes);
+                return value;
+            }
+            segment = after_empty(guard, segment);
+        }
+        return std::nullopt;
+    }
+
+    // Enqueue as many elements as the segment limit allows, one tail CAS
+    // per segment touched
+    size_t enqueue_batch(my_std::span<const T> values) noexcept {
+        if (values.empty()) return 0;
+        record_stat(&QueueStats::batch_enqueues);
+        return enqueue_batch_n(values.size(), [&](size_t i) -> const T& { return values[i]; });
+    }
+
+    // As enqueue_batch, moving the accepted prefix out of values
+    size_t enqueue_batch_move(my_std::span<T> values) noexcept {
+        if (values.empty()) return 0;
+        record_stat(&QueueStats::batch_enqueues);
+        return enqueue_batch_n(values.size(), [&](size_t i) -> T&& { return std::move(values[i]); });
+    }
+
+    // Dequeue up to values.size() elements, crossing segments as needed
+    size_t dequeue_batch(my_std::span<T> values) noexcept {
+        if (values.empty()) return 0;
+        record_stat(&QueueStats::batch_dequeues);
+
+        Guard guard(*this);
+        Backoff backoff;
+        size_t count = 0;
+        Segment* segment = guard.protect(0, head_segment_);
+        while (count < values.size() && segment != nullptr) {
+            size_t popped = pop_batch(*segment, values.subspan(count), backoff);
+            count += popped;
+            if (popped == 0) segment = after_empty(guard, segment);
+        }
+        return count;
+    }
+
+    // Elements in the queue; exact when quiescent
+    size_t size() const noexcept {
+        Guard guard(*this);
+        Segment* head = guard.protect(0, head_segment_);
+        Segment* tail = guard.protect(1, tail_segment_);
+        size_t first = head->base + head->head.load(std::memory_order_acquire);
+        size_t last = tail->base + (tail->tail.load(std::memory_order_acquire) & ~CLOSED);
+        return last > first ? last - first : 0;
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    size_t segment_capacity() const noexcept {
+        return segment_capacity_;
+    }
+
+    // Segments holding or awaiting elements, plus drained ones not yet
+    // recycled because a thread may still be inside them
+    size_t segment_count() const noexcept {
+        std::lock_guard<std::mutex> lock(segments_mutex_);
+        return live_segments_;
+    }
+
+    size_t cached_segment_count() const noexcept {
+        std::lock_guard<std::mutex> lock(segments_mutex_);
+        return cached_.size();
+    }
+
+    // Free the segment cache and any retired segments no longer in use
+    void shrink() noexcept {
+        std::lock_guard<std::mutex> lock(segments_mutex_);
+        reclaim_locked();
+        for (Segment* cached : cached_) delete cached;
+        cached_.clear();
+    }
+
+    // Statistics access
+    StatsMode stats_mode() const noexcept {
+        return stats_.mode();
+    }
+
+    const QueueStats& get_stats() const noexcept {
+        return stats_.get();
+    }
+
+    QueueStatsSnapshot stats_snapshot() const noexcept {
+        return stats_.snapshot();
+    }
+
+    void reset_stats() noexcept {
+        stats_.reset();
+    }
+
+    // Memory usage estimation; follows the segment count
+    size_t memory_usage() const noexcept {
+        size_t segments;
+        {
+            std::lock_guard<std::mutex> lock(segments_mutex_);
+            segments = live_segments_ + cached_.size();
+        }
+        size_t hazards = 0;
+        for (const auto& hazard : hazards_) {
+            if (hazard.load(std::memory_order_relaxed) != nullptr) hazards += sizeof(Hazard);
+        }
+        return sizeof(*this) + segments * segment_bytes() + hazards + stats_.memory_usage();
+    }
+};
+
+using SegmentedPacketQueue = BasicSegmentedQueue<Packet>;
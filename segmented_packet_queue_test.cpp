@@ -0,0 +1,158 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <memory>
+#include "segmented_packet_queue.h"
+
+namespace {
+
+SegmentedQueueConfig small_segments(size_t capacity, size_t max_segments = 0, size_t cached = 2) {
+    SegmentedQueueConfig config;
+    config.segment_capacity = capacity;
+    config.max_segments = max_segments;
+    config.cached_segments = cached;
+    return config;
+}
+
+} // namespace
+
+TEST(SegmentedPacketQueueTest, ConstructorValidation) {
+    EXPECT_THROW(SegmentedPacketQueue(small_segments(0)), std::invalid_argument);
+    EXPECT_THROW(SegmentedPacketQueue(small_segments(1)), std::invalid_argument);
+    EXPECT_THROW(SegmentedPacketQueue(small_segments(8, 1)), std::invalid_argument);
+    EXPECT_NO_THROW(SegmentedPacketQueue(small_segments(8, 2)));
+    EXPECT_EQ(SegmentedPacketQueue(small_segments(5)).segment_capacity(), 8);
+}
+
+TEST(SegmentedPacketQueueTest, GrowsWithBacklogAndShrinksWhenDrained) {
+    SegmentedPacketQueue queue(small_segments(4, 0, 2));
+    EXPECT_TRUE(queue.empty());
+    EXPECT_FALSE(queue.dequeue().has_value());
+    const size_t idle_memory = queue.memory_usage();
+
+    for (size_t i = 0; i < 100; ++i) {
+        ASSERT_TRUE(queue.enqueue(Packet(i)));
+    }
+    EXPECT_EQ(queue.size(), 100);
+    EXPECT_EQ(queue.segment_count(), 25);
+    EXPECT_GE(queue.memory_usage(), idle_memory + 24 * 4 * sizeof(Packet));
+
+    for (size_t i = 0; i < 100; ++i) {
+        auto packet = queue.dequeue();
+        ASSERT_TRUE(packet.has_value());
+        EXPECT_EQ(packet->id, i);
+    }
+    EXPECT_FALSE(queue.dequeue().has_value());
+    EXPECT_TRUE(queue.empty());
+
+    // Drained segments are recycled: a couple cached, the rest freed
+    EXPECT_EQ(queue.segment_count(), 1);
+    EXPECT_EQ(queue.cached_segment_count(), 2);
+    queue.shrink();
+    EXPECT_EQ(queue.cached_segment_count(), 0);
+    EXPECT_EQ(queue.memory_usage(), idle_memory);
+
+    // Within one segment it behaves as a ring and never grows
+    for (size_t round = 0; round < 50; ++round) {
+        ASSERT_TRUE(queue.enqueue(Packet(round)));
+        ASSERT_TRUE(queue.dequeue().has_value());
+    }
+    EXPECT_EQ(queue.segment_count(), 1);
+}
+
+TEST(SegmentedPacketQueueTest, SegmentLimitBoundsTheQueue) {
+    SegmentedPacketQueue queue(small_segments(4, 2));
+    size_t accepted = 0;
+    while (queue.enqueue(Packet(accepted))) ++accepted;
+    EXPECT_EQ(accepted, 8);
+    EXPECT_EQ(queue.segment_count(), 2);
+
+    // Draining the head segment makes room for another one
+    for (size_t i = 0; i < 4; ++i) EXPECT_EQ(queue.dequeue()->id, i);
+    EXPECT_TRUE(queue.enqueue(Packet(8)));
+    EXPECT_EQ(queue.size(), 5);
+    for (size_t i = 4; i <= 8; ++i) EXPECT_EQ(queue.dequeue()->id, i);
+}
+
+TEST(SegmentedPacketQueueTest, BatchesCrossSegments) {
+    SegmentedPacketQueue queue(small_segments(8));
+    std::vector<Packet> in;
+    for (size_t i = 0; i < 50; ++i) in.emplace_back(i);
+    EXPECT_EQ(queue.enqueue_batch(my_std::span<const Packet>(in)), 50);
+    EXPECT_EQ(queue.size(), 50);
+
+    std::vector<Packet> out(64);
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(out).first(20)), 20);
+    EXPECT_EQ(queue.dequeue_batch(my_std::span<Packet>(out).subspan(20)), 30);
+    for (size_t i = 0; i < 50; ++i) EXPECT_EQ(out[i].id, i);
+    EXPECT_TRUE(queue.empty());
+
+    // Move-only elements, moved out of the batch on enqueue
+    BasicSegmentedQueue<std::unique_ptr<int>> owners(small_segments(2));
+    std::vector<std::unique_ptr<int>> values;
+    for (int i = 0; i < 5; ++i) values.push_back(std::make_unique<int>(i));
+    EXPECT_EQ(owners.enqueue_batch_move(my_std::span<std::unique_ptr<int>>(values)), 5);
+    EXPECT_EQ(values[4], nullptr);
+    for (int i = 0; i < 5; ++i) EXPECT_EQ(**owners.dequeue(), i);
+}
+
+TEST(SegmentedPacketQueueTest, ConcurrentProducersConsumers) {
+    SegmentedPacketQueue queue(small_segments(64, 0, 2));
+    constexpr size_t num_producers = 3;
+    constexpr size_t num_consumers = 3;
+    constexpr size_t per_producer = 30000;
+    std::vector<std::atomic<int>> seen(num_producers * per_producer);
+    std::atomic<size_t> consumed{0};
+    std::atomic<bool> order_ok{true};
+
+    std::vector<std::thread> threads;
+    for (size_t p = 0; p < num_producers; ++p) {
+        threads.emplace_back([&, p]() {
+            std::vector<Packet> burst;
+            for (size_t i = 0; i < per_producer;) {
+                if (i % 3 == 0) {
+                    burst.clear();
+                    for (size_t j = 0; j < 10 && i + j < per_producer; ++j) {
+                        burst.emplace_back(p * per_producer + i + j);
+                    }
+                    i += queue.enqueue_batch(my_std::span<const Packet>(burst));
+                } else {
+                    if (queue.enqueue(Packet(p * per_producer + i))) ++i;
+                }
+            }
+        });
+    }
+    for (size_t c = 0; c < num_consumers; ++c) {
+        threads.emplace_back([&, c]() {
+            std::vector<size_t> last(num_producers, SIZE_MAX);
+            std::vector<Packet> burst(16);
+            while (consumed.load() < seen.size()) {
+                size_t n = 0;
+                if (c == 0) {
+                    n = queue.dequeue_batch(my_std::span<Packet>(burst));
+                } else if (auto packet = queue.dequeue()) {
+                    burst[0] = *packet;
+                    n = 1;
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    size_t id = burst[i].id;
+                    size_t producer = id / per_producer;
+                    if (last[producer] != SIZE_MAX && id <= last[producer]) order_ok.store(false);
+                    last[producer] = id;
+                    seen[id].fetch_add(1);
+                }
+                if (n == 0) std::this_thread::yield();
+                consumed.fetch_add(n);
+            }
+        });
+    }
+    for (auto& t : threads) t.join();
+
+    EXPECT_TRUE(order_ok.load());
+    EXPECT_TRUE(std::all_of(seen.begin(), seen.end(), [](const std::atomic<int>& v) { return v.load() == 1; }));
+    EXPECT_TRUE(queue.empty());
+    EXPECT_LE(queue.segment_count(), 3);
+    EXPECT_LE(queue.cached_segment_count(), 2);
+}
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Where a SharedMemoryRegion lives
+//   PosixShm  - shm_open() object; name is "/something"
+//   HugeTlbFs - file on a hugetlbfs mount; name is its path. Sizes are
+//               rounded to 2MB pages, which must be reserved on the host.
+//   Memfd     - anonymous memfd_create() object (Linux); name is only a
+//               label. Other processes attach to the fd, inherited across
+//               fork() or passed over a UNIX socket.
+enum class SharedBacking : uint8_t {
+    PosixShm,
+    HugeTlbFs,
+    Memfd
+};
+
+// Move-only MAP_SHARED mapping of a named (or fd-passed) memory object.
+// Creating fails if the object already exists; attaching maps the object's
+// current size, which is 0 while its creator has not sized it yet. OS
+// failures throw std::system_error. The object outlives the mapping; call
+// unlink() to remove its name once no new process needs to attach.
+class SharedMemoryRegion {
+public:
+    static constexpr size_t HUGE_PAGE_SIZE = size_t(2) << 20;
+
+private:
+    void* base_ = nullptr;
+    size_t size_ = 0;
+    int fd_ = -1;
+    SharedBacking backing_ = SharedBacking::PosixShm;
+
+    [[noreturn]] static void fail(const char* what) {
+        throw std::system_error(errno, std::generic_category(), what);
+    }
+
+    static size_t round_up(size_t bytes, size_t alignment) noexcept {
+        return (bytes + alignment - 1) & ~(alignment - 1);
+    }
+
+    static int open_object(const std::string& name, SharedBacking backing, int flags) {
+        int fd = -1;
+        switch (backing) {
+        case SharedBacking::PosixShm:
+            fd = shm_open(name.c_str(), flags, 0600);
+            break;
+        case SharedBacking::HugeTlbFs:
+            fd = ::open(name.c_str(), flags | O_CLOEXEC, 0600);
+            break;
+        case SharedBacking::Memfd:
+#if defined(__linux__)
+            if ((flags & O_CREAT) == 0) {
+                errno = EINVAL;  // A memfd has no name to open; pass its fd
+                break;
+            }
+            fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+#else
+            errno = ENOSYS;
+#endif
+            break;
+        }
+        return fd;
+    }
+
+    void map(size_t size) {
+        size_ = size;
+        if (size == 0) return;
+        base_ = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if (base_ == MAP_FAILED) {
+            base_ = nullptr;
+            int saved = errno;
+            release();
+            errno = saved;
+            fail("mmap");
+        }
+    }
+
+    void map_existing() {
+        struct stat st;
+        if (fstat(fd_, &st) != 0) {
+            int saved = errno;
+            release();
+            errno = saved;
+            fail("fstat");
+        }
+        map(static_cast<size_t>(st.st_size));
+    }
+
+    void release() noexcept {
+        if (base_ != nullptr) munmap(base_, size_);
+        if (fd_ >= 0) ::close(fd_);
+        base_ = nullptr;
+        size_ = 0;
+        fd_ = -1;
+    }
+
+public:
+    SharedMemoryRegion() = default;
+
+    // Create a new object of at least bytes bytes, zero-filled
+    SharedMemoryRegion(const std::string& name, size_t bytes, SharedBacking backing)
+        : backing_(backing) {
+        fd_ = open_object(name, backing, O_RDWR | O_CREAT | O_EXCL);
+        if (fd_ < 0) fail("Cannot create shared memory object");
+
+        size_t size = round_up(bytes, backing == SharedBacking::HugeTlbFs ? HUGE_PAGE_SIZE : 4096);
+        if (ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+            int saved = errno;
+            release();
+            if (backing != SharedBacking::Memfd) unlink(name, backing);
+            errno = saved;
+            fail("ftruncate");
+        }
+        map(size);
+    }
+
+    // Attach to an existing named object
+    SharedMemoryRegion(const std::string& name, SharedBacking backing)
+        : backing_(backing) {
+        fd_ = open_object(name, backing, O_RDWR);
+        if (fd_ < 0) fail("Cannot open shared memory object");
+        map_existing();
+    }
+
+    // Attach to an object by file descriptor (the fd is duplicated)
+    explicit SharedMemoryRegion(int fd, SharedBacking backing = SharedBacking::Memfd)
+        : backing_(backing) {
+        fd_ = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (fd_ < 0) fail("Cannot duplicate shared memory fd");
+        map_existing();
+    }
+
+    SharedMemoryRegion(SharedMemoryRegion&& other) noexcept
+        : base_(other.base_), size_(other.size_), fd_(other.fd_), backing_(other.backing_) {
+        other.base_ = nullptr;
+        other.size_ = 0;
+        other.fd_ = -1;
+    }
+
+    SharedMemoryRegion& operator=(SharedMemoryRegion&& other) noexcept {
+        if (this != &other) {
+            release();
+            base_ = other.base_;
+            size_ = other.size_;
+            fd_ = other.fd_;
+            backing_ = other.backing_;
+            other.base_ = nullptr;
+            other.size_ = 0;
+            other.fd_ = -1;
+        }
+        return *this;
+    }
+
+    SharedMemoryRegion(const SharedMemoryRegion&) = delete;
+    SharedMemoryRegion& operator=(const SharedMemoryRegion&) = delete;
+
+    ~SharedMemoryRegion() { release(); }
+
+    // Remove a named object; existing mappings stay valid. Returns false if
+    // it did not exist.
+    static bool unlink(const std::string& name, SharedBacking backing = SharedBacking::PosixShm) noexcept {
+        switch (backing) {
+        case SharedBacking::PosixShm: return shm_unlink(name.c_str()) == 0;
+        case SharedBacking::HugeTlbFs: return ::unlink(name.c_str()) == 0;
+        default: return false;
+        }
+    }
+
+    void* data() const noexcept { return base_; }
+    size_t size() const noexcept { return size_; }
+    int fd() const noexcept { return fd_; }
+    SharedBacking backing() const noexcept { return backing_; }
+};
@@ -0,0 +1,394 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <type_traits>
+
+#include <signal.h>
+#include <unistd.h>
+
+#include "mpmc_packet_queue.h"
+#include "shared_memory.h"
+
+// Packet descriptor for queues shared between processes. Each process maps
+// the segment at its own address, so the payload is named by its byte
+// offset from the segment base instead of a pointer; 0 means no payload.
+struct SharedPacket {
+    uint64_t offset = 0;
+    uint64_t length = 0;
+    PacketPriority priority = PacketPriority::Low;
+    uint64_t id = 0;
+
+    SharedPacket() = default;
+    explicit SharedPacket(uint64_t i) : id(i) {}
+
+    bool has_payload() const noexcept { return offset != 0; }
+};
+
+enum class SharedQueueOpen : uint8_t {
+    Create,        // Fail if the name exists
+    Attach,        // Fail if it does not
+    OpenOrCreate
+};
+
+struct SharedQueueConfig {
+    // Layout, used when creating; attaching reads it from the segment
+    size_t capacity = 1024;
+    size_t buffer_count = 0;   // Payload buffers in the segment; 0 = none
+    size_t buffer_size = 2048;
+
+    SharedBacking backing = SharedBacking::PosixShm;
+
+    // How long to wait for a creator that is still initialising
+    std::chrono::milliseconds attach_timeout{1000};
+
+    StatsMode stats_mode = StatsMode::Disabled;  // Per process
+};
+
+namespace detail {
+
+// First bytes of a shared queue segment. Written once by the creator and
+// then read-only, except state, which the creator publishes last.
+struct SharedQueueHeader {
+    static constexpr uint64_t MAGIC = 0x315148535154504bull;  // "KPTQSHQ1"
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint32_t INITIALIZING = 0;
+    static constexpr uint32_t READY = 1;
+
+    uint64_t magic;
+    uint32_t version;
+    uint32_t header_bytes;
+    std::atomic<uint32_t> state;
+    int32_t creator_pid;
+    uint64_t segment_bytes;
+
+    uint64_t ring_capacity;
+    uint64_t ring_offset;
+    uint64_t ring_bytes;
+
+    uint64_t buffer_count;
+    uint64_t buffer_size;
+    uint64_t buffer_stride;
+    uint64_t free_list_offset;
+    uint64_t free_list_bytes;
+    uint64_t buffers_offset;
+};
+
+} // namespace detail
+
+// Bounded MPMC packet queue living in a shared-memory segment, for moving
+// packets between processes without copies or syscalls.
+//
+// The segment holds a versioned header, the ring (the same BasicMPMCQueue
+// code over SharedPacket descriptors) and, optionally, a pool of payload
+// buffers with a lock-free free list, all addressed by offset. Any number of
+// processes can attach and produce or consume at in-process speed; blocking
+// waits park on process-shared futexes.
+//
+// The creator initialises the segment and publishes it last, so an
+// attacher never sees a half-built queue: it waits up to attach_timeout for
+// initialisation, and fails fast if the creator process died first
+// (unlink the name and create it again). A process that dies in the middle
+// of an enqueue or dequeue leaves that slot reserved and stalls the ring
+// at that position; buffers it held are not reclaimed. The pid check uses
+// kill(pid, 0), so all processes must share a pid namespace.
+class SharedPacketQueue {
+public:
+    using Ring = BasicMPMCQueue<SharedPacket, dynamic_capacity, BlockingQueuePolicy>;
+
+private:
+    using FreeList = BasicMPMCQueue<uint32_t, dynamic_capacity, PackedQueuePolicy>;
+    using Header = detail::SharedQueueHeader;
+
+    static_assert(std::atomic<size_t>::is_always_lock_free &&
+                  std::atomic<uint32_t>::is_always_lock_free,
+                  "Shared queues need address-free atomics");
+    static_assert(std::is_trivially_copyable<SharedPacket>::value,
+                  "Shared descriptors must be trivially copyable");
+
+    SharedMemoryRegion region_;
+    Header* header_ = nullptr;
+    std::unique_ptr<Ring> ring_;
+    std::unique_ptr<FreeList> free_list_;
+    uint8_t* base_ = nullptr;
+    bool created_ = false;
+
+    static size_t align_up(size_t bytes, size_t alignment) noexcept {
+        return (bytes + alignment - 1) & ~(alignment - 1);
+    }
+
+    static bool name_exists(const std::system_error& e) noexcept {
+        return e.code() == std::errc::file_exists;
+    }
+
+    static size_t stride_for(size_t buffer_size) noexcept {
+        return align_up(buffer_size, CACHE_LINE_SIZE);
+    }
+
+    void create(const std::string& name, const SharedQueueConfig& config) {
+        if (config.capacity == 0) {
+            throw std::invalid_argument("Capacity must be greater than 0");
+        }
+        if (config.buffer_count > UINT32_MAX) {
+            throw std::invalid_argument("Buffer count too large");
+        }
+        if (config.buffer_count != 0 && config.buffer_size == 0) {
+            throw std::invalid_argument("Buffer size must be greater than 0");
+        }
+
+        const size_t capacity = round_up_to_power_of_two(config.capacity);
+        const size_t stride = stride_for(config.buffer_size);
+        const size_t ring_offset = align_up(sizeof(Header), Ring::storage_alignment());
+        const size_t ring_bytes = Ring::storage_bytes(capacity);
+        const size_t free_list_offset = align_up(ring_offset + ring_bytes, FreeList::storage_alignment());
+        const size_t free_list_bytes = config.buffer_count != 0
+            ? FreeList::storage_bytes(config.buffer_count) : 0;
+        const size_t buffers_offset = align_up(free_list_offset + free_list_bytes, 4096);
+        const size_t segment_bytes = buffers_offset + config.buffer_count * stride;
+
+        region_ = SharedMemoryRegion(name, segment_bytes, config.backing);
+        created_ = true;
+        try {
+            base_ = static_cast<uint8_t*>(region_.data());
+            header_ = new (base_) Header();
+            header_->state.store(Header::INITIALIZING, std::memory_order_relaxed);
+            header_->creator_pid = static_cast<int32_t>(getpid());
+            header_->header_bytes = sizeof(Header);
+            header_->segment_bytes = segment_bytes;
+            header_->ring_capacity = capacity;
+            header_->ring_offset = ring_offset;
+            header_->ring_bytes = ring_bytes;
+            header_->buffer_count = config.buffer_count;
+            header_->buffer_size = config.buffer_size;
+            header_->buffer_stride = stride;
+            header_->free_list_offset = free_list_offset;
+            header_->free_list_bytes = free_list_bytes;
+            header_->buffers_offset = buffers_offset;
+
+            open_queues(ExternalQueueMemory::Init::Construct, config.stats_mode);
+            for (size_t i = 0; i < config.buffer_count; ++i) {
+                free_list_->enqueue(static_cast<uint32_t>(i));
+            }
+
+            header_->magic = Header::MAGIC;
+            header_->version = Header::VERSION;
+            header_->state.store(Header::READY, std::memory_order_release);
+        } catch (...) {
+            if (config.backing != SharedBacking::Memfd) SharedMemoryRegion::unlink(name, config.backing);
+            throw;
+        }
+    }
+
+    void open_queues(ExternalQueueMemory::Init init, StatsMode stats_mode) {
+        ExternalQueueMemory ring_memory;
+        ring_memory.data = base_ + header_->ring_offset;
+        ring_memory.bytes = header_->ring_bytes;
+        ring_memory.init = init;
+        ring_memory.process_shared = true;
+        ring_ = std::make_unique<Ring>(header_->ring_capacity, ring_memory, stats_mode);
+
+        if (header_->buffer_count != 0) {
+            ExternalQueueMemory free_memory;
+            free_memory.data = base_ + header_->free_list_offset;
+            free_memory.bytes = header_->free_list_bytes;
+            free_memory.init = init;
+            free_memory.process_shared = true;
+            free_list_ = std::make_unique<FreeList>(header_->buffer_count, free_memory);
+        }
+    }
+
+    // Returns false if the segment is not ready yet
+    bool try_adopt(SharedMemoryRegion&& region, const SharedQueueConfig& config) {
+        if (region.size() < sizeof(Header)) return false;
+
+        auto* header = static_cast<Header*>(region.data());
+        if (header->state.load(std::memory_order_acquire) != Header::READY) {
+            pid_t creator = static_cast<pid_t>(header->creator_pid);
+            if (creator > 0 && kill(creator, 0) != 0 && errno == ESRCH) {
+                throw std::runtime_error("Shared queue creator died during initialization");
+            }
+            return false;
+        }
+
+        if (header->magic != Header::MAGIC) {
+            throw std::invalid_argument("Not a shared packet queue segment");
+        }
+        if (header->version != Header::VERSION || header->header_bytes != sizeof(Header)) {
+            throw std::invalid_argument("Shared queue segment version mismatch");
+        }
+        // Slot sizes depend on the element type and policy; a mismatch
+        // means the two processes were built against different layouts
+        bool layout_ok =
+            header->segment_bytes <= region.size() &&
+            header->ring_bytes == Ring::storage_bytes(header->ring_capacity) &&
+            header->ring_offset % Ring::storage_alignment() == 0 &&
+            header->ring_offset + header->ring_bytes <= header->segment_bytes &&
+            (header->buffer_count == 0 ||
+             (header->free_list_bytes == FreeList::storage_bytes(header->buffer_count) &&
+              header->free_list_offset % FreeList::storage_alignment() == 0 &&
+              header->buffer_stride >= header->buffer_size &&
+              header->buffers_offset + header->buffer_count * header->buffer_stride <=
+                  header->segment_bytes));
+        if (!layout_ok) {
+            throw std::invalid_argument("Shared queue segment layout mismatch");
+        }
+
+        region_ = std::move(region);
+        base_ = static_cast<uint8_t*>(region_.data());
+        header_ = header;
+        open_queues(ExternalQueueMemory::Init::Attach, config.stats_mode);
+        return true;
+    }
+
+    template <typename OpenRegion>
+    void attach(OpenRegion&& open_region, const SharedQueueConfig& config) {
+        auto deadline = std::chrono::steady_clock::now() + config.attach_timeout;
+        while (true) {
+            if (try_adopt(open_region(), config)) return;
+            if (std::chrono::steady_clock::now() >= deadline) {
+                throw std::runtime_error("Timed out waiting for shared queue initialization");
+            }
+            // Re-open: the creator may not have sized the object yet
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+public:
+    // Create and/or attach to the segment called name. Throws
+    // std::system_error for OS failures (including creating a name that
+    // exists or attaching one that does not), std::invalid_argument for a
+    // bad config or an incompatible segment, and std::runtime_error for a
+    // segment whose initialisation never finished.
+    SharedPacketQueue(const std::string& name, SharedQueueOpen mode,
+                      const SharedQueueConfig& config = {}) {
+        if (mode != SharedQueueOpen::Attach) {
+            try {
+                create(name, config);
+                return;
+            } catch (const std::system_error& e) {
+                if (mode == SharedQueueOpen::Create || !name_exists(e)) throw;
+            }
+        }
+        attach([&]() { return SharedMemoryRegion(name, config.backing); }, config);
+    }
+
+    // Attach to a segment by file descriptor, e.g. a memfd from its creator
+    explicit SharedPacketQueue(int fd, const SharedQueueConfig& config = {}) {
+        attach([&]() { return SharedMemoryRegion(fd, config.backing); }, config);
+    }
+
+    SharedPacketQueue(const SharedPacketQueue&) = delete;
+    SharedPacketQueue& operator=(const SharedPacketQueue&) = delete;
+    SharedPacketQueue(SharedPacketQueue&&) = delete;
+    SharedPacketQueue& operator=(SharedPacketQueue&&) = delete;
+
+    // Unmaps the segment; the name stays until unlink()
+    ~SharedPacketQueue() = default;
+
+    static bool unlink(const std::string& name, SharedBacking backing = SharedBacking::PosixShm) noexcept {
+        return SharedMemoryRegion::unlink(name, backing);
+    }
+
+    // Ring operations
+    bool enqueue(const SharedPacket& packet) noexcept { return ring_->enqueue(packet); }
+    std::optional<SharedPacket> dequeue() noexcept { return ring_->dequeue(); }
+    bool try_enqueue(const SharedPacket& packet) noexcept { return ring_->try_enqueue(packet); }
+    std::optional<SharedPacket> try_dequeue() noexcept { return ring_->try_dequeue(); }
+
+    size_t enqueue_batch(my_std::span<const SharedPacket> packets) noexcept {
+        return ring_->enqueue_batch(packets);
+    }
+
+    size_t dequeue_batch(my_std::span<SharedPacket> packets) noexcept {
+        return ring_->dequeue_batch(packets);
+    }
+
+    template <typename Rep, typename Period>
+    bool enqueue_wait(const SharedPacket& packet, const std::chrono::duration<Rep, Period>& timeout) noexcept {
+        return ring_->enqueue_wait(packet, timeout);
+    }
+
+    template <typename Rep, typename Period>
+    std::optional<SharedPacket> dequeue_wait(const std::chrono::duration<Rep, Period>& timeout) noexcept {
+        return ring_->dequeue_wait(timeout);
+    }
+
+    // The underlying ring, for the rest of the BasicMPMCQueue API
+    Ring& ring() noexcept { return *ring_; }
+
+    // Payload buffers. allocate() returns a descriptor without payload if
+    // the pool is exhausted or has no buffers.
+    SharedPacket allocate() noexcept {
+        SharedPacket packet;
+        if (!free_list_) return packet;
+        if (auto index = free_list_->dequeue()) {
+            packet.offset = header_->buffers_offset + static_cast<uint64_t>(*index) * header_->buffer_stride;
+        }
+        return packet;
+    }
+
+    void free(SharedPacket& packet) noexcept {
+        if (!packet.has_payload() || !owns_offset(packet.offset)) return;
+        auto index = static_cast<uint32_t>((packet.offset - header_->buffers_offset) / header_->buffer_stride);
+        free_list_->enqueue(index);
+        packet.offset = 0;
+        packet.length = 0;
+    }
+
+    // Payload address in this process, nullptr without payload
+    uint8_t* data(const SharedPacket& packet) const noexcept {
+        return packet.has_payload() ? base_ + packet.offset : nullptr;
+    }
+
+    // Conversions to and from the in-process Packet; addresses outside this
+    // segment's buffers become descriptors without payload
+    Packet to_packet(const SharedPacket& packet) const noexcept {
+        return Packet(data(packet), static_cast<size_t>(packet.length), packet.priority,
+                      static_cast<size_t>(packet.id));
+    }
+
+    SharedPacket from_packet(const Packet& packet) const noexcept {
+        SharedPacket shared(packet.id);
+        shared.length = packet.length;
+        shared.priority = packet.priority;
+        if (packet.data != nullptr && packet.data >= base_ &&
+            owns_offset(static_cast<uint64_t>(packet.data - base_))) {
+            shared.offset = static_cast<uint64_t>(packet.data - base_);
+        }
+        return shared;
+    }
+
+    bool owns_offset(uint64_t offset) const noexcept {
+        return header_->buffer_count != 0 && offset >= header_->buffers_offset &&
+               offset < header_->buffers_offset + header_->buffer_count * header_->buffer_stride &&
+               (offset - header_->buffers_offset) % header_->buffer_stride == 0;
+    }
+
+    // Queue state queries
+    size_t size() const noexcept { return ring_->size(); }
+    bool empty() const noexcept { return ring_->empty(); }
+    size_t capacity() const noexcept { return ring_->capacity(); }
+    size_t buffer_count() const noexcept { return static_cast<size_t>(header_->buffer_count); }
+    size_t buffer_size() const noexcept { return static_cast<size_t>(header_->buffer_size); }
+    size_t available_buffers() const noexcept { return free_list_ ? free_list_->size() : 0; }
+
+    // Whether this process created the segment
+    bool created() const noexcept { return created_; }
+
+    int fd() const noexcept { return region_.fd(); }
+    size_t segment_bytes() const noexcept { return region_.size(); }
+
+    // Memory usage estimation
+    size_t memory_usage() const noexcept {
+        return sizeof(*this) + region_.size() + sizeof(Ring) + (free_list_ ? sizeof(FreeList) : 0);
+    }
+
+};
@@ -0,0 +1,198 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "shared_packet_queue.h"
+
+namespace {
+
+std::string unique_name(const char* tag) {
+    return "/packet_queue_test_" + std::to_string(getpid()) + "_" + tag;
+}
+
+} // namespace
+
+TEST(SharedPacketQueueTest, AttachSeesSameRingAtAnotherAddress) {
+    const std::string name = unique_name("attach");
+    SharedQueueConfig config;
+    config.capacity = 64;
+    config.buffer_count = 16;
+    config.buffer_size = 256;
+
+    SharedPacketQueue creator(name, SharedQueueOpen::Create, config);
+    SharedPacketQueue peer(name, SharedQueueOpen::Attach);
+    EXPECT_TRUE(creator.created());
+    EXPECT_FALSE(peer.created());
+    EXPECT_EQ(peer.capacity(), 64);
+    EXPECT_EQ(peer.buffer_count(), 16);
+    EXPECT_EQ(peer.available_buffers(), 16);
+
+    // Two mappings of one segment: offsets agree, pointers do not
+    SharedPacket packet = creator.allocate();
+    ASSERT_TRUE(packet.has_payload());
+    std::strcpy(reinterpret_cast<char*>(creator.data(packet)), "payload");
+    packet.length = 8;
+    packet.id = 7;
+    EXPECT_TRUE(creator.enqueue(packet));
+    EXPECT_NE(creator.data(packet), peer.data(packet));
+
+    auto received = peer.dequeue();
+    ASSERT_TRUE(received.has_value());
+    EXPECT_EQ(received->id, 7);
+    EXPECT_STREQ(reinterpret_cast<const char*>(peer.data(*received)), "payload");
+
+    // Round trip through an in-process Packet
+    Packet local = peer.to_packet(*received);
+    EXPECT_EQ(local.data, peer.data(*received));
+    EXPECT_EQ(peer.from_packet(local).offset, received->offset);
+    EXPECT_FALSE(creator.from_packet(local).has_payload());  // Not in its mapping
+
+    peer.free(*received);
+    EXPECT_EQ(creator.available_buffers(), 16);
+
+    // A second creator for the same name fails; OpenOrCreate attaches
+    EXPECT_THROW(SharedPacketQueue(name, SharedQueueOpen::Create, config), std::system_error);
+    SharedPacketQueue either(name, SharedQueueOpen::OpenOrCreate, config);
+    EXPECT_FALSE(either.created());
+
+    EXPECT_TRUE(SharedPacketQueue::unlink(name));
+    EXPECT_THROW(SharedPacketQueue(name, SharedQueueOpen::Attach), std::system_error);
+}
+
+TEST(SharedPacketQueueTest, CrossProcessTransfer) {
+    const std::string name = unique_name("fork");
+    constexpr size_t num_packets = 20000;
+    SharedQueueConfig config;
+    config.capacity = 256;
+    config.buffer_count = 512;
+    config.buffer_size = 64;
+    SharedPacketQueue consumer(name, SharedQueueOpen::Create, config);
+
+    pid_t child = fork();
+    ASSERT_GE(child, 0);
+    if (child == 0) {
+        // Producer process: attach by name, fill buffers, enqueue
+        int status = 0;
+        try {
+            SharedPacketQueue producer(name, SharedQueueOpen::Attach);
+            for (size_t i = 0; i < num_packets; ++i) {
+                SharedPacket packet = producer.allocate();
+                while (!packet.has_payload()) {
+                    std::this_thread::yield();
+                    packet = producer.allocate();
+                }
+                std::memcpy(producer.data(packet), &i, sizeof(i));
+                packet.length = sizeof(i);
+                packet.id = i;
+                while (!producer.enqueue_wait(packet, std::chrono::milliseconds(100))) {}
+            }
+        } catch (...) {
+            status = 1;
+        }
+        _exit(status);
+    }
+
+    size_t received = 0;
+    bool payloads_match = true;
+    std::vector<SharedPacket> burst(32);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    while (received < num_packets && std::chrono::steady_clock::now() < deadline) {
+        auto first = consumer.dequeue_wait(std::chrono::milliseconds(100));  // Parks across processes
+        if (!first) continue;
+        burst[0] = *first;
+        size_t n = 1 + consumer.dequeue_batch(my_std::span<SharedPacket>(burst).subspan(1));
+        for (size_t i = 0; i < n; ++i) {
+            size_t value;
+            std::memcpy(&value, consumer.data(burst[i]), sizeof(value));
+            if (value != burst[i].id || burst[i].id != received + i) payloads_match = false;
+            consumer.free(burst[i]);
+        }
+        received += n;
+    }
+
+    int status = -1;
+    waitpid(child, &status, 0);
+    EXPECT_TRUE(WIFEXITED(status));
+    EXPECT_EQ(WEXITSTATUS(status), 0);
+    EXPECT_EQ(received, num_packets);
+    EXPECT_TRUE(payloads_match);
+    EXPECT_EQ(consumer.available_buffers(), config.buffer_count);
+    SharedPacketQueue::unlink(name);
+}
+
+TEST(SharedPacketQueueTest, RejectsUnusableSegments) {
+    // Not a queue segment
+    const std::string garbage = unique_name("garbage");
+    {
+        SharedMemoryRegion region(garbage, 8192, SharedBacking::PosixShm);
+        auto* header = static_cast<detail::SharedQueueHeader*>(region.data());
+        header->state.store(detail::SharedQueueHeader::READY);
+        header->magic = 0x1234;
+        EXPECT_THROW(SharedPacketQueue(garbage, SharedQueueOpen::Attach), std::invalid_argument);
+
+        // Right magic, different layout (e.g. another slot size)
+        header->magic = detail::SharedQueueHeader::MAGIC;
+        header->version = detail::SharedQueueHeader::VERSION;
+        header->header_bytes = sizeof(detail::SharedQueueHeader);
+        header->segment_bytes = 8192;
+        header->ring_capacity = 64;
+        header->ring_bytes = 64;
+        EXPECT_THROW(SharedPacketQueue(garbage, SharedQueueOpen::Attach), std::invalid_argument);
+    }
+    SharedMemoryRegion::unlink(garbage);
+
+    // Creator died before publishing the segment
+    const std::string stale = unique_name("stale");
+    {
+        pid_t dead = fork();
+        ASSERT_GE(dead, 0);
+        if (dead == 0) _exit(0);
+        waitpid(dead, nullptr, 0);
+
+        SharedMemoryRegion region(stale, 8192, SharedBacking::PosixShm);
+        auto* header = static_cast<detail::SharedQueueHeader*>(region.data());
+        header->creator_pid = static_cast<int32_t>(dead);
+        SharedQueueConfig config;
+        config.attach_timeout = std::chrono::milliseconds(5000);
+        auto start = std::chrono::steady_clock::now();
+        EXPECT_THROW(SharedPacketQueue(stale, SharedQueueOpen::Attach, config), std::runtime_error);
+        EXPECT_LT(std::chrono::steady_clock::now() - start, std::chrono::seconds(1));
+
+        // Still initialising by a live creator: time out instead
+        header->creator_pid = static_cast<int32_t>(getpid());
+        config.attach_timeout = std::chrono::milliseconds(20);
+        EXPECT_THROW(SharedPacketQueue(stale, SharedQueueOpen::Attach, config), std::runtime_error);
+    }
+    SharedMemoryRegion::unlink(stale);
+
+    SharedQueueConfig bad;
+    bad.capacity = 0;
+    EXPECT_THROW(SharedPacketQueue(unique_name("bad"), SharedQueueOpen::Create, bad),
+                 std::invalid_argument);
+    EXPECT_FALSE(SharedMemoryRegion::unlink(unique_name("bad")));
+}
+
+TEST(SharedPacketQueueTest, MemfdAttachByDescriptor) {
+    SharedQueueConfig config;
+    config.capacity = 16;
+    config.backing = SharedBacking::Memfd;
+    SharedPacketQueue creator("memfd_queue", SharedQueueOpen::Create, config);
+    ASSERT_GE(creator.fd(), 0);
+
+    SharedPacketQueue peer(creator.fd());
+    std::vector<SharedPacket> burst;
+    for (uint64_t i = 0; i < 16; ++i) burst.emplace_back(i);
+    EXPECT_EQ(creator.enqueue_batch(my_std::span<const SharedPacket>(burst)), 16);
+    EXPECT_FALSE(creator.enqueue(SharedPacket(99)));
+
+    std::vector<SharedPacket> out(16);
+    EXPECT_EQ(peer.dequeue_batch(my_std::span<SharedPacket>(out)), 16);
+    for (uint64_t i = 0; i < 16; ++i) EXPECT_EQ(out[i].id, i);
+    EXPECT_TRUE(creator.empty());
+    EXPECT_FALSE(creator.allocate().has_payload());  // No buffers configured
+}
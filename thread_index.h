@@ -0,0 +1,62 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Dense small integer per live thread, for indexing per-thread shards.
+//
+// Indexes are handed out lowest-first and returned when the thread exits,
+// so a pool of N long-lived workers uses indexes [0, N) no matter how many
+// short-lived threads came and went before them. Threads beyond MAX_THREADS
+// get INVALID and must fall back to a shared path.
+class ThreadIndex {
+public:
+    static constexpr size_t MAX_THREADS = 256;
+    static constexpr size_t INVALID = MAX_THREADS;
+
+    static size_t get() noexcept {
+        thread_local Holder holder;
+        return holder.index;
+    }
+
+private:
+    static constexpr size_t WORD_BITS = 64;
+    using Bitmap = std::array<std::atomic<uint64_t>, MAX_THREADS / WORD_BITS>;
+
+    // Constant-initialized and trivially destructible, so it is safe to use
+    // from thread_local destructors that run during process exit.
+    static Bitmap& bitmap() noexcept {
+        static Bitmap used{};
+        return used;
+    }
+
+    static size_t acquire() noexcept {
+        Bitmap& used = bitmap();
+        for (size_t w = 0; w < used.size(); ++w) {
+            uint64_t bits = used[w].load(std::memory_order_relaxed);
+            while (bits != ~uint64_t(0)) {
+                uint64_t free_bit = ~bits & (bits + 1); // Lowest clear bit
+                if (used[w].compare_exchange_weak(bits, bits | free_bit,
+                                                  std::memory_order_acquire,
+                                                  std::memory_order_relaxed)) {
+                    return w * WORD_BITS + static_cast<size_t>(__builtin_ctzll(free_bit));
+                }
+            }
+        }
+        return INVALID;
+    }
+
+    static void release(size_t index) noexcept {
+        if (index >= MAX_THREADS) return;
+        bitmap()[index / WORD_BITS].fetch_and(~(uint64_t(1) << (index % WORD_BITS)),
+                                              std::memory_order_release);
+    }
+
+    struct Holder {
+        size_t index;
+        Holder() noexcept : index(acquire()) {}
+        ~Holder() { release(index); }
+    };
+};
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "latency_histogram.h"
+#include "mpmc_packet_queue.h"
+#include "priority_packet_queue.h"
+
+// Rate limits for one queue or lane. A rate of 0 leaves that dimension
+// unlimited. A burst of 0 picks one millisecond's worth of the rate (at
+// least one unit); that is how much may leave back to back after an idle
+// period.
+struct ShaperConfig {
+    uint64_t bytes_per_second = 0;
+    uint64_t packets_per_second = 0;
+    uint64_t burst_bytes = 0;
+    uint64_t burst_packets = 0;
+};
+
+// Result of a shaped dequeue_batch. delay is how long until the budget
+// admits another packet, zero if it already does. When count is short of
+// the batch size and delay is zero, the queue itself ran empty.
+struct ShapedBatch {
+    size_t count = 0;
+    std::chrono::nanoseconds delay{0};
+};
+
+// Lock-free token bucket for one dimension (bytes or packets), implemented
+// as GCRA: the only state is the theoretical arrival time (TAT) of the next
+// unit, one atomic word updated by CAS. Being at or behind the current time
+// means the bucket is full; being ahead of it by the burst tolerance means
+// it is empty.
+//
+// Times are nanoseconds relative to the bucket's origin, in 1/256 ns fixed
+// point so that per-byte costs at multi-gigabit rates keep their precision.
+// The word then covers about two years from construction.
+class TokenBucket {
+private:
+    static constexpr unsigned FRACTION_BITS = 8;
+    static constexpr uint64_t PERIOD = uint64_t(1'000'000'000) << FRACTION_BITS;  // One second
+
+    uint64_t rate_ = 0;  // Units per second, 0 = unlimited
+    uint64_t tolerance_ = 0;
+    uint64_t unit_cost_ = 0;
+    uint64_t origin_ = 0;
+    alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> tat_{0};
+
+    uint64_t cost(uint64_t units) const noexcept {
+        return static_cast<uint64_t>(static_cast<unsigned __int128>(units) * PERIOD / rate_);
+    }
+
+    uint64_t fixed(uint64_t now_ns) const noexcept {
+        return (now_ns > origin_ ? now_ns - origin_ : 0) << FRACTION_BITS;
+    }
+
+    // Whole units the bucket holds at now, given the current TAT
+    uint64_t available(uint64_t tat, uint64_t now) const noexcept {
+        uint64_t base = std::max(tat, now);
+        if (now + tolerance_ <= base) return 0;
+        return static_cast<uint64_t>(static_cast<unsigned __int128>(now + tolerance_ - base) * rate_ / PERIOD);
+    }
+
+public:
+    TokenBucket() = default;
+
+    TokenBucket(uint64_t rate, uint64_t burst, uint64_t now_ns) noexcept
+        : rate_(rate), origin_(now_ns) {
+        if (rate_ == 0) return;
+        if (burst == 0) burst = std::max<uint64_t>(1, rate_ / 1000);
+        unit_cost_ = std::max<uint64_t>(1, cost(1));
+        tolerance_ = cost(burst);
+    }
+
+    TokenBucket(const TokenBucket&) = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    bool limited() const noexcept { return rate_ != 0; }
+    uint64_t rate() const noexcept { return rate_; }
+
+    // Take up to max units; returns how many were granted
+    uint64_t acquire(uint64_t max, uint64_t now_ns) noexcept {
+        if (rate_ == 0) return max;
+        const uint64_t now = fixed(now_ns);
+        uint64_t tat = tat_.load(std::memory_order_relaxed);
+        while (true) {
+            uint64_t granted = std::min(max, available(tat, now));
+            if (granted == 0) return 0;
+            uint64_t next = std::max(tat, now) + cost(granted);
+            if (tat_.compare_exchange_weak(tat, next, std::memory_order_relaxed)) return granted;
+        }
+    }
+
+    // Return units that were acquired but not used
+    void refund(uint64_t units) noexcept {
+        if (rate_ == 0 || units == 0) return;
+        tat_.fetch_sub(cost(units), std::memory_order_relaxed);
+    }
+
+    // Spend units that have already left, even beyond the burst. The debt
+    // delays later traffic, so the long-term rate still holds.
+    void charge(uint64_t units, uint64_t now_ns) noexcept {
+        if (rate_ == 0 || units == 0) return;
+        const uint64_t now = fixed(now_ns);
+        uint64_t tat = tat_.load(std::memory_order_relaxed);
+        while (!tat_.compare_exchange_weak(tat, std::max(tat, now) + cost(units),
+                                           std::memory_order_relaxed)) {
+        }
+    }
+
+    // Time until one more unit is admitted
+    std::chrono::nanoseconds delay(uint64_t now_ns) const noexcept {
+        if (rate_ == 0) return std::chrono::nanoseconds(0);
+        const uint64_t now = fixed(now_ns);
+        uint64_t eligible = std::max(tat_.load(std::memory_order_relaxed), now) + unit_cost_;
+        if (eligible <= now + tolerance_) return std::chrono::nanoseconds(0);
+        uint64_t wait = eligible - tolerance_ - now;
+        return std::chrono::nanoseconds(
+            static_cast<int64_t>((wait + (uint64_t(1) << FRACTION_BITS) - 1) >> FRACTION_BITS));
+    }
+
+    // Refill to a full burst
+    void reset() noexcept { tat_.store(0, std::memory_order_relaxed); }
+};
+
+// Byte and packet budgets for one queue, shared by all of its consumers.
+//
+// The packet budget is exact: it is taken before the ring is touched and
+// whatever the ring could not supply is refunded. Packet lengths are only
+// known once packets are claimed, so the byte budget gates a batch on the
+// bucket not being in debt and is charged afterwards. A batch may thus
+// overrun the byte burst by up to one batch, which later batches pay back.
+//
+// Clock is the same as for queue latency timing; the default refills from
+// the TSC.
+template <typename Clock = TscLatencyClock>
+class BasicTrafficShaper {
+private:
+    TokenBucket bytes_;
+    TokenBucket packets_;
+
+    static uint64_t now_ns() noexcept {
+        return Clock::to_ns(Clock::now());
+    }
+
+    static uint64_t start_ns() noexcept {
+        Clock::calibrate();
+        return now_ns();
+    }
+
+public:
+    explicit BasicTrafficShaper(const ShaperConfig& config = ShaperConfig())
+        : BasicTrafficShaper(config, start_ns()) {}
+
+    BasicTrafficShaper(const BasicTrafficShaper&) = delete;
+    BasicTrafficShaper& operator=(const BasicTrafficShaper&) = delete;
+    BasicTrafficShaper(BasicTrafficShaper&&) = delete;
+    BasicTrafficShaper& operator=(BasicTrafficShaper&&) = delete;
+
+    // Dequeue up to packets.size() packets from queue, as far as the budget
+    // allows. Queue is anything with dequeue_batch(my_std::span<Packet>).
+    template <typename Queue>
+    ShapedBatch dequeue_batch(Queue& queue, my_std::span<Packet> packets) noexcept {
+        const uint64_t now = now_ns();
+        ShapedBatch result;
+        if (packets.empty()) return result;
+
+        if (bytes_.limited() && bytes_.delay(now).count() != 0) {
+            result.delay = delay(now);
+            return result;
+        }
+        size_t allowed = static_cast<size_t>(packets_.acquire(packets.size(), now));
+        if (allowed != 0) {
+            result.count = queue.dequeue_batch(packets.first(allowed));
+            packets_.refund(allowed - result.count);
+        }
+
+        if (bytes_.limited()) {
+            uint64_t bytes = 0;
+            for (size_t i = 0; i < result.count; ++i) bytes += packets[i].length;
+            bytes_.charge(bytes, now);
+        }
+        result.delay = delay(now);
+        return result;
+    }
+
+    // Time until the budget admits another packet
+    std::chrono::nanoseconds delay() const noexcept { return delay(now_ns()); }
+
+    bool limited() const noexcept { return bytes_.limited() || packets_.limited(); }
+    uint64_t bytes_per_second() const noexcept { return bytes_.rate(); }
+    uint64_t packets_per_second() const noexcept { return packets_.rate(); }
+
+    // Refill both buckets to a full burst
+    void reset() noexcept {
+        bytes_.reset();
+        packets_.reset();
+    }
+
+private:
+    BasicTrafficShaper(const ShaperConfig& config, uint64_t now)
+        : bytes_(config.bytes_per_second, config.burst_bytes, now),
+          packets_(config.packets_per_second, config.burst_packets, now) {}
+
+    std::chrono::nanoseconds delay(uint64_t now) const noexcept {
+        return std::max(bytes_.delay(now), packets_.delay(now));
+    }
+};
+
+using TrafficShaper = BasicTrafficShaper<>;
+
+// One shaper per PacketPriority lane of a PriorityPacketQueue. Lanes are
+// served in strict priority order, each up to its own budget; a lane left
+// unlimited in the config is only bounded by the batch size.
+template <typename Clock = TscLatencyClock>
+class BasicLaneShaper {
+private:
+    std::array<std::unique_ptr<BasicTrafficShaper<Clock>>, PRIORITY_LANE_COUNT> lanes_;
+
+public:
+    explicit BasicLaneShaper(const std::array<ShaperConfig, PRIORITY_LANE_COUNT>& config) {
+        for (size_t i = 0; i < PRIORITY_LANE_COUNT; ++i) {
+            lanes_[i] = std::make_unique<BasicTrafficShaper<Clock>>(config[i]);
+        }
+    }
+
+    BasicLaneShaper(const BasicLaneShaper&) = delete;
+    BasicLaneShaper& operator=(const BasicLaneShaper&) = delete;
+    BasicLaneShaper(BasicLaneShaper&&) = delete;
+    BasicLaneShaper& operator=(BasicLaneShaper&&) = delete;
+
+    // Drain lanes highest priority first. delay is the shortest wait among
+    // lanes that still had packets but were out of budget, so a poller
+    // wakes for the first one that can move again.
+    ShapedBatch dequeue_batch(PriorityPacketQueue& queue, my_std::span<Packet> packets) noexcept {
+        ShapedBatch result;
+        bool throttled = false;
+        for (size_t i = PRIORITY_LANE_COUNT; i-- > 0 && result.count < packets.size();) {
+            MPMC_PacketQueue& lane = queue.lane(static_cast<PacketPriority>(i));
+            ShapedBatch part = lanes_[i]->dequeue_batch(lane, packets.subspan(result.count));
+            result.count += part.count;
+            if (part.delay.count() != 0 && !lane.empty()) {
+                result.delay = throttled ? std::min(result.delay, part.delay) : part.delay;
+                throttled = true;
+            }
+        }
+        return result;
+    }
+
+    BasicTrafficShaper<Clock>& lane(PacketPriority priority) noexcept {
+        return *lanes_[static_cast<size_t>(priority) & (PRIORITY_LANE_COUNT - 1)];
+    }
+};
+
+using LaneShaper = BasicLaneShaper<>;
@@ -0,0 +1,168 @@
+#include <gtest/gtest.h>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "traffic_shaper.h"
+
+namespace {
+
+// Time advanced by hand, in nanoseconds
+struct ManualClock {
+    static inline std::atomic<uint64_t> ticks{1'000'000};
+
+    static uint64_t now() noexcept { return ticks.load(); }
+    static uint64_t to_ns(uint64_t t) noexcept { return t; }
+    static void calibrate() noexcept {}
+    static void advance(std::chrono::nanoseconds by) { ticks.fetch_add(static_cast<uint64_t>(by.count())); }
+};
+
+using ManualShaper = BasicTrafficShaper<ManualClock>;
+
+void fill(MPMC_PacketQueue& queue, size_t count, uint32_t length) {
+    for (size_t i = 0; i < count; ++i) {
+        Packet packet(i);
+        packet.length = length;
+        ASSERT_TRUE(queue.enqueue(packet));
+    }
+}
+
+} // namespace
+
+TEST(TrafficShaperTest, UnlimitedPassesThrough) {
+    MPMC_PacketQueue queue(64);
+    fill(queue, 40, 1500);
+    ManualShaper shaper;
+    EXPECT_FALSE(shaper.limited());
+
+    std::vector<Packet> batch(32);
+    ShapedBatch result = shaper.dequeue_batch(queue, my_std::span<Packet>(batch));
+    EXPECT_EQ(result.count, 32);
+    EXPECT_EQ(result.delay.count(), 0);
+    EXPECT_EQ(shaper.dequeue_batch(queue, my_std::span<Packet>(batch)).count, 8);
+}
+
+TEST(TrafficShaperTest, PacketRateCapsBatches) {
+    MPMC_PacketQueue queue(1024);
+    fill(queue, 1000, 64);
+    ShaperConfig config;
+    config.packets_per_second = 1'000'000;  // One packet per microsecond
+    config.burst_packets = 10;
+    ManualShaper shaper(config);
+
+    std::vector<Packet> batch(32);
+    ShapedBatch result = shaper.dequeue_batch(queue, my_std::span<Packet>(batch));
+    EXPECT_EQ(result.count, 10);  // The burst
+    EXPECT_EQ(result.delay, std::chrono::microseconds(1));
+    for (size_t i = 0; i < 10; ++i) EXPECT_EQ(batch[i].id, i);
+
+    // Out of budget: nothing leaves and the ring is left alone
+    result = shaper.dequeue_batch(queue, my_std::span<Packet>(batch));
+    EXPECT_EQ(result.count, 0);
+    EXPECT_EQ(result.delay, std::chrono::microseconds(1));
+    EXPECT_EQ(queue.size(), 990);
+
+    // Sleeping for the reported delay admits exactly the refill
+    ManualClock::advance(std::chrono::microseconds(5));
+    EXPECT_EQ(shaper.dequeue_batch(queue, my_std::span<Packet>(batch)).count, 5);
+    EXPECT_EQ(batch[0].id, 10);
+
+    // The refill is capped at the burst
+    ManualClock::advance(std::chrono::seconds(1));
+    EXPECT_EQ(shaper.dequeue_batch(queue, my_std::span<Packet>(batch)).count, 10);
+
+    // Budget the ring could not use is refunded
+    MPMC_PacketQueue sparse(64);
+    fill(sparse, 3, 64);
+    ManualClock::advance(std::chrono::seconds(1));
+    result = shaper.dequeue_batch(sparse, my_std::span<Packet>(batch));
+    EXPECT_EQ(result.count, 3);
+    EXPECT_EQ(result.delay.count(), 0);
+    fill(sparse, 20, 64);
+    EXPECT_EQ(shaper.dequeue_batch(sparse, my_std::span<Packet>(batch)).count, 7);
+}
+
+TEST(TrafficShaperTest, ByteRateChargesPacketLengths) {
+    MPMC_PacketQueue queue(64);
+    fill(queue, 32, 1000);
+    ShaperConfig config;
+    config.bytes_per_second = 1'000'000'000;  // One byte per nanosecond
+    config.burst_bytes = 4000;
+    ManualShaper shaper(config);
+
+    // The first batch overruns the burst; the debt is paid back before the
+    // next one may leave
+    std::vector<Packet> batch(8);
+    ShapedBatch result = shaper.dequeue_batch(queue, my_std::span<Packet>(batch));
+    EXPECT_EQ(result.count, 8);
+    EXPECT_EQ(result.delay, std::chrono::nanoseconds(4001));
+    ManualClock::advance(std::chrono::nanoseconds(4000));
+    EXPECT_EQ(shaper.dequeue_batch(queue, my_std::span<Packet>(batch)).count, 0);
+    ManualClock::advance(std::chrono::nanoseconds(1));
+    EXPECT_EQ(shaper.dequeue_batch(queue, my_std::span<Packet>(batch)).count, 8);
+
+    // Over a long run the rate holds: 1 ms admits 1000 packets' worth of
+    // bytes, give or take the burst and one batch
+    MPMC_PacketQueue backlog(2048);
+    fill(backlog, 2000, 1000);
+    ManualClock::advance(std::chrono::nanoseconds(8000));
+    size_t sent = 0;
+    for (int step = 0; step < 1000; ++step) {
+        sent += shaper.dequeue_batch(backlog, my_std::span<Packet>(batch)).count;
+        ManualClock::advance(std::chrono::microseconds(1));
+    }
+    EXPECT_GE(sent, 1000 - 8);
+    EXPECT_LE(sent, 1000 + 4 + 8);
+}
+
+TEST(TrafficShaperTest, ConsumersShareOneBudget) {
+    MPMC_PacketQueue queue(4096);
+    fill(queue, 4000, 64);
+    ShaperConfig config;
+    config.packets_per_second = 1'000;
+    config.burst_packets = 500;
+    ManualShaper shaper(config);
+
+    std::atomic<size_t> taken{0};
+    std::vector<std::thread> consumers;
+    for (int c = 0; c < 4; ++c) {
+        consumers.emplace_back([&]() {
+            std::vector<Packet> batch(16);
+            for (int i = 0; i < 100; ++i) {
+                taken.fetch_add(shaper.dequeue_batch(queue, my_std::span<Packet>(batch)).count);
+            }
+        });
+    }
+    for (auto& t : consumers) t.join();
+    EXPECT_EQ(taken.load(), 500);  // Time stood still: exactly one burst
+    EXPECT_EQ(queue.size(), 3500);
+}
+
+TEST(TrafficShaperTest, PerLaneBudgets) {
+    PriorityPacketQueue queue(256);
+    for (size_t i = 0; i < 100; ++i) {
+        queue.enqueue(Packet(nullptr, 100, PacketPriority::Control, i));
+        queue.enqueue(Packet(nullptr, 100, PacketPriority::Low, 1000 + i));
+    }
+
+    std::array<ShaperConfig, PRIORITY_LANE_COUNT> lanes{};
+    lanes[static_cast<size_t>(PacketPriority::Control)].packets_per_second = 1'000'000;
+    lanes[static_cast<size_t>(PacketPriority::Control)].burst_packets = 4;
+    lanes[static_cast<size_t>(PacketPriority::Low)].packets_per_second = 100'000;
+    lanes[static_cast<size_t>(PacketPriority::Low)].burst_packets = 2;
+    BasicLaneShaper<ManualClock> shaper(lanes);
+
+    // Control's budget first, then Low's; the rest is left queued
+    std::vector<Packet> batch(32);
+    ShapedBatch result = shaper.dequeue_batch(queue, my_std::span<Packet>(batch));
+    EXPECT_EQ(result.count, 6);
+    EXPECT_EQ(batch[0].priority, PacketPriority::Control);
+    EXPECT_EQ(batch[5].priority, PacketPriority::Low);
+    EXPECT_EQ(result.delay, std::chrono::microseconds(1));  // Control refills first
+
+    ManualClock::advance(std::chrono::microseconds(10));
+    result = shaper.dequeue_batch(queue, my_std::span<Packet>(batch));
+    EXPECT_EQ(result.count, 4 + 1);
+    EXPECT_EQ(shaper.lane(PacketPriority::Low).packets_per_second(), 100'000);
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <thread>
+
+#if defined(__linux__)
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// Event count for parking threads until a queue changes state.
+//
+// Waiters register before re-checking their condition, so a notifier that
+// sees no registered waiter can skip the wake entirely: the fast path costs
+// one fence and two loads, never a syscall. The fence is a full barrier,
+// so queues only notify when their policy sets blocking = true. On Linux
+// waiters sleep on a futex; elsewhere std::atomic::wait (C++20) or a short
+// sleep loop is used.
+//
+// Waiter protocol:
+//   uint32_t key = event.prepare_wait();
+//   if (condition holds) { event.cancel_wait(); ... }
+//   else event.wait(key, deadline);   // then re-check the condition
+//
+// Callers that must not block a thread, such as coroutines, register an
+// AsyncWaiter instead. Waiters queue in FIFO order, and each notify_all()
+// unlinks only the oldest one and calls its notify() on the notifying
+// thread, so a notify costs the same however many are parked. A waiter
+// that still wants to wait registers again; one that consumed the state
+// change, and finds its condition still holds, passes the wake on with
+// notify_async_waiter(). Callbacks that notify in turn, e.g. by completing
+// a queue operation, are queued behind the current one rather than run
+// recursively.
+//
+// Async waiter protocol:
+//   event.add_async_waiter(waiter);
+//   if (condition holds) event.notify_async_waiter();
+//   // waiter.notify(&waiter) runs once, perhaps before that returns; the
+//   // caller must not touch waiter after add_async_waiter()
+//
+// Embed it on its own cache line; the epoch word is what sleepers watch.
+// An event in memory shared between processes must be constructed with
+// process_shared = true so the futex is keyed by the physical page; async
+// waiters are process-local and must not be used on such an event.
+struct AsyncWaiter {
+    AsyncWaiter* next = nullptr;
+    void (*notify)(AsyncWaiter*) noexcept = nullptr;
+};
+
+class WaitEvent {
+private:
+    std::atomic<uint32_t> epoch_{0};
+    std::atomic<uint32_t> waiters_{0};
+    // FIFO of async waiters. The list is only changed under async_lock_;
+    // async_head_ is atomic so notifiers can check it without the lock.
+    std::atomic<AsyncWaiter*> async_head_{nullptr};
+    AsyncWaiter* async_tail_ = nullptr;
+    std::atomic<bool> async_lock_{false};
+    const bool process_shared_ = false;
+
+#if defined(__linux__)
+    // Returns false only if the timeout expired
+    bool futex_wait(uint32_t key, const struct timespec* timeout) noexcept {
+        long rc = syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_),
+                          process_shared_ ? FUTEX_WAIT : FUTEX_WAIT_PRIVATE,
+                          key, timeout, nullptr, 0);
+        return !(rc != 0 && errno == ETIMEDOUT);
+    }
+
+    void futex_wake_all() noexcept {
+        syscall(SYS_futex, reinterpret_cast<uint32_t*>(&epoch_),
+                process_shared_ ? FUTEX_WAKE : FUTEX_WAKE_PRIVATE,
+                INT_MAX, nullptr, nullptr, 0);
+    }
+#endif
+
+    // Held for a few pointer updates only
+    void lock_async() noexcept {
+        while (async_lock_.exchange(true, std::memory_order_acquire)) {
+            while (async_lock_.load(std::memory_order_relaxed)) std::this_thread::yield();
+        }
+    }
+
+    void unlock_async() noexcept {
+        async_lock_.store(false, std::memory_order_release);
+    }
+
+public:
+    WaitEvent() = default;
+    explicit WaitEvent(bool process_shared) noexcept : process_shared_(process_shared) {}
+    WaitEvent(const WaitEvent&) = delete;
+    WaitEvent& operator=(const WaitEvent&) = delete;
+
+    // Register as a waiter and return the key to pass to wait()
+    uint32_t prepare_wait() noexcept {
+        waiters_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        return epoch_.load(std::memory_order_acquire);
+    }
+
+    // Unregister without sleeping, when the re-check succeeded
+    void cancel_wait() noexcept {
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Sleep until notified or the deadline passes. Returns false on timeout.
+    // Spurious wakeups are possible, so callers always re-check.
+    bool wait(uint32_t key, std::chrono::steady_clock::time_point deadline) noexcept {
+        bool notified = true;
+        while (epoch_.load(std::memory_order_acquire) == key) {
+            auto now = std::chrono::steady_clock::now();
+            if (now >= deadline) {
+                notified = false;
+                break;
+            }
+            auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now);
+#if defined(__linux__)
+            struct timespec ts;
+            ts.tv_sec = static_cast<time_t>(remaining.count() / 1000000000);
+            ts.tv_nsec = static_cast<long>(remaining.count() % 1000000000);
+            if (!futex_wait(key, &ts)) {
+                notified = epoch_.load(std::memory_order_acquire) != key;
+                break;
+            }
+#else
+            std::this_thread::sleep_for(std::min(remaining, std::chrono::nanoseconds(50000)));
+#endif
+        }
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+        return notified;
+    }
+
+    // Sleep until notified, with no timeout
+    void wait(uint32_t key) noexcept {
+        while (epoch_.load(std::memory_order_acquire) == key) {
+#if defined(__linux__)
+            futex_wait(key, nullptr);
+#elif defined(__cpp_lib_atomic_wait)
+            epoch_.wait(key, std::memory_order_acquire);
+#else
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+#endif
+        }
+        waiters_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    // Wake every sleeping thread and the oldest async waiter. Call after
+    // publishing the state change.
+    void notify_all() noexcept {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (async_head_.load(std::memory_order_relaxed) != nullptr) notify_async_waiter();
+        if (waiters_.load(std::memory_order_relaxed) == 0) return;
+        epoch_.fetch_add(1, std::memory_order_release);
+#if defined(__linux__)
+        futex_wake_all();
+#elif defined(__cpp_lib_atomic_wait)
+        epoch_.notify_all();
+#endif
+    }
+
+    // Register waiter for a later notify. The caller re-checks its
+    // condition afterwards, as after prepare_wait(); waiter must stay valid
+    // until its notify() has run.
+    void add_async_waiter(AsyncWaiter& waiter) noexcept {
+        waiter.next = nullptr;
+        lock_async();
+        if (async_tail_ != nullptr) {
+            async_tail_->next = &waiter;
+        } else {
+            async_head_.store(&waiter, std::memory_order_relaxed);
+        }
+        async_tail_ = &waiter;
+        unlock_async();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+    }
+
+    // Unlink the oldest async waiter, if any, and run its notify()
+    void notify_async_waiter() noexcept {
+        lock_async();
+        AsyncWaiter* waiter = async_head_.load(std::memory_order_relaxed);
+        if (waiter != nullptr) {
+            async_head_.store(waiter->next, std::memory_order_relaxed);
+            if (waiter->next == nullptr) async_tail_ = nullptr;
+        }
+        unlock_async();
+        if (waiter == nullptr) return;
+
+        // Waiters unlinked on this thread, by this call or a nested one
+        struct Pending {
+            AsyncWaiter* head = nullptr;
+            AsyncWaiter* tail = nullptr;
+            bool running = false;
+        };
+        static thread_local Pending pending;
+
+        waiter->next = nullptr;
+        if (pending.tail != nullptr) {
+            pending.tail->next = waiter;
+        } else {
+            pending.head = waiter;
+        }
+        pending.tail = waiter;
+        if (pending.running) return;
+
+        pending.running = true;
+        while (AsyncWaiter* next = pending.head) {
+            pending.head = next->next;
+            if (pending.head == nullptr) pending.tail = nullptr;
+            next->notify(next); // May free or re-register next
+        }
+        pending.running = false;
+    }
+
+    bool has_waiters() const noexcept {
+        return waiters_.load(std::memory_order_relaxed) != 0 ||
+               async_head_.load(std::memory_order_relaxed) != nullptr;
+    }
+};
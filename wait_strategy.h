@@ -0,0 +1,263 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#include <x86intrin.h>
+#endif
+
+#include "wait_event.h"
+
+// Single CPU pause/yield hint for spin loops
+inline void cpu_relax() noexcept {
+    #if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    __builtin_ia32_pause();
+    #elif defined(__aarch64__) || defined(_M_ARM64)
+    __asm__ __volatile__("yield" ::: "memory");
+    #endif
+}
+
+// Wait strategies decide what a queue operation does while it cannot make
+// progress. Pick one with the wait_strategy member of a queue policy.
+//
+// A strategy object lives for one operation, and the queue uses it in two ways:
+//   backoff();                     // lost a CAS race, retry soon
+//   backoff.wait(word, seen, ev);  // another thread owns a slot we have
+//                                  // reserved; return once word (a slot
+//                                  // sequence, of the policy's
+//                                  // sequence_type) != seen,
+//                                  // or earlier (the caller re-checks).
+//                                  // ev is notified after such updates.
+//   backoff.reset();               // progress was made
+//   backoff.stage();               // what the next call would do, for
+//                                  // tracing (optional)
+//
+// Exponential spinning caps at 2^MaxPauseShift pause instructions per call.
+
+namespace detail {
+
+inline void spin_pauses(unsigned shift) noexcept {
+    for (unsigned i = 0; i < (1u << shift); ++i) {
+        cpu_relax();
+    }
+}
+
+// Strategies whose slot waits sleep on the queue's WaitEvent declare
+// parks_on_event = true; only blocking queues notify those events
+template <typename Wait, typename = void>
+struct parks_on_event : std::false_type {};
+
+template <typename Wait>
+struct parks_on_event<Wait, std::enable_if_t<Wait::parks_on_event>> : std::true_type {};
+
+} // namespace detail
+
+// Most expensive thing a strategy's next call may do
+enum class WaitStage : uint8_t {
+    Spin,
+    Yield,
+    Park   // Sleep, futex park or TPAUSE/UMWAIT
+};
+
+// The original queue behaviour: spin with exponentially more pauses, then
+// yield, then sleep 1us at a time. Suits mixed workloads.
+template <unsigned MaxSpins = 16, unsigned MaxYields = 64>
+class BackoffWait {
+    unsigned count_ = 0;
+
+public:
+    void operator()() noexcept {
+        if (count_ < MaxSpins) {
+            detail::spin_pauses(count_);
+            ++count_;
+        } else if (count_ < MaxSpins + MaxYields) {
+            std::this_thread::yield();
+            ++count_;
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(1));
+        }
+    }
+
+    template <typename Word>
+    void wait(const std::atomic<Word>&, Word, WaitEvent&) noexcept {
+        (*this)();
+    }
+
+    void reset() noexcept { count_ = 0; }
+
+    WaitStage stage() const noexcept {
+        if (count_ < MaxSpins) return WaitStage::Spin;
+        return count_ < MaxSpins + MaxYields ? WaitStage::Yield : WaitStage::Park;
+    }
+};
+
+// Never leaves the CPU. For dedicated busy-poll cores.
+template <unsigned MaxPauseShift = 6>
+class BusySpinWait {
+    unsigned shift_ = 0;
+
+public:
+    void operator()() noexcept {
+        detail::spin_pauses(shift_);
+        if (shift_ < MaxPauseShift) ++shift_;
+    }
+
+    template <typename Word>
+    void wait(const std::atomic<Word>&, Word, WaitEvent&) noexcept {
+        (*this)();
+    }
+
+    void reset() noexcept { shift_ = 0; }
+
+    WaitStage stage() const noexcept { return WaitStage::Spin; }
+};
+
+// Spin for a few rounds, then yield on every call. Never sleeps.
+template <unsigned Spins = 8, unsigned MaxPauseShift = 6>
+class SpinYieldWait {
+    unsigned count_ = 0;
+
+public:
+    void operator()() noexcept {
+        if (count_ < Spins) {
+            detail::spin_pauses(count_ < MaxPauseShift ? count_ : MaxPauseShift);
+            ++count_;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    template <typename Word>
+    void wait(const std::atomic<Word>&, Word, WaitEvent&) noexcept {
+        (*this)();
+    }
+
+    void reset() noexcept { count_ = 0; }
+
+    WaitStage stage() const noexcept {
+        return count_ < Spins ? WaitStage::Spin : WaitStage::Yield;
+    }
+};
+
+// Spin for a few rounds, then park. Slot waits sleep on the queue's
+// WaitEvent, which the other side notifies after each slot update, for at
+// most ParkMicros. Races with nothing to wait for yield instead.
+// For shared-tenant services where idle cores must go back to the OS.
+// Needs a policy with blocking = true.
+template <unsigned Spins = 8, unsigned ParkMicros = 1000, unsigned MaxPauseShift = 6>
+class SpinParkWait {
+    unsigned count_ = 0;
+
+public:
+    static constexpr bool parks_on_event = true;
+
+    void operator()() noexcept {
+        if (count_ < Spins) {
+            detail::spin_pauses(count_ < MaxPauseShift ? count_ : MaxPauseShift);
+            ++count_;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+
+    template <typename Word>
+    void wait(const std::atomic<Word>& word, Word seen, WaitEvent& event) noexcept {
+        if (count_ < Spins) {
+            (*this)();
+            return;
+        }
+        uint32_t key = event.prepare_wait();
+        if (word.load(std::memory_order_acquire) != seen) {
+            event.cancel_wait();
+            return;
+        }
+        event.wait(key, std::chrono::steady_clock::now() + std::chrono::microseconds(ParkMicros));
+    }
+
+    void reset() noexcept { count_ = 0; }
+
+    // Slot waits park from here on; plain retries yield
+    WaitStage stage() const noexcept {
+        return count_ < Spins ? WaitStage::Spin : WaitStage::Park;
+    }
+};
+
+// x86 WAITPKG: parks the core in a light C0.1 sleep with no system call.
+// Slot waits UMONITOR the slot's sequence word and UMWAIT until it is
+// written or TscCycles pass; races TPAUSE for TscCycles. On CPUs without
+// WAITPKG (checked once at runtime) it behaves like SpinYieldWait.
+template <uint64_t TscCycles = 10000, unsigned Spins = 4>
+class UmwaitWait {
+    unsigned count_ = 0;
+    SpinYieldWait<Spins> fallback_;
+
+#if defined(__x86_64__) || defined(__i386__)
+    static bool has_waitpkg() noexcept {
+        static const bool supported = [] {
+            unsigned eax, ebx, ecx, edx;
+            if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) return false;
+            return (ecx & (1u << 5)) != 0;
+        }();
+        return supported;
+    }
+
+    __attribute__((target("waitpkg")))
+    static void tpause() noexcept {
+        _tpause(1, __rdtsc() + TscCycles);
+    }
+
+    template <typename Word>
+    __attribute__((target("waitpkg")))
+    static void umwait(const std::atomic<Word>& word, Word seen) noexcept {
+        _umonitor(const_cast<std::atomic<Word>*>(&word));
+        if (word.load(std::memory_order_acquire) == seen) {
+            _umwait(1, __rdtsc() + TscCycles);
+        }
+    }
+#else
+    static bool has_waitpkg() noexcept { return false; }
+    static void tpause() noexcept {}
+    template <typename Word>
+    static void umwait(const std::atomic<Word>&, Word) noexcept {}
+#endif
+
+public:
+    void operator()() noexcept {
+        if (!has_waitpkg()) {
+            fallback_();
+            return;
+        }
+        if (count_ < Spins) {
+            detail::spin_pauses(count_);
+            ++count_;
+        } else {
+            tpause();
+        }
+    }
+
+    template <typename Word>
+    void wait(const std::atomic<Word>& word, Word seen, WaitEvent& event) noexcept {
+        if (!has_waitpkg()) {
+            fallback_.wait(word, seen, event);
+            return;
+        }
+        umwait(word, seen);
+    }
+
+    void reset() noexcept {
+        count_ = 0;
+        fallback_.reset();
+    }
+
+    WaitStage stage() const noexcept {
+        if (!has_waitpkg()) return fallback_.stage();
+        return count_ < Spins ? WaitStage::Spin : WaitStage::Park;
+    }
+};
@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "mpmc_packet_queue.h"
+#include "priority_packet_queue.h"
+
+// Configuration for WorkStealingPacketScheduler
+struct WorkStealingConfig {
+    size_t worker_count = 1;
+
+    // Capacity of each priority lane of each worker
+    size_t lane_capacity = 1024;
+
+    // NUMA node of each worker, used to order steal victims (same node
+    // first). Empty means every worker is on one node.
+    std::vector<int> worker_nodes;
+
+    // Allocate every worker's rings on its worker_nodes entry
+    bool place_on_nodes = false;
+
+    // Upper bound on one steal, and the backlog a victim needs before it is
+    // robbed. A steal takes half the victim's lane, rounded up.
+    size_t max_steal = 32;
+    size_t min_victim_backlog = 1;
+
+    StatsMode stats_mode = StatsMode::Disabled;
+};
+
+// Per-core packet rings with work stealing.
+//
+// Every worker owns one ring per PacketPriority and normally drains only its
+// own rings (highest priority first), so in steady state each ring's head
+// line is touched by one core and there is no global hotspot. A worker that
+// finds its rings empty steals half of some victim's backlog with a single
+// dequeue_batch. Victims are tried highest lane first; within a lane,
+// workers on the thief's NUMA node come before remote ones, and each thief
+// starts at its right-hand neighbour so thieves spread over victims. Idle
+// polls read each lane's occupancy hint, which the owner only refreshes
+// every occupancy_hint_interval operations, so a victim with a real
+// backlog is found without touching its head and tail lines. Only lanes
+// whose hint reads below min_victim_backlog are checked with size().
+//
+// The rings are multi-consumer, since thieves dequeue from them too. The
+// owner's dequeue_batch rarely loses a CAS, though: thieves only show up when
+// they are idle. A stolen packet may be processed before packets of the
+// same flow on another worker, so flows that need strict ordering should not
+// go through stealable lanes.
+class WorkStealingPacketScheduler {
+private:
+    struct Worker {
+        std::array<std::unique_ptr<MPMC_PacketQueue>, PRIORITY_LANE_COUNT> lanes;
+        std::vector<uint32_t> victims;  // Steal order
+        int node = 0;
+        alignas(CACHE_LINE_SIZE) std::atomic<uint64_t> steals{0};
+        std::atomic<uint64_t> stolen_packets{0};
+    };
+
+    std::vector<std::unique_ptr<Worker>> workers_;
+    const size_t max_steal_;
+    const size_t min_victim_backlog_;
+
+    static size_t lane_index(PacketPriority priority) noexcept {
+        return static_cast<size_t>(priority) & (PRIORITY_LANE_COUNT - 1);
+    }
+
+    void build_steal_orders() {
+        const size_t n = workers_.size();
+        for (size_t thief = 0; thief < n; ++thief) {
+            std::vector<uint32_t>& victims = workers_[thief]->victims;
+            for (size_t step = 1; step < n; ++step) {
+                victims.push_back(static_cast<uint32_t>((thief + step) % n));
+            }
+            // Local node first; ring distance order is kept within each group
+            int node = workers_[thief]->node;
+            std::stable_partition(victims.begin(), victims.end(), [&](uint32_t v) {
+                return workers_[v]->node == node;
+            });
+        }
+    }
+
+public:
+    explicit WorkStealingPacketScheduler(const WorkStealingConfig& config)
+        : max_steal_(config.max_steal),
+          min_victim_backlog_(std::max<size_t>(config.min_victim_backlog, 1)) {
+        if (config.worker_count == 0) {
+            throw std::invalid_argument("Worker count must be greater than 0");
+        }
+        if (!config.worker_nodes.empty() && config.worker_nodes.size() != config.worker_count) {
+            throw std::invalid_argument("worker_nodes must have one entry per worker");
+        }
+        if (config.max_steal == 0) {
+            throw std::invalid_argument("max_steal must be greater than 0");
+        }
+
+        workers_.reserve(config.worker_count);
+        for (size_t w = 0; w < config.worker_count; ++w) {
+            auto worker = std::make_unique<Worker>();
+            worker->node = config.worker_nodes.empty() ? 0 : config.worker_nodes[w];
+            for (auto& lane : worker->lanes) {
+                if (config.place_on_nodes && !config.worker_nodes.empty()) {
+                    MemoryRegionOptions placement;
+                    placement.huge_pages = false;
+                    placement.numa_node = worker->node;
+                    lane = std::make_unique<MPMC_PacketQueue>(config.lane_capacity,
+                                                              config.stats_mode, placement);
+                } else {
+                    lane = std::make_unique<MPMC_PacketQueue>(config.lane_capacity,
+                                                              config.stats_mode);
+                }
+            }
+            workers_.push_back(std::move(worker));
+        }
+        build_steal_orders();
+    }
+
+    WorkStealingPacketScheduler(const WorkStealingPacketScheduler&) = delete;
+    WorkStealingPacketScheduler& operator=(const WorkStealingPacketScheduler&) = delete;
+    WorkStealingPacketScheduler(WorkStealingPacketScheduler&&) = delete;
+    WorkStealingPacketScheduler& operator=(WorkStealingPacketScheduler&&) = delete;
+
+    ~WorkStealingPacketScheduler() = default;
+
+    // Hand a packet to worker's lane for packet.priority
+    bool submit(size_t worker, const Packet& packet) noexcept {
+        return workers_[worker]->lanes[lane_index(packet.priority)]->enqueue(packet);
+    }
+
+    bool submit(size_t worker, Packet&& packet) noexcept {
+        MPMC_PacketQueue& lane = *workers_[worker]->lanes[lane_index(packet.priority)];
+        return lane.enqueue(std::move(packet));
+    }
+
+    // Hand a burst to one worker, one batch per run of equal priority.
+    // Stops at the first packet whose lane is full and returns the accepted
+    // prefix length.
+    size_t submit_batch(size_t worker, my_std::span<const Packet> packets) noexcept {
+        Worker& target = *workers_[worker];
+        size_t submitted = 0;
+        while (submitted < packets.size()) {
+            PacketPriority priority = packets[submitted].priority;
+            size_t run = 1;
+            while (submitted + run < packets.size() &&
+                   packets[submitted + run].priority == priority) {
+                ++run;
+            }
+
+            size_t accepted = target.lanes[lane_index(priority)]->enqueue_batch(
+                packets.subspan(submitted, run));
+            submitted += accepted;
+            if (accepted < run) break;
+        }
+        return submitted;
+    }
+
+    // Worker's main loop call: drain its own lanes highest priority first,
+    // and steal only if they are all empty
+    size_t poll(size_t worker, my_std::span<Packet> packets) noexcept {
+        if (packets.empty()) return 0;
+
+        Worker& self = *workers_[worker];
+        size_t got = 0;
+        for (size_t p = PRIORITY_LANE_COUNT; p-- > 0 && got < packets.size();) {
+            got += self.lanes[p]->dequeue_batch(packets.subspan(got));
+        }
+        return got != 0 ? got : steal(worker, packets);
+    }
+
+    // Take half of one victim's backlog (at most max_steal packets) into
+    // packets. Returns the number stolen, 0 if no victim had enough. The
+    // backlog comes from approx_size(), which can lag a racing owner; the
+    // dequeue_batch then just takes what is really there.
+    size_t steal(size_t thief, my_std::span<Packet> packets) noexcept {
+        if (packets.empty()) return 0;
+
+        Worker& self = *workers_[thief];
+        size_t limit = std::min(packets.size(), max_steal_);
+        for (size_t p = PRIORITY_LANE_COUNT; p-- > 0;) {
+            for (uint32_t v : self.victims) {
+                MPMC_PacketQueue& lane = *workers_[v]->lanes[p];
+                size_t backlog = lane.approx_size();
+                if (backlog < min_victim_backlog_) {
+                    // A backlog smaller than the hint interval can read as
+                    // empty; only then look at the indexes
+                    backlog = lane.size();
+                    if (backlog < min_victim_backlog_ || backlog > lane.capacity()) continue;
+                }
+
+                size_t take = std::min(limit, (backlog + 1) / 2);
+                size_t got = lane.dequeue_batch(packets.first(take));
+                if (got != 0) {
+                    self.steals.fetch_add(1, std::memory_order_relaxed);
+                    self.stolen_packets.fetch_add(got, std::memory_order_relaxed);
+                    return got;
+                }
+            }
+        }
+        return 0;
+    }
+
+    // Queue state queries
+    size_t worker_count() const noexcept {
+        return workers_.size();
+    }
+
+    size_t worker_size(size_t worker) const noexcept {
+        size_t total = 0;
+        for (const auto& lane : workers_[worker]->lanes) total += lane->size();
+        return total;
+    }
+
+    size_t size() const noexcept {
+        size_t total = 0;
+        for (size_t w = 0; w < workers_.size(); ++w) total += worker_size(w);
+        return total;
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    int worker_node(size_t worker) const noexcept {
+        return workers_[worker]->node;
+    }
+
+    // Victims in the order worker tries them
+    const std::vector<uint32_t>& steal_order(size_t worker) const noexcept {
+        return workers_[worker]->victims;
+    }
+
+    // Successful steals by worker, and the packets they moved
+    uint64_t steal_count(size_t worker) const noexcept {
+        return workers_[worker]->steals.load(std::memory_order_relaxed);
+    }
+
+    uint64_t stolen_packets(size_t worker) const noexcept {
+        return workers_[worker]->stolen_packets.load(std::memory_order_relaxed);
+    }
+
+    // Direct access to one worker lane, e.g. for per-lane statistics
+    MPMC_PacketQueue& lane(size_t worker, PacketPriority priority) noexcept {
+        return *workers_[worker]->lanes[lane_index(priority)];
+    }
+
+    // Memory usage estimation
+    size_t memory_usage() const noexcept {
+        size_t total = sizeof(*this);
+        for (const auto& worker : workers_) {
+            total += sizeof(Worker) + worker->victims.capacity() * sizeof(uint32_t);
+            for (const auto& lane : worker->lanes) total += lane->memory_usage();
+        }
+        return total;
+    }
+};
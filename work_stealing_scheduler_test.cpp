@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <set>
+#include "work_stealing_scheduler.h"
+
+namespace {
+
+Packet make_packet(size_t id, PacketPriority priority) {
+    Packet packet(id);
+    packet.priority = priority;
+    return packet;
+}
+
+WorkStealingConfig make_config(size_t workers, size_t lane_capacity) {
+    WorkStealingConfig config;
+    config.worker_count = workers;
+    config.lane_capacity = lane_capacity;
+    return config;
+}
+
+} // namespace
+
+TEST(WorkStealingPacketSchedulerTest, OwnerDrainsByPriority) {
+    WorkStealingPacketScheduler scheduler(make_config(2, 16));
+
+    EXPECT_TRUE(scheduler.submit(0, make_packet(1, PacketPriority::Low)));
+    EXPECT_TRUE(scheduler.submit(0, make_packet(2, PacketPriority::Control)));
+    EXPECT_TRUE(scheduler.submit(0, make_packet(3, PacketPriority::High)));
+    EXPECT_EQ(scheduler.worker_size(0), 3);
+    EXPECT_EQ(scheduler.size(), 3);
+
+    std::vector<Packet> out(8);
+    ASSERT_EQ(scheduler.poll(0, my_std::span<Packet>(out)), 3);
+    EXPECT_EQ(out[0].id, 2);
+    EXPECT_EQ(out[1].id, 3);
+    EXPECT_EQ(out[2].id, 1);
+    EXPECT_EQ(scheduler.steal_count(0), 0);
+    EXPECT_TRUE(scheduler.empty());
+
+    EXPECT_THROW(WorkStealingPacketScheduler(make_config(0, 16)), std::invalid_argument);
+}
+
+TEST(WorkStealingPacketSchedulerTest, IdleWorkerStealsHalf) {
+    WorkStealingPacketScheduler scheduler(make_config(2, 64));
+
+    std::vector<Packet> burst;
+    for (size_t i = 0; i < 20; ++i) burst.push_back(make_packet(i, PacketPriority::Low));
+    EXPECT_EQ(scheduler.submit_batch(0, my_std::span<const Packet>(burst)), 20);
+
+    std::vector<Packet> out(32);
+    EXPECT_EQ(scheduler.poll(1, my_std::span<Packet>(out)), 10);
+    EXPECT_EQ(out[0].id, 0);
+    EXPECT_EQ(scheduler.steal_count(1), 1);
+    EXPECT_EQ(scheduler.stolen_packets(1), 10);
+    EXPECT_EQ(scheduler.worker_size(0), 10);
+
+    // A single leftover packet is still stolen
+    WorkStealingPacketScheduler small(make_config(2, 8));
+    EXPECT_TRUE(small.submit(1, make_packet(7, PacketPriority::Medium)));
+    EXPECT_EQ(small.steal(0, my_std::span<Packet>(out)), 1);
+    EXPECT_EQ(out[0].id, 7);
+    EXPECT_EQ(small.steal(0, my_std::span<Packet>(out)), 0);
+}
+
+TEST(WorkStealingPacketSchedulerTest, StealOrderPrefersLocalNodeAndPriority) {
+    WorkStealingConfig config = make_config(4, 16);
+    config.worker_nodes = {0, 1, 0, 1};
+    WorkStealingPacketScheduler scheduler(config);
+
+    EXPECT_EQ(scheduler.steal_order(0), (std::vector<uint32_t>{2, 1, 3}));
+    EXPECT_EQ(scheduler.steal_order(1), (std::vector<uint32_t>{3, 2, 0}));
+    EXPECT_EQ(scheduler.worker_node(3), 1);
+
+    // Low backlog on the local node, High backlog on a remote node: the
+    // higher lane wins
+    EXPECT_TRUE(scheduler.submit(2, make_packet(1, PacketPriority::Low)));
+    EXPECT_TRUE(scheduler.submit(1, make_packet(2, PacketPriority::High)));
+    std::vector<Packet> out(4);
+    ASSERT_EQ(scheduler.steal(0, my_std::span<Packet>(out)), 1);
+    EXPECT_EQ(out[0].id, 2);
+
+    // Same lane on both nodes: the local victim wins
+    EXPECT_TRUE(scheduler.submit(3, make_packet(3, PacketPriority::Low)));
+    ASSERT_EQ(scheduler.steal(0, my_std::span<Packet>(out)), 1);
+    EXPECT_EQ(out[0].id, 1);
+
+    config.worker_nodes = {0, 1};
+    EXPECT_THROW(WorkStealingPacketScheduler bad(config), std::invalid_argument);
+}
+
+TEST(WorkStealingPacketSchedulerTest, AllPacketsProcessedOnce) {
+    constexpr size_t num_workers = 4;
+    constexpr size_t num_packets = 20000;
+    WorkStealingPacketScheduler scheduler(make_config(num_workers, 1024));
+
+    std::atomic<size_t> processed{0};
+    std::vector<std::set<size_t>> seen(num_workers);
+    std::vector<std::thread> workers;
+    for (size_t w = 0; w < num_workers; ++w) {
+        workers.emplace_back([&, w]() {
+            std::vector<Packet> batch(32);
+            while (processed.load() < num_packets) {
+                size_t n = scheduler.poll(w, my_std::span<Packet>(batch));
+                if (n == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (size_t i = 0; i < n; ++i) seen[w].insert(batch[i].id);
+                processed.fetch_add(n);
+            }
+        });
+    }
+
+    // Skewed load: everything goes to worker 0
+    for (size_t i = 0; i < num_packets; ++i) {
+        Packet packet = make_packet(i, static_cast<PacketPriority>(i % PRIORITY_LANE_COUNT));
+        while (!scheduler.submit(0, packet)) {
+            std::this_thread::yield();
+        }
+    }
+    for (auto& t : workers) t.join();
+
+    std::set<size_t> all;
+    for (const auto& ids : seen) {
+        for (size_t id : ids) {
+            EXPECT_TRUE(all.insert(id).second) << "Packet " << id << " processed twice";
+        }
+    }
+    EXPECT_EQ(all.size(), num_packets);
+    EXPECT_TRUE(scheduler.empty());
+}